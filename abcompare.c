@@ -0,0 +1,595 @@
+// abcompare.c
+// Replays the same captures through two profiles side by side and reports
+// what changes before a profile is rolled out: emitted events, key chatter,
+// cursor travel, response delay to stick onsets and per-stage CPU cost, plus
+// the time windows where the two outputs diverge the most.
+// Compile: make abcompare
+// Run: ./abcompare A B FILE.xcap...
+//      A and B are each: default             keymapping.h as built
+//                        FILE.profile[:NAME] text profile (first one if no NAME)
+//                        FILE.xprof[:NAME]   compiled profile file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "gip.h"
+#include "gip_protocol.h"
+#include "capture.h"
+#include "mapper.h"
+#include "keymapping.h"
+#include "calibration.h"
+#include "profile.h"
+
+// Same output tick and epoch as xbox_replay
+#define TICK_NS             10000000ull
+#define REPLAY_EPOCH_NS     1000000000ull
+
+#define CHATTER_NS          50000000ull     // Release → press of the same key within this is chatter
+#define REST_MAGNITUDE      4000            // Raw stick radius counted as "at rest"
+#define ONSET_MAGNITUDE     12000           // Leaving rest past this is a stick onset
+#define ONSET_WINDOW_NS     300000000ull    // No response within this → counted as missed
+#define WINDOW_NS           250000000ull    // Divergence report granularity
+#define TOP_WINDOWS         5
+
+#define TIMING_RUNS         5
+#define TIMING_MIN_PACKETS  200000
+
+typedef struct {
+    CaptureRecord *records;
+    int count;
+    uint64_t duration_ns;
+} Corpus;
+
+// Output of one side within one WINDOW_NS slice
+typedef struct {
+    int key_events;
+    int button_events;
+    float dx, dy;
+} WindowStats;
+
+typedef struct {
+    uint64_t start_ns;          // 0 = no onset pending
+    bool responded;
+} Onset;
+
+typedef struct {
+    const char *label;
+    CompiledProfile profile;
+    Mapper mapper;
+    OutputActions actions;
+    uint64_t last_ns;
+
+    uint64_t key_presses;
+    uint64_t key_releases;
+    uint64_t button_events;
+    uint64_t moves;
+    uint64_t chatter;
+    double travel;
+    uint64_t last_release_ns[256];  // Per keycode, for chatter
+
+    Onset onsets[2];            // Left, right stick
+    uint64_t onset_count;
+    uint64_t onset_missed;
+    double onset_delay_total_ns;
+
+    WindowStats *windows;
+    double stage_ns[3];         // decode, map, tick: fastest run, per packet / per tick
+    double stage_noise_ns[3];   // Slowest run minus fastest
+} Side;
+
+enum { STAGE_DECODE, STAGE_MAP, STAGE_TICK };
+
+// ============================================================================
+// Loading
+// ============================================================================
+
+static bool corpus_load(Corpus *corpus, const char *path) {
+    CaptureReader reader;
+    if (!capture_reader_open(&reader, path)) {
+        printf("❌ %s is not a capture file\n", path);
+        return false;
+    }
+
+    int result;
+    CaptureRecord record;
+    while ((result = capture_read(&reader, &record)) == 1) {
+        if (record.direction != CAPTURE_DIR_IN) {
+            continue;
+        }
+        if ((corpus->count & (corpus->count - 1)) == 0) {
+            int capacity = corpus->count ? corpus->count * 2 : 1024;
+            CaptureRecord *grown = realloc(corpus->records, capacity * sizeof(*grown));
+            if (!grown) {
+                capture_reader_close(&reader);
+                return false;
+            }
+            corpus->records = grown;
+        }
+        record.timestamp_ns += corpus->duration_ns;
+        corpus->records[corpus->count++] = record;
+    }
+    capture_reader_close(&reader);
+
+    if (result < 0) {
+        printf("⚠️  %s is truncated after %llu records\n", path, (unsigned long long)reader.records);
+    }
+    if (corpus->count > 0) {
+        corpus->duration_ns = corpus->records[corpus->count - 1].timestamp_ns + TICK_NS;
+    }
+    return true;
+}
+
+static bool ends_with(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+// "default", "FILE.profile[:NAME]" or "FILE.xprof[:NAME]" → compiled profile
+static bool load_profile(const char *spec, CompiledProfile *out) {
+    if (strcmp(spec, "default") == 0) {
+        ControllerMapping config = get_default_mapping();
+        mapper_compile_profile(&config, NULL, out);
+        return true;
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s", spec);
+    const char *name = NULL;
+    char *colon = strrchr(path, ':');
+    if (colon) {
+        *colon = '\0';
+        name = colon + 1;
+    }
+    char error[256];
+
+    if (ends_with(path, ".xprof")) {
+        ProfileFile file;
+        if (!profile_file_map(&file, path, error, sizeof(error))) {
+            printf("❌ %s\n", error);
+            return false;
+        }
+        int index = name ? profile_file_find(&file, name) : 0;
+        if (index < 0) {
+            printf("❌ No profile [%s] in %s\n", name, path);
+            profile_file_unmap(&file);
+            return false;
+        }
+        *out = *profile_file_get(&file, index);
+        profile_file_unmap(&file);
+        return true;
+    }
+
+    static ProfileSource sources[PROFILE_MAX_PROFILES];
+    int count = profile_parse_file(path, sources, PROFILE_MAX_PROFILES, error, sizeof(error));
+    if (count < 0) {
+        printf("❌ %s\n", error);
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (name && strcmp(sources[i].name, name) != 0) {
+            continue;
+        }
+        // Same calibration profilec would bake in
+        StickCalibration calibration;
+        bool calibrated = sources[i].calibration_serial[0] &&
+                          calibration_load(sources[i].calibration_serial, &calibration);
+        profile_source_compile(&sources[i], calibrated ? &calibration : NULL, out);
+        return true;
+    }
+    printf("❌ No profile [%s] in %s\n", name ? name : "", path);
+    return false;
+}
+
+// ============================================================================
+// Side-by-side Replay
+// ============================================================================
+
+static bool stick_owns_key(const CompiledStick *stick, uint16_t code) {
+    return (stick->mode == STICK_MODE_WASD || stick->mode == STICK_MODE_ARROWS) &&
+           (code == stick->key_up || code == stick->key_down ||
+            code == stick->key_left || code == stick->key_right);
+}
+
+static bool stick_is_pointer(const CompiledStick *stick) {
+    return stick->mode == STICK_MODE_MOUSE || stick->mode == STICK_MODE_KINETIC;
+}
+
+// Does this action answer a pending onset of the given stick?
+static bool answers_onset(const Side *side, int stick, const OutputAction *action) {
+    const CompiledStick *cs = stick == 0 ? &side->profile.left_stick : &side->profile.right_stick;
+    if (action->type == OUTPUT_KEY) {
+        return action->pressed && stick_owns_key(cs, action->code);
+    }
+    if (action->type == OUTPUT_MOUSE_MOVE) {
+        // Both pointer sticks feed one cursor; credit the stick that is pending
+        return stick_is_pointer(cs) && (action->dx != 0.0f || action->dy != 0.0f);
+    }
+    return false;
+}
+
+static void account(Side *side, uint64_t now_ns, uint64_t start_ns) {
+    WindowStats *window = &side->windows[(now_ns - start_ns) / WINDOW_NS];
+
+    for (int i = 0; i < side->actions.count; i++) {
+        const OutputAction *action = &side->actions.actions[i];
+        switch (action->type) {
+            case OUTPUT_KEY: {
+                uint8_t code = (uint8_t)action->code;
+                if (action->pressed) {
+                    side->key_presses++;
+                    if (side->last_release_ns[code] && now_ns - side->last_release_ns[code] < CHATTER_NS) {
+                        side->chatter++;
+                    }
+                } else {
+                    side->key_releases++;
+                    side->last_release_ns[code] = now_ns;
+                }
+                window->key_events++;
+                break;
+            }
+            case OUTPUT_MOUSE_BUTTON:
+                side->button_events++;
+                window->button_events++;
+                break;
+            case OUTPUT_MOUSE_MOVE:
+                side->moves++;
+                side->travel += hypotf(action->dx, action->dy);
+                window->dx += action->dx;
+                window->dy += action->dy;
+                break;
+        }
+
+        for (int stick = 0; stick < 2; stick++) {
+            Onset *onset = &side->onsets[stick];
+            if (onset->start_ns && !onset->responded && answers_onset(side, stick, action)) {
+                onset->responded = true;
+                side->onset_delay_total_ns += (double)(now_ns - onset->start_ns);
+            }
+        }
+    }
+}
+
+static void track_onsets(Side *side, const GipInputPacket *input, const float *previous, uint64_t now_ns) {
+    float magnitude[2] = {
+        hypotf(input->left_stick_x, input->left_stick_y),
+        hypotf(input->right_stick_x, input->right_stick_y),
+    };
+    const CompiledStick *sticks[2] = { &side->profile.left_stick, &side->profile.right_stick };
+
+    for (int stick = 0; stick < 2; stick++) {
+        Onset *onset = &side->onsets[stick];
+        if (onset->start_ns && now_ns - onset->start_ns > ONSET_WINDOW_NS) {
+            side->onset_missed += !onset->responded;
+            onset->start_ns = 0;
+        }
+        if (sticks[stick]->mode == STICK_MODE_DISABLED) {
+            continue;
+        }
+        if (previous[stick] < REST_MAGNITUDE && magnitude[stick] >= ONSET_MAGNITUDE && !onset->start_ns) {
+            onset->start_ns = now_ns;
+            onset->responded = false;
+            side->onset_count++;
+        }
+    }
+}
+
+static void replay_sides(const Corpus *corpus, Side *sides) {
+    float previous[2] = { 0.0f, 0.0f };
+
+    for (int s = 0; s < 2; s++) {
+        mapper_init(&sides[s].mapper, &sides[s].profile);
+        sides[s].last_ns = REPLAY_EPOCH_NS;
+    }
+
+    for (int i = 0; i < corpus->count; i++) {
+        const CaptureRecord *record = &corpus->records[i];
+        uint64_t now_ns = REPLAY_EPOCH_NS + record->timestamp_ns;
+        const GipInputPacket *input = gip_decode_input(record->data, record->length);
+
+        for (int s = 0; s < 2; s++) {
+            Side *side = &sides[s];
+            while (mapper_tick_pending(&side->mapper) && now_ns - side->last_ns > TICK_NS) {
+                side->last_ns += TICK_NS;
+                mapper_tick(&side->mapper, side->last_ns, &side->actions);
+                account(side, side->last_ns, REPLAY_EPOCH_NS);
+            }
+            side->last_ns = now_ns;
+            if (input) {
+                track_onsets(side, input, previous, now_ns);
+                mapper_process(&side->mapper, input, now_ns, &side->actions);
+                account(side, now_ns, REPLAY_EPOCH_NS);
+            }
+        }
+        if (input) {
+            previous[0] = hypotf(input->left_stick_x, input->left_stick_y);
+            previous[1] = hypotf(input->right_stick_x, input->right_stick_y);
+        }
+    }
+
+    for (int s = 0; s < 2; s++) {
+        while (mapper_release_all(&sides[s].mapper, &sides[s].actions) > 0) {
+            account(&sides[s], sides[s].last_ns, REPLAY_EPOCH_NS);
+        }
+        for (int stick = 0; stick < 2; stick++) {
+            if (sides[s].onsets[stick].start_ns && !sides[s].onsets[stick].responded) {
+                sides[s].onset_missed++;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Per-stage CPU Cost
+// ============================================================================
+
+static uint64_t bench_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Inputs decoded once, so the map passes time the mapper alone
+typedef struct {
+    GipInputPacket *inputs;
+    uint64_t *now_ns;
+    int count;
+    int passes;                 // Corpus passes per timed run, TIMING_MIN_PACKETS or more
+} TimingCorpus;
+
+static volatile uint32_t timing_sink;   // Keeps the decode pass from being optimized away
+
+static uint64_t time_decode(const Corpus *corpus, int passes) {
+    uint32_t decoded = 0;
+    uint64_t start = bench_clock_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        for (int i = 0; i < corpus->count; i++) {
+            decoded += gip_decode_input(corpus->records[i].data, corpus->records[i].length) != NULL;
+        }
+    }
+    uint64_t elapsed = bench_clock_ns() - start;
+    timing_sink += decoded;
+    return elapsed;
+}
+
+// Packets only, or packets plus the output ticks between them as in the replay
+static uint64_t time_map(const TimingCorpus *timing, const CompiledProfile *profile, bool ticks,
+                         uint64_t *tick_count) {
+    static Mapper mapper;
+    static OutputActions actions;
+    uint64_t count = 0;
+
+    uint64_t start = bench_clock_ns();
+    for (int pass = 0; pass < timing->passes; pass++) {
+        uint64_t last_ns = REPLAY_EPOCH_NS;
+        mapper_init(&mapper, profile);
+        for (int i = 0; i < timing->count; i++) {
+            uint64_t now_ns = timing->now_ns[i];
+            while (ticks && mapper_tick_pending(&mapper) && now_ns - last_ns > TICK_NS) {
+                last_ns += TICK_NS;
+                mapper_tick(&mapper, last_ns, &actions);
+                count++;
+            }
+            last_ns = now_ns;
+            mapper_process(&mapper, &timing->inputs[i], now_ns, &actions);
+        }
+    }
+    uint64_t elapsed = bench_clock_ns() - start;
+    if (tick_count) {
+        *tick_count = count;
+    }
+    return elapsed;
+}
+
+// Each stage is timed over whole passes, never per call, so clock reads
+// don't swamp stages that take tens of nanoseconds. Ticks can't run
+// without the packets between them: their cost is the replay pass minus
+// the packets-only pass. A and B alternate within every run, so both sides
+// see the same machine conditions; the spread over the runs is the noise a
+// difference has to beat.
+static void time_stages(const Corpus *corpus, Side *sides) {
+    TimingCorpus timing;
+    double samples[2][3][TIMING_RUNS];
+
+    timing.inputs = malloc(corpus->count * sizeof(GipInputPacket));
+    timing.now_ns = malloc(corpus->count * sizeof(uint64_t));
+    timing.count = 0;
+    if (!timing.inputs || !timing.now_ns) {
+        free(timing.inputs);
+        free(timing.now_ns);
+        memset(sides[0].stage_ns, 0, sizeof(sides[0].stage_ns));
+        memset(sides[1].stage_ns, 0, sizeof(sides[1].stage_ns));
+        return;
+    }
+    for (int i = 0; i < corpus->count; i++) {
+        const GipInputPacket *input = gip_decode_input(corpus->records[i].data, corpus->records[i].length);
+        if (input) {
+            timing.inputs[timing.count] = *input;
+            timing.now_ns[timing.count++] = REPLAY_EPOCH_NS + corpus->records[i].timestamp_ns;
+        }
+    }
+    int decode_passes = 1;
+    while ((uint64_t)decode_passes * corpus->count < TIMING_MIN_PACKETS) {
+        decode_passes *= 2;
+    }
+    timing.passes = 1;
+    while (timing.count > 0 && (uint64_t)timing.passes * timing.count < TIMING_MIN_PACKETS) {
+        timing.passes *= 2;
+    }
+
+    for (int run = 0; run < TIMING_RUNS; run++) {
+        for (int turn = 0; turn < 2; turn++) {
+            int s = (run + turn) & 1;   // A first on even runs, B first on odd ones
+            uint64_t ticks;
+
+            uint64_t decode_ns = time_decode(corpus, decode_passes);
+            uint64_t map_ns = time_map(&timing, &sides[s].profile, false, NULL);
+            uint64_t replay_ns = time_map(&timing, &sides[s].profile, true, &ticks);
+
+            samples[s][STAGE_DECODE][run] = (double)decode_ns / ((double)decode_passes * corpus->count);
+            samples[s][STAGE_MAP][run] = timing.count ?
+                (double)map_ns / ((double)timing.passes * timing.count) : 0.0;
+            samples[s][STAGE_TICK][run] = ticks ? ((double)replay_ns - (double)map_ns) / ticks : 0.0;
+        }
+    }
+
+    for (int s = 0; s < 2; s++) {
+        for (int stage = 0; stage < 3; stage++) {
+            double fastest = samples[s][stage][0], slowest = samples[s][stage][0];
+            for (int run = 1; run < TIMING_RUNS; run++) {
+                fastest = samples[s][stage][run] < fastest ? samples[s][stage][run] : fastest;
+                slowest = samples[s][stage][run] > slowest ? samples[s][stage][run] : slowest;
+            }
+            sides[s].stage_ns[stage] = fastest < 0.0 ? 0.0 : fastest;
+            sides[s].stage_noise_ns[stage] = slowest - fastest;
+        }
+    }
+    free(timing.inputs);
+    free(timing.now_ns);
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+static void print_row(const char *name, double a, double b, const char *format) {
+    char a_text[32], b_text[32], delta[32];
+    snprintf(a_text, sizeof(a_text), format, a);
+    snprintf(b_text, sizeof(b_text), format, b);
+    if (a == b) {
+        snprintf(delta, sizeof(delta), "=");
+    } else if (a != 0.0) {
+        snprintf(delta, sizeof(delta), "%+.1f%%", (b - a) / a * 100.0);
+    } else {
+        snprintf(delta, sizeof(delta), "new");
+    }
+    printf("  %-26s %14s %14s %10s\n", name, a_text, b_text, delta);
+}
+
+// Timings differ only when the gap is bigger than either side's run-to-run spread
+static void print_timing_row(const char *name, const Side *a, const Side *b, int stage) {
+    double noise = a->stage_noise_ns[stage] > b->stage_noise_ns[stage] ?
+                   a->stage_noise_ns[stage] : b->stage_noise_ns[stage];
+    if (fabs(b->stage_ns[stage] - a->stage_ns[stage]) > noise) {
+        print_row(name, a->stage_ns[stage], b->stage_ns[stage], "%.1f");
+        return;
+    }
+    char a_text[32], b_text[32];
+    snprintf(a_text, sizeof(a_text), "%.1f", a->stage_ns[stage]);
+    snprintf(b_text, sizeof(b_text), "%.1f", b->stage_ns[stage]);
+    printf("  %-26s %14s %14s %10s\n", name, a_text, b_text, "no difference");
+}
+
+static double window_divergence(const WindowStats *a, const WindowStats *b) {
+    // 10 px of cursor difference weighs as much as one extra key event
+    return abs(a->key_events - b->key_events) + abs(a->button_events - b->button_events) +
+           hypotf(a->dx - b->dx, a->dy - b->dy) / 10.0f;
+}
+
+static void print_divergence(const Side *sides, int windows) {
+    int top[TOP_WINDOWS];
+    double score[TOP_WINDOWS];
+    int found = 0;
+
+    for (int w = 0; w < windows; w++) {
+        double d = window_divergence(&sides[0].windows[w], &sides[1].windows[w]);
+        if (d <= 0.0) {
+            continue;
+        }
+        // Insertion into the small top-N list
+        int pos = found < TOP_WINDOWS ? found++ : TOP_WINDOWS;
+        while (pos > 0 && score[pos - 1] < d) {
+            if (pos < TOP_WINDOWS) {
+                top[pos] = top[pos - 1];
+                score[pos] = score[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < TOP_WINDOWS) {
+            top[pos] = w;
+            score[pos] = d;
+        }
+    }
+
+    printf("\nMost divergent %.0f ms windows:\n", WINDOW_NS / 1e6);
+    if (found == 0) {
+        printf("  none - outputs are identical\n");
+        return;
+    }
+    for (int i = 0; i < found; i++) {
+        const WindowStats *a = &sides[0].windows[top[i]];
+        const WindowStats *b = &sides[1].windows[top[i]];
+        printf("  %7.2f s  score %6.1f | keys %3d vs %3d, buttons %2d vs %2d, cursor (%+7.1f,%+7.1f) vs (%+7.1f,%+7.1f)\n",
+               top[i] * WINDOW_NS / 1e9, score[i], a->key_events, b->key_events,
+               a->button_events, b->button_events, a->dx, a->dy, b->dx, b->dy);
+    }
+}
+
+int main(int argc, char **argv) {
+    Corpus corpus;
+    int files = 0;
+    static Side sides[2];
+
+    if (argc < 4) {
+        printf("Usage: %s A B FILE.xcap...\n", argv[0]);
+        printf("  A, B: default | FILE.profile[:NAME] | FILE.xprof[:NAME]\n");
+        return 1;
+    }
+    memset(&corpus, 0, sizeof(corpus));
+    for (int i = 3; i < argc; i++) {
+        if (!corpus_load(&corpus, argv[i])) {
+            return 1;
+        }
+        files++;
+    }
+    if (corpus.count == 0) {
+        printf("❌ No packets in the captures\n");
+        return 1;
+    }
+
+    for (int s = 0; s < 2; s++) {
+        sides[s].label = argv[1 + s];
+        if (!load_profile(sides[s].label, &sides[s].profile)) {
+            return 1;
+        }
+    }
+
+    int windows = (int)(corpus.duration_ns / WINDOW_NS) + 2;
+    for (int s = 0; s < 2; s++) {
+        sides[s].windows = calloc(windows, sizeof(WindowStats));
+    }
+
+    printf("A/B comparison over %d packets (%.1f s) from %d file(s)\n", corpus.count,
+           corpus.duration_ns / 1e9, files);
+    printf("  A: %s\n  B: %s\n\n", sides[0].label, sides[1].label);
+
+    replay_sides(&corpus, sides);
+    time_stages(&corpus, sides);
+
+    const Side *a = &sides[0], *b = &sides[1];
+    printf("  %-26s %14s %14s %10s\n", "", "A", "B", "B vs A");
+    print_row("Key presses", a->key_presses, b->key_presses, "%.0f");
+    print_row("Key releases", a->key_releases, b->key_releases, "%.0f");
+    print_row("Mouse button events", a->button_events, b->button_events, "%.0f");
+    print_row("Mouse moves", a->moves, b->moves, "%.0f");
+    print_row("Key chatter (<50 ms)", a->chatter, b->chatter, "%.0f");
+    print_row("Cursor travel (px)", a->travel, b->travel, "%.0f");
+    print_row("Stick onsets", a->onset_count, b->onset_count, "%.0f");
+    print_row("  no response (300 ms)", a->onset_missed, b->onset_missed, "%.0f");
+    print_row("  mean response (ms)",
+              a->onset_count > a->onset_missed ? a->onset_delay_total_ns / (a->onset_count - a->onset_missed) / 1e6 : 0.0,
+              b->onset_count > b->onset_missed ? b->onset_delay_total_ns / (b->onset_count - b->onset_missed) / 1e6 : 0.0,
+              "%.2f");
+    print_timing_row("Decode (ns/packet)", a, b, STAGE_DECODE);
+    print_timing_row("Map (ns/packet)", a, b, STAGE_MAP);
+    print_timing_row("Tick (ns/tick)", a, b, STAGE_TICK);
+
+    print_divergence(sides, windows);
+
+    for (int s = 0; s < 2; s++) {
+        free(sides[s].windows);
+    }
+    free(corpus.records);
+    return 0;
+}
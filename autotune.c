@@ -0,0 +1,623 @@
+// autotune.c
+// Searches mouse_sensitivity, mouse_curve, mouse_smoothing and deadzone for
+// the best trade-off on recorded input, instead of editing keymapping.h and
+// rebuilding by trial and error. Every candidate is replayed through the real
+// mapper (same decode → mapper_process/mapper_tick path as xbox_replay) on
+// all cores, scored, and the winner is written as a text profile for profilec.
+// Compile: make autotune
+// Run: ./autotune [options] FILE.xcap...
+//      --max-speed PX_PER_S   target cursor speed at full deflection (default 3000)
+//      --weights J,L,S,D      objective weights (default 1,1,1,1)
+//      --threads N            worker threads (default: all cores)
+//      --output FILE.profile  write the best parameters as profile [tuned]
+//
+// Objective (lower is better), each term scaled so 1.0 is "noticeably bad":
+//   J  jitter at rest     cursor travel while the mouse stick is at rest, per 10 px/s
+//
+// "At rest" means inside the resting noise floor measured from the captures
+// themselves (stretches where the stick was left alone), not a fixed radius,
+// so the deadzone is tuned to the controller that was recorded.
+//   L  flick lag          time from a flick's first report to 90% of its peak output, per 20 ms
+//   S  max speed          distance of the peak speed from --max-speed, per 10%
+//   D  dead travel        share of small deliberate deflections with no output, per 10%
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "gip.h"
+#include "gip_protocol.h"
+#include "capture.h"
+#include "mapper.h"
+#include "keymapping.h"
+
+// Same output tick and epoch as xbox_replay
+#define TICK_NS             10000000ull
+#define REPLAY_EPOCH_NS     1000000000ull
+
+#define SMALL_MAGNITUDE     12000       // Deliberate but small deflection (dead travel)
+#define REST_WINDOW_REPORTS 25          // ~100 ms at 250 Hz
+#define REST_SEGMENT_NS     500000000ull    // Still this long: left alone
+#define REST_PERCENTILE     0.99        // Of magnitudes in rest segments: the noise floor
+#define REST_FALLBACK       4000        // Floor when the captures have no rest segments
+#define FLICK_MAGNITUDE     20000       // Rest → this in one report is a flick
+#define FLICK_WINDOW_NS     250000000ull
+#define SPEED_BIN_NS        50000000ull
+
+#define DEFAULT_MAX_SPEED   3000.0
+#define REFINE_ROUNDS       4
+#define REFINE_SEEDS        4           // Best candidates refined each round
+#define MAX_THREADS         64
+
+typedef struct {
+    CaptureRecord *records;
+    int count;
+    uint64_t duration_ns;
+} Corpus;
+
+typedef struct {
+    float sensitivity;
+    float curve;
+    float smoothing;
+    int deadzone;
+} Params;
+
+typedef struct {
+    double jitter_px_per_s;
+    double flick_lag_ms;
+    double max_speed;
+    double dead_travel;         // 0..1
+    int flicks;
+    double score;
+} Metrics;
+
+typedef struct {
+    Params params;
+    Metrics metrics;
+} Candidate;
+
+static double weights[4] = { 1.0, 1.0, 1.0, 1.0 };
+static double target_speed = DEFAULT_MAX_SPEED;
+static float rest_floor = REST_FALLBACK;    // Raw stick radius still counted as "at rest"
+
+// Search space: coarse grid, then refined around the leaders
+static const Params param_min = { 0.25f, 1.0f, 0.0f, 1000 };
+static const Params param_max = { 5.0f, 4.0f, 0.9f, 16000 };
+static const Params coarse_step = { 0.5f, 0.5f, 0.2f, 2000 };
+
+// ============================================================================
+// Corpus
+// ============================================================================
+
+static bool corpus_load(Corpus *corpus, const char *path) {
+    CaptureReader reader;
+    if (!capture_reader_open(&reader, path)) {
+        printf("❌ %s is not a capture file\n", path);
+        return false;
+    }
+
+    int result;
+    CaptureRecord record;
+    while ((result = capture_read(&reader, &record)) == 1) {
+        if (record.direction != CAPTURE_DIR_IN ||
+            !gip_decode_input(record.data, record.length)) {
+            continue;   // Only input reports matter for stick tuning
+        }
+        if ((corpus->count & (corpus->count - 1)) == 0) {
+            int capacity = corpus->count ? corpus->count * 2 : 1024;
+            CaptureRecord *grown = realloc(corpus->records, capacity * sizeof(*grown));
+            if (!grown) {
+                capture_reader_close(&reader);
+                return false;
+            }
+            corpus->records = grown;
+        }
+        record.timestamp_ns += corpus->duration_ns;
+        corpus->records[corpus->count++] = record;
+    }
+    capture_reader_close(&reader);
+
+    if (result < 0) {
+        printf("⚠️  %s is truncated after %llu records\n", path, (unsigned long long)reader.records);
+    }
+    if (corpus->count > 0) {
+        corpus->duration_ns = corpus->records[corpus->count - 1].timestamp_ns + TICK_NS;
+    }
+    return true;
+}
+
+// ============================================================================
+// Evaluation
+// ============================================================================
+
+static ControllerMapping candidate_mapping(const Params *p) {
+    ControllerMapping mapping = get_default_mapping();
+    mapping.sticks.mouse_sensitivity = p->sensitivity;
+    mapping.sticks.mouse_curve = p->curve;
+    mapping.sticks.mouse_smoothing = p->smoothing;
+    mapping.sticks.deadzone = (int16_t)p->deadzone;
+    return mapping;
+}
+
+// Largest deflection of the sticks that drive the cursor
+static float mouse_stick_magnitude(const CompiledProfile *profile, const GipInputPacket *input) {
+    float magnitude = 0.0f;
+    if (profile->left_stick.mode == STICK_MODE_MOUSE || profile->left_stick.mode == STICK_MODE_KINETIC) {
+        magnitude = hypotf(input->left_stick_x, input->left_stick_y);
+    }
+    if (profile->right_stick.mode == STICK_MODE_MOUSE || profile->right_stick.mode == STICK_MODE_KINETIC) {
+        magnitude = fmaxf(magnitude, hypotf(input->right_stick_x, input->right_stick_y));
+    }
+    return magnitude;
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Where a cursor stick sat over reports [start, end): mean position and
+// spread (RMS distance from the mean)
+static void stick_window(const Corpus *corpus, int start, int end, bool right,
+                         float *mean_x, float *mean_y, float *spread) {
+    double sum_x = 0.0, sum_y = 0.0, sum_sq = 0.0;
+    for (int i = start; i < end; i++) {
+        const GipInputPacket *input = gip_decode_input(corpus->records[i].data, corpus->records[i].length);
+        double x = right ? input->right_stick_x : input->left_stick_x;
+        double y = right ? input->right_stick_y : input->left_stick_y;
+        sum_x += x;
+        sum_y += y;
+        sum_sq += x * x + y * y;
+    }
+    int n = end - start;
+    *mean_x = (float)(sum_x / n);
+    *mean_y = (float)(sum_y / n);
+    double variance = sum_sq / n - (double)*mean_x * *mean_x - (double)*mean_y * *mean_y;
+    *spread = variance > 0.0 ? (float)sqrt(variance) : 0.0f;
+}
+
+// Resting noise floor of the cursor sticks, from the stretches of the
+// captures where they were left alone: at least REST_SEGMENT_NS of
+// REST_WINDOW_REPORTS windows in which neither moved (its mean position
+// shifted less than its own spread since the previous window, so noise of
+// any amplitude counts as still and a sweep of any size doesn't) or reached
+// SMALL_MAGNITUDE. The floor is the REST_PERCENTILE magnitude over those
+// stretches. False if the captures have none.
+static bool measure_rest_floor(const Corpus *corpus, float *floor, double *rest_s, int *segments) {
+    ControllerMapping mapping = get_default_mapping();
+    CompiledProfile profile;
+    mapper_compile_profile(&mapping, NULL, &profile);
+    bool cursor[2] = {
+        profile.left_stick.mode == STICK_MODE_MOUSE || profile.left_stick.mode == STICK_MODE_KINETIC,
+        profile.right_stick.mode == STICK_MODE_MOUSE || profile.right_stick.mode == STICK_MODE_KINETIC
+    };
+
+    float *rest = malloc(corpus->count * sizeof(float));
+    if (!rest) {
+        return false;
+    }
+    int rest_count = 0;
+    int segment_start = -1;     // First report of the current run of still windows
+    float previous[2][2] = { { 0 } };
+    *rest_s = 0.0;
+    *segments = 0;
+
+    for (int w = 0; w <= corpus->count; w += REST_WINDOW_REPORTS) {
+        int end = w + REST_WINDOW_REPORTS < corpus->count ? w + REST_WINDOW_REPORTS : corpus->count;
+        bool still = end - w == REST_WINDOW_REPORTS && w > 0;   // A short last window ends the run
+        for (int stick = 0; stick < 2 && end > w; stick++) {
+            if (!cursor[stick]) {
+                continue;
+            }
+            float mean_x, mean_y, spread;
+            stick_window(corpus, w, end, stick == 1, &mean_x, &mean_y, &spread);
+            still = still && hypotf(mean_x - previous[stick][0], mean_y - previous[stick][1]) <= spread;
+            previous[stick][0] = mean_x;
+            previous[stick][1] = mean_y;
+        }
+        for (int i = w; i < end && still; i++) {
+            still = mouse_stick_magnitude(&profile, gip_decode_input(corpus->records[i].data,
+                                                                     corpus->records[i].length)) < SMALL_MAGNITUDE;
+        }
+
+        if (still) {
+            segment_start = segment_start < 0 ? w : segment_start;
+            continue;
+        }
+        // A run of still windows [segment_start, w) ends here
+        if (segment_start >= 0) {
+            uint64_t length_ns = corpus->records[w - 1].timestamp_ns - corpus->records[segment_start].timestamp_ns;
+            if (length_ns >= REST_SEGMENT_NS) {
+                for (int i = segment_start; i < w; i++) {
+                    rest[rest_count++] = mouse_stick_magnitude(&profile,
+                        gip_decode_input(corpus->records[i].data, corpus->records[i].length));
+                }
+                *rest_s += length_ns / 1e9;
+                (*segments)++;
+            }
+            segment_start = -1;
+        }
+    }
+
+    if (rest_count > 0) {
+        qsort(rest, rest_count, sizeof(float), compare_float);
+        *floor = rest[(int)((rest_count - 1) * REST_PERCENTILE)];
+    }
+    free(rest);
+    return rest_count > 0;
+}
+
+// Per-replay bookkeeping for the objective terms
+typedef struct {
+    bool at_rest;
+    double rest_travel;
+    uint64_t rest_ns;
+    uint64_t last_ns;
+
+    bool in_flick;
+    uint64_t flick_start_ns;
+    float flick_peak;
+    uint64_t flick_peak_ns;     // First time output reached 90% of the peak so far
+    double flick_lag_total_ns;
+    int flicks;
+
+    uint64_t bin_start_ns;
+    double bin_travel;
+    double max_speed;
+
+    int small_reports;
+    int small_silent;
+} Scorer;
+
+static void score_moves(Scorer *s, const OutputActions *actions, uint64_t now_ns) {
+    float travel = 0.0f;
+    for (int i = 0; i < actions->count; i++) {
+        if (actions->actions[i].type == OUTPUT_MOUSE_MOVE) {
+            travel += hypotf(actions->actions[i].dx, actions->actions[i].dy);
+        }
+    }
+
+    if (s->at_rest) {
+        s->rest_travel += travel;
+    }
+
+    if (now_ns - s->bin_start_ns >= SPEED_BIN_NS) {
+        double speed = s->bin_travel * 1e9 / SPEED_BIN_NS;
+        if (speed > s->max_speed) {
+            s->max_speed = speed;
+        }
+        s->bin_start_ns = now_ns;
+        s->bin_travel = 0.0;
+    }
+    s->bin_travel += travel;
+
+    if (s->in_flick) {
+        if (now_ns - s->flick_start_ns > FLICK_WINDOW_NS) {
+            s->in_flick = false;
+            s->flick_lag_total_ns += (double)(s->flick_peak_ns - s->flick_start_ns);
+            s->flicks++;
+        } else if (travel > s->flick_peak) {
+            // A new peak restarts the 90% clock only if it raises the bar past the old output
+            if (travel * 0.9f > s->flick_peak) {
+                s->flick_peak_ns = now_ns;
+            }
+            s->flick_peak = travel;
+        }
+    }
+}
+
+static void evaluate(const Corpus *corpus, const Params *params, Metrics *metrics) {
+    ControllerMapping mapping = candidate_mapping(params);
+    CompiledProfile profile;
+    Mapper mapper;
+    OutputActions actions;
+    Scorer s;
+
+    mapper_compile_profile(&mapping, NULL, &profile);
+    mapper_init(&mapper, &profile);
+    memset(&s, 0, sizeof(s));
+    s.at_rest = true;
+    s.last_ns = REPLAY_EPOCH_NS;
+    s.bin_start_ns = REPLAY_EPOCH_NS;
+
+    for (int i = 0; i < corpus->count; i++) {
+        const CaptureRecord *record = &corpus->records[i];
+        uint64_t now_ns = REPLAY_EPOCH_NS + record->timestamp_ns;
+
+        while (mapper_tick_pending(&mapper) && now_ns - s.last_ns > TICK_NS) {
+            s.last_ns += TICK_NS;
+            mapper_tick(&mapper, s.last_ns, &actions);
+            score_moves(&s, &actions, s.last_ns);
+        }
+        if (s.at_rest) {
+            s.rest_ns += now_ns - s.last_ns;
+        }
+        s.last_ns = now_ns;
+
+        const GipInputPacket *input = gip_decode_input(record->data, record->length);
+        float magnitude = mouse_stick_magnitude(&profile, input);
+        bool was_rest = s.at_rest;
+        s.at_rest = magnitude <= rest_floor;
+        if (was_rest && magnitude >= FLICK_MAGNITUDE && !s.in_flick) {
+            s.in_flick = true;
+            s.flick_start_ns = now_ns;
+            s.flick_peak = 0.0f;
+            s.flick_peak_ns = now_ns;
+        }
+
+        mapper_process(&mapper, input, now_ns, &actions);
+        score_moves(&s, &actions, now_ns);
+
+        if (magnitude > rest_floor && magnitude < SMALL_MAGNITUDE) {
+            s.small_reports++;
+            bool moved = false;
+            for (int a = 0; a < actions.count; a++) {
+                moved |= actions.actions[a].type == OUTPUT_MOUSE_MOVE;
+            }
+            s.small_silent += !moved;
+        }
+    }
+
+    metrics->jitter_px_per_s = s.rest_ns ? s.rest_travel * 1e9 / s.rest_ns : 0.0;
+    metrics->flicks = s.flicks;
+    metrics->flick_lag_ms = s.flicks ? s.flick_lag_total_ns / s.flicks / 1e6 : 0.0;
+    metrics->max_speed = s.max_speed;
+    metrics->dead_travel = s.small_reports ? (double)s.small_silent / s.small_reports : 0.0;
+    metrics->score = weights[0] * metrics->jitter_px_per_s / 10.0 +
+                     weights[1] * metrics->flick_lag_ms / 20.0 +
+                     weights[2] * fabs(metrics->max_speed - target_speed) / target_speed * 10.0 +
+                     weights[3] * metrics->dead_travel * 10.0;
+}
+
+// ============================================================================
+// Parallel Evaluation
+// ============================================================================
+
+typedef struct {
+    const Corpus *corpus;
+    Candidate *candidates;
+    int count;
+    atomic_int next;
+} Batch;
+
+static void *worker(void *arg) {
+    Batch *batch = arg;
+    int index;
+    while ((index = atomic_fetch_add(&batch->next, 1)) < batch->count) {
+        evaluate(batch->corpus, &batch->candidates[index].params, &batch->candidates[index].metrics);
+    }
+    return NULL;
+}
+
+static void evaluate_all(const Corpus *corpus, Candidate *candidates, int count, int threads) {
+    Batch batch = { corpus, candidates, count, 0 };
+    pthread_t ids[MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < threads - 1; i++) {
+        if (pthread_create(&ids[started], NULL, worker, &batch) == 0) {
+            started++;
+        }
+    }
+    worker(&batch);
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+}
+
+static int compare_score(const void *a, const void *b) {
+    double x = ((const Candidate *)a)->metrics.score;
+    double y = ((const Candidate *)b)->metrics.score;
+    return (x > y) - (x < y);
+}
+
+// ============================================================================
+// Search
+// ============================================================================
+
+static float clampf(float value, float low, float high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+static Params clamp_params(Params p) {
+    p.sensitivity = clampf(p.sensitivity, param_min.sensitivity, param_max.sensitivity);
+    p.curve = clampf(p.curve, param_min.curve, param_max.curve);
+    p.smoothing = clampf(p.smoothing, param_min.smoothing, param_max.smoothing);
+    p.deadzone = p.deadzone < param_min.deadzone ? param_min.deadzone :
+                 (p.deadzone > param_max.deadzone ? param_max.deadzone : p.deadzone);
+    return p;
+}
+
+static bool params_equal(const Params *a, const Params *b) {
+    return fabsf(a->sensitivity - b->sensitivity) < 1e-4f && fabsf(a->curve - b->curve) < 1e-4f &&
+           fabsf(a->smoothing - b->smoothing) < 1e-4f && a->deadzone == b->deadzone;
+}
+
+static bool add_candidate(Candidate *list, int *count, int capacity, Params p) {
+    p = clamp_params(p);
+    for (int i = 0; i < *count; i++) {
+        if (params_equal(&list[i].params, &p)) {
+            return false;
+        }
+    }
+    if (*count >= capacity) {
+        return false;
+    }
+    memset(&list[*count], 0, sizeof(Candidate));
+    list[(*count)++].params = p;
+    return true;
+}
+
+static int coarse_grid(Candidate *list, int capacity) {
+    int count = 0;
+    for (float sens = param_min.sensitivity; sens <= 3.25f; sens += coarse_step.sensitivity) {
+        for (float curve = param_min.curve; curve <= 3.0f; curve += coarse_step.curve) {
+            for (float smooth = param_min.smoothing; smooth <= 0.8f; smooth += coarse_step.smoothing) {
+                for (int dz = 2000; dz <= 14000; dz += coarse_step.deadzone) {
+                    add_candidate(list, &count, capacity, (Params){ sens, curve, smooth, dz });
+                }
+            }
+        }
+    }
+    return count;
+}
+
+// Every ±step combination around seed (3^4 points)
+static int neighbours(const Params *seed, const Params *step, Candidate *list, int count, int capacity) {
+    for (int i = 0; i < 81; i++) {
+        int d[4] = { i % 3 - 1, i / 3 % 3 - 1, i / 9 % 3 - 1, i / 27 % 3 - 1 };
+        Params p = {
+            seed->sensitivity + d[0] * step->sensitivity,
+            seed->curve + d[1] * step->curve,
+            seed->smoothing + d[2] * step->smoothing,
+            seed->deadzone + d[3] * step->deadzone,
+        };
+        add_candidate(list, &count, capacity, p);
+    }
+    return count;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+static void print_candidate(const char *label, const Candidate *c) {
+    printf("%-9s sens %.3f curve %.3f smooth %.3f deadzone %5d | "
+           "jitter %6.2f px/s, flick lag %5.1f ms, max %6.0f px/s, dead %4.1f%% | score %.3f\n",
+           label, c->params.sensitivity, c->params.curve, c->params.smoothing, c->params.deadzone,
+           c->metrics.jitter_px_per_s, c->metrics.flick_lag_ms, c->metrics.max_speed,
+           c->metrics.dead_travel * 100.0, c->metrics.score);
+}
+
+static bool write_profile(const char *path, const Candidate *best, int files) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    fprintf(f, "# Written by autotune from %d capture file(s), target max speed %.0f px/s\n",
+            files, target_speed);
+    fprintf(f, "# jitter %.2f px/s, flick lag %.1f ms, max speed %.0f px/s, dead travel %.1f%%, score %.3f\n",
+            best->metrics.jitter_px_per_s, best->metrics.flick_lag_ms, best->metrics.max_speed,
+            best->metrics.dead_travel * 100.0, best->metrics.score);
+    fprintf(f, "# Other settings are the keymapping.h defaults; merge into your own profile as needed.\n\n");
+    fprintf(f, "[tuned]\n");
+    fprintf(f, "mouse.sensitivity = %.3f\n", best->params.sensitivity);
+    fprintf(f, "mouse.curve       = %.3f\n", best->params.curve);
+    fprintf(f, "mouse.smoothing   = %.3f\n", best->params.smoothing);
+    fprintf(f, "deadzone          = %d\n", best->params.deadzone);
+    return fclose(f) == 0;
+}
+
+static void usage(const char *program) {
+    printf("Usage: %s [--max-speed PX_PER_S] [--weights J,L,S,D] [--threads N]\n", program);
+    printf("       %*s [--output FILE.profile] FILE.xcap...\n", (int)strlen(program), "");
+}
+
+int main(int argc, char **argv) {
+    Corpus corpus;
+    int files = 0;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *output = NULL;
+
+    memset(&corpus, 0, sizeof(corpus));
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-speed") == 0 && i + 1 < argc) {
+            target_speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &weights[0], &weights[1], &weights[2], &weights[3]) != 4) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] == '-' || !corpus_load(&corpus, argv[i])) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            files++;
+        }
+    }
+    if (files == 0 || corpus.count == 0 || target_speed <= 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+    threads = threads < 1 ? 1 : (threads > MAX_THREADS ? MAX_THREADS : threads);
+
+    printf("Auto-tuning on %d input reports (%.1f s) from %d file(s), %d threads\n",
+           corpus.count, corpus.duration_ns / 1e9, files, threads);
+    printf("Weights: jitter %.2g, lag %.2g, speed %.2g, dead travel %.2g; target %.0f px/s\n\n",
+           weights[0], weights[1], weights[2], weights[3], target_speed);
+
+    double rest_s;
+    int segments;
+    if (measure_rest_floor(&corpus, &rest_floor, &rest_s, &segments)) {
+        printf("Resting noise floor: %.0f (%.0fth percentile over %.1f s of rest in %d segments)\n\n",
+               rest_floor, REST_PERCENTILE * 100.0, rest_s, segments);
+    } else {
+        printf("⚠️  No rest segments (%.1f s without touching the cursor stick) in these captures;\n"
+               "   assuming a noise floor of %d\n\n", REST_SEGMENT_NS / 1e9, REST_FALLBACK);
+    }
+
+    // Baseline: keymapping.h as shipped
+    ControllerMapping defaults = get_default_mapping();
+    Candidate baseline;
+    memset(&baseline, 0, sizeof(baseline));
+    baseline.params = (Params){ defaults.sticks.mouse_sensitivity, defaults.sticks.mouse_curve,
+                                defaults.sticks.mouse_smoothing, defaults.sticks.deadzone };
+    evaluate(&corpus, &baseline.params, &baseline.metrics);
+    if (baseline.metrics.flicks == 0) {
+        printf("⚠️  No flicks in these captures; the lag term will be 0\n");
+    }
+
+    int capacity = 4096;
+    Candidate *candidates = calloc(capacity, sizeof(Candidate));
+    int count = coarse_grid(candidates, capacity);
+    uint64_t evaluated = 0;
+
+    evaluate_all(&corpus, candidates, count, threads);
+    evaluated += count;
+    qsort(candidates, count, sizeof(Candidate), compare_score);
+    printf("📈 Coarse grid: %d candidates, best score %.3f\n", count, candidates[0].metrics.score);
+
+    Params step = coarse_step;
+    for (int round = 0; round < REFINE_ROUNDS; round++) {
+        step.sensitivity /= 2.0f;
+        step.curve /= 2.0f;
+        step.smoothing /= 2.0f;
+        step.deadzone = step.deadzone / 2 > 1 ? step.deadzone / 2 : 1;
+
+        // Keep the leaders (already scored) and add their neighbours
+        int seeds = count < REFINE_SEEDS ? count : REFINE_SEEDS;
+        int refined = seeds;
+        for (int i = 0; i < seeds; i++) {
+            refined = neighbours(&candidates[i].params, &step, candidates, refined, capacity);
+        }
+        evaluate_all(&corpus, candidates + seeds, refined - seeds, threads);
+        evaluated += refined - seeds;
+        count = refined;
+        qsort(candidates, count, sizeof(Candidate), compare_score);
+        printf("📈 Refine %d: %d candidates, best score %.3f\n", round + 1, refined - seeds,
+               candidates[0].metrics.score);
+    }
+
+    printf("\nEvaluated %llu parameter sets\n\n", (unsigned long long)evaluated);
+    print_candidate("Default:", &baseline);
+    print_candidate("Best:", &candidates[0]);
+
+    int result = 0;
+    if (output) {
+        if (write_profile(output, &candidates[0], files)) {
+            printf("\n✅ Wrote %s (compile with: ./profilec -o tuned.xprof %s)\n", output, output);
+        } else {
+            printf("\n❌ Could not write %s\n", output);
+            result = 1;
+        }
+    }
+    free(candidates);
+    free(corpus.records);
+    return result;
+}
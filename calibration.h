@@ -0,0 +1,234 @@
+// calibration.h
+// Per-angle outer-range calibration for analog sticks
+// Real sticks don't reach a perfect circle of radius 32767: the gate may be
+// squarish and some directions top out early. We record the largest radius
+// seen in each angular bin while the user rotates the stick, then rescale
+// live input so every direction reaches full deflection.
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#define CALIBRATION_BINS        32
+#define CALIBRATION_MAGIC       0x4C414358  // "XCAL"
+#define CALIBRATION_VERSION     1
+
+// Samples closer to the center than this are ignored while recording, and
+// no bin is allowed to shrink below it (avoids huge scale factors)
+#define CALIBRATION_MIN_RADIUS  16384.0f
+
+// Outer radius reached in each angular bin of one stick (raw packet units)
+typedef struct {
+    float outer_radius[CALIBRATION_BINS];
+} StickRange;
+
+// Stored per controller, keyed by USB serial number
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t bins;
+    char serial[64];
+    StickRange left;
+    StickRange right;
+} StickCalibration;
+
+// Cheap monotonic stand-in for atan2: 0..4 around the circle, no trig needed
+// (0 = +X, 1 = +Y, 2 = -X, 3 = -Y). Recording and lookup use the same
+// mapping, so bins don't need to be evenly spaced in real degrees.
+static inline float calibration_diamond_angle(float x, float y) {
+    float sum = fabsf(x) + fabsf(y);
+    if (sum == 0.0f) {
+        return 0.0f;        // Centre: no direction
+    }
+    if (y >= 0) {
+        return (x >= 0) ? y / sum : 1.0f - x / sum;
+    }
+    return (x < 0) ? 2.0f - y / sum : 3.0f + x / sum;
+}
+
+// Degrees at the center of a bin (for reports only)
+static inline float calibration_bin_degrees(int bin) {
+    float da = bin * 4.0f / CALIBRATION_BINS;
+    int quadrant = (int)da;
+    float p = da - quadrant;
+    return quadrant * 90.0f + atanf(p / (1.0f - p + 1e-9f)) * (180.0f / (float)M_PI);
+}
+
+static inline void calibration_range_reset(StickRange *range) {
+    memset(range, 0, sizeof(*range));
+}
+
+// Record one raw sample while the user rotates the stick
+static inline void calibration_record(StickRange *range, int16_t x, int16_t y) {
+    float fx = x, fy = y;
+    float radius = sqrtf(fx * fx + fy * fy);
+    if (radius < CALIBRATION_MIN_RADIUS) {
+        return;
+    }
+
+    float pos = calibration_diamond_angle(fx, fy) * (CALIBRATION_BINS / 4.0f);
+    int bin = (int)(pos + 0.5f) % CALIBRATION_BINS;
+    if (radius > range->outer_radius[bin]) {
+        range->outer_radius[bin] = radius;
+    }
+}
+
+// Fill bins that never saw a sample by interpolating between recorded
+// neighbours. Returns how many bins had to be filled in.
+static inline int calibration_finish(StickRange *range) {
+    int missing = 0;
+    int recorded = 0;
+
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        if (range->outer_radius[i] > 0) {
+            recorded++;
+        }
+    }
+
+    if (recorded == 0) {
+        for (int i = 0; i < CALIBRATION_BINS; i++) {
+            range->outer_radius[i] = 32767.0f;
+        }
+        return CALIBRATION_BINS;
+    }
+
+    float filled[CALIBRATION_BINS];
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        filled[i] = range->outer_radius[i];
+        if (filled[i] > 0) {
+            continue;
+        }
+        missing++;
+
+        int prev = 1, next = 1;
+        while (range->outer_radius[(i - prev + CALIBRATION_BINS) % CALIBRATION_BINS] <= 0) prev++;
+        while (range->outer_radius[(i + next) % CALIBRATION_BINS] <= 0) next++;
+
+        float a = range->outer_radius[(i - prev + CALIBRATION_BINS) % CALIBRATION_BINS];
+        float b = range->outer_radius[(i + next) % CALIBRATION_BINS];
+        filled[i] = a + (b - a) * prev / (float)(prev + next);
+    }
+
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        range->outer_radius[i] = filled[i] < CALIBRATION_MIN_RADIUS ? CALIBRATION_MIN_RADIUS : filled[i];
+    }
+    return missing;
+}
+
+// Hot path: one table lookup plus linear interpolation between bins
+static inline float calibration_outer_radius(const StickRange *range, float x, float y) {
+    float pos = calibration_diamond_angle(x, y) * (CALIBRATION_BINS / 4.0f);
+    int i0 = (int)pos;
+    float frac = pos - i0;
+    i0 %= CALIBRATION_BINS;
+    int i1 = (i0 + 1) % CALIBRATION_BINS;
+
+    return range->outer_radius[i0] + (range->outer_radius[i1] - range->outer_radius[i0]) * frac;
+}
+
+// ============================================================================
+// Storage (one file per controller serial, in the working directory)
+// ============================================================================
+
+// The serial comes from the device and the file may be written as root, so
+// anything outside [A-Za-z0-9_-] (a '/' or ".." above all) becomes '_'
+static inline void calibration_path(const char *serial, char *path, size_t size) {
+    char name[64];
+    size_t length = 0;
+
+    if (serial) {
+        for (; serial[length] && length < sizeof(name) - 1; length++) {
+            char c = serial[length];
+            bool safe = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                        c == '_' || c == '-';
+            name[length] = safe ? c : '_';
+        }
+    }
+    name[length] = '\0';
+    snprintf(path, size, "calibration_%s.cal", length > 0 ? name : "default");
+}
+
+static inline bool calibration_save(const StickCalibration *cal) {
+    char path[128];
+    calibration_path(cal->serial, path, sizeof(path));
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(cal, sizeof(*cal), 1, f) == 1;
+    fclose(f);
+    return ok;
+}
+
+static inline bool calibration_load(const char *serial, StickCalibration *cal) {
+    char path[128];
+    calibration_path(serial, path, sizeof(path));
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fread(cal, sizeof(*cal), 1, f) == 1;
+    fclose(f);
+
+    return ok && cal->magic == CALIBRATION_MAGIC &&
+           cal->version == CALIBRATION_VERSION &&
+           cal->bins == CALIBRATION_BINS;
+}
+
+// ============================================================================
+// Circularity report
+// ============================================================================
+
+// Prints per-bin reach and a summary. Circularity error is the mean absolute
+// deviation of the bin radii from their average, as a percentage.
+static inline void calibration_print_report(const char *name, const StickRange *range) {
+    float sum = 0, min_r = range->outer_radius[0], max_r = range->outer_radius[0];
+    int min_bin = 0, max_bin = 0;
+    float cardinal = 0, diagonal = 0;
+    int cardinal_n = 0, diagonal_n = 0;
+
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        float r = range->outer_radius[i];
+        sum += r;
+        if (r < min_r) { min_r = r; min_bin = i; }
+        if (r > max_r) { max_r = r; max_bin = i; }
+
+        // Bins on the axes vs. half way between them
+        int phase = i % (CALIBRATION_BINS / 4);
+        if (phase == 0) { cardinal += r; cardinal_n++; }
+        if (phase == CALIBRATION_BINS / 8) { diagonal += r; diagonal_n++; }
+    }
+    float mean = sum / CALIBRATION_BINS;
+
+    float deviation = 0;
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        deviation += fabsf(range->outer_radius[i] - mean);
+    }
+    deviation /= CALIBRATION_BINS;
+
+    printf("%s stick:\n", name);
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        float r = range->outer_radius[i];
+        int bar = (int)(r / 32767.0f * 40.0f);
+        printf("  %5.1f°  %6.0f  %5.1f%%  ", calibration_bin_degrees(i), r, r / 327.67f);
+        for (int b = 0; b < bar && b < 50; b++) printf("#");
+        printf("\n");
+    }
+    printf("  Mean reach:         %.0f (%.1f%% of 32767)\n", mean, mean / 327.67f);
+    printf("  Weakest direction:  %.1f° (%.0f)\n", calibration_bin_degrees(min_bin), min_r);
+    printf("  Strongest direction: %.1f° (%.0f)\n", calibration_bin_degrees(max_bin), max_r);
+    if (cardinal_n && diagonal_n) {
+        printf("  Diagonal/axis ratio: %.3f (1.000 = round gate, >1 = square gate)\n",
+               (diagonal / diagonal_n) / (cardinal / cardinal_n));
+    }
+    printf("  Circularity error:  %.2f%%\n\n", mean > 0 ? deviation / mean * 100.0f : 0.0f);
+}
+
+#endif // CALIBRATION_H
@@ -0,0 +1,575 @@
+// capture.c
+// Raw GIP packet capture files (part of libgip)
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "capture.h"
+
+// Tag byte of a packed record
+#define TAG_DIRECTION_OUT   0x01
+#define TAG_DELTA           0x02
+#define TAG_DIRECTION_STATE 0x04
+
+#define DIRECTIONS          3
+
+// Worst case: tag + two 10-byte varints + a full packet
+#define MAX_ENCODED_RECORD  (1 + 10 + 10 + CAPTURE_MAX_PACKET)
+
+// Last packet per (direction, command): what delta records are against
+typedef struct {
+    uint8_t length[DIRECTIONS][256];
+    uint8_t data[DIRECTIONS][256][CAPTURE_MAX_PACKET];
+} DeltaReferences;
+
+struct CapturePacker {
+    uint8_t block[CAPTURE_BLOCK_SIZE];
+    uint32_t used;
+    uint32_t block_records;
+    uint64_t block_first_ns;
+    uint64_t last_ns;
+    uint64_t offset;            // File offset of the next block
+    DeltaReferences refs;
+
+    CaptureBlockEntry *index;
+    uint32_t block_count;
+    uint32_t index_capacity;
+    bool failed;
+};
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+static bool write_file_header(CaptureWriter *writer, uint16_t version, uint16_t vendor_id,
+                              uint16_t product_id, const char *serial) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    CaptureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CAPTURE_MAGIC;
+    header.version = version;
+    header.header_size = sizeof(header);
+    header.start_realtime_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    header.vendor_id = vendor_id;
+    header.product_id = product_id;
+    snprintf(header.serial, sizeof(header.serial), "%s", serial ? serial : "");
+
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        fclose(writer->file);
+        writer->file = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool capture_writer_open(CaptureWriter *writer, const char *path,
+                         uint16_t vendor_id, uint16_t product_id, const char *serial) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        return false;
+    }
+    setvbuf(writer->file, writer->buffer, _IOFBF, sizeof(writer->buffer));
+    return write_file_header(writer, CAPTURE_VERSION, vendor_id, product_id, serial);
+}
+
+bool capture_writer_open_packed(CaptureWriter *writer, const char *path,
+                                uint16_t vendor_id, uint16_t product_id, const char *serial) {
+    if (!capture_writer_open(writer, path, vendor_id, product_id, serial)) {
+        return false;
+    }
+    writer->packer = calloc(1, sizeof(CapturePacker));
+    if (!writer->packer || fseek(writer->file, 0, SEEK_SET) != 0 ||
+        !write_file_header(writer, CAPTURE_VERSION_PACKED, vendor_id, product_id, serial)) {
+        if (writer->file) {
+            fclose(writer->file);
+            writer->file = NULL;
+        }
+        free(writer->packer);
+        writer->packer = NULL;
+        return false;
+    }
+    writer->packer->offset = sizeof(CaptureFileHeader);
+    return true;
+}
+
+static int put_varint(uint8_t *out, uint64_t value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static bool flush_block(CaptureWriter *writer) {
+    CapturePacker *p = writer->packer;
+    if (p->block_records == 0) {
+        return true;
+    }
+    if (p->block_count == p->index_capacity) {
+        uint32_t capacity = p->index_capacity ? p->index_capacity * 2 : 256;
+        CaptureBlockEntry *grown = realloc(p->index, capacity * sizeof(*grown));
+        if (!grown) {
+            return false;
+        }
+        p->index = grown;
+        p->index_capacity = capacity;
+    }
+    if (fwrite(p->block, p->used, 1, writer->file) != 1) {
+        return false;
+    }
+
+    CaptureBlockEntry *entry = &p->index[p->block_count++];
+    entry->offset = p->offset;
+    entry->first_timestamp_ns = p->block_first_ns;
+    entry->first_record = writer->records - p->block_records;
+    entry->size = p->used;
+    entry->records = p->block_records;
+
+    p->offset += p->used;
+    p->used = 0;
+    p->block_records = 0;
+    return true;
+}
+
+static bool pack_record(CaptureWriter *writer, uint64_t timestamp_ns, CaptureDirection direction,
+                        const uint8_t *data, int length) {
+    CapturePacker *p = writer->packer;
+    if (p->used + MAX_ENCODED_RECORD > CAPTURE_BLOCK_SIZE || p->block_records == CAPTURE_BLOCK_MAX_RECORDS) {
+        if (!flush_block(writer)) {
+            return false;
+        }
+    }
+    if (p->block_records == 0) {
+        // Keyframe: the block must decode without anything before it
+        memset(p->refs.length, 0, sizeof(p->refs.length));
+        p->block_first_ns = timestamp_ns;
+        p->last_ns = timestamp_ns;
+    }
+
+    uint8_t *out = p->block + p->used;
+    int n = 0;
+    int dir = direction;
+    uint8_t command = length > 0 ? data[0] : 0;
+    bool delta = length > 0 && p->refs.length[dir][command] == length;
+
+    out[n++] = (uint8_t)((direction == CAPTURE_DIR_OUT ? TAG_DIRECTION_OUT : 0) |
+                         (direction == CAPTURE_DIR_STATE ? TAG_DIRECTION_STATE : 0) |
+                         (delta ? TAG_DELTA : 0));
+    n += put_varint(out + n, zigzag((int64_t)(timestamp_ns - p->last_ns)));
+    if (delta) {
+        // Command byte names the reference (and so the length); the mask
+        // covers the rest of the packet
+        const uint8_t *ref = p->refs.data[dir][command];
+        uint64_t mask = 0;
+        out[n++] = command;
+        for (int i = 1; i < length; i++) {
+            if (data[i] != ref[i]) {
+                mask |= 1ull << i;
+            }
+        }
+        n += put_varint(out + n, mask);
+        for (int i = 1; i < length; i++) {
+            if (mask & (1ull << i)) {
+                out[n++] = data[i];
+            }
+        }
+    } else {
+        n += put_varint(out + n, (uint64_t)length);
+        memcpy(out + n, data, length);
+        n += length;
+    }
+
+    if (length > 0) {
+        p->refs.length[dir][command] = (uint8_t)length;
+        memcpy(p->refs.data[dir][command], data, length);
+    }
+    p->used += n;
+    p->block_records++;
+    p->last_ns = timestamp_ns;
+    return true;
+}
+
+bool capture_write(CaptureWriter *writer, uint64_t timestamp_ns, CaptureDirection direction,
+                   const uint8_t *data, int length) {
+    if (!writer->file || length < 0 || length > CAPTURE_MAX_PACKET || direction > CAPTURE_DIR_STATE) {
+        return false;
+    }
+    if (writer->records == 0) {
+        writer->first_ns = timestamp_ns;
+    }
+    if (writer->packer) {
+        if (!pack_record(writer, timestamp_ns - writer->first_ns, direction, data, length)) {
+            writer->packer->failed = true;
+            return false;
+        }
+        writer->records++;
+        return true;
+    }
+
+    CaptureRecordHeader record = {
+        .timestamp_ns = timestamp_ns - writer->first_ns,
+        .length = (uint16_t)length,
+        .direction = (uint8_t)direction,
+        .flags = 0
+    };
+    if (fwrite(&record, sizeof(record), 1, writer->file) != 1 ||
+        (length > 0 && fwrite(data, length, 1, writer->file) != 1)) {
+        return false;
+    }
+    writer->records++;
+    return true;
+}
+
+bool capture_write_state(CaptureWriter *writer, uint64_t timestamp_ns, const uint8_t *state, int length) {
+    int chunks = (length + CAPTURE_STATE_CHUNK - 1) / CAPTURE_STATE_CHUNK;
+    if (length <= 0 || length > CAPTURE_STATE_MAX) {
+        return false;
+    }
+    for (int i = 0; i < chunks; i++) {
+        uint8_t chunk[CAPTURE_MAX_PACKET];
+        int offset = i * CAPTURE_STATE_CHUNK;
+        int size = length - offset < CAPTURE_STATE_CHUNK ? length - offset : CAPTURE_STATE_CHUNK;
+        chunk[0] = (uint8_t)i;
+        chunk[1] = (uint8_t)chunks;
+        memcpy(chunk + 2, state + offset, size);
+        if (!capture_write(writer, timestamp_ns, CAPTURE_DIR_STATE, chunk, size + 2)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool capture_writer_close(CaptureWriter *writer) {
+    if (!writer->file) {
+        return false;
+    }
+    bool ok = true;
+    CapturePacker *p = writer->packer;
+    if (p) {
+        // Last block, then the index and trailer that make the file seekable
+        ok = !p->failed && flush_block(writer);
+        CaptureTrailer trailer = {
+            .index_offset = p->offset,
+            .records = writer->records,
+            .block_count = p->block_count,
+            .magic = CAPTURE_TRAILER_MAGIC
+        };
+        ok = ok && (p->block_count == 0 ||
+                    fwrite(p->index, sizeof(CaptureBlockEntry), p->block_count, writer->file) == p->block_count);
+        ok = ok && fwrite(&trailer, sizeof(trailer), 1, writer->file) == 1;
+        free(p->index);
+        free(p);
+        writer->packer = NULL;
+    }
+    ok = !ferror(writer->file) && ok;
+    ok = (fclose(writer->file) == 0) && ok;
+    writer->file = NULL;
+    return ok;
+}
+
+// ============================================================================
+// Packed Files: Mapping and Block Decoding
+// ============================================================================
+
+bool capture_map_open(CaptureMap *map, const char *path) {
+    memset(map, 0, sizeof(*map));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CaptureFileHeader) + sizeof(CaptureTrailer)) {
+        close(fd);
+        return false;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    map->base = base;
+    map->size = (size_t)st.st_size;
+    map->header = (const CaptureFileHeader *)map->base;
+
+    const CaptureTrailer *trailer = (const CaptureTrailer *)(map->base + map->size - sizeof(CaptureTrailer));
+    const CaptureFileHeader *header = map->header;
+    bool ok = header->magic == CAPTURE_MAGIC && header->version == CAPTURE_VERSION_PACKED &&
+              header->header_size >= sizeof(CaptureFileHeader) && trailer->magic == CAPTURE_TRAILER_MAGIC &&
+              trailer->index_offset >= header->header_size &&
+              // Bound each term before the sum, which could otherwise wrap
+              trailer->index_offset <= map->size - sizeof(CaptureTrailer) &&
+              trailer->block_count <= (map->size - sizeof(CaptureTrailer) - trailer->index_offset) /
+                                          sizeof(CaptureBlockEntry) &&
+              trailer->index_offset + (uint64_t)trailer->block_count * sizeof(CaptureBlockEntry) +
+                  sizeof(CaptureTrailer) == map->size;
+
+    // Blocks must lie between the header and the index, in order
+    map->blocks = (const CaptureBlockEntry *)(map->base + (ok ? trailer->index_offset : 0));
+    uint64_t records = 0;
+    for (uint32_t i = 0; ok && i < trailer->block_count; i++) {
+        const CaptureBlockEntry *b = &map->blocks[i];
+        ok = b->offset >= header->header_size && b->size <= CAPTURE_BLOCK_SIZE &&
+             b->offset <= trailer->index_offset && b->size <= trailer->index_offset - b->offset &&
+             b->records > 0 && b->records <= CAPTURE_BLOCK_MAX_RECORDS && b->first_record == records &&
+             (i == 0 || b->first_timestamp_ns >= map->blocks[i - 1].first_timestamp_ns);
+        records += b->records;
+    }
+    if (!ok || records != trailer->records) {
+        capture_map_close(map);
+        return false;
+    }
+    map->block_count = trailer->block_count;
+    map->records = records;
+    return true;
+}
+
+void capture_map_close(CaptureMap *map) {
+    if (map->base) {
+        munmap((void *)map->base, map->size);
+    }
+    memset(map, 0, sizeof(*map));
+}
+
+uint32_t capture_map_find_block(const CaptureMap *map, uint64_t timestamp_ns) {
+    uint32_t low = 0, high = map->block_count;
+    while (high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if (map->blocks[mid].first_timestamp_ns <= timestamp_ns) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static bool get_varint(const uint8_t **in, const uint8_t *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *in < end; shift += 7) {
+        uint8_t byte = *(*in)++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+int capture_map_decode_block(const CaptureMap *map, uint32_t block, CaptureRecord *records) {
+    if (block >= map->block_count) {
+        return -1;
+    }
+    const CaptureBlockEntry *entry = &map->blocks[block];
+    const uint8_t *in = map->base + entry->offset;
+    const uint8_t *end = in + entry->size;
+    // Decoding reuses the previous record of the same (direction, command)
+    // in the output array instead of a reference table
+    int16_t last[DIRECTIONS][256];
+    memset(last, 0xff, sizeof(last));
+    uint64_t now = entry->first_timestamp_ns;
+
+    for (uint32_t r = 0; r < entry->records; r++) {
+        CaptureRecord *record = &records[r];
+        uint64_t value;
+        if (in >= end) {
+            return -1;
+        }
+        uint8_t tag = *in++;
+        int dir = (tag & TAG_DIRECTION_STATE) ? CAPTURE_DIR_STATE : (tag & TAG_DIRECTION_OUT);
+        if (!get_varint(&in, end, &value)) {
+            return -1;
+        }
+        // Un-zigzag the timestamp delta
+        now += (uint64_t)((int64_t)(value >> 1) ^ -(int64_t)(value & 1));
+
+        if (tag & TAG_DELTA) {
+            uint64_t mask;
+            if (in >= end) {
+                return -1;
+            }
+            uint8_t command = *in++;
+            int ref = last[dir][command];
+            if (ref < 0 || !get_varint(&in, end, &mask)) {
+                return -1;
+            }
+            record->length = records[ref].length;
+            memcpy(record->data, records[ref].data, record->length);
+            for (int i = 1; i < record->length; i++) {
+                if (mask & (1ull << i)) {
+                    if (in >= end) {
+                        return -1;
+                    }
+                    record->data[i] = *in++;
+                }
+            }
+        } else {
+            if (!get_varint(&in, end, &value) || value > CAPTURE_MAX_PACKET || value > (uint64_t)(end - in)) {
+                return -1;
+            }
+            record->length = (int)value;
+            memcpy(record->data, in, record->length);
+            in += record->length;
+        }
+        if (record->length > 0) {
+            last[dir][record->data[0]] = (int16_t)r;
+        }
+        record->timestamp_ns = now;
+        record->direction = (CaptureDirection)dir;
+    }
+    return in == end ? (int)entry->records : -1;
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+bool capture_state_collect(CaptureState *state, const CaptureRecord *record) {
+    if (record->direction != CAPTURE_DIR_STATE || record->length < 2) {
+        return false;
+    }
+    int index = record->data[0], chunks = record->data[1];
+    if (index == 0) {
+        state->length = 0;
+        state->next_chunk = 0;
+        state->timestamp_ns = record->timestamp_ns;
+    }
+    // A chunk out of order means the start was lost: wait for the next checkpoint
+    if (index != state->next_chunk || state->length + record->length - 2 > CAPTURE_STATE_MAX) {
+        state->next_chunk = -1;
+        return false;
+    }
+    memcpy(state->data + state->length, record->data + 2, record->length - 2);
+    state->length += record->length - 2;
+    state->next_chunk++;
+    return state->next_chunk == chunks;
+}
+
+static bool open_packed(CaptureReader *reader, const char *path) {
+    reader->map = calloc(1, sizeof(CaptureMap));
+    reader->block = malloc(CAPTURE_BLOCK_MAX_RECORDS * sizeof(CaptureRecord));
+    if (!reader->map || !reader->block || !capture_map_open(reader->map, path)) {
+        free(reader->map);
+        free(reader->block);
+        reader->map = NULL;
+        reader->block = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool capture_reader_open(CaptureReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (!reader->file) {
+        return false;
+    }
+
+    CaptureFileHeader *header = &reader->header;
+    if (fread(header, sizeof(*header), 1, reader->file) != 1 ||
+        header->magic != CAPTURE_MAGIC ||
+        (header->version != CAPTURE_VERSION && header->version != CAPTURE_VERSION_PACKED) ||
+        header->header_size < sizeof(*header) ||
+        fseek(reader->file, header->header_size, SEEK_SET) != 0) {
+        fclose(reader->file);
+        reader->file = NULL;
+        return false;
+    }
+    header->serial[sizeof(header->serial) - 1] = '\0';
+
+    if (header->version == CAPTURE_VERSION_PACKED) {
+        fclose(reader->file);
+        reader->file = NULL;
+        return open_packed(reader, path);
+    }
+    return true;
+}
+
+static int read_packed(CaptureReader *reader, CaptureRecord *record) {
+    while (reader->block_pos == reader->block_records) {
+        if (reader->next_block == reader->map->block_count) {
+            return 0;
+        }
+        int count = capture_map_decode_block(reader->map, reader->next_block, reader->block);
+        if (count < 0) {
+            return -1;
+        }
+        reader->next_block++;
+        reader->block_records = count;
+        reader->block_pos = 0;
+    }
+    *record = reader->block[reader->block_pos++];
+    reader->records++;
+    return 1;
+}
+
+int capture_read(CaptureReader *reader, CaptureRecord *record) {
+    if (reader->map) {
+        return read_packed(reader, record);
+    }
+
+    CaptureRecordHeader header;
+    size_t got = fread(&header, 1, sizeof(header), reader->file);
+    if (got == 0 && feof(reader->file)) {
+        return 0;
+    }
+    if (got != sizeof(header) || header.length > CAPTURE_MAX_PACKET ||
+        header.direction > CAPTURE_DIR_STATE) {
+        return -1;
+    }
+    if (header.length > 0 && fread(record->data, header.length, 1, reader->file) != 1) {
+        return -1;
+    }
+
+    record->timestamp_ns = header.timestamp_ns;
+    record->direction = (CaptureDirection)header.direction;
+    record->length = header.length;
+    reader->records++;
+    return 1;
+}
+
+bool capture_reader_seek(CaptureReader *reader, uint64_t timestamp_ns) {
+    if (!reader->map || reader->map->block_count == 0) {
+        return false;
+    }
+    uint32_t block = capture_map_find_block(reader->map, timestamp_ns);
+    int count = capture_map_decode_block(reader->map, block, reader->block);
+    if (count < 0) {
+        return false;
+    }
+    reader->next_block = block + 1;
+    reader->block_records = count;
+    reader->block_pos = 0;
+    while (reader->block_pos < count && reader->block[reader->block_pos].timestamp_ns < timestamp_ns) {
+        reader->block_pos++;
+    }
+    reader->records = reader->map->blocks[block].first_record + reader->block_pos;
+    return true;
+}
+
+void capture_reader_close(CaptureReader *reader) {
+    if (reader->file) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+    if (reader->map) {
+        capture_map_close(reader->map);
+        free(reader->map);
+        free(reader->block);
+        reader->map = NULL;
+        reader->block = NULL;
+    }
+}
@@ -0,0 +1,178 @@
+// capture.h
+// Raw GIP packet capture files (part of libgip)
+//
+// Written by `xbox_gip_test --sniff --capture FILE` and read by the replay
+// tooling. Two layouts share the header; capture_reader_open() reads both.
+//
+// Version 1 (raw), little-endian, no padding:
+//
+//   CaptureFileHeader
+//   CaptureRecordHeader + `length` packet bytes, repeated until EOF
+//
+// Version 2 (packed, for long sessions):
+//
+//   CaptureFileHeader
+//   blocks of at most CAPTURE_BLOCK_SIZE bytes
+//   CaptureBlockEntry[block_count]      (the index)
+//   CaptureTrailer
+//
+// Each record in a block is a tag byte (direction, literal/delta), a zigzag
+// varint timestamp delta from the previous record, then either a varint
+// length + the bytes, or the command byte + a varint mask of the bytes that
+// differ from the last packet with that direction and command + those
+// bytes (a delta keeps the reference's length). Every
+// block starts from empty references, so it is a keyframe: blocks decode
+// independently (in parallel, if you like), and capture_map_find_block()
+// seeks by time with a binary search over the index.
+//
+// Either layout may also carry CAPTURE_DIR_STATE records: opaque pipeline
+// checkpoints (see mapper_save_state()) split into chunks of up to
+// CAPTURE_STATE_CHUNK bytes, each prefixed with its index and the chunk
+// count. Tools that only want packets skip them like any non-IN record.
+//
+// Timestamps are CLOCK_MONOTONIC nanoseconds relative to the first record
+// (USB completion time, as delivered by gip_device), so inter-arrival
+// timing survives the round trip.
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define CAPTURE_MAGIC           0x50414358  // "XCAP"
+#define CAPTURE_VERSION         1
+#define CAPTURE_VERSION_PACKED  2
+#define CAPTURE_MAX_PACKET      64          // Largest packet on the interrupt endpoint
+
+#define CAPTURE_STATE_CHUNK     (CAPTURE_MAX_PACKET - 2)
+#define CAPTURE_STATE_MAX       512         // Largest checkpoint
+
+#define CAPTURE_TRAILER_MAGIC       0x58444958  // "XIDX"
+#define CAPTURE_BLOCK_SIZE          4096
+#define CAPTURE_BLOCK_MAX_RECORDS   1024
+
+typedef enum {
+    CAPTURE_DIR_IN  = 0,    // Controller → host
+    CAPTURE_DIR_OUT = 1,    // Host → controller
+    CAPTURE_DIR_STATE = 2   // Checkpoint chunk written by a tool, not a packet
+} CaptureDirection;
+
+#pragma pack(push, 1)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // sizeof(CaptureFileHeader), to allow growing it
+    uint64_t start_realtime_ns; // Wall clock when the capture started
+    uint16_t vendor_id;
+    uint16_t product_id;
+    char serial[32];
+} CaptureFileHeader;
+
+typedef struct {
+    uint64_t timestamp_ns;      // Since the first record
+    uint16_t length;
+    uint8_t direction;          // CaptureDirection
+    uint8_t flags;              // Reserved, 0
+} CaptureRecordHeader;
+
+typedef struct {
+    uint64_t offset;            // From the start of the file
+    uint64_t first_timestamp_ns;
+    uint64_t first_record;      // Index of the block's first record in the file
+    uint32_t size;              // Encoded bytes
+    uint32_t records;
+} CaptureBlockEntry;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t records;
+    uint32_t block_count;
+    uint32_t magic;             // CAPTURE_TRAILER_MAGIC
+} CaptureTrailer;
+
+#pragma pack(pop)
+
+typedef struct {
+    uint64_t timestamp_ns;
+    CaptureDirection direction;
+    int length;
+    uint8_t data[CAPTURE_MAX_PACKET];
+} CaptureRecord;
+
+// A checkpoint reassembled from its chunks
+typedef struct {
+    uint64_t timestamp_ns;      // Of its first chunk
+    int length;
+    int next_chunk;
+    uint8_t data[CAPTURE_STATE_MAX];
+} CaptureState;
+
+typedef struct CapturePacker CapturePacker;
+
+typedef struct {
+    FILE *file;
+    uint64_t first_ns;          // Monotonic time of the first record
+    uint64_t records;
+    CapturePacker *packer;      // Version 2 only
+    char buffer[1 << 16];       // stdio buffer, so records don't hit the disk one by one
+} CaptureWriter;
+
+// A version 2 file mapped read-only
+typedef struct {
+    const uint8_t *base;
+    size_t size;
+    const CaptureFileHeader *header;
+    const CaptureBlockEntry *blocks;
+    uint32_t block_count;
+    uint64_t records;
+} CaptureMap;
+
+typedef struct {
+    FILE *file;                 // Version 1
+    CaptureFileHeader header;
+    uint64_t records;
+
+    CaptureMap *map;            // Version 2: the current block, decoded
+    CaptureRecord *block;
+    int block_records;
+    int block_pos;
+    uint32_t next_block;
+} CaptureReader;
+
+// Create path and write the file header
+bool capture_writer_open(CaptureWriter *writer, const char *path,
+                         uint16_t vendor_id, uint16_t product_id, const char *serial);
+// timestamp_ns is CLOCK_MONOTONIC; packets over CAPTURE_MAX_PACKET are refused
+bool capture_write(CaptureWriter *writer, uint64_t timestamp_ns, CaptureDirection direction,
+                   const uint8_t *data, int length);
+// Same, writing the packed version 2 layout (index written on close)
+bool capture_writer_open_packed(CaptureWriter *writer, const char *path,
+                                uint16_t vendor_id, uint16_t product_id, const char *serial);
+// Checkpoint taken just before the packet with timestamp_ns (split into chunks)
+bool capture_write_state(CaptureWriter *writer, uint64_t timestamp_ns, const uint8_t *state, int length);
+// Flush and close; false if any write failed
+bool capture_writer_close(CaptureWriter *writer);
+
+// Open path (either version) and validate its header
+bool capture_reader_open(CaptureReader *reader, const char *path);
+// 1 = record read, 0 = end of file, -1 = corrupt or truncated record
+int capture_read(CaptureReader *reader, CaptureRecord *record);
+// Feed records in order; true when record completes a checkpoint in state
+bool capture_state_collect(CaptureState *state, const CaptureRecord *record);
+// Continue from the first record at or after timestamp_ns (version 2 only)
+bool capture_reader_seek(CaptureReader *reader, uint64_t timestamp_ns);
+void capture_reader_close(CaptureReader *reader);
+
+// Version 2 random access. capture_map_open() validates the whole index.
+bool capture_map_open(CaptureMap *map, const char *path);
+void capture_map_close(CaptureMap *map);
+// Block holding timestamp_ns: the last one starting at or before it
+uint32_t capture_map_find_block(const CaptureMap *map, uint64_t timestamp_ns);
+// Decode one block into records (room for CAPTURE_BLOCK_MAX_RECORDS).
+// Thread-safe. Returns the record count, or -1 if the block is corrupt.
+int capture_map_decode_block(const CaptureMap *map, uint32_t block, CaptureRecord *records);
+
+#endif // CAPTURE_H
@@ -0,0 +1,154 @@
+// capture_async.c
+// Background capture writer (see capture_async.h)
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "capture_async.h"
+#include "input_state.h"
+
+#define QUEUE_MASK  (CAPTURE_ASYNC_QUEUE_RECORDS - 1)
+
+struct CaptureAsync {
+    // Producer (input thread) and consumer (writer thread) indices on
+    // separate cache lines, as in usb_ring
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t head;
+    _Atomic uint64_t dropped;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t tail;
+
+    _Alignas(CACHE_LINE_SIZE) CaptureRecord queue[CAPTURE_ASYNC_QUEUE_RECORDS];
+
+    // Writer thread only
+    CaptureWriter writer;
+    pthread_t thread;
+    atomic_bool stop;
+    uint64_t written;
+    bool failed;
+    uint64_t flushes;
+    uint64_t flush_buckets[40];     // Log2 ns buckets
+    uint64_t flush_max_ns;
+};
+
+static uint64_t async_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ============================================================================
+// Writer Thread
+// ============================================================================
+
+static void drain(CaptureAsync *c) {
+    uint32_t tail = atomic_load_explicit(&c->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&c->head, memory_order_acquire);
+    if (head == tail) {
+        return;
+    }
+
+    uint64_t start = async_clock_ns();
+    for (; tail != head; tail++) {
+        const CaptureRecord *r = &c->queue[tail & QUEUE_MASK];
+        if (!c->failed && !capture_write(&c->writer, r->timestamp_ns, r->direction, r->data, r->length)) {
+            c->failed = true;
+        }
+        c->written += !c->failed;
+    }
+    atomic_store_explicit(&c->tail, tail, memory_order_release);
+
+    uint64_t ns = async_clock_ns() - start;
+    int bucket = 0;
+    while (bucket < 39 && (ns >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    c->flush_buckets[bucket]++;
+    c->flushes++;
+    if (ns > c->flush_max_ns) {
+        c->flush_max_ns = ns;
+    }
+}
+
+static void *writer_thread(void *arg) {
+    CaptureAsync *c = arg;
+    struct timespec interval = { 0, CAPTURE_ASYNC_DRAIN_MS * 1000000L };
+    while (!atomic_load(&c->stop)) {
+        nanosleep(&interval, NULL);
+        drain(c);
+    }
+    drain(c);
+    return NULL;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+bool capture_async_open(CaptureAsync **out, const char *path, bool packed,
+                        uint16_t vendor_id, uint16_t product_id, const char *serial) {
+    CaptureAsync *c = aligned_alloc(CACHE_LINE_SIZE, sizeof(CaptureAsync));
+    if (!c) {
+        return false;
+    }
+    memset(c, 0, sizeof(*c));
+
+    bool opened = packed ? capture_writer_open_packed(&c->writer, path, vendor_id, product_id, serial)
+                         : capture_writer_open(&c->writer, path, vendor_id, product_id, serial);
+    if (!opened) {
+        free(c);
+        return false;
+    }
+    if (pthread_create(&c->thread, NULL, writer_thread, c) != 0) {
+        capture_writer_close(&c->writer);
+        free(c);
+        return false;
+    }
+    *out = c;
+    return true;
+}
+
+bool capture_async_write(CaptureAsync *c, uint64_t timestamp_ns, CaptureDirection direction,
+                         const uint8_t *data, int length) {
+    uint32_t head = atomic_load_explicit(&c->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&c->tail, memory_order_acquire);
+    if (head - tail == CAPTURE_ASYNC_QUEUE_RECORDS || length < 0 || length > CAPTURE_MAX_PACKET) {
+        atomic_fetch_add_explicit(&c->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    CaptureRecord *r = &c->queue[head & QUEUE_MASK];
+    r->timestamp_ns = timestamp_ns;
+    r->direction = direction;
+    r->length = length;
+    memcpy(r->data, data, length);
+    atomic_store_explicit(&c->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool capture_async_close(CaptureAsync *c, CaptureAsyncStats *stats) {
+    atomic_store(&c->stop, true);
+    pthread_join(c->thread, NULL);
+    bool closed = capture_writer_close(&c->writer);
+
+    CaptureAsyncStats s = {
+        .written = c->written,
+        .dropped = atomic_load(&c->dropped),
+        .flushes = c->flushes,
+        .flush_max_ns = c->flush_max_ns,
+        .failed = c->failed || !closed
+    };
+    uint64_t seen = 0;
+    for (int i = 0; i < 40 && s.flushes > 0; i++) {
+        seen += c->flush_buckets[i];
+        if (seen > s.flushes * 99 / 100) {
+            s.flush_p99_ns = 2ull << i;
+            break;
+        }
+    }
+    if (stats) {
+        *stats = s;
+    }
+    free(c);
+    return !s.failed && s.dropped == 0;
+}
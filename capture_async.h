@@ -0,0 +1,42 @@
+// capture_async.h
+// Background capture writer for live sessions (part of libgip)
+//
+// The packet callback only copies the packet into a single-producer/
+// single-consumer queue of records; a writer thread drains the queue every
+// few milliseconds into a CaptureWriter, whose 64 KB stdio buffer turns the
+// records into large sequential writes. The input path makes no syscalls
+// and never waits for the disk: if the queue is full the record is dropped
+// and counted.
+
+#ifndef CAPTURE_ASYNC_H
+#define CAPTURE_ASYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "capture.h"
+
+#define CAPTURE_ASYNC_QUEUE_RECORDS 4096    // Must be a power of two; ~4 s at 1 kHz
+#define CAPTURE_ASYNC_DRAIN_MS      10
+
+typedef struct CaptureAsync CaptureAsync;
+
+typedef struct {
+    uint64_t written;           // Records handed to the file
+    uint64_t dropped;           // Refused because the queue was full
+    uint64_t flushes;           // Drain passes that wrote something
+    uint64_t flush_p99_ns;      // Upper bound of the log2 bucket
+    uint64_t flush_max_ns;
+    bool failed;                // A write to the file failed; later records were discarded
+} CaptureAsyncStats;
+
+// Create path (packed = version 2 layout) and start the writer thread
+bool capture_async_open(CaptureAsync **out, const char *path, bool packed,
+                        uint16_t vendor_id, uint16_t product_id, const char *serial);
+// Hot path, single producer. false = dropped (queue full)
+bool capture_async_write(CaptureAsync *capture, uint64_t timestamp_ns, CaptureDirection direction,
+                         const uint8_t *data, int length);
+// Drain what is queued, close the file and free capture; stats may be NULL.
+// false if any record was dropped or any write failed.
+bool capture_async_close(CaptureAsync *capture, CaptureAsyncStats *stats);
+
+#endif // CAPTURE_ASYNC_H
@@ -0,0 +1,306 @@
+// capture_gen.c
+// Writes the synthetic capture corpus used by the replay benchmark and the
+// PGO build: scripted sessions of realistic controller input, generated
+// from a fixed seed so every machine trains and measures on identical data.
+// Real captures from `xbox_gip_test --sniff --capture` can sit alongside.
+// Compile: make capture_gen
+// Run: ./capture_gen [directory]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gip.h"
+#include "capture.h"
+
+#define DEFAULT_DIRECTORY   "captures"
+
+#define REPORT_INTERVAL_NS  4000000ull     // 250 Hz while anything changes
+#define REPORT_JITTER_NS    400000ull
+#define REST_NOISE          1500            // Resting stick noise, inside the deadzone
+
+typedef struct {
+    uint16_t buttons;
+    uint8_t left_trigger;
+    uint8_t right_trigger;
+    int16_t left_x, left_y;
+    int16_t right_x, right_y;
+} PadState;
+
+typedef struct {
+    CaptureWriter writer;
+    uint64_t now_ns;
+    uint8_t sequence;
+    uint8_t status_sequence;
+    PadState last;
+    bool ok;
+} Session;
+
+static uint32_t rng_state;
+
+static uint32_t rng_next(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static int rng_range(int low, int high) {
+    return low + (int)(rng_next() % (uint32_t)(high - low + 1));
+}
+
+static int16_t clamp_axis(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+}
+
+static int16_t rest_noise(void) {
+    return (int16_t)rng_range(-REST_NOISE, REST_NOISE);
+}
+
+// Integer sine approximation (Bhaskara I), phase in 1/1024ths of a turn,
+// so the corpus doesn't depend on the platform's libm
+static int32_t isin(int32_t phase, int32_t amplitude) {
+    phase &= 1023;
+    int32_t sign = 1;
+    if (phase >= 512) {
+        phase -= 512;
+        sign = -1;
+    }
+    int64_t x = phase;   // 0..511 = 0..pi
+    int64_t numerator = 16 * x * (512 - x);
+    int64_t denominator = 5 * 512 * 512 - 4 * x * (512 - x);
+    return sign * (int32_t)(amplitude * numerator / denominator);
+}
+
+static bool session_open(Session *s, const char *directory, const char *name, uint32_t seed) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    memset(s, 0, sizeof(*s));
+    rng_state = seed;
+    s->ok = capture_writer_open(&s->writer, path, 0x045e, 0x02dd, "synthetic");
+    if (!s->ok) {
+        printf("❌ Could not create %s\n", path);
+    }
+    return s->ok;
+}
+
+static void session_packet(Session *s, const uint8_t *data, int length) {
+    s->ok &= capture_write(&s->writer, s->now_ns, CAPTURE_DIR_IN, data, length);
+}
+
+static void session_input(Session *s, const PadState *pad) {
+    GipInputPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.header.command = GIP_CMD_INPUT;
+    packet.header.sequence = s->sequence++;
+    packet.header.length = sizeof(packet) - sizeof(GipHeader);
+    packet.buttons = pad->buttons;
+    packet.left_trigger = pad->left_trigger;
+    packet.right_trigger = pad->right_trigger;
+    packet.left_stick_x = pad->left_x;
+    packet.left_stick_y = pad->left_y;
+    packet.right_stick_x = pad->right_x;
+    packet.right_stick_y = pad->right_y;
+    session_packet(s, (const uint8_t *)&packet, sizeof(packet));
+    s->last = *pad;
+}
+
+static void session_status(Session *s) {
+    uint8_t status[] = { GIP_CMD_STATUS, 0x20, s->status_sequence++, 0x04, 0x0f, 0x00, 0x00, 0x00 };
+    session_packet(s, status, sizeof(status));
+}
+
+static void session_guide(Session *s, bool pressed) {
+    uint8_t guide[] = { GIP_CMD_GUIDE_BUTTON, 0x30, s->status_sequence++, 0x02, pressed ? 0x01 : 0x00, 0x5b };
+    session_packet(s, guide, sizeof(guide));
+}
+
+// Advance one report slot. The controller only reports changes, so an
+// unchanged pad produces no packet.
+static void session_step(Session *s, const PadState *pad) {
+    s->now_ns += REPORT_INTERVAL_NS - REPORT_JITTER_NS / 2 + rng_next() % REPORT_JITTER_NS;
+    if (memcmp(pad, &s->last, sizeof(*pad)) != 0) {
+        session_input(s, pad);
+    }
+}
+
+static bool session_close(Session *s, const char *name) {
+    uint64_t records = s->writer.records;
+    s->ok &= capture_writer_close(&s->writer);
+    if (s->ok) {
+        printf("✅ %-24s %7llu packets, %5.1f s\n", name, (unsigned long long)records, s->now_ns / 1e9);
+    } else {
+        printf("❌ Failed to write %s\n", name);
+    }
+    return s->ok;
+}
+
+// ============================================================================
+// Scenarios
+// ============================================================================
+
+// Shooter: WASD movement on the left stick, continuous aiming with flicks on
+// the right, trigger pulls and button taps
+static bool generate_fps(const char *directory) {
+    static const char *name = "synthetic_fps.xcap";
+    static const int16_t move_dirs[8][2] = {
+        {0, 32000}, {22000, 22000}, {32000, 0}, {22000, -22000},
+        {0, -32000}, {-22000, -22000}, {-32000, 0}, {-22000, 22000}
+    };
+    static const uint16_t taps[] = { XBOX_BTN_A, XBOX_BTN_X, XBOX_BTN_B, XBOX_BTN_LB, XBOX_BTN_RB, XBOX_BTN_Y };
+    Session s;
+    PadState pad;
+    if (!session_open(&s, directory, name, 0x1697f05)) {
+        return false;
+    }
+    memset(&pad, 0, sizeof(pad));
+
+    int move_left = 0, move_dir = 0;
+    int aim_left = 0, aim_mode = 0, aim_phase = 0, aim_speed = 0, aim_radius = 0;
+    int flick_dx = 0, flick_dy = 0;
+    int fire_left = rng_range(100, 400), fire_hold = 0;
+    int tap_left = rng_range(100, 300), tap_hold = 0;
+    uint16_t tap_button = 0;
+
+    for (int slot = 0; slot < 60 * 250; slot++) {
+        // Left stick: hold a direction for a while, sometimes let go
+        if (--move_left <= 0) {
+            move_left = rng_range(60, 400);
+            move_dir = (rng_next() % 4 == 0) ? -1 : (int)(rng_next() % 8);
+        }
+        if (move_dir < 0) {
+            pad.left_x = rest_noise();
+            pad.left_y = rest_noise();
+        } else {
+            pad.left_x = clamp_axis(move_dirs[move_dir][0] + rng_range(-600, 600));
+            pad.left_y = clamp_axis(move_dirs[move_dir][1] + rng_range(-600, 600));
+        }
+
+        // Right stick: rest, slow sweeps, or a quick flick
+        if (--aim_left <= 0) {
+            aim_mode = (int)(rng_next() % 3);
+            aim_left = (aim_mode == 2) ? rng_range(8, 20) : rng_range(100, 500);
+            aim_speed = rng_range(2, 12);
+            aim_radius = rng_range(9000, 30000);
+            flick_dx = rng_range(-32000, 32000);
+            flick_dy = rng_range(-20000, 20000);
+        }
+        if (aim_mode == 0) {
+            pad.right_x = rest_noise();
+            pad.right_y = rest_noise();
+        } else if (aim_mode == 1) {
+            aim_phase += aim_speed;
+            pad.right_x = clamp_axis(isin(aim_phase + 256, aim_radius) + rng_range(-300, 300));
+            pad.right_y = clamp_axis(isin(aim_phase, aim_radius / 2) + rng_range(-300, 300));
+        } else {
+            pad.right_x = clamp_axis(flick_dx + rng_range(-500, 500));
+            pad.right_y = clamp_axis(flick_dy + rng_range(-500, 500));
+        }
+
+        // Right trigger: ramp in, hold, ramp out; left trigger aims down sights
+        if (fire_hold > 0) {
+            fire_hold--;
+            pad.right_trigger = (pad.right_trigger > 215) ? 255 : pad.right_trigger + 40;
+        } else {
+            pad.right_trigger = (pad.right_trigger < 40) ? 0 : pad.right_trigger - 40;
+            if (--fire_left <= 0) {
+                fire_left = rng_range(150, 500);
+                fire_hold = rng_range(20, 120);
+            }
+        }
+        pad.left_trigger = (aim_mode == 1) ? 200 + (uint8_t)rng_range(0, 55) : 0;
+
+        // Face buttons and bumpers: short taps
+        if (tap_hold > 0) {
+            if (--tap_hold == 0) {
+                pad.buttons &= (uint16_t)~tap_button;
+            }
+        } else if (--tap_left <= 0) {
+            tap_left = rng_range(80, 400);
+            tap_hold = rng_range(15, 60);
+            tap_button = taps[rng_next() % (sizeof(taps) / sizeof(taps[0]))];
+            pad.buttons |= tap_button;
+        }
+
+        session_step(&s, &pad);
+        if (slot % (250 * 20) == 0) {
+            session_status(&s);
+        }
+    }
+    return session_close(&s, name);
+}
+
+// Menus: sticks at rest, D-pad and A/B navigation
+static bool generate_menus(const char *directory) {
+    static const char *name = "synthetic_menus.xcap";
+    static const uint16_t taps[] = {
+        XBOX_BTN_DPAD_UP, XBOX_BTN_DPAD_DOWN, XBOX_BTN_DPAD_LEFT, XBOX_BTN_DPAD_RIGHT,
+        XBOX_BTN_DPAD_DOWN, XBOX_BTN_A, XBOX_BTN_B, XBOX_BTN_MENU, XBOX_BTN_VIEW
+    };
+    Session s;
+    PadState pad;
+    if (!session_open(&s, directory, name, 0x1697a11)) {
+        return false;
+    }
+    memset(&pad, 0, sizeof(pad));
+
+    int tap_left = rng_range(50, 150), tap_hold = 0;
+    for (int slot = 0; slot < 30 * 250; slot++) {
+        // Resting sticks drift a little every few reports
+        if (rng_next() % 12 == 0) {
+            pad.left_x = rest_noise();
+            pad.left_y = rest_noise();
+            pad.right_x = rest_noise();
+            pad.right_y = rest_noise();
+        }
+
+        if (tap_hold > 0) {
+            if (--tap_hold == 0) {
+                pad.buttons = 0;
+            }
+        } else if (--tap_left <= 0) {
+            tap_left = rng_range(50, 150);
+            tap_hold = rng_range(15, 40);
+            pad.buttons = taps[rng_next() % (sizeof(taps) / sizeof(taps[0]))];
+        }
+
+        session_step(&s, &pad);
+        if (slot == 20 * 250) {
+            session_guide(&s, true);
+        } else if (slot == 20 * 250 + 60) {
+            session_guide(&s, false);
+        }
+    }
+    return session_close(&s, name);
+}
+
+// Idle: controller on the desk, only resting noise and status reports
+static bool generate_idle(const char *directory) {
+    static const char *name = "synthetic_idle.xcap";
+    Session s;
+    PadState pad;
+    if (!session_open(&s, directory, name, 0x1697d1e)) {
+        return false;
+    }
+    memset(&pad, 0, sizeof(pad));
+
+    for (int slot = 0; slot < 30 * 250; slot++) {
+        if (rng_next() % 40 == 0) {
+            pad.left_x = rest_noise();
+            pad.right_y = rest_noise();
+        }
+        session_step(&s, &pad);
+        if (slot % (250 * 5) == 0) {
+            session_status(&s);
+        }
+    }
+    return session_close(&s, name);
+}
+
+int main(int argc, char **argv) {
+    const char *directory = (argc > 1) ? argv[1] : DEFAULT_DIRECTORY;
+
+    bool ok = generate_fps(directory);
+    ok &= generate_menus(directory);
+    ok &= generate_idle(directory);
+    return ok ? 0 : 1;
+}
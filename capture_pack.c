@@ -0,0 +1,244 @@
+// capture_pack.c
+// Converts captures between the raw (version 1) and packed, indexed
+// (version 2) layouts, and measures what packing buys: size, block decode
+// throughput on one thread and on many, and seek time through the index.
+// Compile: make capture_pack
+// Run: ./capture_pack IN.xcap OUT.xcap            (pack)
+//      ./capture_pack --unpack IN.xcap OUT.xcap   (back to version 1)
+//      ./capture_pack --bench FILE.xcap [threads]  (FILE must be packed)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "capture.h"
+
+#define DEFAULT_THREADS     4
+#define MAX_THREADS         64
+#define BENCH_MIN_NS        200000000ull    // Repeat each measurement for at least this long
+#define SEEK_TRIALS         2000
+
+static uint64_t bench_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ============================================================================
+// Conversion
+// ============================================================================
+
+static int convert(const char *in_path, const char *out_path, bool packed) {
+    CaptureReader reader;
+    if (!capture_reader_open(&reader, in_path)) {
+        printf("❌ %s is not a capture file\n", in_path);
+        return 1;
+    }
+
+    CaptureWriter *writer = malloc(sizeof(CaptureWriter));
+    const CaptureFileHeader *h = &reader.header;
+    bool opened = packed
+        ? capture_writer_open_packed(writer, out_path, h->vendor_id, h->product_id, h->serial)
+        : capture_writer_open(writer, out_path, h->vendor_id, h->product_id, h->serial);
+    if (!opened) {
+        printf("❌ Could not create %s\n", out_path);
+        capture_reader_close(&reader);
+        free(writer);
+        return 1;
+    }
+
+    // Timestamps are already relative to the first record, which the writer
+    // makes its zero again
+    CaptureRecord record;
+    int result;
+    bool ok = true;
+    while ((result = capture_read(&reader, &record)) == 1) {
+        ok = ok && capture_write(writer, record.timestamp_ns, record.direction, record.data, record.length);
+    }
+    ok = capture_writer_close(writer) && ok;
+    uint64_t records = reader.records;
+    capture_reader_close(&reader);
+    free(writer);
+
+    if (result < 0) {
+        printf("⚠️  %s is truncated after %llu records\n", in_path, (unsigned long long)records);
+    }
+    if (!ok) {
+        printf("❌ Writing %s failed\n", out_path);
+        return 1;
+    }
+    printf("✅ Wrote %llu records to %s (%s)\n", (unsigned long long)records, out_path,
+           packed ? "packed" : "raw");
+    return 0;
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+typedef struct {
+    const CaptureMap *map;
+    atomic_uint *next;
+    uint64_t checksum;
+    bool failed;
+} DecodeWorker;
+
+// Order-independent, so one thread and many must agree
+static uint64_t block_checksum(const CaptureRecord *records, int count) {
+    uint64_t hash = 1469598103934665603ull;
+    for (int r = 0; r < count; r++) {
+        hash = (hash ^ records[r].timestamp_ns) * 1099511628211ull;
+        for (int i = 0; i < records[r].length; i++) {
+            hash = (hash ^ records[r].data[i]) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+static void *decode_worker(void *arg) {
+    DecodeWorker *w = arg;
+    CaptureRecord *records = malloc(CAPTURE_BLOCK_MAX_RECORDS * sizeof(CaptureRecord));
+    unsigned block;
+    while ((block = atomic_fetch_add_explicit(w->next, 1, memory_order_relaxed)) < w->map->block_count) {
+        int count = capture_map_decode_block(w->map, block, records);
+        if (count < 0) {
+            w->failed = true;
+            break;
+        }
+        w->checksum += block_checksum(records, count);
+    }
+    free(records);
+    return NULL;
+}
+
+// One full decode of the file on `threads` threads; returns elapsed ns
+static uint64_t decode_all(const CaptureMap *map, int threads, uint64_t *checksum, bool *failed) {
+    pthread_t tid[MAX_THREADS];
+    DecodeWorker workers[MAX_THREADS];
+    atomic_uint next = 0;
+
+    uint64_t start = bench_clock_ns();
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (DecodeWorker){ .map = map, .next = &next };
+        pthread_create(&tid[t], NULL, decode_worker, &workers[t]);
+    }
+    *checksum = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tid[t], NULL);
+        *checksum += workers[t].checksum;
+        *failed |= workers[t].failed;
+    }
+    return bench_clock_ns() - start;
+}
+
+static void report_decode(const char *label, const CaptureMap *map, int threads,
+                          uint64_t raw_bytes, uint64_t *checksum, bool *failed) {
+    uint64_t elapsed = 0, best = UINT64_MAX;
+    int passes = 0;
+    while (elapsed < BENCH_MIN_NS && !*failed) {
+        uint64_t ns = decode_all(map, threads, checksum, failed);
+        best = ns < best ? ns : best;
+        elapsed += ns;
+        passes++;
+    }
+    double seconds = best / 1e9;
+    printf("  %-12s %8.1f MB/s (raw) %8.2f M records/s   best of %d\n", label,
+           raw_bytes / seconds / 1e6, map->records / seconds / 1e6, passes);
+}
+
+static int bench(const char *path, int threads) {
+    CaptureMap map;
+    if (!capture_map_open(&map, path)) {
+        printf("❌ %s is not a packed capture (pack it first: ./capture_pack IN OUT)\n", path);
+        return 1;
+    }
+
+    // What the same records take in the raw layout
+    CaptureRecord *records = malloc(CAPTURE_BLOCK_MAX_RECORDS * sizeof(CaptureRecord));
+    uint64_t raw_bytes = sizeof(CaptureFileHeader);
+    uint64_t last_ns = 0;
+    for (uint32_t b = 0; b < map.block_count; b++) {
+        int count = capture_map_decode_block(&map, b, records);
+        if (count < 0) {
+            printf("❌ Block %u is corrupt\n", b);
+            free(records);
+            capture_map_close(&map);
+            return 1;
+        }
+        for (int r = 0; r < count; r++) {
+            raw_bytes += sizeof(CaptureRecordHeader) + records[r].length;
+            last_ns = records[r].timestamp_ns;
+        }
+    }
+    free(records);
+
+    printf("%s: %llu records in %u blocks, %.1f s\n", path, (unsigned long long)map.records,
+           map.block_count, last_ns / 1e9);
+    printf("  size         %8.1f KB packed, %.1f KB raw, ratio %.2fx\n\n",
+           map.size / 1024.0, raw_bytes / 1024.0, (double)raw_bytes / map.size);
+
+    printf("Block decode:\n");
+    uint64_t single, parallel;
+    bool failed = false;
+    report_decode("1 thread", &map, 1, raw_bytes, &single, &failed);
+    char label[32];
+    snprintf(label, sizeof(label), "%d threads", threads);
+    report_decode(label, &map, threads, raw_bytes, &parallel, &failed);
+    if (failed || single != parallel) {
+        printf("❌ Parallel decode disagrees with the single-threaded one\n");
+        capture_map_close(&map);
+        return 1;
+    }
+
+    // Random seeks: index lookup + one block decode + first record
+    CaptureReader reader;
+    if (!capture_reader_open(&reader, path)) {
+        capture_map_close(&map);
+        return 1;
+    }
+    uint32_t rng = 12345;
+    CaptureRecord record;
+    int misses = 0;
+    uint64_t start = bench_clock_ns();
+    for (int i = 0; i < SEEK_TRIALS; i++) {
+        rng = rng * 1664525u + 1013904223u;
+        uint64_t target = last_ns ? ((uint64_t)rng * last_ns) >> 32 : 0;
+        if (!capture_reader_seek(&reader, target) || capture_read(&reader, &record) != 1 ||
+            record.timestamp_ns < target) {
+            misses++;
+        }
+    }
+    uint64_t seek_ns = (bench_clock_ns() - start) / SEEK_TRIALS;
+    capture_reader_close(&reader);
+    capture_map_close(&map);
+
+    printf("\nSeek:          %8.1f us per seek + read (%d random)\n", seek_ns / 1000.0, SEEK_TRIALS);
+    if (misses) {
+        printf("❌ %d seeks landed before their target\n", misses);
+        return 1;
+    }
+    printf("\n✅ Checksums match (%016llx)\n", (unsigned long long)single);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[1], "--bench") == 0) {
+        int threads = argc > 3 ? atoi(argv[3]) : DEFAULT_THREADS;
+        if (threads < 1 || threads > MAX_THREADS) {
+            printf("❌ threads must be 1..%d\n", MAX_THREADS);
+            return 1;
+        }
+        return bench(argv[2], threads);
+    }
+    if (argc == 4 && strcmp(argv[1], "--unpack") == 0) {
+        return convert(argv[2], argv[3], false);
+    }
+    if (argc == 3 && argv[1][0] != '-') {
+        return convert(argv[1], argv[2], true);
+    }
+    printf("Usage: %s IN.xcap OUT.xcap | --unpack IN.xcap OUT.xcap | --bench FILE.xcap [threads]\n",
+           argv[0]);
+    return 1;
+}
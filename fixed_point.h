@@ -0,0 +1,249 @@
+// fixed_point.h
+// Integer stick pipeline in Q15/Q16 fixed point
+// Mirrors stick_math.h stage for stage (deadzone, calibration, smoothing,
+// curve, scaling) without floats on the per-packet path. Every operation is
+// integer add/multiply/shift/divide, so results are bit-exact across
+// compilers and CPUs - golden replays stay golden, and low-end ARM boards
+// without a fast FPU skip powf/sqrtf entirely.
+//
+// Formats:  Q15 = value * 32768 (stick positions, smoothing, curve output)
+//           Q16 = value * 65536 (exponents, pixel deltas)
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "calibration.h"
+
+#define FX_ONE_Q15          32768
+#define FX_ONE_Q16          65536
+
+// Curve lookup table: 2^8 segments over 0..1, linearly interpolated
+#define FX_CURVE_LUT_BITS   8
+#define FX_CURVE_LUT_SIZE   (1 << FX_CURVE_LUT_BITS)
+
+// Calibration table rounded to whole raw units
+typedef struct {
+    uint16_t outer_radius[CALIBRATION_BINS];
+} FixedStickRange;
+
+// Everything the per-packet path needs, precomputed at startup
+typedef struct {
+    uint32_t deadzone_sq;                       // deadzone², raw units
+    int32_t alpha_q15;                          // 1 - mouse_smoothing
+    int32_t gain_q16;                           // pixels per tick at full deflection
+    int32_t curve_lut[FX_CURVE_LUT_SIZE + 1];   // |v|^mouse_curve, Q15
+} FixedStickParams;
+
+// ============================================================================
+// Integer math helpers
+// ============================================================================
+
+// floor(sqrt(v)), bit by bit
+static inline uint32_t fx_isqrt(uint32_t v) {
+    uint32_t result = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= result + bit) {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+// log2 of a positive Q15 value, as Q16 (negative below 1.0)
+static inline int32_t fx_log2_q16(uint32_t v) {
+    int32_t result = 0;
+
+    // Normalize into [1.0, 2.0)
+    while (v < (1u << 15)) {
+        v <<= 1;
+        result -= FX_ONE_Q16;
+    }
+    while (v >= (2u << 15)) {
+        v >>= 1;
+        result += FX_ONE_Q16;
+    }
+
+    // One fractional bit per squaring
+    uint64_t z = v;
+    for (int bit = 15; bit >= 0; bit--) {
+        z = (z * z) >> 15;
+        if (z >= (2u << 15)) {
+            z >>= 1;
+            result += 1 << bit;
+        }
+    }
+    return result;
+}
+
+// 2^e for a Q16 exponent <= 0, as Q15
+static inline int32_t fx_exp2_q15(int32_t e) {
+    // 2^(2^-k) in Q30 for k = 1..16
+    static const uint32_t root_q30[16] = {
+        1518500250u, 1276901417u, 1170923762u, 1121280436u,
+        1097253708u, 1085434106u, 1079572136u, 1076653033u,
+        1075196443u, 1074468888u, 1074105294u, 1073923544u,
+        1073832680u, 1073787251u, 1073764537u, 1073753181u
+    };
+
+    if (e > 0) {
+        e = 0;
+    }
+    int32_t whole = (-e + FX_ONE_Q16 - 1) >> 16;   // ceil(-e)
+    uint32_t frac = (uint32_t)(e + whole * FX_ONE_Q16);  // e = -whole + frac
+    if (whole > 30) {
+        return 0;
+    }
+
+    uint64_t r = 1u << 30;
+    for (int k = 0; k < 16; k++) {
+        if (frac & (0x8000u >> k)) {
+            r = (r * root_q30[k] + (1u << 29)) >> 30;
+        }
+    }
+    return (int32_t)((r >> whole) >> 15);
+}
+
+// |v|^curve for v in Q15 (0..1), curve in Q16
+static inline int32_t fx_pow_q15(int32_t v, int32_t curve_q16) {
+    if (v <= 0) {
+        return 0;
+    }
+    int64_t e = ((int64_t)fx_log2_q16((uint32_t)v) * curve_q16) / FX_ONE_Q16;
+    return fx_exp2_q15((int32_t)e);
+}
+
+// ============================================================================
+// Setup (once per config/calibration load)
+// ============================================================================
+
+// Config floats are rounded once here; the LUT itself is built with the
+// integer log2/exp2 above, so it is identical on every platform.
+static inline void fx_stick_params_init(FixedStickParams *p, int16_t deadzone,
+                                        float smoothing, float curve, float sensitivity,
+                                        float pixels_per_tick) {
+    int32_t curve_q16 = (int32_t)lroundf(curve * FX_ONE_Q16);
+
+    p->deadzone_sq = (uint32_t)((int32_t)deadzone * deadzone);
+    p->alpha_q15 = (int32_t)lroundf((1.0f - smoothing) * FX_ONE_Q15);
+    p->gain_q16 = (int32_t)lroundf(sensitivity * pixels_per_tick * FX_ONE_Q16);
+
+    for (int i = 0; i <= FX_CURVE_LUT_SIZE; i++) {
+        p->curve_lut[i] = fx_pow_q15(i << (15 - FX_CURVE_LUT_BITS), curve_q16);
+    }
+}
+
+static inline void fx_range_from_calibration(FixedStickRange *fixed, const StickRange *range) {
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        fixed->outer_radius[i] = (uint16_t)lroundf(range->outer_radius[i]);
+    }
+}
+
+// ============================================================================
+// Per-packet kernels
+// ============================================================================
+
+// Integer version of calibration_outer_radius(): diamond angle in Q16
+static inline int32_t fx_outer_radius(const FixedStickRange *range, int32_t x, int32_t y) {
+    uint32_t ax = (uint32_t)(x < 0 ? -x : x);
+    uint32_t ay = (uint32_t)(y < 0 ? -y : y);
+    uint32_t sum = ax + ay;
+    uint32_t quadrant, part;
+
+    if (y >= 0) {
+        quadrant = (x >= 0) ? 0 : 1;
+        part = (x >= 0) ? ay : ax;
+    } else {
+        quadrant = (x < 0) ? 2 : 3;
+        part = (x < 0) ? ay : ax;
+    }
+
+    uint32_t angle_q16 = (quadrant << 16) + (uint32_t)(((uint64_t)part << 16) / sum);
+    uint32_t pos_q16 = angle_q16 * (CALIBRATION_BINS / 4);
+    uint32_t i0 = (pos_q16 >> 16) % CALIBRATION_BINS;
+    uint32_t i1 = (i0 + 1) % CALIBRATION_BINS;
+    int32_t frac = (int32_t)(pos_q16 & 0xFFFF);
+
+    int32_t r0 = range->outer_radius[i0];
+    int32_t r1 = range->outer_radius[i1];
+    return r0 + (int32_t)(((int64_t)(r1 - r0) * frac) >> 16);
+}
+
+// Integer version of apply_deadzone(). The square root is only needed when
+// the stick is past its calibrated reach (or outside the unit circle).
+static inline void fx_apply_deadzone(int16_t *x, int16_t *y, const FixedStickParams *p,
+                                     const FixedStickRange *range) {
+    int32_t ix = *x, iy = *y;
+    uint32_t mag_sq = (uint32_t)(ix * ix) + (uint32_t)(iy * iy);
+    uint32_t denom;
+
+    if (mag_sq < p->deadzone_sq) {
+        *x = 0;
+        *y = 0;
+        return;
+    }
+
+    if (range && mag_sq > 0) {
+        // Stretch to full deflection, clamped to the unit circle
+        uint32_t outer = (uint32_t)fx_outer_radius(range, ix, iy);
+        denom = (mag_sq > outer * outer) ? fx_isqrt(mag_sq) : outer;
+    } else if (mag_sq > 32767u * 32767u) {
+        denom = fx_isqrt(mag_sq);
+    } else {
+        return;
+    }
+
+    // One division for both axes: scale = 32767 / denom in Q16
+    int32_t scale_q16 = (int32_t)((32767u << 16) / denom);
+    *x = (int16_t)((ix * (int64_t)scale_q16) / FX_ONE_Q16);
+    *y = (int16_t)((iy * (int64_t)scale_q16) / FX_ONE_Q16);
+}
+
+// Signed curve lookup: sign(v) * |v|^curve, Q15 in and out
+static inline int32_t fx_curve(const FixedStickParams *p, int32_t v) {
+    int32_t a = v < 0 ? -v : v;
+    if (a >= FX_ONE_Q15) {
+        a = FX_ONE_Q15;
+    }
+
+    int32_t index = a >> (15 - FX_CURVE_LUT_BITS);
+    int32_t frac = a & ((1 << (15 - FX_CURVE_LUT_BITS)) - 1);
+    int32_t out = p->curve_lut[index];
+    if (index < FX_CURVE_LUT_SIZE) {
+        out += ((p->curve_lut[index + 1] - out) * frac) >> (15 - FX_CURVE_LUT_BITS);
+    }
+    return v < 0 ? -out : out;
+}
+
+// Integer version of stick_shape_input() plus sensitivity scaling.
+// smoothed_x/y: filter state in Q15. dx/dy: pixel deltas in Q16.
+static inline void fx_process_stick_as_mouse(const FixedStickParams *p, int16_t x, int16_t y,
+                                             int32_t *smoothed_x, int32_t *smoothed_y,
+                                             int32_t *dx_q16, int32_t *dy_q16) {
+    // Axes are swapped in the controller - swap them back, invert Y
+    int32_t target_x = y;
+    int32_t target_y = -(int32_t)x;
+
+    // Exponential smoothing: s += alpha * (target - s), rounded
+    *smoothed_x += (int32_t)(((int64_t)p->alpha_q15 * (target_x - *smoothed_x) + (1 << 14)) >> 15);
+    *smoothed_y += (int32_t)(((int64_t)p->alpha_q15 * (target_y - *smoothed_y) + (1 << 14)) >> 15);
+
+    int32_t curved_x = fx_curve(p, *smoothed_x);
+    int32_t curved_y = fx_curve(p, *smoothed_y);
+
+    *dx_q16 = (int32_t)(((int64_t)curved_x * p->gain_q16) >> 15);
+    *dy_q16 = (int32_t)(((int64_t)curved_y * p->gain_q16) >> 15);
+}
+
+#endif // FIXED_POINT_H
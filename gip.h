@@ -5,6 +5,7 @@
 #ifndef GIP_H
 #define GIP_H
 
+#include <stdio.h>
 #include <stdint.h>
 
 #pragma pack(push, 1)
@@ -0,0 +1,663 @@
+// gip_device.c
+// Xbox One controller over USB (part of libgip)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <libusb.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#elif defined(__APPLE__)
+#include <sys/event.h>
+#endif
+#include "gip_device.h"
+#include "gip_protocol.h"
+#include "probes.h"
+
+// Transfers kept in flight, so a packet arriving while the previous one is
+// being handled doesn't wait for a resubmit
+#define GIP_NUM_TRANSFERS       2
+#define GIP_PACKET_SIZE         64
+
+#define HANDSHAKE_ATTEMPTS      5
+#define HANDSHAKE_TIMEOUT_MS    2000
+#define COMMAND_TIMEOUT_MS      1000
+
+// Stop: 100 ms event-handling rounds to wait for cancelled transfers
+#define STOP_SPINS              20
+
+// Recovery probe: long enough for a streaming controller to send a report
+#define PROBE_TIMEOUT_MS        20
+
+struct GipDevice {
+    libusb_context *ctx;
+    libusb_device_handle *handle;
+    uint8_t in_endpoint;
+    uint8_t out_endpoint;
+    char serial[64];
+    int verbosity;
+
+    // Asynchronous input
+    struct libusb_transfer *transfers[GIP_NUM_TRANSFERS];
+    uint8_t buffers[GIP_NUM_TRANSFERS][GIP_PACKET_SIZE];
+    GipPacketCallback callback;
+    void *user_data;
+    int in_flight;              // Submitted transfers not yet handed back
+    bool active[GIP_NUM_TRANSFERS];     // Which ones those are
+    int delivered;              // Packets passed to the callback this process() call
+    int error;                  // First fatal transfer error (0 = none)
+    bool stopping;
+    bool started;               // Between gip_device_start() and gip_device_stop()
+
+    int poll_fd;                // epoll/kqueue set over libusb's fds (-1 = not created)
+};
+
+uint64_t gip_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+const char *gip_strerror(int error) {
+    switch (error) {
+        case GIP_OK:                 return "success";
+        case GIP_ERROR_IO:           return "I/O error";
+        case GIP_ERROR_ACCESS:       return "access denied (run with sudo)";
+        case GIP_ERROR_NO_DEVICE:    return "controller disconnected";
+        case GIP_ERROR_NOT_FOUND:    return "controller not found";
+        case GIP_ERROR_BUSY:         return "interface busy (another driver or program has it)";
+        case GIP_ERROR_TIMEOUT:      return "timed out";
+        case GIP_ERROR_OVERFLOW:     return "packet overflow";
+        case GIP_ERROR_PIPE:         return "endpoint stalled";
+        case GIP_ERROR_NO_MEM:       return "out of memory";
+        case GIP_ERROR_NO_ENDPOINTS: return "could not find interrupt endpoints";
+        default:                     return "unknown error";
+    }
+}
+
+// ============================================================================
+// Open / Close
+// ============================================================================
+
+static bool find_endpoints(GipDevice *dev) {
+    struct libusb_config_descriptor *desc;
+    if (libusb_get_active_config_descriptor(libusb_get_device(dev->handle), &desc) != 0) {
+        return false;
+    }
+
+    const struct libusb_interface *inter = &desc->interface[0];
+    const struct libusb_interface_descriptor *interdesc = &inter->altsetting[0];
+
+    for (int i = 0; i < interdesc->bNumEndpoints; i++) {
+        const struct libusb_endpoint_descriptor *ep = &interdesc->endpoint[i];
+        if ((ep->bmAttributes & 0x03) == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
+            if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+                dev->in_endpoint = ep->bEndpointAddress;
+            } else {
+                dev->out_endpoint = ep->bEndpointAddress;
+            }
+        }
+    }
+
+    libusb_free_config_descriptor(desc);
+    return dev->in_endpoint != 0 && dev->out_endpoint != 0;
+}
+
+int gip_device_open(GipDevice **out, uint16_t vendor_id, uint16_t product_id) {
+    *out = NULL;
+
+    GipDevice *dev = calloc(1, sizeof(*dev));
+    if (!dev) {
+        return GIP_ERROR_NO_MEM;
+    }
+    dev->poll_fd = -1;
+
+    int result = libusb_init(&dev->ctx);
+    if (result < 0) {
+        free(dev);
+        return result;
+    }
+
+    dev->handle = libusb_open_device_with_vid_pid(dev->ctx, vendor_id, product_id);
+    if (!dev->handle) {
+        libusb_exit(dev->ctx);
+        free(dev);
+        return GIP_ERROR_NOT_FOUND;
+    }
+
+    // Serial number identifies per-controller data such as stick calibration
+    struct libusb_device_descriptor dev_desc;
+    if (libusb_get_device_descriptor(libusb_get_device(dev->handle), &dev_desc) == 0 &&
+        dev_desc.iSerialNumber) {
+        libusb_get_string_descriptor_ascii(dev->handle, dev_desc.iSerialNumber,
+                                           (unsigned char *)dev->serial, sizeof(dev->serial));
+    }
+
+    // Detach kernel driver
+    if (libusb_kernel_driver_active(dev->handle, 0) == 1) {
+        libusb_detach_kernel_driver(dev->handle, 0);
+    }
+
+    result = libusb_claim_interface(dev->handle, 0);
+    if (result < 0) {
+        libusb_close(dev->handle);
+        libusb_exit(dev->ctx);
+        free(dev);
+        return result;
+    }
+
+    if (!find_endpoints(dev)) {
+        libusb_release_interface(dev->handle, 0);
+        libusb_close(dev->handle);
+        libusb_exit(dev->ctx);
+        free(dev);
+        return GIP_ERROR_NO_ENDPOINTS;
+    }
+
+    *out = dev;
+    return GIP_OK;
+}
+
+void gip_device_close(GipDevice *dev) {
+    if (!dev) {
+        return;
+    }
+    gip_device_stop(dev);
+    if (dev->poll_fd >= 0) {
+        libusb_set_pollfd_notifiers(dev->ctx, NULL, NULL, NULL);
+        close(dev->poll_fd);
+    }
+    libusb_release_interface(dev->handle, 0);
+    libusb_close(dev->handle);
+    libusb_exit(dev->ctx);
+    free(dev);
+}
+
+void gip_device_set_verbosity(GipDevice *dev, int verbosity) {
+    dev->verbosity = verbosity;
+}
+
+const char *gip_device_serial(const GipDevice *dev) {
+    return dev->serial;
+}
+
+uint8_t gip_device_in_endpoint(const GipDevice *dev) {
+    return dev->in_endpoint;
+}
+
+uint8_t gip_device_out_endpoint(const GipDevice *dev) {
+    return dev->out_endpoint;
+}
+
+// ============================================================================
+// Handshake and OUT Commands
+// ============================================================================
+
+int gip_device_send(GipDevice *dev, const uint8_t *data, int length) {
+    uint8_t buffer[GIP_MAX_COMMAND_SIZE];
+    int transferred;
+
+    if (length > (int)sizeof(buffer)) {
+        return GIP_ERROR_OVERFLOW;
+    }
+    // libusb wants a mutable buffer
+    memcpy(buffer, data, length);
+    return libusb_interrupt_transfer(dev->handle, dev->out_endpoint, buffer, length,
+                                     &transferred, COMMAND_TIMEOUT_MS);
+}
+
+int gip_device_send_ack(GipDevice *dev, uint8_t sequence) {
+    uint8_t ack_packet[GIP_MAX_COMMAND_SIZE];
+    int length = gip_build_ack(ack_packet, sizeof(ack_packet), sequence);
+
+    int result = gip_device_send(dev, ack_packet, length);
+    if (result == 0) {
+        if (dev->verbosity >= GIP_VERBOSE_SUMMARY) {
+            printf("  → Sent ACK (seq=%d)\n", sequence);
+        }
+    } else if (dev->verbosity >= GIP_VERBOSE_PACKETS) {
+        printf("  ❌ Failed to send ACK: %s\n", libusb_error_name(result));
+    }
+    return result;
+}
+
+int gip_device_handshake(GipDevice *dev) {
+    uint8_t buffer[GIP_PACKET_SIZE];
+    int transferred;
+    int result;
+
+    if (dev->verbosity >= GIP_VERBOSE_SUMMARY) {
+        printf("\n=== Initializing Controller ===\n");
+        printf("Performing GIP handshake...\n\n");
+    }
+
+    // The controller announces itself until acknowledged
+    for (int attempt = 0; attempt < HANDSHAKE_ATTEMPTS; attempt++) {
+        if (dev->verbosity >= GIP_VERBOSE_PACKETS) {
+            printf("Reading initialization packet %d...\n", attempt + 1);
+        }
+
+        result = gip_device_read(dev, buffer, sizeof(buffer), &transferred, HANDSHAKE_TIMEOUT_MS);
+
+        if (result == 0) {
+            const GipHeader *header = gip_decode_header(buffer, transferred);
+            if (!header) {
+                continue;
+            }
+
+            if (dev->verbosity >= GIP_VERBOSE_SUMMARY) {
+                printf("  Received: %s (0x%02x), seq=%d\n",
+                       gip_command_name(header->command), header->command, header->sequence);
+            }
+            if (dev->verbosity >= GIP_VERBOSE_PACKETS) {
+                printf("  Data: ");
+                for (int i = 0; i < transferred && i < 32; i++) {
+                    printf("%02x ", buffer[i]);
+                }
+                if (transferred > 32) printf("...");
+                printf("\n");
+            }
+
+            if (gip_wants_ack(header)) {
+                PROBE_HANDSHAKE_STATE(GIP_HANDSHAKE_ANNOUNCE_RECEIVED, header->sequence);
+                if (gip_device_send_ack(dev, header->sequence) == 0) {
+                    PROBE_HANDSHAKE_STATE(GIP_HANDSHAKE_ACK_SENT, header->sequence);
+                }
+            }
+        } else if (result == GIP_ERROR_TIMEOUT) {
+            if (dev->verbosity >= GIP_VERBOSE_PACKETS) {
+                printf("  Timeout (this is normal after init sequence)\n");
+            }
+            break;
+        } else if (result == GIP_ERROR_NO_DEVICE) {
+            PROBE_HANDSHAKE_STATE(GIP_HANDSHAKE_FAILED, 0);
+            return result;
+        } else if (dev->verbosity >= GIP_VERBOSE_PACKETS) {
+            printf("  Error: %s\n", libusb_error_name(result));
+        }
+    }
+
+    if (dev->verbosity >= GIP_VERBOSE_SUMMARY) {
+        printf("\n✅ Initialization complete!\n");
+        printf("Sending POWER ON command...\n");
+    }
+
+    uint8_t power_on[GIP_MAX_COMMAND_SIZE];
+    int length = gip_build_power_on(power_on, sizeof(power_on));
+    result = gip_device_send(dev, power_on, length);
+    PROBE_HANDSHAKE_STATE(result == 0 ? GIP_HANDSHAKE_POWER_ON_SENT : GIP_HANDSHAKE_FAILED, 0);
+
+    if (dev->verbosity >= GIP_VERBOSE_SUMMARY) {
+        if (result == 0) {
+            printf("✅ Controller powered on!\n\n");
+        } else {
+            printf("⚠️  Failed to send power on: %s\n\n", libusb_error_name(result));
+        }
+    }
+
+    // Give the controller time to start streaming input
+    usleep(500000);
+    return result;
+}
+
+int gip_device_read(GipDevice *dev, uint8_t *buffer, int size, int *transferred,
+                    unsigned int timeout_ms) {
+    int result = libusb_interrupt_transfer(dev->handle, dev->in_endpoint, buffer, size,
+                                           transferred, timeout_ms);
+    if (result == GIP_ERROR_NO_DEVICE) {
+        PROBE_DISCONNECT(result);
+    }
+    return result;
+}
+
+// ============================================================================
+// Asynchronous Input
+// ============================================================================
+
+static int transfer_status_error(enum libusb_transfer_status status) {
+    switch (status) {
+        case LIBUSB_TRANSFER_NO_DEVICE: return GIP_ERROR_NO_DEVICE;
+        case LIBUSB_TRANSFER_STALL:     return GIP_ERROR_PIPE;
+        case LIBUSB_TRANSFER_OVERFLOW:  return GIP_ERROR_OVERFLOW;
+        case LIBUSB_TRANSFER_TIMED_OUT: return GIP_ERROR_TIMEOUT;
+        default:                        return GIP_ERROR_IO;
+    }
+}
+
+// libusb handed a transfer back and it is not going out again
+static void transfer_retired(GipDevice *dev, struct libusb_transfer *transfer) {
+    for (int i = 0; i < GIP_NUM_TRANSFERS; i++) {
+        if (dev->transfers[i] == transfer) {
+            dev->active[i] = false;
+        }
+    }
+    dev->in_flight--;
+}
+
+static void LIBUSB_CALL transfer_callback(struct libusb_transfer *transfer) {
+    GipDevice *dev = transfer->user_data;
+
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+        // Hand the packet over straight from the transfer buffer
+        dev->callback(dev->user_data, transfer->buffer, transfer->actual_length,
+                      gip_monotonic_ns());
+        dev->delivered++;
+    } else if (transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+        if (!dev->error) {
+            dev->error = transfer_status_error(transfer->status);
+        }
+        if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE) {
+            PROBE_DISCONNECT(GIP_ERROR_NO_DEVICE);
+        }
+    }
+
+    // A failed transfer is not resubmitted: a stalled endpoint would fail it
+    // again at once, forever. gip_device_process() reports the error and
+    // the caller recovers (gip_recovery.h).
+    if (dev->stopping || transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        transfer_retired(dev, transfer);
+        return;
+    }
+
+    int result = libusb_submit_transfer(transfer);
+    if (result != 0) {
+        transfer_retired(dev, transfer);
+        if (!dev->error) {
+            dev->error = result;
+        }
+    }
+}
+
+int gip_device_start(GipDevice *dev, GipPacketCallback callback, void *user_data) {
+    dev->callback = callback;
+    dev->user_data = user_data;
+    dev->error = 0;
+    dev->stopping = false;
+    dev->started = true;
+
+    for (int i = 0; i < GIP_NUM_TRANSFERS; i++) {
+        if (dev->active[i]) {
+            continue;       // Never came back after the last stop; still counted in flight
+        }
+        if (!dev->transfers[i]) {
+            dev->transfers[i] = libusb_alloc_transfer(0);
+        }
+        if (!dev->transfers[i]) {
+            gip_device_stop(dev);
+            return GIP_ERROR_NO_MEM;
+        }
+        libusb_fill_interrupt_transfer(dev->transfers[i], dev->handle, dev->in_endpoint,
+                                       dev->buffers[i], GIP_PACKET_SIZE,
+                                       transfer_callback, dev, 0);
+        int result = libusb_submit_transfer(dev->transfers[i]);
+        if (result != 0) {
+            libusb_free_transfer(dev->transfers[i]);
+            dev->transfers[i] = NULL;
+            gip_device_stop(dev);
+            return result;
+        }
+        dev->active[i] = true;
+        dev->in_flight++;
+    }
+    return GIP_OK;
+}
+
+int gip_device_process(GipDevice *dev, int timeout_us) {
+    struct timeval timeout = { timeout_us / 1000000, timeout_us % 1000000 };
+
+    dev->delivered = 0;
+    int result = libusb_handle_events_timeout_completed(dev->ctx, &timeout, NULL);
+    if (result < 0 && result != LIBUSB_ERROR_INTERRUPTED) {
+        return result;
+    }
+
+    // Report packets that made it through before an error first
+    if (dev->delivered) {
+        return dev->delivered;
+    }
+    if (dev->error) {
+        return dev->error;
+    }
+    return dev->in_flight == 0 ? GIP_ERROR_IO : 0;
+}
+
+void gip_device_stop(GipDevice *dev) {
+    struct timeval timeout = { 0, 100000 };
+    int leaked = 0;
+
+    dev->stopping = true;
+    // Wait for libusb to hand every transfer back before freeing them,
+    // cancelling again each time in case a cancel raced a resubmit
+    for (int spins = 0; dev->in_flight > 0 && spins < STOP_SPINS; spins++) {
+        for (int i = 0; i < GIP_NUM_TRANSFERS; i++) {
+            if (dev->active[i]) {
+                libusb_cancel_transfer(dev->transfers[i]);
+            }
+        }
+        libusb_handle_events_timeout_completed(dev->ctx, &timeout, NULL);
+    }
+    // Freeing a transfer libusb still holds would be a use-after-free when
+    // it comes back, so those are left allocated (and still counted in
+    // flight; the next start skips them)
+    for (int i = 0; i < GIP_NUM_TRANSFERS; i++) {
+        if (dev->active[i]) {
+            leaked++;
+        } else if (dev->transfers[i]) {
+            libusb_free_transfer(dev->transfers[i]);
+            dev->transfers[i] = NULL;
+        }
+    }
+    if (leaked) {
+        printf("⚠️  %d input transfer%s not handed back after %d ms, left allocated\n", leaked,
+               leaked == 1 ? "" : "s", STOP_SPINS * 100);
+    }
+    dev->started = false;
+}
+
+// ============================================================================
+// Recovery
+// ============================================================================
+
+int gip_device_clear_halt(GipDevice *dev) {
+    int result = libusb_clear_halt(dev->handle, dev->in_endpoint);
+    if (result == 0) {
+        result = libusb_clear_halt(dev->handle, dev->out_endpoint);
+    }
+    if (result != 0 || !dev->started) {
+        return result;
+    }
+
+    // Asynchronous input: the transfer that stalled was handed back without
+    // being resubmitted, and its error is still latched. Forget the error
+    // and send that transfer out again, or the probe can only fail.
+    dev->error = 0;
+    for (int i = 0; i < GIP_NUM_TRANSFERS; i++) {
+        if (dev->transfers[i] && !dev->active[i]) {
+            result = libusb_submit_transfer(dev->transfers[i]);
+            if (result != 0) {
+                return result;
+            }
+            dev->active[i] = true;
+            dev->in_flight++;
+        }
+    }
+    return GIP_OK;
+}
+
+int gip_device_resubmit(GipDevice *dev) {
+    // Not dev->callback: a failed start or a stop leaves that set, and
+    // restarting transfers under a blocking-read loop would steal its packets
+    if (!dev->started) {
+        return GIP_OK;      // Blocking reads: nothing in flight to restart
+    }
+    gip_device_stop(dev);
+    return gip_device_start(dev, dev->callback, dev->user_data);
+}
+
+int gip_device_reset(GipDevice *dev) {
+    bool restart = dev->started;
+    gip_device_stop(dev);
+
+    // NOT_FOUND: the device came back with different descriptors, as a new
+    // device - the handle is dead and the caller has to reopen
+    int result = libusb_reset_device(dev->handle);
+    if (result == LIBUSB_ERROR_NOT_FOUND || result == LIBUSB_ERROR_NO_DEVICE) {
+        return GIP_ERROR_NO_DEVICE;
+    }
+    if (result < 0) {
+        return result;
+    }
+    // Some platforms drop the claim across a reset
+    result = libusb_claim_interface(dev->handle, 0);
+    if (result < 0 && result != LIBUSB_ERROR_BUSY) {
+        return result;
+    }
+    if (!find_endpoints(dev)) {
+        return GIP_ERROR_NO_ENDPOINTS;
+    }
+
+    // A reset controller is back to announcing itself
+    result = gip_device_handshake(dev);
+    if (result == GIP_OK && restart) {
+        result = gip_device_start(dev, dev->callback, dev->user_data);
+    }
+    return result;
+}
+
+static int recovery_clear_halt(void *ctx) {
+    return gip_device_clear_halt(ctx);
+}
+
+static int recovery_resubmit(void *ctx) {
+    return gip_device_resubmit(ctx);
+}
+
+// The handshake reads synchronously, so asynchronous transfers pause for it
+static int recovery_handshake(void *ctx) {
+    GipDevice *dev = ctx;
+    bool restart = dev->started;
+    gip_device_stop(dev);
+    int result = gip_device_handshake(dev);
+    if (result == GIP_OK && restart) {
+        result = gip_device_start(dev, dev->callback, dev->user_data);
+    }
+    return result;
+}
+
+static int recovery_reset(void *ctx) {
+    return gip_device_reset(ctx);
+}
+
+// Asynchronous: packets reach the callback as usual. Blocking reads: the one
+// packet read here is dropped, which costs nothing since every input report
+// carries the full controller state.
+static int recovery_probe(void *ctx) {
+    GipDevice *dev = ctx;
+    if (dev->started) {
+        int result = gip_device_process(dev, PROBE_TIMEOUT_MS * 1000);
+        return result >= 0 ? GIP_OK : result;
+    }
+    uint8_t buffer[GIP_PACKET_SIZE];
+    int transferred;
+    int result = gip_device_read(dev, buffer, sizeof(buffer), &transferred, PROBE_TIMEOUT_MS);
+    return (result == 0 || result == GIP_ERROR_TIMEOUT) ? GIP_OK : result;
+}
+
+static uint64_t recovery_now_ns(void *ctx) {
+    (void)ctx;
+    return gip_monotonic_ns();
+}
+
+static void recovery_sleep_us(void *ctx, unsigned us) {
+    (void)ctx;
+    usleep(us);
+}
+
+void gip_device_recovery_ops(GipDevice *dev, GipRecoveryOps *ops) {
+    *ops = (GipRecoveryOps){
+        .ctx = dev,
+        .clear_halt = recovery_clear_halt,
+        .resubmit = recovery_resubmit,
+        .handshake = recovery_handshake,
+        .reset = recovery_reset,
+        .probe = recovery_probe,
+        .now_ns = recovery_now_ns,
+        .sleep_us = recovery_sleep_us
+    };
+}
+
+// ============================================================================
+// Pollable Descriptor
+// ============================================================================
+
+// libusb may use several fds (device, timer, event pipe) and can change them
+// at runtime; mirror them into one epoll/kqueue set so callers wait on one fd
+
+static void poll_set_add(int poll_fd, int fd, short events) {
+#if defined(__linux__)
+    struct epoll_event ev = {0};
+    ev.events = ((events & POLLIN) ? EPOLLIN : 0) | ((events & POLLOUT) ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    epoll_ctl(poll_fd, EPOLL_CTL_ADD, fd, &ev);
+#elif defined(__APPLE__)
+    struct kevent changes[2];
+    int count = 0;
+    if (events & POLLIN) {
+        EV_SET(&changes[count++], fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+    }
+    if (events & POLLOUT) {
+        EV_SET(&changes[count++], fd, EVFILT_WRITE, EV_ADD, 0, 0, NULL);
+    }
+    kevent(poll_fd, changes, count, NULL, 0, NULL);
+#endif
+}
+
+static void poll_set_remove(int poll_fd, int fd) {
+#if defined(__linux__)
+    epoll_ctl(poll_fd, EPOLL_CTL_DEL, fd, NULL);
+#elif defined(__APPLE__)
+    struct kevent change;
+    EV_SET(&change, fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    kevent(poll_fd, &change, 1, NULL, 0, NULL);
+    EV_SET(&change, fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    kevent(poll_fd, &change, 1, NULL, 0, NULL);
+#endif
+}
+
+static void LIBUSB_CALL pollfd_added(int fd, short events, void *user_data) {
+    GipDevice *dev = user_data;
+    poll_set_add(dev->poll_fd, fd, events);
+}
+
+static void LIBUSB_CALL pollfd_removed(int fd, void *user_data) {
+    GipDevice *dev = user_data;
+    poll_set_remove(dev->poll_fd, fd);
+}
+
+int gip_device_fd(GipDevice *dev) {
+    if (dev->poll_fd >= 0) {
+        return dev->poll_fd;
+    }
+
+#if defined(__linux__)
+    dev->poll_fd = epoll_create1(EPOLL_CLOEXEC);
+#elif defined(__APPLE__)
+    dev->poll_fd = kqueue();
+#endif
+    if (dev->poll_fd < 0) {
+        return GIP_ERROR_OTHER;
+    }
+
+    const struct libusb_pollfd **fds = libusb_get_pollfds(dev->ctx);
+    if (fds) {
+        for (int i = 0; fds[i]; i++) {
+            poll_set_add(dev->poll_fd, fds[i]->fd, fds[i]->events);
+        }
+        libusb_free_pollfds(fds);
+    }
+    libusb_set_pollfd_notifiers(dev->ctx, pollfd_added, pollfd_removed, dev);
+    return dev->poll_fd;
+}
@@ -0,0 +1,94 @@
+// gip_device.h
+// Xbox One controller over USB: open, GIP handshake, OUT commands and input
+// reception (part of libgip)
+//
+// Input can be read two ways:
+//  - gip_device_read(): blocking read of one packet (simple tools)
+//  - gip_device_start() + gip_device_process(): asynchronous transfers whose
+//    packets are handed to a callback straight from the USB buffer. To embed
+//    the engine in an existing event loop, add gip_device_fd() to your
+//    epoll/kqueue set and call gip_device_process(dev, 0) whenever it becomes
+//    readable - no extra threads, no copies:
+//
+//      gip_device_start(dev, on_packet, ctx);
+//      epoll_ctl(loop, EPOLL_CTL_ADD, gip_device_fd(dev), &(struct epoll_event){ .events = EPOLLIN });
+//      ...
+//      // on EPOLLIN:
+//      if (gip_device_process(dev, 0) == GIP_ERROR_NO_DEVICE) { /* unplugged */ }
+
+#ifndef GIP_DEVICE_H
+#define GIP_DEVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gip_recovery.h"
+
+#define XBOX_VENDOR_ID  0x045e
+#define XBOX_PRODUCT_ID 0x02dd  // Model 1697
+
+// Error codes (same values as the matching libusb errors)
+#define GIP_OK                  0
+#define GIP_ERROR_IO            -1
+#define GIP_ERROR_ACCESS        -3
+#define GIP_ERROR_NO_DEVICE     -4
+#define GIP_ERROR_NOT_FOUND     -5
+#define GIP_ERROR_BUSY          -6
+#define GIP_ERROR_TIMEOUT       -7
+#define GIP_ERROR_OVERFLOW      -8
+#define GIP_ERROR_PIPE          -9
+#define GIP_ERROR_NO_MEM        -11
+#define GIP_ERROR_OTHER         -99
+#define GIP_ERROR_NO_ENDPOINTS  -100
+
+// How much the library prints while opening and handshaking
+#define GIP_VERBOSE_QUIET       0
+#define GIP_VERBOSE_SUMMARY     1   // Handshake steps
+#define GIP_VERBOSE_PACKETS     2   // Plus raw handshake packets and errors
+
+typedef struct GipDevice GipDevice;
+
+// Called for every received packet. data points into the transfer buffer
+// and is only valid during the call. timestamp_ns is CLOCK_MONOTONIC at the
+// moment libusb handed over the completed transfer.
+typedef void (*GipPacketCallback)(void *user_data, const uint8_t *data, int length,
+                                  uint64_t timestamp_ns);
+
+// Open the first matching controller, detach any kernel driver, claim
+// interface 0 and locate the interrupt endpoints
+int gip_device_open(GipDevice **out, uint16_t vendor_id, uint16_t product_id);
+void gip_device_close(GipDevice *dev);
+
+void gip_device_set_verbosity(GipDevice *dev, int verbosity);
+const char *gip_device_serial(const GipDevice *dev);
+uint8_t gip_device_in_endpoint(const GipDevice *dev);
+uint8_t gip_device_out_endpoint(const GipDevice *dev);
+
+// Acknowledge the controller's announce packets and power it on
+int gip_device_handshake(GipDevice *dev);
+
+// OUT commands
+int gip_device_send(GipDevice *dev, const uint8_t *data, int length);
+int gip_device_send_ack(GipDevice *dev, uint8_t sequence);
+
+// Blocking read of one IN packet
+int gip_device_read(GipDevice *dev, uint8_t *buffer, int size, int *transferred,
+                    unsigned int timeout_ms);
+
+// Asynchronous input
+int gip_device_start(GipDevice *dev, GipPacketCallback callback, void *user_data);
+int gip_device_fd(GipDevice *dev);
+int gip_device_process(GipDevice *dev, int timeout_us);  // packets delivered, or error
+void gip_device_stop(GipDevice *dev);
+
+// Recovery primitives. After an error other than GIP_ERROR_NO_DEVICE the
+// asynchronous transfers stay stopped until one of these restarts them;
+// gip_recover() with gip_device_recovery_ops() runs them in order.
+int gip_device_clear_halt(GipDevice *dev);
+int gip_device_resubmit(GipDevice *dev);    // Restart the asynchronous transfers, if started
+int gip_device_reset(GipDevice *dev);       // GIP_ERROR_NO_DEVICE if it re-enumerated
+void gip_device_recovery_ops(GipDevice *dev, GipRecoveryOps *ops);
+
+const char *gip_strerror(int error);
+uint64_t gip_monotonic_ns(void);
+
+#endif // GIP_DEVICE_H
@@ -0,0 +1,158 @@
+// gip_protocol.c
+// GIP packet decoding and OUT command encoding (part of libgip)
+
+#include <stdio.h>
+#include <string.h>
+#include "gip_protocol.h"
+
+const GipHeader *gip_decode_header(const uint8_t *data, int length) {
+    if (!data || length < (int)sizeof(GipHeader)) {
+        return NULL;
+    }
+    return (const GipHeader *)data;
+}
+
+const GipInputPacket *gip_decode_input(const uint8_t *data, int length) {
+    const GipHeader *header = gip_decode_header(data, length);
+    if (!header || header->command != GIP_CMD_INPUT ||
+        length < (int)sizeof(GipInputPacket)) {
+        return NULL;
+    }
+    return (const GipInputPacket *)data;
+}
+
+bool gip_wants_ack(const GipHeader *header) {
+    // The controller repeats its announce until the host acknowledges it
+    return header->command == GIP_CMD_ANNOUNCE;
+}
+
+bool gip_is_ack_for(const uint8_t *data, int length, uint8_t command, uint8_t sequence) {
+    const GipHeader *header = gip_decode_header(data, length);
+    if (!header || header->command != GIP_CMD_ACKNOWLEDGE || header->sequence != sequence) {
+        return false;
+    }
+    // Byte 5 names the command being acknowledged (absent on short acks)
+    return length <= 5 || data[5] == command;
+}
+
+static uint16_t read_le16(const uint8_t *data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+int gip_describe_packet(const uint8_t *data, int length, char *out, int size) {
+    const GipHeader *header = gip_decode_header(data, length);
+    if (!header) {
+        return snprintf(out, size, "truncated (%d bytes)", length);
+    }
+    const uint8_t *payload = data + sizeof(GipHeader);
+    int payload_length = length - (int)sizeof(GipHeader);
+
+    switch (header->command) {
+        case GIP_CMD_INPUT: {
+            const GipInputPacket *input = gip_decode_input(data, length);
+            if (!input) {
+                break;
+            }
+            return snprintf(out, size, "buttons=0x%04x LT=%d RT=%d LS=(%d,%d) RS=(%d,%d)%s",
+                            input->buttons, input->left_trigger, input->right_trigger,
+                            input->left_stick_x, input->left_stick_y,
+                            input->right_stick_x, input->right_stick_y,
+                            length > (int)sizeof(GipInputPacket) ? " +extended" : "");
+        }
+        case GIP_CMD_GUIDE_BUTTON:
+            if (payload_length < 1) {
+                break;
+            }
+            return snprintf(out, size, "guide=%s", payload[0] ? "pressed" : "released");
+        case GIP_CMD_STATUS: {
+            // Bits 0-1 battery level, bits 2-3 battery type
+            static const char *levels[] = { "critical", "low", "medium", "full" };
+            static const char *types[] = { "wired", "alkaline", "nimh", "unknown" };
+            if (payload_length < 1) {
+                break;
+            }
+            return snprintf(out, size, "battery=%s type=%s",
+                            levels[payload[0] & 0x03], types[(payload[0] >> 2) & 0x03]);
+        }
+        case GIP_CMD_ANNOUNCE:
+            // MAC address, 2 unknown bytes, vendor/product id, firmware version
+            if (payload_length < 20) {
+                break;
+            }
+            return snprintf(out, size, "mac=%02x:%02x:%02x:%02x:%02x:%02x vid=%04x pid=%04x fw=%d.%d.%d.%d",
+                            payload[0], payload[1], payload[2], payload[3], payload[4], payload[5],
+                            read_le16(payload + 8), read_le16(payload + 10),
+                            read_le16(payload + 12), read_le16(payload + 14),
+                            read_le16(payload + 16), read_le16(payload + 18));
+        case GIP_CMD_ACKNOWLEDGE:
+            // Byte 5 is the command being acknowledged
+            if (payload_length < 2) {
+                break;
+            }
+            return snprintf(out, size, "ack of %s (0x%02x)", gip_command_name(payload[1]), payload[1]);
+        case GIP_CMD_SERIAL_NUM: {
+            // Printable ASCII, possibly after a couple of binary bytes
+            int start = 0;
+            while (start < payload_length && (payload[start] < 0x20 || payload[start] > 0x7e)) {
+                start++;
+            }
+            int end = start;
+            while (end < payload_length && payload[end] >= 0x20 && payload[end] <= 0x7e) {
+                end++;
+            }
+            return snprintf(out, size, "serial=\"%.*s\"", end - start, (const char *)payload + start);
+        }
+        default:
+            break;
+    }
+    return snprintf(out, size, "%d payload bytes", payload_length);
+}
+
+int gip_build_ack(uint8_t *buffer, int size, uint8_t sequence) {
+    const uint8_t ack_packet[] = {
+        GIP_CMD_ACKNOWLEDGE,
+        GIP_OPT_INTERNAL,   // options
+        sequence,           // sequence number from the packet we're acknowledging
+        0x09,               // length
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+
+    if (size < (int)sizeof(ack_packet)) {
+        return -1;
+    }
+    memcpy(buffer, ack_packet, sizeof(ack_packet));
+    return sizeof(ack_packet);
+}
+
+int gip_build_power_on(uint8_t *buffer, int size) {
+    const uint8_t power_on[] = {
+        GIP_CMD_POWER,      // 0x05
+        GIP_OPT_INTERNAL,   // options
+        0x00,               // sequence (can be 0 for commands we initiate)
+        0x01,               // length
+        0x00                // mode: 0x00 = on
+    };
+
+    if (size < (int)sizeof(power_on)) {
+        return -1;
+    }
+    memcpy(buffer, power_on, sizeof(power_on));
+    return sizeof(power_on);
+}
+
+int gip_build_command(uint8_t *buffer, int size, uint8_t command, uint8_t options,
+                      uint8_t sequence, const uint8_t *payload, int payload_length) {
+    int length = (int)sizeof(GipHeader) + payload_length;
+    if (payload_length < 0 || payload_length > 255 || size < length) {
+        return -1;
+    }
+
+    buffer[0] = command;
+    buffer[1] = options;
+    buffer[2] = sequence;
+    buffer[3] = (uint8_t)payload_length;
+    if (payload_length > 0) {
+        memcpy(buffer + sizeof(GipHeader), payload, payload_length);
+    }
+    return length;
+}
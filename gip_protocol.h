@@ -0,0 +1,43 @@
+// gip_protocol.h
+// GIP packet decoding and OUT command encoding (part of libgip)
+// Pure functions with no USB dependency, so replay and analysis tools can
+// link them without libusb.
+
+#ifndef GIP_PROTOCOL_H
+#define GIP_PROTOCOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gip.h"
+
+// Option bits in GipHeader.options
+#define GIP_OPT_ACK_REQUIRED   0x10
+#define GIP_OPT_INTERNAL       0x20
+
+// Largest OUT command we build
+#define GIP_MAX_COMMAND_SIZE   64
+
+// Header of a received packet, or NULL if it is too short to have one
+const GipHeader *gip_decode_header(const uint8_t *data, int length);
+
+// Input report in place (no copy), or NULL if this isn't a full input packet
+const GipInputPacket *gip_decode_input(const uint8_t *data, int length);
+
+// Whether the host must acknowledge this packet during the handshake
+bool gip_wants_ack(const GipHeader *header);
+
+// Whether this packet is the controller acknowledging our command/sequence
+bool gip_is_ack_for(const uint8_t *data, int length, uint8_t command, uint8_t sequence);
+
+// One-line description of a packet's payload for sniffers and replay tools
+// (e.g. "battery=full type=alkaline"); returns the snprintf length
+int gip_describe_packet(const uint8_t *data, int length, char *out, int size);
+
+// OUT command builders: write into buffer, return the command length
+// (or -1 if the buffer is too small)
+int gip_build_ack(uint8_t *buffer, int size, uint8_t sequence);
+int gip_build_power_on(uint8_t *buffer, int size);
+int gip_build_command(uint8_t *buffer, int size, uint8_t command, uint8_t options,
+                      uint8_t sequence, const uint8_t *payload, int payload_length);
+
+#endif // GIP_PROTOCOL_H
@@ -0,0 +1,63 @@
+// gip_recovery.c
+// USB error recovery ladder (see gip_recovery.h)
+
+#include <stddef.h>
+#include "gip_recovery.h"
+#include "gip_device.h"
+
+const char *gip_recovery_step_name(GipRecoveryStep step) {
+    switch (step) {
+        case GIP_RECOVER_CLEAR_HALT: return "clear halt";
+        case GIP_RECOVER_RESUBMIT:   return "resubmit";
+        case GIP_RECOVER_HANDSHAKE:  return "handshake";
+        case GIP_RECOVER_RESET:      return "reset";
+        default:                     return "unknown";
+    }
+}
+
+static int run_step(const GipRecoveryOps *ops, GipRecoveryStep step) {
+    switch (step) {
+        case GIP_RECOVER_CLEAR_HALT: return ops->clear_halt(ops->ctx);
+        case GIP_RECOVER_RESUBMIT:   return ops->resubmit(ops->ctx);
+        case GIP_RECOVER_HANDSHAKE:  return ops->handshake(ops->ctx);
+        case GIP_RECOVER_RESET:      return ops->reset(ops->ctx);
+        default:                     return GIP_ERROR_OTHER;
+    }
+}
+
+int gip_recover(const GipRecoveryOps *ops, const GipRecoveryPolicy *policy, int error,
+                GipRecoveryResult *result) {
+    uint64_t start = ops->now_ns(ops->ctx);
+    unsigned backoff = policy->initial_backoff_us;
+    int last_error = error;
+
+    result->attempts = 0;
+    result->step = error == GIP_ERROR_PIPE ? GIP_RECOVER_CLEAR_HALT : GIP_RECOVER_RESUBMIT;
+
+    for (; result->step < GIP_RECOVER_STEP_COUNT; result->step++) {
+        for (int attempt = 0; attempt < policy->attempts_per_step; attempt++) {
+            result->attempts++;
+            int status = run_step(ops, result->step);
+            if (status == GIP_OK) {
+                status = ops->probe(ops->ctx);
+            }
+            if (status == GIP_OK) {
+                result->elapsed_ns = ops->now_ns(ops->ctx) - start;
+                return GIP_OK;
+            }
+            if (status == GIP_ERROR_NO_DEVICE) {
+                result->elapsed_ns = ops->now_ns(ops->ctx) - start;
+                return GIP_ERROR_NO_DEVICE;
+            }
+            last_error = status;
+
+            // Back off before trying again; the next step gets the longer wait too
+            ops->sleep_us(ops->ctx, backoff);
+            backoff = backoff * 2 < policy->max_backoff_us ? backoff * 2 : policy->max_backoff_us;
+        }
+    }
+
+    result->step = GIP_RECOVER_RESET;
+    result->elapsed_ns = ops->now_ns(ops->ctx) - start;
+    return last_error;
+}
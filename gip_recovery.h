@@ -0,0 +1,73 @@
+// gip_recovery.h
+// In-place recovery from USB errors, short of re-enumerating (part of libgip)
+//
+// A stall, overflow or I/O error on the input endpoint does not mean the
+// controller is gone. gip_recover() walks a ladder of increasingly drastic
+// steps, probing after each one, and stops at the first that works:
+//
+//   1. clear halt on the endpoints
+//   2. resubmit the input transfers
+//   3. re-run the GIP handshake (the controller may have dropped power state)
+//   4. reset the device
+//
+// Each step is tried a bounded number of times with exponential backoff.
+// GIP_ERROR_NO_DEVICE from any step ends the walk: the controller was
+// unplugged and the caller has to reopen it.
+//
+// The ladder only sees a table of operations, so it runs unchanged against a
+// real GipDevice (gip_device_recovery_ops()) or a fake one that injects
+// faults (recovery_bench.c).
+
+#ifndef GIP_RECOVERY_H
+#define GIP_RECOVERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    GIP_RECOVER_CLEAR_HALT,
+    GIP_RECOVER_RESUBMIT,
+    GIP_RECOVER_HANDSHAKE,
+    GIP_RECOVER_RESET,
+    GIP_RECOVER_STEP_COUNT
+} GipRecoveryStep;
+
+typedef struct {
+    void *ctx;
+    int (*clear_halt)(void *ctx);
+    int (*resubmit)(void *ctx);
+    int (*handshake)(void *ctx);
+    int (*reset)(void *ctx);
+    // GIP_OK if the input endpoint works again (a timeout counts: an idle
+    // controller sends nothing), otherwise the error it still returns
+    int (*probe)(void *ctx);
+    // Clock and sleep, so a fake device can run the ladder in virtual time
+    uint64_t (*now_ns)(void *ctx);
+    void (*sleep_us)(void *ctx, unsigned us);
+} GipRecoveryOps;
+
+typedef struct {
+    int attempts_per_step;
+    unsigned initial_backoff_us;
+    unsigned max_backoff_us;
+} GipRecoveryPolicy;
+
+#define GIP_RECOVERY_DEFAULT_POLICY { .attempts_per_step = 2, .initial_backoff_us = 1000, \
+                                      .max_backoff_us = 100000 }
+
+typedef struct {
+    GipRecoveryStep step;       // Step that fixed it (or the last one tried)
+    int attempts;               // Operations run, over all steps
+    uint64_t elapsed_ns;
+} GipRecoveryResult;
+
+// Returns GIP_OK once the probe succeeds, GIP_ERROR_NO_DEVICE if the
+// controller is gone, or the probe's last error if every step failed.
+// error is what the caller saw; a stall starts at clearing the halt, and
+// anything else starts by resubmitting.
+int gip_recover(const GipRecoveryOps *ops, const GipRecoveryPolicy *policy, int error,
+                GipRecoveryResult *result);
+
+const char *gip_recovery_step_name(GipRecoveryStep step);
+
+#endif // GIP_RECOVERY_H
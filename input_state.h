@@ -0,0 +1,102 @@
+// input_state.h
+// Per-controller input state, split by access pattern
+// The hot block holds everything the per-packet path reads or writes and is
+// exactly two cache lines; the cold block holds the 256-entry key table and
+// mouse button flags, which only change when an output event is sent. Both
+// blocks are cache-line aligned, so an array of controllers never has two
+// controllers (or two threads) sharing a line.
+
+#ifndef INPUT_STATE_H
+#define INPUT_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CACHE_LINE_SIZE 64
+
+// Bits for the directions a stick in WASD/arrows mode is currently holding
+#define STICK_DIR_UP     0x01
+#define STICK_DIR_DOWN   0x02
+#define STICK_DIR_LEFT   0x04
+#define STICK_DIR_RIGHT  0x08
+
+// Glide state for a stick in kinetic mode
+typedef struct {
+    float velocity_x;         // Cursor velocity in pixels per second
+    float velocity_y;
+    float remainder_x;        // Sub-pixel movement not yet sent
+    float remainder_y;
+    double last_tick;         // Monotonic time of last integration step (0 = idle)
+    bool gliding;             // Velocity is above KINETIC_STOP_SPEED
+    bool deflected;           // Stick was out of the deadzone on the last step
+} KineticState;
+
+// Touched on every packet / output tick
+typedef struct {
+    // --- Cache line 0: change detection, positions, filters, mouse output ---
+
+    // Previous controller state for change detection
+    _Alignas(CACHE_LINE_SIZE) uint16_t prev_buttons;
+    uint8_t prev_left_trigger;
+    uint8_t prev_right_trigger;
+    int16_t prev_left_stick_x;
+    int16_t prev_left_stick_y;
+    int16_t prev_right_stick_x;
+    int16_t prev_right_stick_y;
+
+    // Current stick positions (for continuous movement)
+    int16_t current_left_stick_x;
+    int16_t current_left_stick_y;
+    int16_t current_right_stick_x;
+    int16_t current_right_stick_y;
+
+    // Directions held by sticks in key modes (STICK_DIR_* bits)
+    uint8_t left_stick_dirs;
+    uint8_t right_stick_dirs;
+
+    // Smoothed stick positions (for mouse mode)
+    float smoothed_right_x;
+    float smoothed_right_y;
+    float smoothed_left_x;
+    float smoothed_left_y;
+
+    // Smoothed stick positions for the fixed-point pipeline (Q15)
+    int32_t fx_smoothed_right_x;
+    int32_t fx_smoothed_right_y;
+    int32_t fx_smoothed_left_x;
+    int32_t fx_smoothed_left_y;
+
+    // Mouse delta accumulation
+    float mouse_dx;
+    float mouse_dy;
+
+    // --- Cache line 1: kinetic glide state (for kinetic mode) ---
+    KineticState kinetic_left;
+    KineticState kinetic_right;
+} InputStateHot;
+
+// Only touched when an output event is actually sent (and on shutdown)
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) bool keys[256];  // Track which keys are currently pressed
+    bool mouse_left;          // Left mouse button state
+    bool mouse_right;         // Right mouse button state
+    bool mouse_middle;        // Middle mouse button state
+} InputStateCold;
+
+// All state for one controller
+typedef struct {
+    InputStateHot hot;
+    InputStateCold cold;
+} ControllerState;
+
+_Static_assert(offsetof(InputStateHot, kinetic_left) == CACHE_LINE_SIZE,
+               "Per-packet fields must fill exactly the first cache line");
+_Static_assert(sizeof(InputStateHot) == 2 * CACHE_LINE_SIZE,
+               "InputStateHot must be two cache lines");
+_Static_assert(sizeof(InputStateCold) % CACHE_LINE_SIZE == 0,
+               "InputStateCold must be a whole number of cache lines");
+_Static_assert(sizeof(ControllerState) % CACHE_LINE_SIZE == 0,
+               "ControllerState arrays must not share cache lines");
+
+#endif // INPUT_STATE_H
@@ -22,6 +22,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /*******************************************************************************
  * SECTION 1: STICK BEHAVIOR
@@ -30,13 +31,15 @@
  * - STICK_MODE_WASD:     Use stick as WASD keys (good for movement)
  * - STICK_MODE_ARROWS:   Use stick as arrow keys
  * - STICK_MODE_MOUSE:    Use stick to move mouse cursor (good for camera)
+ * - STICK_MODE_KINETIC:  Flick stick to send the cursor gliding (trackball feel)
  * - STICK_MODE_DISABLED: Turn off this stick
  ******************************************************************************/
 typedef enum {
     STICK_MODE_WASD,
     STICK_MODE_ARROWS,
     STICK_MODE_MOUSE,
-    STICK_MODE_DISABLED
+    STICK_MODE_DISABLED,
+    STICK_MODE_KINETIC
 } StickMode;
 
 /*******************************************************************************
@@ -53,6 +56,33 @@ typedef enum {
     TRIGGER_MODE_DISABLED
 } TriggerMode;
 
+/*******************************************************************************
+ * SECTION 3: STICK STAGES (advanced)
+ * 
+ * Mouse and kinetic sticks run their input through a chain of stages, in
+ * order. Left empty, the chain is built from the mouse settings below:
+ *   calibrate → deadzone → filter (smoothing) → curve → scale (sensitivity)
+ * 
+ * - STAGE_CALIBRATE: Stretch to the recorded outer range (first stage only)
+ * - STAGE_DEADZONE:  Ignore deflection below value (0-32767, like deadzone)
+ * - STAGE_CURVE:     Response curve exponent (like mouse_curve)
+ * - STAGE_FILTER:    Smoothing 0.0-0.95 (like mouse_smoothing; once per chain)
+ * - STAGE_SNAP:      Snap to the nearest axis within value degrees
+ * - STAGE_SCALE:     Multiply X by value and Y by value2 (like mouse_sensitivity)
+ * - STAGE_ROTATE:    Rotate by value degrees (counterclockwise)
+ ******************************************************************************/
+typedef enum {
+    STAGE_CALIBRATE,
+    STAGE_DEADZONE,
+    STAGE_CURVE,
+    STAGE_FILTER,
+    STAGE_SNAP,
+    STAGE_SCALE,
+    STAGE_ROTATE
+} StickStageType;
+
+#define STICK_CHAIN_MAX 8
+
 /*******************************************************************************
  * INTERNAL STRUCTURES (Don't modify these, edit the config below instead)
  ******************************************************************************/
@@ -64,6 +94,17 @@ typedef struct {
     uint16_t key_dpad_up, key_dpad_down, key_dpad_left, key_dpad_right;
 } ButtonMapping;
 
+typedef struct {
+    StickStageType type;
+    float value;
+    float value2;
+} StickStageSpec;
+
+typedef struct {
+    int count;
+    StickStageSpec stages[STICK_CHAIN_MAX];
+} StickChainSpec;
+
 typedef struct {
     StickMode left_stick_mode;
     uint16_t left_up, left_down, left_left, left_right;
@@ -74,7 +115,11 @@ typedef struct {
     float mouse_sensitivity;
     float mouse_curve;
     float mouse_smoothing;
+    float kinetic_friction;
     int16_t deadzone;
+    
+    StickChainSpec left_chain;      // count 0 = built from the settings above
+    StickChainSpec right_chain;
 } StickMapping;
 
 typedef struct {
@@ -91,6 +136,14 @@ typedef struct {
     TriggerMapping triggers;
     bool console_output_enabled;
     bool streaming_mode;
+    bool fixed_point_math;
+    bool busy_poll_enabled;
+    int busy_poll_cpu;
+    int busy_poll_idle_ms;
+    bool trace_enabled;
+    const char *metrics_socket_path;
+    const char *metrics_textfile_path;
+    int metrics_interval_ms;
 } ControllerMapping;
 
 /*******************************************************************************
@@ -163,11 +216,12 @@ static inline ControllerMapping get_default_mapping(void) {
      * 
      * Choose behavior mode (same options as left stick):
      *   STICK_MODE_MOUSE   - Move mouse cursor (recommended for camera)
+     *   STICK_MODE_KINETIC - Flick to glide the cursor (large screens)
      *   STICK_MODE_WASD    - Use WASD keys
      *   STICK_MODE_ARROWS  - Use arrow keys
      *   STICK_MODE_DISABLED - Turn off right stick
      * 
-     * If using MOUSE mode, adjust sensitivity/smoothing below.
+     * If using MOUSE or KINETIC mode, adjust sensitivity/smoothing below.
      **************************************************************************/
     
     mapping.sticks.right_stick_mode = STICK_MODE_MOUSE;  // ← CHANGE THIS
@@ -202,6 +256,22 @@ static inline ControllerMapping get_default_mapping(void) {
     mapping.sticks.mouse_smoothing   = 0.3;  // ← ADJUST FOR SMOOTHNESS
     
     
+    /***************************************************************************
+     * KINETIC SETTINGS (for sticks in KINETIC mode)
+     * 
+     * While the stick is held the cursor moves exactly like MOUSE mode (same
+     * sensitivity, curve and smoothing). When you let go, the cursor keeps
+     * gliding and slows down. Push the stick again to catch or redirect it.
+     * 
+     * kinetic_friction: How quickly a glide slows down (per second)
+     *   - 1.5 = long, floaty glide
+     *   - 4.0 = default
+     *   - 10.0 = stops almost immediately
+     **************************************************************************/
+    
+    mapping.sticks.kinetic_friction  = 4.0;  // ← ADJUST GLIDE LENGTH
+    
+    
     /***************************************************************************
      * DEADZONE (for both sticks)
      * 
@@ -217,6 +287,25 @@ static inline ControllerMapping get_default_mapping(void) {
     mapping.sticks.deadzone = 8000;  // ← ADJUST IF STICK DRIFTS
     
     
+    /***************************************************************************
+     * STICK STAGES (advanced, see SECTION 3 at the top)
+     * 
+     * Leave the counts at 0 to use the settings above. Example: a right
+     * stick with a smaller deadzone that snaps to the axes and moves
+     * faster horizontally:
+     * 
+     *   mapping.sticks.right_chain = (StickChainSpec){ 5, {
+     *       { STAGE_CALIBRATE, 0, 0 },
+     *       { STAGE_DEADZONE, 5000, 0 },
+     *       { STAGE_SNAP, 8, 0 },
+     *       { STAGE_CURVE, 1.8f, 0 },
+     *       { STAGE_SCALE, 2.0f, 1.5f } } };
+     **************************************************************************/
+    
+    mapping.sticks.left_chain.count  = 0;
+    mapping.sticks.right_chain.count = 0;
+    
+    
     /***************************************************************************
      * TRIGGER CONFIGURATION
      * 
@@ -259,10 +348,42 @@ static inline ControllerMapping get_default_mapping(void) {
      * streaming_mode: Optimize for game streaming (Moonlight/Parsec)?
      *   - false = Local gaming (default)
      *   - true  = Streaming mode (use relative mouse movement)
+     * 
+     * fixed_point_math: Use integer math for deadzone/calibration/mouse mode?
+     *   - false = Floating-point (default)
+     *   - true  = Fixed-point: identical results on every machine, and
+     *             cheaper on small ARM boards (kinetic mode stays float)
+     * 
+     * busy_poll_enabled: Spin on the USB connection instead of sleeping?
+     *   - false = Normal (default)
+     *   - true  = Lowest latency for competitive play, but keeps one CPU
+     *             core at 100% while input is arriving
+     * busy_poll_cpu: Core to spin on (-1 = let the OS choose)
+     * busy_poll_idle_ms: Go back to sleeping after this long without input
+     * 
+     * trace_enabled: Record how long each input stage takes?
+     *   - false = Off (default, no measurable cost)
+     *   - true  = Record into memory; run "kill -USR1 <pid>" (or quit) to
+     *             write simulator_trace.json, then open it in ui.perfetto.dev
+     *             to see which stage a latency spike came from
+     * 
+     * metrics_socket_path: Serve Prometheus metrics (packets, errors,
+     *   latency...) on this Unix socket, or NULL for off
+     * metrics_textfile_path: Also write them to this file every
+     *   metrics_interval_ms, e.g. into node_exporter's textfile directory
+     *   ("/usr/local/var/node_exporter/xbox.prom"), or NULL for off
      **************************************************************************/
     
     mapping.console_output_enabled = true;   // ← Set to false to hide debug output
     mapping.streaming_mode         = false;  // ← Set to true for Moonlight/Parsec
+    mapping.fixed_point_math       = false;  // ← Set to true for deterministic math
+    mapping.busy_poll_enabled      = false;  // ← Set to true for lowest latency
+    mapping.busy_poll_cpu          = -1;     // ← Core to dedicate (-1 = any)
+    mapping.busy_poll_idle_ms      = 2000;   // ← Idle time before falling back
+    mapping.trace_enabled          = false;  // ← Set to true to record stage timings
+    mapping.metrics_socket_path    = NULL;   // ← e.g. "/tmp/xbox_simulator.sock"
+    mapping.metrics_textfile_path  = NULL;   // ← e.g. node_exporter textfile dir
+    mapping.metrics_interval_ms    = 15000;  // ← How often the textfile is rewritten
     
     
     return mapping;
@@ -0,0 +1,720 @@
+// latency_rig.c
+// End-to-end input latency on Linux, with no hardware: a fake GIP device
+// publishes timestamped input transitions into a usb_ring (the same path
+// as `simulator --helper`), a pipeline thread decodes and maps them and
+// writes the output actions to a uinput device, and a reader thread opens
+// the resulting /dev/input/event node and matches every event back to the
+// transition that caused it. Unlike the simulator's own histograms this
+// includes the kernel input stack:
+//   inject→evdev   fake device → kernel timestamp on the evdev event
+//   inject→read    fake device → event read by a userspace consumer
+// Each mapping mode (buttons, WASD stick, mouse stick, mouse trigger) gets
+// its own distribution. The device is grabbed, so nothing reaches the desktop.
+// With --play the same uinput device is driven from a capture instead, at
+// the capture's own timing and ungrabbed, so a game under test receives it.
+// Compile: make latency_rig          (Linux only)
+// Run: sudo ./latency_rig [--trials N] [--csv FILE]
+//      (root, or write access to /dev/uinput)
+//      sudo ./latency_rig --play FILE.xcap [--speed X] [--loop [N]]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include "gip.h"
+#include "gip_protocol.h"
+#include "gip_device.h"
+#include "mapper.h"
+#include "keymapping.h"
+#include "usb_ring.h"
+#include "playback.h"
+
+#define DEFAULT_TRIALS      200
+#define MATCH_TIMEOUT_MS    200         // No matching evdev event → trial missed
+#define SETTLE_MS           30          // Between trials: let smoothing and repeats die down
+#define GAP_JITTER_US       4000        // Random extra gap so trials don't phase-lock to ticks
+#define TICK_TIMEOUT_MS     10          // Same output tick as the simulator
+#define IDLE_TIMEOUT_MS     100
+#define RIG_RING_CAPACITY   64
+
+#define STICK_PUSH          30000       // Well outside the default deadzone
+
+static uint64_t rig_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ============================================================================
+// macOS keycodes → Linux evdev
+// ============================================================================
+
+// The mapper speaks macOS virtual keycodes (keymapping.h); these are the
+// ones the bindings can use
+static const struct {
+    uint16_t mac;
+    uint16_t linux_code;
+} keycode_table[] = {
+    { 0x00, KEY_A }, { 0x01, KEY_S }, { 0x02, KEY_D }, { 0x03, KEY_F }, { 0x04, KEY_H },
+    { 0x05, KEY_G }, { 0x06, KEY_Z }, { 0x07, KEY_X }, { 0x08, KEY_C }, { 0x09, KEY_V },
+    { 0x0B, KEY_B }, { 0x0C, KEY_Q }, { 0x0D, KEY_W }, { 0x0E, KEY_E }, { 0x0F, KEY_R },
+    { 0x10, KEY_Y }, { 0x11, KEY_T }, { 0x12, KEY_1 }, { 0x13, KEY_2 }, { 0x14, KEY_3 },
+    { 0x15, KEY_4 }, { 0x16, KEY_6 }, { 0x17, KEY_5 }, { 0x18, KEY_EQUAL }, { 0x19, KEY_9 },
+    { 0x1A, KEY_7 }, { 0x1B, KEY_MINUS }, { 0x1C, KEY_8 }, { 0x1D, KEY_0 },
+    { 0x1E, KEY_RIGHTBRACE }, { 0x1F, KEY_O }, { 0x20, KEY_U }, { 0x21, KEY_LEFTBRACE },
+    { 0x22, KEY_I }, { 0x23, KEY_P }, { 0x24, KEY_ENTER }, { 0x25, KEY_L }, { 0x26, KEY_J },
+    { 0x27, KEY_APOSTROPHE }, { 0x28, KEY_K }, { 0x29, KEY_SEMICOLON }, { 0x2A, KEY_BACKSLASH },
+    { 0x2B, KEY_COMMA }, { 0x2C, KEY_SLASH }, { 0x2D, KEY_N }, { 0x2E, KEY_M }, { 0x2F, KEY_DOT },
+    { 0x30, KEY_TAB }, { 0x31, KEY_SPACE }, { 0x32, KEY_GRAVE }, { 0x33, KEY_BACKSPACE },
+    { 0x35, KEY_ESC }, { 0x37, KEY_LEFTMETA }, { 0x38, KEY_LEFTSHIFT }, { 0x39, KEY_CAPSLOCK },
+    { 0x3A, KEY_LEFTALT }, { 0x3B, KEY_LEFTCTRL },
+    { 0x7B, KEY_LEFT }, { 0x7C, KEY_RIGHT }, { 0x7D, KEY_DOWN }, { 0x7E, KEY_UP },
+};
+
+#define KEYCODE_COUNT (int)(sizeof(keycode_table) / sizeof(keycode_table[0]))
+
+static uint16_t linux_keycode(uint16_t mac) {
+    for (int i = 0; i < KEYCODE_COUNT; i++) {
+        if (keycode_table[i].mac == mac) {
+            return keycode_table[i].linux_code;
+        }
+    }
+    return KEY_RESERVED;
+}
+
+static uint16_t linux_mouse_button(uint16_t button) {
+    switch (button) {
+        case MOUSE_BUTTON_RIGHT:  return BTN_RIGHT;
+        case MOUSE_BUTTON_MIDDLE: return BTN_MIDDLE;
+        case MOUSE_BUTTON_LEFT:
+        default:                  return BTN_LEFT;
+    }
+}
+
+// ============================================================================
+// uinput Output
+// ============================================================================
+
+typedef struct {
+    int fd;
+    float remainder_x;          // Sub-pixel motion carried to the next move
+    float remainder_y;
+} UinputOutput;
+
+static void emit(int fd, uint16_t type, uint16_t code, int32_t value) {
+    struct input_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    (void)!write(fd, &event, sizeof(event));
+}
+
+static bool uinput_open(UinputOutput *out) {
+    memset(out, 0, sizeof(*out));
+    out->fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (out->fd < 0) {
+        return false;
+    }
+
+    ioctl(out->fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(out->fd, UI_SET_EVBIT, EV_REL);
+    ioctl(out->fd, UI_SET_EVBIT, EV_SYN);
+    for (int i = 0; i < KEYCODE_COUNT; i++) {
+        ioctl(out->fd, UI_SET_KEYBIT, keycode_table[i].linux_code);
+    }
+    ioctl(out->fd, UI_SET_KEYBIT, BTN_LEFT);
+    ioctl(out->fd, UI_SET_KEYBIT, BTN_RIGHT);
+    ioctl(out->fd, UI_SET_KEYBIT, BTN_MIDDLE);
+    ioctl(out->fd, UI_SET_RELBIT, REL_X);
+    ioctl(out->fd, UI_SET_RELBIT, REL_Y);
+
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = XBOX_VENDOR_ID;
+    setup.id.product = XBOX_PRODUCT_ID;
+    snprintf(setup.name, UINPUT_MAX_NAME_SIZE, "Xbox latency rig");
+    if (ioctl(out->fd, UI_DEV_SETUP, &setup) != 0 || ioctl(out->fd, UI_DEV_CREATE) != 0) {
+        close(out->fd);
+        return false;
+    }
+    return true;
+}
+
+static void uinput_close(UinputOutput *out) {
+    ioctl(out->fd, UI_DEV_DESTROY);
+    close(out->fd);
+}
+
+// Same job as the simulator's post_actions(), with evdev codes
+static void uinput_post(UinputOutput *out, const OutputActions *actions) {
+    bool wrote = false;
+    for (int i = 0; i < actions->count; i++) {
+        const OutputAction *action = &actions->actions[i];
+        switch (action->type) {
+            case OUTPUT_KEY:
+                emit(out->fd, EV_KEY, linux_keycode(action->code), action->pressed);
+                wrote = true;
+                break;
+            case OUTPUT_MOUSE_BUTTON:
+                emit(out->fd, EV_KEY, linux_mouse_button(action->code), action->pressed);
+                wrote = true;
+                break;
+            case OUTPUT_MOUSE_MOVE: {
+                out->remainder_x += action->dx;
+                out->remainder_y += action->dy;
+                int dx = (int)out->remainder_x;
+                int dy = (int)out->remainder_y;
+                out->remainder_x -= dx;
+                out->remainder_y -= dy;
+                if (dx) emit(out->fd, EV_REL, REL_X, dx);
+                if (dy) emit(out->fd, EV_REL, REL_Y, dy);
+                wrote |= dx || dy;
+                break;
+            }
+        }
+    }
+    if (wrote) {
+        emit(out->fd, EV_SYN, SYN_REPORT, 0);
+    }
+}
+
+// The evdev node the kernel made for our uinput device
+static int open_event_node(int uinput_fd) {
+    char sysname[64];
+    if (ioctl(uinput_fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+        return -1;
+    }
+    char dir_path[128];
+    snprintf(dir_path, sizeof(dir_path), "/sys/devices/virtual/input/%s", sysname);
+
+    // udev may take a moment to create the /dev node
+    for (int attempt = 0; attempt < 100; attempt++) {
+        DIR *dir = opendir(dir_path);
+        struct dirent *entry;
+        while (dir && (entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "event", 5) != 0) {
+                continue;
+            }
+            char node[300];
+            snprintf(node, sizeof(node), "/dev/input/%s", entry->d_name);
+            int fd = open(node, O_RDONLY | O_NONBLOCK);
+            if (fd >= 0) {
+                closedir(dir);
+                int clock = CLOCK_MONOTONIC;
+                ioctl(fd, EVIOCSCLOCKID, &clock);   // Same clock as the injection stamps
+                ioctl(fd, EVIOCGRAB, 1);            // Keep rig events away from the desktop
+                return fd;
+            }
+        }
+        if (dir) {
+            closedir(dir);
+        }
+        usleep(10000);
+    }
+    return -1;
+}
+
+// ============================================================================
+// Trials and Matching
+// ============================================================================
+
+typedef struct {
+    uint16_t type;
+    uint16_t code;
+    int32_t value;              // For EV_REL: expected sign
+} ExpectedEvent;
+
+typedef struct {
+    uint64_t evdev_ns;
+    uint64_t read_ns;
+} Sample;
+
+// Shared between the fake device (main thread) and the evdev reader
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t matched_cond;
+    bool armed;
+    bool matched;
+    ExpectedEvent expected;
+    uint64_t inject_ns;
+    Sample sample;
+
+    int event_fd;
+    atomic_bool running;
+} Matcher;
+
+static bool event_matches(const ExpectedEvent *expected, const struct input_event *event) {
+    if (event->type != expected->type || event->code != expected->code) {
+        return false;
+    }
+    if (event->type == EV_REL) {
+        return (expected->value > 0) == (event->value > 0);
+    }
+    return event->value == expected->value;
+}
+
+static void *reader_thread(void *arg) {
+    Matcher *m = arg;
+    struct input_event events[64];
+
+    while (atomic_load(&m->running)) {
+        struct pollfd pfd = { m->event_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+        ssize_t bytes = read(m->event_fd, events, sizeof(events));
+        uint64_t read_ns = rig_clock_ns();
+        if (bytes <= 0) {
+            continue;
+        }
+
+        pthread_mutex_lock(&m->lock);
+        for (int i = 0; i < (int)(bytes / sizeof(events[0])); i++) {
+            if (!m->armed || !event_matches(&m->expected, &events[i])) {
+                continue;
+            }
+            uint64_t stamp = (uint64_t)events[i].input_event_sec * 1000000000ull +
+                             (uint64_t)events[i].input_event_usec * 1000ull;
+            m->sample.evdev_ns = stamp - m->inject_ns;
+            m->sample.read_ns = read_ns - m->inject_ns;
+            m->armed = false;
+            m->matched = true;
+            pthread_cond_signal(&m->matched_cond);
+        }
+        pthread_mutex_unlock(&m->lock);
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Pipeline (decode → mapper → uinput), fed from the ring
+// ============================================================================
+
+typedef struct {
+    UsbRing *ring;
+    Mapper mapper;
+    OutputActions actions;
+    UinputOutput *output;
+} Pipeline;
+
+static void *pipeline_thread(void *arg) {
+    Pipeline *p = arg;
+    UsbRingPacket packet;
+
+    for (;;) {
+        int timeout_ms = mapper_tick_pending(&p->mapper) ? TICK_TIMEOUT_MS : IDLE_TIMEOUT_MS;
+        int result = usb_ring_wait(p->ring, timeout_ms * 1000);
+        if (result < 0) {
+            break;
+        }
+        if (result == 0) {
+            mapper_tick(&p->mapper, rig_clock_ns(), &p->actions);
+            uinput_post(p->output, &p->actions);
+            continue;
+        }
+        while (usb_ring_pop(p->ring, &packet)) {
+            const GipInputPacket *input = gip_decode_input(packet.data, packet.length);
+            if (input) {
+                mapper_process(&p->mapper, input, packet.completion_ns, &p->actions);
+                uinput_post(p->output, &p->actions);
+            }
+        }
+    }
+
+    while (mapper_release_all(&p->mapper, &p->actions) > 0) {
+        uinput_post(p->output, &p->actions);
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Fake GIP Device and Mapping Modes
+// ============================================================================
+
+typedef enum {
+    MODE_BUTTON,            // A → key
+    MODE_STICK_WASD,        // Left stick right → D
+    MODE_STICK_MOUSE,       // Right stick → cursor motion
+    MODE_TRIGGER_MOUSE,     // Right trigger → right click
+    MODE_COUNT
+} RigMode;
+
+static const char *mode_names[MODE_COUNT] = {
+    "button→key", "stick→wasd", "stick→mouse", "trigger→click",
+};
+
+typedef struct {
+    uint64_t *evdev;
+    uint64_t *read;
+    int count;
+    int missed;
+} ModeResults;
+
+typedef struct {
+    UsbRing *ring;
+    uint8_t sequence;
+    uint32_t rng;
+} FakeDevice;
+
+static void fake_device_send(FakeDevice *dev, const GipInputPacket *state) {
+    GipInputPacket packet = *state;
+    packet.header.command = GIP_CMD_INPUT;
+    packet.header.options = 0;
+    packet.header.sequence = dev->sequence++;
+    packet.header.length = sizeof(packet) - sizeof(GipHeader);
+    usb_ring_push(dev->ring, (const uint8_t *)&packet, sizeof(packet), rig_clock_ns());
+}
+
+static void sleep_us(uint64_t us) {
+    struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+// Arm the matcher, send the transition, wait for the evdev event
+static bool run_transition(Matcher *m, FakeDevice *dev, const GipInputPacket *state,
+                           ExpectedEvent expected, Sample *sample) {
+    pthread_mutex_lock(&m->lock);
+    m->expected = expected;
+    m->matched = false;
+    m->armed = true;
+    m->inject_ns = rig_clock_ns();
+    fake_device_send(dev, state);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += MATCH_TIMEOUT_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    while (!m->matched &&
+           pthread_cond_timedwait(&m->matched_cond, &m->lock, &deadline) != ETIMEDOUT) {
+    }
+    bool matched = m->matched;
+    m->armed = false;
+    *sample = m->sample;
+    pthread_mutex_unlock(&m->lock);
+    return matched;
+}
+
+static void record(ModeResults *results, bool matched, const Sample *sample) {
+    if (matched) {
+        results->evdev[results->count] = sample->evdev_ns;
+        results->read[results->count] = sample->read_ns;
+        results->count++;
+    } else {
+        results->missed++;
+    }
+}
+
+static void run_mode(RigMode mode, int trials, Matcher *m, UinputOutput *output,
+                     ModeResults *results) {
+    ControllerMapping mapping = get_default_mapping();
+    mapping.sticks.left_stick_mode = STICK_MODE_WASD;
+    mapping.sticks.right_stick_mode = STICK_MODE_MOUSE;
+    mapping.triggers.right_trigger_mode = TRIGGER_MODE_MOUSE;
+
+    CompiledProfile profile;
+    mapper_compile_profile(&mapping, NULL, &profile);
+
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.output = output;
+    mapper_init(&pipeline.mapper, &profile);
+    if (usb_ring_create(&pipeline.ring, RIG_RING_CAPACITY, "latency-rig") != GIP_OK) {
+        printf("❌ Could not create ring\n");
+        return;
+    }
+    FakeDevice dev = { pipeline.ring, 0, 12345u + (uint32_t)mode };
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, pipeline_thread, &pipeline);
+
+    GipInputPacket idle;
+    memset(&idle, 0, sizeof(idle));
+    uint16_t key_a = linux_keycode(mapping.buttons.key_a);
+    uint16_t key_right = linux_keycode(mapping.sticks.left_right);
+
+    // GIP swaps both stick axes and both triggers (the mapper swaps them
+    // back), so the physical right push is the raw Y axis and the physical
+    // right trigger is the packet's left_trigger
+
+    for (int trial = 0; trial < trials; trial++) {
+        GipInputPacket active = idle;
+        Sample sample;
+        bool matched;
+
+        switch (mode) {
+            case MODE_BUTTON:
+                active.buttons = XBOX_BTN_A;
+                matched = run_transition(m, &dev, &active, (ExpectedEvent){ EV_KEY, key_a, 1 }, &sample);
+                record(results, matched, &sample);
+                matched = run_transition(m, &dev, &idle, (ExpectedEvent){ EV_KEY, key_a, 0 }, &sample);
+                record(results, matched, &sample);
+                break;
+            case MODE_STICK_WASD:
+                active.left_stick_y = STICK_PUSH;
+                matched = run_transition(m, &dev, &active, (ExpectedEvent){ EV_KEY, key_right, 1 }, &sample);
+                record(results, matched, &sample);
+                matched = run_transition(m, &dev, &idle, (ExpectedEvent){ EV_KEY, key_right, 0 }, &sample);
+                record(results, matched, &sample);
+                break;
+            case MODE_STICK_MOUSE: {
+                // Alternate directions so leftover smoothed motion from the
+                // previous push never matches
+                int sign = (trial & 1) ? -1 : 1;
+                active.right_stick_y = (int16_t)(sign * STICK_PUSH);
+                matched = run_transition(m, &dev, &active, (ExpectedEvent){ EV_REL, REL_X, sign }, &sample);
+                record(results, matched, &sample);
+                fake_device_send(&dev, &idle);
+                break;
+            }
+            case MODE_TRIGGER_MOUSE:
+                active.left_trigger = 255;
+                matched = run_transition(m, &dev, &active, (ExpectedEvent){ EV_KEY, BTN_RIGHT, 1 }, &sample);
+                record(results, matched, &sample);
+                matched = run_transition(m, &dev, &idle, (ExpectedEvent){ EV_KEY, BTN_RIGHT, 0 }, &sample);
+                record(results, matched, &sample);
+                break;
+            default:
+                break;
+        }
+
+        dev.rng = dev.rng * 1103515245u + 12345u;
+        sleep_us(SETTLE_MS * 1000 + (dev.rng >> 16) % GAP_JITTER_US);
+    }
+
+    usb_ring_set_state(pipeline.ring, USB_RING_DISCONNECTED);
+    pthread_join(thread, NULL);
+    usb_ring_close(pipeline.ring);
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_distribution(const char *name, const char *path, uint64_t *samples, int count) {
+    if (count == 0) {
+        printf("  %-14s %-13s no samples\n", name, path);
+        return;
+    }
+    qsort(samples, count, sizeof(uint64_t), compare_u64);
+    printf("  %-14s %-13s p50=%7.1fus p90=%7.1fus p99=%7.1fus max=%7.1fus\n", name, path,
+           samples[count / 2] / 1000.0, samples[(int)(count * 0.9)] / 1000.0,
+           samples[(int)(count * 0.99)] / 1000.0, samples[count - 1] / 1000.0);
+}
+
+static bool write_csv(const char *path, ModeResults *results) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    fprintf(f, "mode,inject_to_evdev_ns,inject_to_read_ns\n");
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        for (int i = 0; i < results[mode].count; i++) {
+            fprintf(f, "%s,%llu,%llu\n", mode_names[mode],
+                    (unsigned long long)results[mode].evdev[i],
+                    (unsigned long long)results[mode].read[i]);
+        }
+    }
+    return fclose(f) == 0;
+}
+
+// ============================================================================
+// Capture Playback (--play)
+// ============================================================================
+
+static volatile int playing = 1;
+
+static void stop_playing(int sig) {
+    (void)sig;
+    playing = 0;
+}
+
+typedef struct {
+    Mapper mapper;
+    OutputActions actions;
+    UinputOutput *output;
+} PlaySink;
+
+static void play_packet(void *user, const uint8_t *data, int length, uint64_t now_ns) {
+    PlaySink *p = user;
+    const GipInputPacket *input = gip_decode_input(data, length);
+    if (input) {
+        mapper_process(&p->mapper, input, now_ns, &p->actions);
+        uinput_post(p->output, &p->actions);
+    }
+}
+
+static void play_tick(void *user, uint64_t now_ns) {
+    PlaySink *p = user;
+    mapper_tick(&p->mapper, now_ns, &p->actions);
+    uinput_post(p->output, &p->actions);
+}
+
+// Drive the uinput device from a capture through the default mapping. The
+// device is not grabbed: whatever has focus gets the input.
+static int play_capture(const char *path, PlaybackOptions *options) {
+    Playback playback;
+    char error[256];
+    if (!playback_load(&playback, path, error, sizeof(error))) {
+        printf("❌ %s\n", error);
+        return 1;
+    }
+
+    UinputOutput output;
+    if (!uinput_open(&output)) {
+        printf("❌ Could not create uinput device: %s\n", strerror(errno));
+        printf("   Run with sudo, or give your user write access to /dev/uinput\n");
+        playback_free(&playback);
+        return 1;
+    }
+
+    static PlaySink sink;
+    static CompiledProfile profile;
+    ControllerMapping config = get_default_mapping();
+    mapper_compile_profile(&config, NULL, &profile);
+    mapper_init(&sink.mapper, &profile);
+    sink.output = &output;
+
+    signal(SIGINT, stop_playing);
+    signal(SIGTERM, stop_playing);
+    options->running = &playing;
+    options->tick_ns = (uint64_t)TICK_TIMEOUT_MS * 1000000ull;
+
+    // Give the desktop a moment to pick up the new device before input starts
+    sleep_us(500000);
+    printf("🎮 Playing %d packets (%.1f s) from %s at %.2gx, Ctrl+C to stop\n\n", playback.count,
+           playback.duration_ns / 1e9, path, options->speed);
+
+    PlaybackSink callbacks = { .packet = play_packet, .tick = play_tick, .user = &sink };
+    PlaybackStats stats;
+    playback_run(&playback, options, &callbacks, &stats);
+
+    while (mapper_release_all(&sink.mapper, &sink.actions) > 0) {
+        uinput_post(&output, &sink.actions);
+    }
+    uinput_close(&output);
+    playback_free(&playback);
+
+    playback_print_stats(&stats);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int trials = DEFAULT_TRIALS;
+    const char *csv_path = NULL;
+    const char *play_path = NULL;
+    PlaybackOptions play_options = PLAYBACK_DEFAULT_OPTIONS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trials") == 0 && i + 1 < argc) {
+            trials = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc) {
+            play_path = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            play_options.speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            play_options.loops = (i + 1 < argc && argv[i + 1][0] != '-') ? atoi(argv[++i]) : 0;
+        } else {
+            printf("Usage: %s [--trials N] [--csv FILE]\n"
+                   "       %s --play FILE.xcap [--speed X] [--loop [N]]\n", argv[0], argv[0]);
+            return 1;
+        }
+    }
+    if (play_path) {
+        if (play_options.speed <= 0 || play_options.loops < 0) {
+            printf("❌ --speed must be above 0 and --loop not negative\n");
+            return 1;
+        }
+        return play_capture(play_path, &play_options);
+    }
+    if (trials <= 0) {
+        printf("❌ --trials must be positive\n");
+        return 1;
+    }
+
+    printf("Xbox Controller Latency Rig (fake GIP → mapper → uinput → evdev)\n");
+    printf("=================================================================\n\n");
+
+    UinputOutput output;
+    if (!uinput_open(&output)) {
+        printf("❌ Could not create uinput device: %s\n", strerror(errno));
+        printf("   Run with sudo, or give your user write access to /dev/uinput\n");
+        return 1;
+    }
+
+    Matcher matcher;
+    memset(&matcher, 0, sizeof(matcher));
+    pthread_mutex_init(&matcher.lock, NULL);
+    pthread_cond_init(&matcher.matched_cond, NULL);
+    atomic_store(&matcher.running, true);
+    matcher.event_fd = open_event_node(output.fd);
+    if (matcher.event_fd < 0) {
+        printf("❌ Could not open the uinput device's event node\n");
+        uinput_close(&output);
+        return 1;
+    }
+    printf("✅ Virtual device ready, %d trials per mode\n\n", trials);
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, reader_thread, &matcher);
+
+    // Key modes measure press and release
+    ModeResults results[MODE_COUNT];
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        results[mode].evdev = calloc(2 * trials, sizeof(uint64_t));
+        results[mode].read = calloc(2 * trials, sizeof(uint64_t));
+        results[mode].count = 0;
+        results[mode].missed = 0;
+        printf("🎮 %s...\n", mode_names[mode]);
+        run_mode((RigMode)mode, trials, &matcher, &output, &results[mode]);
+    }
+
+    atomic_store(&matcher.running, false);
+    pthread_join(reader, NULL);
+    close(matcher.event_fd);
+    uinput_close(&output);
+
+    bool csv_ok = !csv_path || write_csv(csv_path, results);
+
+    bool all_matched = true;
+    printf("\nInput-to-evdev latency:\n");
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        print_distribution(mode_names[mode], "inject→evdev", results[mode].evdev, results[mode].count);
+        print_distribution("", "inject→read", results[mode].read, results[mode].count);
+        if (results[mode].count == 0) {
+            printf("  %-14s ❌ No transition produced its event within %d ms\n", "", MATCH_TIMEOUT_MS);
+            all_matched = false;
+        } else if (results[mode].missed) {
+            printf("  %-14s ⚠️  %d transitions produced no event within %d ms\n", "",
+                   results[mode].missed, MATCH_TIMEOUT_MS);
+        }
+        free(results[mode].evdev);
+        free(results[mode].read);
+    }
+
+    if (csv_path) {
+        printf("\n%s %s\n", csv_ok ? "✅ Wrote samples to" : "❌ Could not write", csv_path);
+    }
+    return csv_ok && all_matched ? 0 : 1;
+}
@@ -0,0 +1,923 @@
+// mapper.c
+// Controller input → keyboard/mouse output actions (libmapper)
+
+#include <string.h>
+#include <math.h>
+#include "mapper.h"
+#include "stick_math.h"
+#include "probes.h"
+
+// Arrow keys (STICK_MODE_ARROWS)
+#define KEY_UP_ARROW     0x7E
+#define KEY_DOWN_ARROW   0x7D
+#define KEY_LEFT_ARROW   0x7B
+#define KEY_RIGHT_ARROW  0x7C
+
+// ============================================================================
+// Profile Compilation
+// ============================================================================
+
+static void compile_stick(CompiledStick *stick, StickMode mode,
+                          uint16_t up, uint16_t down, uint16_t left, uint16_t right,
+                          const StickMapping *sticks, const StickChainSpec *spec,
+                          const StickRange *range) {
+    stick->mode = mode;
+    if (mode == STICK_MODE_ARROWS) {
+        stick->key_up = KEY_UP_ARROW;
+        stick->key_down = KEY_DOWN_ARROW;
+        stick->key_left = KEY_LEFT_ARROW;
+        stick->key_right = KEY_RIGHT_ARROW;
+    } else {
+        stick->key_up = up;
+        stick->key_down = down;
+        stick->key_left = left;
+        stick->key_right = right;
+    }
+
+    // An empty spec means the chain the mouse settings describe
+    if (spec->count == 0) {
+        StickChainSpec from_settings;
+        stick_chain_from_settings(sticks, &from_settings);
+        stick_chain_compile(&from_settings, true, &stick->chain);
+    } else {
+        stick_chain_compile(spec, false, &stick->chain);
+    }
+
+    // Calibration only applies where the chain asks for it
+    if (!stick->chain.calibrate) {
+        range = NULL;
+    }
+    stick->calibrated = (range != NULL);
+    if (range) {
+        stick->range = *range;
+        fx_range_from_calibration(&stick->fx_range, range);
+    }
+}
+
+void mapper_compile_profile(const ControllerMapping *mapping, const StickCalibration *calibration,
+                            CompiledProfile *profile) {
+    const ButtonMapping *b = &mapping->buttons;
+    const StickMapping *s = &mapping->sticks;
+    const ButtonBinding buttons[MAPPER_NUM_BUTTONS] = {
+        {XBOX_BTN_A, b->key_a},
+        {XBOX_BTN_B, b->key_b},
+        {XBOX_BTN_X, b->key_x},
+        {XBOX_BTN_Y, b->key_y},
+        {XBOX_BTN_LB, b->key_lb},
+        {XBOX_BTN_RB, b->key_rb},
+        {XBOX_BTN_LS, b->key_ls},
+        {XBOX_BTN_RS, b->key_rs},
+        {XBOX_BTN_VIEW, b->key_view},
+        {XBOX_BTN_MENU, b->key_menu},
+        {XBOX_BTN_DPAD_UP, b->key_dpad_up},
+        {XBOX_BTN_DPAD_DOWN, b->key_dpad_down},
+        {XBOX_BTN_DPAD_LEFT, b->key_dpad_left},
+        {XBOX_BTN_DPAD_RIGHT, b->key_dpad_right}
+    };
+
+    memset(profile, 0, sizeof(*profile));
+    memcpy(profile->buttons, buttons, sizeof(buttons));
+
+    compile_stick(&profile->left_stick, s->left_stick_mode,
+                  s->left_up, s->left_down, s->left_left, s->left_right, s, &s->left_chain,
+                  calibration ? &calibration->left : NULL);
+    compile_stick(&profile->right_stick, s->right_stick_mode,
+                  s->right_up, s->right_down, s->right_left, s->right_right, s, &s->right_chain,
+                  calibration ? &calibration->right : NULL);
+
+    profile->left_trigger.mode = mapping->triggers.left_trigger_mode;
+    profile->left_trigger.key = mapping->triggers.left_trigger_key;
+    profile->right_trigger.mode = mapping->triggers.right_trigger_mode;
+    profile->right_trigger.key = mapping->triggers.right_trigger_key;
+    profile->trigger_threshold = mapping->triggers.threshold;
+
+    profile->deadzone = s->deadzone;
+    profile->mouse_sensitivity = s->mouse_sensitivity;
+    profile->mouse_curve = s->mouse_curve;
+    profile->mouse_smoothing = s->mouse_smoothing;
+    profile->kinetic_friction = s->kinetic_friction;
+    profile->fixed_point_math = mapping->fixed_point_math;
+    fx_stick_params_init(&profile->fx_params, s->deadzone, s->mouse_smoothing,
+                         s->mouse_curve, s->mouse_sensitivity, MOUSE_PIXELS_PER_TICK);
+}
+
+// ============================================================================
+// Output Actions
+// ============================================================================
+
+static void emit(OutputActions *actions, OutputActionType type, uint16_t code, bool pressed) {
+    if (actions->count < MAPPER_MAX_ACTIONS) {
+        OutputAction *action = &actions->actions[actions->count++];
+        action->type = type;
+        action->code = code;
+        action->pressed = pressed;
+        action->dx = 0.0f;
+        action->dy = 0.0f;
+    }
+    PROBE_BINDING_FIRED(type, code, pressed);
+}
+
+static void emit_key(Mapper *mapper, OutputActions *actions, uint16_t keycode, bool pressed) {
+    emit(actions, OUTPUT_KEY, keycode, pressed);
+    mapper->state.cold.keys[keycode & 0xFF] = pressed;
+}
+
+static void emit_mouse_button(Mapper *mapper, OutputActions *actions, MouseButton button, bool pressed) {
+    InputStateCold *outputs = &mapper->state.cold;
+
+    emit(actions, OUTPUT_MOUSE_BUTTON, button, pressed);
+    if (button == MOUSE_BUTTON_LEFT) {
+        outputs->mouse_left = pressed;
+    } else if (button == MOUSE_BUTTON_RIGHT) {
+        outputs->mouse_right = pressed;
+    } else {
+        outputs->mouse_middle = pressed;
+    }
+}
+
+// Flush the accumulated mouse delta as one move action
+static void emit_mouse_movement(Mapper *mapper, OutputActions *actions) {
+    InputStateHot *state = &mapper->state.hot;
+
+    // Always send accumulated mouse movement if any exists (no minimum threshold)
+    if ((state->mouse_dx != 0.0f || state->mouse_dy != 0.0f) &&
+        actions->count < MAPPER_MAX_ACTIONS) {
+        OutputAction *action = &actions->actions[actions->count++];
+        action->type = OUTPUT_MOUSE_MOVE;
+        action->code = 0;
+        action->pressed = false;
+        action->dx = state->mouse_dx;
+        action->dy = state->mouse_dy;
+    }
+    state->mouse_dx = 0.0f;
+    state->mouse_dy = 0.0f;
+}
+
+// ============================================================================
+// Buttons and Triggers
+// ============================================================================
+
+static void process_buttons(Mapper *mapper, uint16_t buttons, OutputActions *actions) {
+    InputStateHot *state = &mapper->state.hot;
+    uint16_t changed = buttons ^ state->prev_buttons;
+
+    // Common case: no button changed
+    if (changed) {
+        const ButtonBinding *binding = mapper->profile->buttons;
+        for (int i = 0; i < MAPPER_NUM_BUTTONS; i++) {
+            if (changed & binding[i].mask) {
+                emit_key(mapper, actions, binding[i].keycode, (buttons & binding[i].mask) != 0);
+            }
+        }
+    }
+
+    state->prev_buttons = buttons;
+}
+
+static void process_trigger(Mapper *mapper, const CompiledTrigger *trigger, MouseButton button,
+                            bool pressed, OutputActions *actions) {
+    if (trigger->mode == TRIGGER_MODE_MOUSE) {
+        emit_mouse_button(mapper, actions, button, pressed);
+    } else if (trigger->mode == TRIGGER_MODE_KEY) {
+        emit_key(mapper, actions, trigger->key, pressed);
+    }
+}
+
+static void process_triggers(Mapper *mapper, uint8_t left_trigger, uint8_t right_trigger,
+                             OutputActions *actions) {
+    InputStateHot *state = &mapper->state.hot;
+    const CompiledProfile *profile = mapper->profile;
+    uint8_t threshold = profile->trigger_threshold;
+
+    // Right trigger (swapped - GIP packet has them reversed)
+    bool right_pressed = left_trigger > threshold;
+    bool right_was_pressed = state->prev_right_trigger > threshold;
+    if (right_pressed != right_was_pressed) {
+        process_trigger(mapper, &profile->right_trigger, MOUSE_BUTTON_RIGHT, right_pressed, actions);
+    }
+
+    // Left trigger (swapped - GIP packet has them reversed)
+    bool left_pressed = right_trigger > threshold;
+    bool left_was_pressed = state->prev_left_trigger > threshold;
+    if (left_pressed != left_was_pressed) {
+        process_trigger(mapper, &profile->left_trigger, MOUSE_BUTTON_LEFT, left_pressed, actions);
+    }
+
+    state->prev_left_trigger = right_trigger;  // Swapped
+    state->prev_right_trigger = left_trigger;  // Swapped
+}
+
+// ============================================================================
+// Sticks
+// ============================================================================
+
+// Press/release one key for a stick direction that changed
+static void update_stick_key(Mapper *mapper, OutputActions *actions, uint8_t dirs,
+                             uint8_t changed, uint8_t dir, uint16_t keycode) {
+    if (changed & dir) {
+        emit_key(mapper, actions, keycode, (dirs & dir) != 0);
+    }
+}
+
+static void process_stick_as_keys(Mapper *mapper, const CompiledStick *stick, int16_t x, int16_t y,
+                                  uint8_t *held_dirs, OutputActions *actions) {
+    // Axes are swapped in the controller - swap them back
+    // Physical up/down is reported in X, physical left/right is reported in Y
+    int16_t temp = x;
+    x = y;
+    y = temp;
+
+    // Normalize to -1.0 to 1.0
+    float norm_x = x / 32767.0f;
+    float norm_y = y / 32767.0f;
+
+    // Determine which directions are active (with threshold)
+    uint8_t dirs = 0;
+    if (norm_y > 0.3f) dirs |= STICK_DIR_UP;
+    if (norm_y < -0.3f) dirs |= STICK_DIR_DOWN;
+    if (norm_x < -0.3f) dirs |= STICK_DIR_LEFT;
+    if (norm_x > 0.3f) dirs |= STICK_DIR_RIGHT;
+
+    // Common case: nothing changed, don't touch the key table at all
+    uint8_t changed = dirs ^ *held_dirs;
+    if (!changed) {
+        return;
+    }
+    *held_dirs = dirs;
+
+    update_stick_key(mapper, actions, dirs, changed, STICK_DIR_UP, stick->key_up);
+    update_stick_key(mapper, actions, dirs, changed, STICK_DIR_DOWN, stick->key_down);
+    update_stick_key(mapper, actions, dirs, changed, STICK_DIR_LEFT, stick->key_left);
+    update_stick_key(mapper, actions, dirs, changed, STICK_DIR_RIGHT, stick->key_right);
+}
+
+// The fixed-point pipeline is built from the mouse settings, so it only
+// stands in for chains built from them too
+static bool use_fixed_point(const CompiledProfile *profile, const CompiledStick *stick) {
+    return profile->fixed_point_math && stick->chain.from_settings;
+}
+
+// The chain's gate (deadzone + calibration) for one stick, on whichever
+// pipeline is configured. Stored positions are already calibrated, so
+// output ticks pass use_range = false.
+static void gate_stick(const CompiledProfile *profile, const CompiledStick *stick, bool use_range,
+                       int16_t *x, int16_t *y) {
+    bool calibrated = use_range && stick->calibrated;
+
+    if (use_fixed_point(profile, stick)) {
+        fx_apply_deadzone(x, y, &profile->fx_params, calibrated ? &stick->fx_range : NULL);
+    } else {
+        apply_deadzone(x, y, stick->chain.deadzone, calibrated ? &stick->range : NULL);
+    }
+}
+
+static void process_stick_as_mouse(Mapper *mapper, const StickChain *chain, int16_t x, int16_t y,
+                                   float *smoothed_x, float *smoothed_y) {
+    float shaped_x, shaped_y;
+
+    stick_chain_run(chain, x, y, smoothed_x, smoothed_y, &shaped_x, &shaped_y);
+
+    // Scale by sensitivity and accumulate (flushed once per packet/tick)
+    mapper->state.hot.mouse_dx += shaped_x * chain->gain_x * MOUSE_PIXELS_PER_TICK;
+    mapper->state.hot.mouse_dy += shaped_y * chain->gain_y * MOUSE_PIXELS_PER_TICK;
+}
+
+// Fixed-point mouse mode: integer all the way to the pixel delta
+static void process_stick_as_mouse_fixed(Mapper *mapper, int16_t x, int16_t y,
+                                         int32_t *smoothed_x, int32_t *smoothed_y) {
+    int32_t dx_q16, dy_q16;
+    fx_process_stick_as_mouse(&mapper->profile->fx_params, x, y, smoothed_x, smoothed_y,
+                              &dx_q16, &dy_q16);
+
+    mapper->state.hot.mouse_dx += dx_q16 / (float)FX_ONE_Q16;
+    mapper->state.hot.mouse_dy += dy_q16 / (float)FX_ONE_Q16;
+}
+
+// Mouse mode for one stick, on whichever pipeline is configured
+static void mouse_stick(Mapper *mapper, const CompiledStick *stick, bool is_left, int16_t x, int16_t y) {
+    InputStateHot *state = &mapper->state.hot;
+
+    if (use_fixed_point(mapper->profile, stick)) {
+        process_stick_as_mouse_fixed(mapper, x, y,
+                                     is_left ? &state->fx_smoothed_left_x : &state->fx_smoothed_right_x,
+                                     is_left ? &state->fx_smoothed_left_y : &state->fx_smoothed_right_y);
+    } else {
+        process_stick_as_mouse(mapper, &stick->chain, x, y,
+                               is_left ? &state->smoothed_left_x : &state->smoothed_right_x,
+                               is_left ? &state->smoothed_left_y : &state->smoothed_right_y);
+    }
+}
+
+// Trackball-style cursor: a stick that has just been deflected sets the
+// velocity directly (so it can catch or redirect a glide), a released stick
+// lets the velocity decay with friction. While the stick stays deflected it
+// can speed the cursor up at once, but easing it back only lets the velocity
+// coast down with friction - otherwise a flick would launch at the crawl of
+// its last sample near the deadzone rather than the speed it had before the
+// return began. Integrated against the caller's clock on every output tick.
+static void kinetic_stick(Mapper *mapper, const CompiledStick *stick, bool is_left, int16_t x, int16_t y,
+                          uint64_t now_ns) {
+    const CompiledProfile *profile = mapper->profile;
+    const StickChain *chain = &stick->chain;
+    InputStateHot *state = &mapper->state.hot;
+    KineticState *kinetic = is_left ? &state->kinetic_left : &state->kinetic_right;
+    float *smoothed_x = is_left ? &state->smoothed_left_x : &state->smoothed_right_x;
+    float *smoothed_y = is_left ? &state->smoothed_left_y : &state->smoothed_right_y;
+    bool deflected = (x != 0 || y != 0);
+
+    // Nothing to do until the stick moves again
+    if (!deflected && !kinetic->gliding) {
+        kinetic->last_tick = 0;
+        return;
+    }
+
+    double now = now_ns / 1e9;
+    float dt = (kinetic->last_tick > 0) ? (float)(now - kinetic->last_tick) : 0.0f;
+    if (dt > KINETIC_MAX_DT) {
+        dt = KINETIC_MAX_DT;
+    }
+    kinetic->last_tick = now;
+
+    if (deflected) {
+        float shaped_x, shaped_y;
+        stick_chain_run(chain, x, y, smoothed_x, smoothed_y, &shaped_x, &shaped_y);
+
+        float velocity_x = shaped_x * (chain->gain_x * MOUSE_PIXELS_PER_TICK * NOMINAL_TICK_HZ);
+        float velocity_y = shaped_y * (chain->gain_y * MOUSE_PIXELS_PER_TICK * NOMINAL_TICK_HZ);
+        if (kinetic->deflected) {
+            float decay = expf(-profile->kinetic_friction * dt);
+            float coast_x = kinetic->velocity_x * decay;
+            float coast_y = kinetic->velocity_y * decay;
+            if (coast_x * coast_x + coast_y * coast_y > velocity_x * velocity_x + velocity_y * velocity_y) {
+                velocity_x = coast_x;
+                velocity_y = coast_y;
+            }
+        }
+        kinetic->velocity_x = velocity_x;
+        kinetic->velocity_y = velocity_y;
+        kinetic->gliding = true;
+        kinetic->deflected = true;
+    } else {
+        // Released: glide with exponential friction, start from rest next time
+        float decay = expf(-profile->kinetic_friction * dt);
+        kinetic->velocity_x *= decay;
+        kinetic->velocity_y *= decay;
+        *smoothed_x = 0.0f;
+        *smoothed_y = 0.0f;
+        kinetic->deflected = false;
+
+        float speed = sqrtf(kinetic->velocity_x * kinetic->velocity_x +
+                            kinetic->velocity_y * kinetic->velocity_y);
+        if (speed < KINETIC_STOP_SPEED) {
+            kinetic->velocity_x = 0.0f;
+            kinetic->velocity_y = 0.0f;
+            kinetic->remainder_x = 0.0f;
+            kinetic->remainder_y = 0.0f;
+            kinetic->gliding = false;
+            kinetic->last_tick = 0;
+            return;
+        }
+    }
+
+    // Sub-pixel accumulator: only whole pixels leave, the fraction carries over
+    kinetic->remainder_x += kinetic->velocity_x * dt;
+    kinetic->remainder_y += kinetic->velocity_y * dt;
+    float step_x = truncf(kinetic->remainder_x);
+    float step_y = truncf(kinetic->remainder_y);
+    kinetic->remainder_x -= step_x;
+    kinetic->remainder_y -= step_y;
+
+    state->mouse_dx += step_x;
+    state->mouse_dy += step_y;
+}
+
+static void process_stick(Mapper *mapper, bool is_left, int16_t x, int16_t y,
+                          uint64_t now_ns, OutputActions *actions) {
+    const CompiledStick *stick = is_left ? &mapper->profile->left_stick : &mapper->profile->right_stick;
+    InputStateHot *state = &mapper->state.hot;
+
+    switch (stick->mode) {
+        case STICK_MODE_WASD:
+        case STICK_MODE_ARROWS:
+            process_stick_as_keys(mapper, stick, x, y,
+                                  is_left ? &state->left_stick_dirs : &state->right_stick_dirs,
+                                  actions);
+            break;
+        case STICK_MODE_MOUSE:
+            mouse_stick(mapper, stick, is_left, x, y);
+            break;
+        case STICK_MODE_KINETIC:
+            kinetic_stick(mapper, stick, is_left, x, y, now_ns);
+            break;
+        case STICK_MODE_DISABLED:
+        default:
+            break;
+    }
+}
+
+static void process_sticks(Mapper *mapper, int16_t left_x, int16_t left_y,
+                           int16_t right_x, int16_t right_y, uint64_t now_ns,
+                           OutputActions *actions) {
+    const CompiledProfile *profile = mapper->profile;
+    InputStateHot *state = &mapper->state.hot;
+
+    // Apply each chain's gate: deadzone, and outer-range calibration if recorded
+    gate_stick(profile, &profile->left_stick, true, &left_x, &left_y);
+    gate_stick(profile, &profile->right_stick, true, &right_x, &right_y);
+
+    process_stick(mapper, true, left_x, left_y, now_ns, actions);
+    process_stick(mapper, false, right_x, right_y, now_ns, actions);
+    emit_mouse_movement(mapper, actions);
+
+    // Store current positions for continuous movement generation
+    state->current_left_stick_x = left_x;
+    state->current_left_stick_y = left_y;
+    state->current_right_stick_x = right_x;
+    state->current_right_stick_y = right_y;
+
+    state->prev_left_stick_x = left_x;
+    state->prev_left_stick_y = left_y;
+    state->prev_right_stick_x = right_x;
+    state->prev_right_stick_y = right_y;
+}
+
+// ============================================================================
+// Rules
+// ============================================================================
+
+// What rules see: the last packet's buttons and triggers, and the gated stick
+// positions, with the GIP axis and trigger swaps undone
+static void rule_input_from_state(const InputStateHot *state, RuleInput *input) {
+    input->buttons = state->prev_buttons;
+    input->axis[RULE_AXIS_LX] = state->current_left_stick_y;
+    input->axis[RULE_AXIS_LY] = state->current_left_stick_x;
+    input->axis[RULE_AXIS_RX] = state->current_right_stick_y;
+    input->axis[RULE_AXIS_RY] = state->current_right_stick_x;
+    input->axis[RULE_AXIS_LT] = state->prev_left_trigger;
+    input->axis[RULE_AXIS_RT] = state->prev_right_trigger;
+}
+
+// Press a rule's keys in order, or release them in reverse
+static void emit_chord(Mapper *mapper, OutputActions *actions, const CompiledRule *rule, bool pressed) {
+    for (int i = 0; i < rule->count && i < RULE_CHORD_MAX; i++) {
+        int k = pressed ? i : rule->count - 1 - i;
+        if (rule->target[k] == RULE_TARGET_MOUSE) {
+            emit_mouse_button(mapper, actions, (MouseButton)rule->code[k], pressed);
+        } else {
+            emit_key(mapper, actions, rule->code[k], pressed);
+        }
+    }
+}
+
+static void process_rules(Mapper *mapper, uint64_t now_ns, OutputActions *actions) {
+    const RuleProgram *program = &mapper->profile->rules;
+    RuleState *state = &mapper->rules;
+    RuleInput input;
+    uint64_t rose, fell;
+
+    rule_input_from_state(&mapper->state.hot, &input);
+    rules_run(program, state, &input, now_ns, &rose, &fell);
+
+    // Common case: no rule switched
+    for (uint64_t edges = rose | fell; edges; edges &= edges - 1) {
+        int index = __builtin_ctzll(edges);
+        const CompiledRule *rule = &program->rules[index];
+        uint64_t bit = 1ull << index;
+        bool on = (rose & bit) != 0;
+
+        switch (rule->action) {
+            case RULE_ACTION_TAP:
+                if (on) {
+                    emit_chord(mapper, actions, rule, true);
+                    emit_chord(mapper, actions, rule, false);
+                }
+                break;
+            case RULE_ACTION_HOLD:
+                emit_chord(mapper, actions, rule, on);
+                break;
+            case RULE_ACTION_TOGGLE:
+                if (on) {
+                    state->toggled ^= bit;
+                    emit_chord(mapper, actions, rule, (state->toggled & bit) != 0);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void mapper_init(Mapper *mapper, const CompiledProfile *profile) {
+    memset(mapper, 0, sizeof(*mapper));
+    mapper->profile = profile;
+}
+
+void mapper_process(Mapper *mapper, const GipInputPacket *input, uint64_t now_ns,
+                    OutputActions *actions) {
+    actions->count = 0;
+    process_buttons(mapper, input->buttons, actions);
+    process_triggers(mapper, input->left_trigger, input->right_trigger, actions);
+    process_sticks(mapper, input->left_stick_x, input->left_stick_y,
+                   input->right_stick_x, input->right_stick_y, now_ns, actions);
+    if (mapper->profile->rules.count) {
+        process_rules(mapper, now_ns, actions);
+    }
+}
+
+void mapper_tick(Mapper *mapper, uint64_t now_ns, OutputActions *actions) {
+    const CompiledProfile *profile = mapper->profile;
+    InputStateHot *state = &mapper->state.hot;
+
+    actions->count = 0;
+
+    // Use the last known stick positions to generate movement
+    int16_t left_x = state->current_left_stick_x;
+    int16_t left_y = state->current_left_stick_y;
+    int16_t right_x = state->current_right_stick_x;
+    int16_t right_y = state->current_right_stick_y;
+
+    // Apply the gates again (stored positions are already calibrated, so no range here)
+    gate_stick(profile, &profile->left_stick, false, &left_x, &left_y);
+    gate_stick(profile, &profile->right_stick, false, &right_x, &right_y);
+
+    // Key modes only change on new packets
+    if (profile->left_stick.mode == STICK_MODE_MOUSE ||
+        profile->left_stick.mode == STICK_MODE_KINETIC) {
+        process_stick(mapper, true, left_x, left_y, now_ns, actions);
+    }
+    if (profile->right_stick.mode == STICK_MODE_MOUSE ||
+        profile->right_stick.mode == STICK_MODE_KINETIC) {
+        process_stick(mapper, false, right_x, right_y, now_ns, actions);
+    }
+
+    emit_mouse_movement(mapper, actions);
+
+    // Inputs haven't changed, only time: just the rules waiting on a timer can switch
+    if (rules_pending(&profile->rules, &mapper->rules)) {
+        process_rules(mapper, now_ns, actions);
+    }
+}
+
+bool mapper_tick_pending(const Mapper *mapper) {
+    const CompiledProfile *profile = mapper->profile;
+    const InputStateHot *state = &mapper->state.hot;
+
+    if (profile->left_stick.mode == STICK_MODE_MOUSE ||
+        profile->right_stick.mode == STICK_MODE_MOUSE) {
+        return true;
+    }
+    if (profile->left_stick.mode == STICK_MODE_KINETIC &&
+        (state->kinetic_left.gliding ||
+         state->current_left_stick_x != 0 || state->current_left_stick_y != 0)) {
+        return true;
+    }
+    if (profile->right_stick.mode == STICK_MODE_KINETIC &&
+        (state->kinetic_right.gliding ||
+         state->current_right_stick_x != 0 || state->current_right_stick_y != 0)) {
+        return true;
+    }
+    return rules_pending(&profile->rules, &mapper->rules);
+}
+
+int mapper_release_all(Mapper *mapper, OutputActions *actions) {
+    InputStateCold *outputs = &mapper->state.cold;
+
+    actions->count = 0;
+    for (int i = 0; i < 256 && actions->count < MAPPER_MAX_ACTIONS; i++) {
+        if (outputs->keys[i]) {
+            emit_key(mapper, actions, i, false);
+        }
+    }
+    if (outputs->mouse_left && actions->count < MAPPER_MAX_ACTIONS) {
+        emit(actions, OUTPUT_MOUSE_BUTTON, MOUSE_BUTTON_LEFT, false);
+        outputs->mouse_left = false;
+    }
+    if (outputs->mouse_right && actions->count < MAPPER_MAX_ACTIONS) {
+        emit(actions, OUTPUT_MOUSE_BUTTON, MOUSE_BUTTON_RIGHT, false);
+        outputs->mouse_right = false;
+    }
+    if (outputs->mouse_middle && actions->count < MAPPER_MAX_ACTIONS) {
+        emit(actions, OUTPUT_MOUSE_BUTTON, MOUSE_BUTTON_MIDDLE, false);
+        outputs->mouse_middle = false;
+    }
+
+    // Forget the inputs behind them too, so the next packet sees whatever is
+    // still held as a fresh press and presses it again. Otherwise a button
+    // held through the release would stay up until it was let go and pressed.
+    InputStateHot *state = &mapper->state.hot;
+    state->prev_buttons = 0;
+    state->prev_left_trigger = 0;
+    state->prev_right_trigger = 0;
+    state->left_stick_dirs = 0;
+    state->right_stick_dirs = 0;
+    state->current_left_stick_x = 0;
+    state->current_left_stick_y = 0;
+    state->current_right_stick_x = 0;
+    state->current_right_stick_y = 0;
+
+    // Rules switch on again from the next packet; toggled keys are released
+    // now, so that switch-on presses them again
+    memset(&mapper->rules, 0, sizeof(mapper->rules));
+    return actions->count;
+}
+
+// ============================================================================
+// Checkpoints
+// ============================================================================
+
+// Byte i of a scalar field, least significant first, whatever the host order
+static uint8_t scalar_byte(const void *field, int size, int i) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return ((const uint8_t *)field)[size - 1 - i];
+#else
+    (void)size;
+    return ((const uint8_t *)field)[i];
+#endif
+}
+
+static void set_scalar_byte(void *field, int size, int i, uint8_t value) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    ((uint8_t *)field)[size - 1 - i] = value;
+#else
+    (void)size;
+    ((uint8_t *)field)[i] = value;
+#endif
+}
+
+// The profile fingerprint is FNV-1a over the fields, never the padding
+// between them, which nothing guarantees is zeroed in a profile built
+// elsewhere
+#define HASH_FIELD(hash, field) hash_scalar((hash), &(field), sizeof(field))
+
+static uint64_t hash_scalar(uint64_t hash, const void *field, int size) {
+    for (int i = 0; i < size; i++) {
+        hash = (hash ^ scalar_byte(field, size, i)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t hash_chain(uint64_t hash, const StickChain *chain) {
+    uint32_t path = chain->path;
+    int count = chain->count < STICK_CHAIN_MAX ? chain->count : STICK_CHAIN_MAX;
+    hash = HASH_FIELD(hash, path);
+    hash = HASH_FIELD(hash, chain->calibrate);
+    hash = HASH_FIELD(hash, chain->from_settings);
+    hash = HASH_FIELD(hash, chain->deadzone);
+    hash = HASH_FIELD(hash, chain->smoothing);
+    hash = HASH_FIELD(hash, chain->curve);
+    hash = HASH_FIELD(hash, chain->gain_x);
+    hash = HASH_FIELD(hash, chain->gain_y);
+    hash = HASH_FIELD(hash, chain->count);
+    for (int i = 0; i < count; i++) {
+        const StickStage *stage = &chain->stages[i];
+        uint32_t type = stage->type;
+        hash = HASH_FIELD(hash, type);
+        // Only the union member the stage uses
+        switch (stage->type) {
+            case STAGE_DEADZONE:
+                hash = HASH_FIELD(hash, stage->deadzone.radius);
+                break;
+            case STAGE_CURVE:
+                hash = HASH_FIELD(hash, stage->curve.exponent);
+                break;
+            case STAGE_FILTER:
+                hash = HASH_FIELD(hash, stage->filter.alpha);
+                break;
+            case STAGE_SNAP:
+                hash = HASH_FIELD(hash, stage->snap.tan_limit);
+                break;
+            case STAGE_SCALE:
+                hash = HASH_FIELD(hash, stage->scale.x);
+                hash = HASH_FIELD(hash, stage->scale.y);
+                break;
+            case STAGE_ROTATE:
+                hash = HASH_FIELD(hash, stage->rotate.cos_angle);
+                hash = HASH_FIELD(hash, stage->rotate.sin_angle);
+                break;
+            case STAGE_CALIBRATE:
+            default:
+                break;
+        }
+    }
+    return hash;
+}
+
+static uint64_t hash_stick(uint64_t hash, const CompiledStick *stick) {
+    uint32_t mode = stick->mode;
+    hash = HASH_FIELD(hash, mode);
+    hash = HASH_FIELD(hash, stick->key_up);
+    hash = HASH_FIELD(hash, stick->key_down);
+    hash = HASH_FIELD(hash, stick->key_left);
+    hash = HASH_FIELD(hash, stick->key_right);
+    hash = HASH_FIELD(hash, stick->calibrated);
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        hash = HASH_FIELD(hash, stick->range.outer_radius[i]);
+        hash = HASH_FIELD(hash, stick->fx_range.outer_radius[i]);
+    }
+    return hash_chain(hash, &stick->chain);
+}
+
+static uint64_t hash_trigger(uint64_t hash, const CompiledTrigger *trigger) {
+    uint32_t mode = trigger->mode;
+    hash = HASH_FIELD(hash, mode);
+    return HASH_FIELD(hash, trigger->key);
+}
+
+static uint64_t hash_rules(uint64_t hash, const RuleProgram *program) {
+    int count = program->count < RULES_MAX ? program->count : RULES_MAX;
+    int code_size = program->code_size < RULE_CODE_MAX ? program->code_size : RULE_CODE_MAX;
+    hash = HASH_FIELD(hash, program->code_size);
+    hash = HASH_FIELD(hash, program->instructions);
+    hash = HASH_FIELD(hash, program->count);
+    hash = HASH_FIELD(hash, program->timers);
+    for (int i = 0; i < count; i++) {
+        const CompiledRule *rule = &program->rules[i];
+        hash = HASH_FIELD(hash, rule->action);
+        hash = HASH_FIELD(hash, rule->count);
+        hash = HASH_FIELD(hash, rule->timer);
+        for (int k = 0; k < RULE_CHORD_MAX; k++) {
+            hash = HASH_FIELD(hash, rule->target[k]);
+            hash = HASH_FIELD(hash, rule->code[k]);
+        }
+        hash = HASH_FIELD(hash, rule->for_ms);
+    }
+    for (int i = 0; i < code_size; i++) {
+        hash = HASH_FIELD(hash, program->code[i]);
+    }
+    return hash;
+}
+
+uint64_t mapper_profile_hash(const CompiledProfile *profile) {
+    const FixedStickParams *fx = &profile->fx_params;
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (int i = 0; i < MAPPER_NUM_BUTTONS; i++) {
+        hash = HASH_FIELD(hash, profile->buttons[i].mask);
+        hash = HASH_FIELD(hash, profile->buttons[i].keycode);
+    }
+    hash = hash_stick(hash, &profile->left_stick);
+    hash = hash_stick(hash, &profile->right_stick);
+    hash = hash_trigger(hash, &profile->left_trigger);
+    hash = hash_trigger(hash, &profile->right_trigger);
+    hash = HASH_FIELD(hash, profile->trigger_threshold);
+    hash = HASH_FIELD(hash, profile->deadzone);
+    hash = HASH_FIELD(hash, profile->mouse_sensitivity);
+    hash = HASH_FIELD(hash, profile->mouse_curve);
+    hash = HASH_FIELD(hash, profile->mouse_smoothing);
+    hash = HASH_FIELD(hash, profile->kinetic_friction);
+    hash = HASH_FIELD(hash, profile->fixed_point_math);
+    hash = HASH_FIELD(hash, fx->deadzone_sq);
+    hash = HASH_FIELD(hash, fx->alpha_q15);
+    hash = HASH_FIELD(hash, fx->gain_q16);
+    for (int i = 0; i <= FX_CURVE_LUT_SIZE; i++) {
+        hash = HASH_FIELD(hash, fx->curve_lut[i]);
+    }
+    return hash_rules(hash, &profile->rules);
+}
+
+// One walk over the state serves both directions, so save and restore can't
+// disagree about the layout. pos counts every byte the walk asked for, even
+// past the buffer, so the callers can check it came to MAPPER_STATE_SIZE.
+typedef struct {
+    uint8_t *buffer;
+    int pos;
+    bool save;
+} StateStream;
+
+// field is one scalar (or a single byte); it goes out little-endian
+static void stream_bytes(StateStream *s, void *field, int size) {
+    for (int i = 0; i < size; i++, s->pos++) {
+        if (s->pos >= MAPPER_STATE_SIZE) {
+            continue;
+        }
+        if (s->save) {
+            s->buffer[s->pos] = scalar_byte(field, size, i);
+        } else {
+            set_scalar_byte(field, size, i, s->buffer[s->pos]);
+        }
+    }
+}
+
+static void stream_bool(StateStream *s, bool *field) {
+    uint8_t value = *field;
+    stream_bytes(s, &value, 1);
+    *field = value != 0;
+}
+
+static void stream_kinetic(StateStream *s, KineticState *k) {
+    stream_bytes(s, &k->velocity_x, sizeof(k->velocity_x));
+    stream_bytes(s, &k->velocity_y, sizeof(k->velocity_y));
+    stream_bytes(s, &k->remainder_x, sizeof(k->remainder_x));
+    stream_bytes(s, &k->remainder_y, sizeof(k->remainder_y));
+    stream_bytes(s, &k->last_tick, sizeof(k->last_tick));
+    stream_bool(s, &k->gliding);
+    stream_bool(s, &k->deflected);
+}
+
+static void stream_state(StateStream *s, ControllerState *state) {
+    InputStateHot *hot = &state->hot;
+    InputStateCold *cold = &state->cold;
+
+    stream_bytes(s, &hot->prev_buttons, sizeof(hot->prev_buttons));
+    stream_bytes(s, &hot->prev_left_trigger, 1);
+    stream_bytes(s, &hot->prev_right_trigger, 1);
+    stream_bytes(s, &hot->prev_left_stick_x, 2);
+    stream_bytes(s, &hot->prev_left_stick_y, 2);
+    stream_bytes(s, &hot->prev_right_stick_x, 2);
+    stream_bytes(s, &hot->prev_right_stick_y, 2);
+    stream_bytes(s, &hot->current_left_stick_x, 2);
+    stream_bytes(s, &hot->current_left_stick_y, 2);
+    stream_bytes(s, &hot->current_right_stick_x, 2);
+    stream_bytes(s, &hot->current_right_stick_y, 2);
+    stream_bytes(s, &hot->left_stick_dirs, 1);
+    stream_bytes(s, &hot->right_stick_dirs, 1);
+    stream_bytes(s, &hot->smoothed_right_x, 4);
+    stream_bytes(s, &hot->smoothed_right_y, 4);
+    stream_bytes(s, &hot->smoothed_left_x, 4);
+    stream_bytes(s, &hot->smoothed_left_y, 4);
+    stream_bytes(s, &hot->fx_smoothed_right_x, 4);
+    stream_bytes(s, &hot->fx_smoothed_right_y, 4);
+    stream_bytes(s, &hot->fx_smoothed_left_x, 4);
+    stream_bytes(s, &hot->fx_smoothed_left_y, 4);
+    stream_bytes(s, &hot->mouse_dx, 4);
+    stream_bytes(s, &hot->mouse_dy, 4);
+    stream_kinetic(s, &hot->kinetic_left);
+    stream_kinetic(s, &hot->kinetic_right);
+
+    // Held keys as a 256-bit set
+    for (int byte = 0; byte < 32; byte++) {
+        uint8_t bits = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            bits |= (uint8_t)(cold->keys[byte * 8 + bit] << bit);
+        }
+        stream_bytes(s, &bits, 1);
+        for (int bit = 0; bit < 8; bit++) {
+            cold->keys[byte * 8 + bit] = (bits >> bit) & 1;
+        }
+    }
+    uint8_t mouse = (uint8_t)(cold->mouse_left | cold->mouse_right << 1 | cold->mouse_middle << 2);
+    stream_bytes(s, &mouse, 1);
+    cold->mouse_left = mouse & 1;
+    cold->mouse_right = (mouse >> 1) & 1;
+    cold->mouse_middle = (mouse >> 2) & 1;
+}
+
+static void stream_rules(StateStream *s, RuleState *rules) {
+    stream_bytes(s, &rules->latched, 8);
+    stream_bytes(s, &rules->toggled, 8);
+    stream_bytes(s, &rules->armed, 2);
+    for (int i = 0; i < RULE_TIMERS_MAX; i++) {
+        stream_bytes(s, &rules->timer_since_ns[i], 8);
+    }
+}
+
+bool mapper_save_state(const Mapper *mapper, uint8_t out[MAPPER_STATE_SIZE]) {
+    uint32_t magic = MAPPER_STATE_MAGIC;
+    uint16_t version = MAPPER_STATE_VERSION;
+    uint64_t hash = mapper_profile_hash(mapper->profile);
+    ControllerState copy = mapper->state;     // The walk writes back what it reads
+    RuleState rules = mapper->rules;
+    StateStream s = { .buffer = out, .save = true };
+
+    stream_bytes(&s, &magic, sizeof(magic));
+    stream_bytes(&s, &version, sizeof(version));
+    stream_bytes(&s, &hash, sizeof(hash));
+    stream_state(&s, &copy);
+    stream_rules(&s, &rules);
+    return s.pos == MAPPER_STATE_SIZE;
+}
+
+bool mapper_restore_state(Mapper *mapper, const uint8_t *in, int length) {
+    uint32_t magic;
+    uint16_t version;
+    uint64_t hash;
+    if (length != MAPPER_STATE_SIZE) {
+        return false;
+    }
+
+    StateStream s = { .buffer = (uint8_t *)in, .save = false };
+    stream_bytes(&s, &magic, sizeof(magic));
+    stream_bytes(&s, &version, sizeof(version));
+    stream_bytes(&s, &hash, sizeof(hash));
+    if (magic != MAPPER_STATE_MAGIC || version != MAPPER_STATE_VERSION ||
+        hash != mapper_profile_hash(mapper->profile)) {
+        return false;
+    }
+
+    ControllerState state;
+    RuleState rules;
+    memset(&state, 0, sizeof(state));
+    memset(&rules, 0, sizeof(rules));
+    stream_state(&s, &state);
+    stream_rules(&s, &rules);
+    if (s.pos != MAPPER_STATE_SIZE) {
+        return false;
+    }
+    mapper->state = state;
+    mapper->rules = rules;
+    return true;
+}
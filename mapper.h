@@ -0,0 +1,177 @@
+// mapper.h
+// Controller input → keyboard/mouse output actions (libmapper)
+//
+// A ControllerMapping (keymapping.h) plus optional stick calibration is
+// compiled once into a flat CompiledProfile. A Mapper then turns each decoded
+// input packet into a list of output actions; posting them to the OS is left
+// to the caller (the simulator uses CoreGraphics). The mapper does no I/O and
+// reads no clocks - time is passed in - so it can be embedded anywhere and
+// driven from recorded input.
+//
+//   CompiledProfile profile;
+//   Mapper mapper;
+//   OutputActions actions;
+//
+//   mapper_compile_profile(&config, calibration_or_null, &profile);
+//   mapper_init(&mapper, &profile);
+//   mapper_process(&mapper, input, gip_monotonic_ns(), &actions);   // per packet
+//   mapper_tick(&mapper, gip_monotonic_ns(), &actions);             // per output tick
+
+#ifndef MAPPER_H
+#define MAPPER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gip.h"
+#include "keymapping.h"
+#include "calibration.h"
+#include "fixed_point.h"
+#include "input_state.h"
+#include "stick_chain.h"
+#include "rules.h"
+
+// Full stick deflection moves the cursor 15 * sensitivity pixels per output
+// tick; kinetic mode converts that to a velocity using the nominal tick rate
+#define MOUSE_PIXELS_PER_TICK   15.0f
+#define NOMINAL_TICK_HZ         100.0f
+
+// Kinetic glides stop below this speed (pixels per second)
+#define KINETIC_STOP_SPEED      1.0f
+
+// Longest step integrated in one tick, so a stalled loop can't fling the cursor
+#define KINETIC_MAX_DT          0.1f
+
+#define MAPPER_NUM_BUTTONS      14
+#define MAPPER_MAX_ACTIONS      64
+
+// ============================================================================
+// Output Actions
+// ============================================================================
+
+typedef enum {
+    OUTPUT_KEY,             // code = macOS virtual keycode
+    OUTPUT_MOUSE_BUTTON,    // code = MouseButton
+    OUTPUT_MOUSE_MOVE       // dx/dy in pixels
+} OutputActionType;
+
+typedef enum {
+    MOUSE_BUTTON_LEFT,
+    MOUSE_BUTTON_RIGHT,
+    MOUSE_BUTTON_MIDDLE
+} MouseButton;
+
+typedef struct {
+    OutputActionType type;
+    bool pressed;
+    uint16_t code;
+    float dx;
+    float dy;
+} OutputAction;
+
+typedef struct {
+    int count;
+    OutputAction actions[MAPPER_MAX_ACTIONS];
+} OutputActions;
+
+// ============================================================================
+// Compiled Profile
+// ============================================================================
+
+typedef struct {
+    uint16_t mask;          // XBOX_BTN_* bit
+    uint16_t keycode;
+} ButtonBinding;
+
+typedef struct {
+    StickMode mode;
+    uint16_t key_up, key_down, key_left, key_right;   // WASD/arrows modes
+    bool calibrated;
+    StickRange range;                                  // Valid if calibrated
+    FixedStickRange fx_range;
+    StickChain chain;                                  // Gate, then mouse/kinetic shaping
+} CompiledStick;
+
+typedef struct {
+    TriggerMode mode;
+    uint16_t key;
+} CompiledTrigger;
+
+// Everything the per-packet path needs, resolved up front. Contains no
+// pointers, so it can be copied or shared read-only between mappers.
+typedef struct {
+    ButtonBinding buttons[MAPPER_NUM_BUTTONS];
+    CompiledStick left_stick;
+    CompiledStick right_stick;
+    CompiledTrigger left_trigger;
+    CompiledTrigger right_trigger;
+    uint8_t trigger_threshold;
+
+    int16_t deadzone;
+    float mouse_sensitivity;
+    float mouse_curve;
+    float mouse_smoothing;
+    float kinetic_friction;
+    bool fixed_point_math;
+    FixedStickParams fx_params;
+    RuleProgram rules;      // Conditional bindings (text profiles only, see profile.h)
+} CompiledProfile;
+
+// calibration may be NULL (ideal circular stick range). Leaves rules empty.
+void mapper_compile_profile(const ControllerMapping *mapping, const StickCalibration *calibration,
+                            CompiledProfile *profile);
+
+// ============================================================================
+// Mapper
+// ============================================================================
+
+typedef struct {
+    const CompiledProfile *profile;
+    ControllerState state;
+    RuleState rules;
+} Mapper;
+
+void mapper_init(Mapper *mapper, const CompiledProfile *profile);
+
+// Map one input packet. Replaces the contents of actions.
+void mapper_process(Mapper *mapper, const GipInputPacket *input, uint64_t now_ns,
+                    OutputActions *actions);
+
+// Continuous output (mouse/kinetic sticks) and rules waiting on a `for`
+// timer, when no packet arrived this tick. Replaces the contents of actions.
+void mapper_tick(Mapper *mapper, uint64_t now_ns, OutputActions *actions);
+
+// True while some stick or rule timer still needs output ticks without new packets
+bool mapper_tick_pending(const Mapper *mapper);
+
+// Release everything currently held. Replaces the contents of actions; call
+// until it returns 0.
+int mapper_release_all(Mapper *mapper, OutputActions *actions);
+
+// ============================================================================
+// Checkpoints
+// ============================================================================
+
+// Everything the mapper carries from packet to packet (filters, held keys
+// and directions, kinetic glides, sub-pixel remainders, rule latches and
+// timers), serialized field by field in a fixed little-endian layout, with
+// floats stored as their bits.
+// A mapper restored from a checkpoint produces exactly the output the
+// original would have from that point on, so replay tools can start mid-
+// capture or split a capture into segments and run them in parallel.
+#define MAPPER_STATE_MAGIC      0x4b504843  // "CHPK"
+#define MAPPER_STATE_VERSION    4
+#define MAPPER_STATE_SIZE       307
+
+// Fingerprint of a compiled profile; checkpoints only restore under the
+// profile they were taken with
+uint64_t mapper_profile_hash(const CompiledProfile *profile);
+
+// Writes MAPPER_STATE_SIZE bytes. False if the layout walk didn't come to
+// exactly that many (MAPPER_STATE_SIZE not updated with the layout).
+bool mapper_save_state(const Mapper *mapper, uint8_t out[MAPPER_STATE_SIZE]);
+// The mapper must already be initialized with the checkpoint's profile.
+// False (mapper unchanged) on a bad header, version or profile mismatch, or
+// a layout walk that doesn't come to MAPPER_STATE_SIZE.
+bool mapper_restore_state(Mapper *mapper, const uint8_t *in, int length);
+
+#endif // MAPPER_H
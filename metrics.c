@@ -0,0 +1,407 @@
+// metrics.c
+// Sharded metrics registry and Prometheus exposition (see metrics.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "metrics.h"
+#include "input_state.h"
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+static const struct {
+    const char *name;
+    const char *labels;
+    const char *help;
+} counter_info[METRIC_COUNTER_COUNT] = {
+    [METRIC_PACKETS]             = { "xbox_packets_total", "", "GIP packets received from the controller" },
+    [METRIC_BYTES]               = { "xbox_received_bytes_total", "", "Bytes received from the controller" },
+    [METRIC_DECODE_ERRORS]       = { "xbox_decode_errors_total", "", "Packets too short for their command" },
+    [METRIC_TIMEOUTS]            = { "xbox_read_timeouts_total", "", "USB reads that timed out without a packet" },
+    [METRIC_SEQUENCE_GAPS]       = { "xbox_sequence_gaps_total", "", "Input packets missing between received ones" },
+    [METRIC_EVENTS_KEY]          = { "xbox_output_events_total", "type=\"key\"", "Keyboard/mouse events posted" },
+    [METRIC_EVENTS_MOUSE_BUTTON] = { "xbox_output_events_total", "type=\"mouse_button\"", "Keyboard/mouse events posted" },
+    [METRIC_EVENTS_MOUSE_MOVE]   = { "xbox_output_events_total", "type=\"mouse_move\"", "Keyboard/mouse events posted" },
+    [METRIC_USB_RECOVERIES]      = { "xbox_usb_recoveries_total", "", "USB errors recovered without reopening the controller" },
+    [METRIC_CAPTURE_DROPPED]     = { "xbox_capture_dropped_total", "", "Packets not recorded because the capture queue was full" },
+    [METRIC_PLUGIN_OVERRUNS]     = { "xbox_plugin_overruns_total", "", "Input plugin calls over their per-packet time budget" },
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} gauge_info[METRIC_GAUGE_COUNT] = {
+    [METRIC_CONNECTED]          = { "xbox_connected", "1 while the controller is streaming input" },
+    [METRIC_BUSY_POLL_SPINNING] = { "xbox_busy_poll_spinning", "1 while the busy-poll loop is spinning" },
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} histogram_info[METRIC_HISTOGRAM_COUNT] = {
+    [METRIC_POST_LATENCY]    = { "xbox_post_latency_seconds", "USB completion to output events posted" },
+    [METRIC_PACKET_INTERVAL] = { "xbox_packet_interval_seconds", "Time between consecutive packets" },
+    [METRIC_PLUGIN_TIME]     = { "xbox_plugin_seconds", "Time spent in input plugins per packet" },
+};
+
+static const uint64_t bucket_bounds_us[METRIC_HISTOGRAM_BUCKETS] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000
+};
+
+// One thread's counters and histograms. Only the owning thread writes, so
+// updates are relaxed load+store (no locked instructions); scrapes read
+// with relaxed loads and may see a shard mid-update, which is fine for
+// monotonic counters.
+typedef struct {
+    _Atomic uint64_t buckets[METRIC_HISTOGRAM_BUCKETS + 1];  // Last = +Inf
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+} HistogramShard;
+
+typedef struct MetricShard {
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t counters[METRIC_COUNTER_COUNT];
+    HistogramShard histograms[METRIC_HISTOGRAM_COUNT];
+    struct MetricShard *next;
+} MetricShard;
+
+_Static_assert(sizeof(MetricShard) % CACHE_LINE_SIZE == 0,
+               "Shards must not share cache lines");
+
+static _Atomic(MetricShard *) shards = NULL;
+static __thread MetricShard *thread_shard = NULL;
+static _Atomic int64_t gauges[METRIC_GAUGE_COUNT];
+
+static MetricShard *shard_create(void) {
+    MetricShard *shard = aligned_alloc(CACHE_LINE_SIZE, sizeof(MetricShard));
+    if (!shard) {
+        return NULL;
+    }
+    memset(shard, 0, sizeof(*shard));
+
+    MetricShard *head = atomic_load_explicit(&shards, memory_order_relaxed);
+    do {
+        shard->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&shards, &head, shard,
+                                                    memory_order_release, memory_order_relaxed));
+    thread_shard = shard;
+    return shard;
+}
+
+static inline void shard_add(_Atomic uint64_t *value, uint64_t delta) {
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + delta,
+                          memory_order_relaxed);
+}
+
+void metrics_add(MetricCounter counter, uint64_t value) {
+    MetricShard *shard = thread_shard;
+    if (!shard && !(shard = shard_create())) {
+        return;
+    }
+    shard_add(&shard->counters[counter], value);
+}
+
+void metrics_observe_ns(MetricHistogram histogram, uint64_t ns) {
+    MetricShard *shard = thread_shard;
+    if (!shard && !(shard = shard_create())) {
+        return;
+    }
+
+    HistogramShard *h = &shard->histograms[histogram];
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+    while (bucket < METRIC_HISTOGRAM_BUCKETS && us > bucket_bounds_us[bucket]) {
+        bucket++;
+    }
+    shard_add(&h->buckets[bucket], 1);
+    shard_add(&h->count, 1);
+    shard_add(&h->sum_ns, ns);
+}
+
+void metrics_gauge_set(MetricGauge gauge, int64_t value) {
+    atomic_store_explicit(&gauges[gauge], value, memory_order_relaxed);
+}
+
+uint64_t metrics_counter_value(MetricCounter counter) {
+    uint64_t total = 0;
+    for (MetricShard *shard = atomic_load_explicit(&shards, memory_order_acquire);
+         shard; shard = shard->next) {
+        total += atomic_load_explicit(&shard->counters[counter], memory_order_relaxed);
+    }
+    return total;
+}
+
+// ============================================================================
+// Prometheus Text Format
+// ============================================================================
+
+void metrics_write_prometheus(FILE *out) {
+    const char *previous = NULL;
+
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        // Labelled series of one metric share a single HELP/TYPE header
+        if (!previous || strcmp(previous, counter_info[i].name) != 0) {
+            fprintf(out, "# HELP %s %s\n# TYPE %s counter\n",
+                    counter_info[i].name, counter_info[i].help, counter_info[i].name);
+            previous = counter_info[i].name;
+        }
+        if (counter_info[i].labels[0]) {
+            fprintf(out, "%s{%s} %llu\n", counter_info[i].name, counter_info[i].labels,
+                    (unsigned long long)metrics_counter_value(i));
+        } else {
+            fprintf(out, "%s %llu\n", counter_info[i].name,
+                    (unsigned long long)metrics_counter_value(i));
+        }
+    }
+
+    for (int i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n",
+                gauge_info[i].name, gauge_info[i].help, gauge_info[i].name, gauge_info[i].name,
+                (long long)atomic_load_explicit(&gauges[i], memory_order_relaxed));
+    }
+
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        uint64_t buckets[METRIC_HISTOGRAM_BUCKETS + 1] = {0};
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+
+        for (MetricShard *shard = atomic_load_explicit(&shards, memory_order_acquire);
+             shard; shard = shard->next) {
+            const HistogramShard *h = &shard->histograms[i];
+            for (int b = 0; b <= METRIC_HISTOGRAM_BUCKETS; b++) {
+                buckets[b] += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+            }
+            count += atomic_load_explicit(&h->count, memory_order_relaxed);
+            sum_ns += atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+        }
+
+        const char *name = histogram_info[i].name;
+        fprintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, histogram_info[i].help, name);
+
+        // Prometheus buckets are cumulative
+        uint64_t cumulative = 0;
+        for (int b = 0; b < METRIC_HISTOGRAM_BUCKETS; b++) {
+            cumulative += buckets[b];
+            fprintf(out, "%s_bucket{le=\"%g\"} %llu\n", name, bucket_bounds_us[b] / 1e6,
+                    (unsigned long long)cumulative);
+        }
+        cumulative += buckets[METRIC_HISTOGRAM_BUCKETS];
+        fprintf(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+        fprintf(out, "%s_sum %.9f\n", name, sum_ns / 1e9);
+        fprintf(out, "%s_count %llu\n", name, (unsigned long long)count);
+    }
+}
+
+// ============================================================================
+// Exposition Thread
+// ============================================================================
+
+static pthread_t exporter_thread;
+static bool exporter_running = false;
+static int listen_fd = -1;
+static int stop_pipe[2] = { -1, -1 };
+static char socket_path[108];
+static char textfile_path[256];
+static int textfile_interval_ms;
+
+static void send_all(int fd, const char *data, size_t length) {
+#if defined(MSG_NOSIGNAL)
+    int flags = MSG_NOSIGNAL;
+#else
+    int flags = 0;
+#endif
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, flags);
+        if (sent <= 0) {
+            return;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+}
+
+// One HTTP/1.0 response per connection, whatever was asked for
+static void serve_client(int client) {
+    char request[1024];
+    char *body = NULL;
+    size_t body_length = 0;
+    struct timeval timeout = { 0, 200000 };
+
+#if defined(SO_NOSIGPIPE)
+    int one = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (recv(client, request, sizeof(request), 0) < 0) {
+        // Plain "nc -U" clients may send nothing; answer anyway
+    }
+
+    FILE *out = open_memstream(&body, &body_length);
+    if (!out) {
+        return;
+    }
+    metrics_write_prometheus(out);
+    fclose(out);
+
+    char header[128];
+    int header_length = snprintf(header, sizeof(header),
+                                 "HTTP/1.0 200 OK\r\n"
+                                 "Content-Type: text/plain; version=0.0.4\r\n"
+                                 "Content-Length: %zu\r\n\r\n", body_length);
+    send_all(client, header, (size_t)header_length);
+    send_all(client, body, body_length);
+    free(body);
+}
+
+// Write next to the target and rename, so node_exporter never reads a partial file
+static void write_textfile(void) {
+    char tmp_path[sizeof(textfile_path) + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", textfile_path);
+
+    FILE *file = fopen(tmp_path, "w");
+    if (!file) {
+        return;
+    }
+    metrics_write_prometheus(file);
+    if (fclose(file) == 0) {
+        rename(tmp_path, textfile_path);
+    } else {
+        unlink(tmp_path);
+    }
+}
+
+static uint64_t exporter_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000ull;
+}
+
+static void *exporter_main(void *arg) {
+    (void)arg;
+    struct pollfd fds[2] = {
+        { .fd = stop_pipe[0], .events = POLLIN },
+        { .fd = listen_fd, .events = POLLIN },
+    };
+    int nfds = (listen_fd >= 0) ? 2 : 1;
+    uint64_t next_write_ms = exporter_clock_ms() + (uint64_t)textfile_interval_ms;
+
+    // The textfile keeps its own deadline: scrapes arriving more often than
+    // the interval must not keep pushing the next write out
+    for (;;) {
+        int timeout = -1;
+        if (textfile_path[0]) {
+            uint64_t now_ms = exporter_clock_ms();
+            if (now_ms >= next_write_ms) {
+                write_textfile();
+                next_write_ms = now_ms + (uint64_t)textfile_interval_ms;
+            }
+            timeout = (int)(next_write_ms - now_ms);
+        }
+
+        int ready = poll(fds, nfds, timeout);
+        if (ready < 0) {
+            continue;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+        if (nfds > 1 && (fds[1].revents & POLLIN)) {
+            int client = accept(listen_fd, NULL, NULL);
+            if (client >= 0) {
+                serve_client(client);
+                close(client);
+            }
+        }
+    }
+
+    // Final snapshot so the textfile reflects the whole run
+    if (textfile_path[0]) {
+        write_textfile();
+    }
+    return NULL;
+}
+
+static int open_listen_socket(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);  // Stale socket from a previous run
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        close(fd);
+        return -1;
+    }
+    // The simulator runs as root; let unprivileged scrapers connect
+    chmod(path, 0666);
+    return fd;
+}
+
+bool metrics_exporter_start(const char *socket, const char *textfile, int interval_ms) {
+    if (exporter_running || (!socket && !textfile)) {
+        return false;
+    }
+
+    socket_path[0] = '\0';
+    textfile_path[0] = '\0';
+    if (socket) {
+        listen_fd = open_listen_socket(socket);
+        if (listen_fd < 0) {
+            return false;
+        }
+        snprintf(socket_path, sizeof(socket_path), "%s", socket);
+    }
+    if (textfile) {
+        snprintf(textfile_path, sizeof(textfile_path), "%s", textfile);
+        textfile_interval_ms = (interval_ms > 0) ? interval_ms : 15000;
+    }
+
+    if (pipe(stop_pipe) != 0) {
+        metrics_exporter_stop();
+        return false;
+    }
+    if (pthread_create(&exporter_thread, NULL, exporter_main, NULL) != 0) {
+        metrics_exporter_stop();
+        return false;
+    }
+    exporter_running = true;
+    return true;
+}
+
+void metrics_exporter_stop(void) {
+    if (exporter_running) {
+        ssize_t woke = write(stop_pipe[1], "x", 1);
+        (void)woke;
+        pthread_join(exporter_thread, NULL);
+        exporter_running = false;
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path);
+        listen_fd = -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (stop_pipe[i] >= 0) {
+            close(stop_pipe[i]);
+            stop_pipe[i] = -1;
+        }
+    }
+}
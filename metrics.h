@@ -0,0 +1,74 @@
+// metrics.h
+// Counters, gauges and histograms exported in Prometheus text format
+//
+// The metric set is fixed (see the enums below). Counters and histograms are
+// sharded per thread: each thread writes only its own cache-line-aligned
+// shard with plain (relaxed) stores, and shards are summed only when the
+// metrics are scraped. Gauges are single values set by whoever owns them.
+//
+// Exposition, both optional and served from one background thread:
+//  - Unix socket: each connection gets one HTTP/1.0 response, e.g.
+//      curl --unix-socket /tmp/xbox_simulator.sock http://localhost/metrics
+//  - Textfile: rewritten atomically every interval, for node_exporter's
+//      --collector.textfile.directory
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef enum {
+    METRIC_PACKETS,             // GIP packets received
+    METRIC_BYTES,               // Bytes received
+    METRIC_DECODE_ERRORS,       // Packets too short for their command
+    METRIC_TIMEOUTS,            // Reads that timed out without a packet
+    METRIC_SEQUENCE_GAPS,       // Input packets missing between received ones
+    METRIC_EVENTS_KEY,          // Output events posted, by type
+    METRIC_EVENTS_MOUSE_BUTTON,
+    METRIC_EVENTS_MOUSE_MOVE,
+    METRIC_CAPTURE_DROPPED,     // Packets not recorded (--record queue full)
+    METRIC_USB_RECOVERIES,      // USB errors recovered in place (gip_recover)
+    METRIC_PLUGIN_OVERRUNS,     // Plugin calls over their per-packet budget
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    METRIC_CONNECTED,           // 1 while the controller is streaming input
+    METRIC_BUSY_POLL_SPINNING,  // 1 while the busy-poll loop is spinning
+    METRIC_GAUGE_COUNT
+} MetricGauge;
+
+typedef enum {
+    METRIC_POST_LATENCY,        // USB completion → output events posted
+    METRIC_PACKET_INTERVAL,     // Time between consecutive packets
+    METRIC_PLUGIN_TIME,         // All input plugins, per packet (--plugin)
+    METRIC_HISTOGRAM_COUNT
+} MetricHistogram;
+
+// Histogram bucket upper bounds in microseconds (plus +Inf)
+#define METRIC_HISTOGRAM_BUCKETS 10
+
+// Hot path: add to the calling thread's shard (allocated on first use)
+void metrics_add(MetricCounter counter, uint64_t value);
+void metrics_observe_ns(MetricHistogram histogram, uint64_t ns);
+void metrics_gauge_set(MetricGauge gauge, int64_t value);
+
+static inline void metrics_inc(MetricCounter counter) {
+    metrics_add(counter, 1);
+}
+
+// Sum of all shards
+uint64_t metrics_counter_value(MetricCounter counter);
+
+// Aggregate all shards and write Prometheus text exposition format
+void metrics_write_prometheus(FILE *out);
+
+// Start the exposition thread. Either path may be NULL to disable it;
+// interval_ms is how often the textfile is rewritten.
+bool metrics_exporter_start(const char *socket_path, const char *textfile_path, int interval_ms);
+void metrics_exporter_stop(void);
+
+#endif // METRICS_H
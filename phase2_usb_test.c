@@ -2,36 +2,493 @@
 // Tests basic USB communication with Xbox One controller
 // Compile: make xbox_usb_test
 // Run: sudo ./xbox_usb_test
+//      sudo ./xbox_usb_test --measure [seconds]      (report rate, jitter, round trip)
+//      sudo ./xbox_usb_test --measure --json FILE    (also write a machine-readable report)
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <libusb.h>
+#include "gip.h"
+#include "gip_protocol.h"
+#include "gip_device.h"
+#include "trace.h"
 
-#define XBOX_VENDOR_ID  0x045e
-#define XBOX_PRODUCT_ID 0x02dd  // Model 1697
+#define DEFAULT_MEASURE_SECONDS 10
+#define RTT_PINGS               20
+#define RTT_TIMEOUT_MS          100
 
-int main() {
+// Interval/jitter histogram bucket upper bounds in microseconds (plus overflow)
+#define INTERVAL_BUCKETS 9
+static const uint32_t interval_bounds_us[INTERVAL_BUCKETS] = {
+    250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000
+};
+
+typedef struct {
+    uint64_t buckets[INTERVAL_BUCKETS + 1];
+    uint64_t count;
+    uint64_t min_us;
+    uint64_t max_us;
+    uint64_t total_us;
+} IntervalHistogram;
+
+typedef struct {
+    int seconds;
+    double elapsed;
+    uint64_t packets;
+    uint64_t input_packets;
+    uint64_t bytes;
+    uint64_t timeouts;
+    uint64_t errors;
+    IntervalHistogram interval;     // Between consecutive input reports
+    IntervalHistogram jitter;       // Change in interval between consecutive reports
+
+    int rtt_sent;
+    int rtt_received;
+    IntervalHistogram rtt;          // OUT command → its ack on IN
+} Measurement;
+
+// ============================================================================
+// Descriptor Dump
+// ============================================================================
+
+static const char *transfer_type_name(int type) {
+    switch (type) {
+        case LIBUSB_TRANSFER_TYPE_CONTROL:     return "Control";
+        case LIBUSB_TRANSFER_TYPE_ISOCHRONOUS: return "Isochronous";
+        case LIBUSB_TRANSFER_TYPE_BULK:        return "Bulk";
+        case LIBUSB_TRANSFER_TYPE_INTERRUPT:   return "Interrupt";
+        default:                               return "Unknown";
+    }
+}
+
+static const char *speed_name(int speed) {
+    switch (speed) {
+        case 1:  return "low";       // 1.5 Mbit/s
+        case 2:  return "full";      // 12 Mbit/s
+        case 3:  return "high";      // 480 Mbit/s
+        case 4:  return "super";     // 5 Gbit/s
+        case 5:  return "super_plus";
+        default: return "unknown";
+    }
+}
+
+// Polling period an interrupt endpoint asks for, in microseconds
+static double endpoint_interval_us(int speed, uint8_t bInterval) {
+    if (speed >= 3) {
+        // High speed and up: 2^(bInterval-1) microframes of 125 us
+        int exponent = (bInterval >= 1 && bInterval <= 16) ? bInterval - 1 : 0;
+        return 125.0 * (1 << exponent);
+    }
+    // Low/full speed: bInterval frames of 1 ms
+    return 1000.0 * bInterval;
+}
+
+// Print every configuration, interface, alternate setting and endpoint
+void dump_descriptors(libusb_device *device, int speed) {
+    struct libusb_device_descriptor desc;
+    libusb_get_device_descriptor(device, &desc);
+
+    for (int c = 0; c < desc.bNumConfigurations; c++) {
+        struct libusb_config_descriptor *config;
+        if (libusb_get_config_descriptor(device, c, &config) != 0) {
+            printf("⚠️  Could not read configuration %d\n", c);
+            continue;
+        }
+
+        printf("Configuration %d (value %d):\n", c, config->bConfigurationValue);
+        printf("  Number of interfaces: %d\n", config->bNumInterfaces);
+        printf("  Attributes: 0x%02x, Max power: %d mA\n", config->bmAttributes, config->MaxPower * 2);
+
+        for (int i = 0; i < config->bNumInterfaces; i++) {
+            const struct libusb_interface *inter = &config->interface[i];
+            for (int a = 0; a < inter->num_altsetting; a++) {
+                const struct libusb_interface_descriptor *interdesc = &inter->altsetting[a];
+
+                printf("  Interface %d, alt setting %d: class 0x%02x, subclass 0x%02x, protocol 0x%02x, %d endpoints\n",
+                       interdesc->bInterfaceNumber, interdesc->bAlternateSetting,
+                       interdesc->bInterfaceClass, interdesc->bInterfaceSubClass,
+                       interdesc->bInterfaceProtocol, interdesc->bNumEndpoints);
+
+                for (int e = 0; e < interdesc->bNumEndpoints; e++) {
+                    const struct libusb_endpoint_descriptor *endpoint = &interdesc->endpoint[e];
+                    int direction = endpoint->bEndpointAddress & LIBUSB_ENDPOINT_IN;
+                    int type = endpoint->bmAttributes & 0x03;
+
+                    printf("    Endpoint 0x%02x: %-3s %-11s wMaxPacketSize=%-4d bInterval=%d",
+                           endpoint->bEndpointAddress, direction ? "IN" : "OUT",
+                           transfer_type_name(type), endpoint->wMaxPacketSize, endpoint->bInterval);
+                    if (type == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
+                        double interval = endpoint_interval_us(speed, endpoint->bInterval);
+                        printf(" (%.0f us → max %.0f reports/s)", interval, 1e6 / interval);
+                    }
+                    printf("\n");
+                }
+            }
+        }
+        printf("\n");
+        libusb_free_config_descriptor(config);
+    }
+}
+
+// ============================================================================
+// Measurement
+// ============================================================================
+
+static void interval_record(IntervalHistogram *h, uint64_t us) {
+    int bucket = 0;
+    while (bucket < INTERVAL_BUCKETS && us > interval_bounds_us[bucket]) {
+        bucket++;
+    }
+    h->buckets[bucket]++;
+    if (h->count == 0 || us < h->min_us) {
+        h->min_us = us;
+    }
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+    h->total_us += us;
+    h->count++;
+}
+
+static double interval_mean(const IntervalHistogram *h) {
+    return h->count ? (double)h->total_us / h->count : 0.0;
+}
+
+static void interval_print(const char *name, const IntervalHistogram *h) {
+    if (h->count == 0) {
+        printf("  %s: no samples\n", name);
+        return;
+    }
+    printf("  %s: n=%llu min=%lluus mean=%.0fus max=%lluus\n", name,
+           (unsigned long long)h->count, (unsigned long long)h->min_us,
+           interval_mean(h), (unsigned long long)h->max_us);
+    for (int b = 0; b <= INTERVAL_BUCKETS; b++) {
+        if (h->buckets[b] == 0) {
+            continue;
+        }
+        if (b < INTERVAL_BUCKETS) {
+            printf("    <= %6uus %8llu\n", interval_bounds_us[b], (unsigned long long)h->buckets[b]);
+        } else {
+            printf("     > %6uus %8llu\n", interval_bounds_us[b - 1], (unsigned long long)h->buckets[b]);
+        }
+    }
+}
+
+// Input report rate and inter-arrival jitter over m->seconds
+void measure_report_rate(GipDevice *dev, Measurement *m) {
+    uint8_t buffer[64];
+    int transferred;
+    uint64_t last_input_ns = 0;
+    uint64_t prev_interval_us = 0;
+
+    printf("=== Measuring Input Reports (%d s) ===\n", m->seconds);
+    printf("Keep moving both sticks the whole time - the controller only reports changes.\n\n");
+
+    uint64_t start = gip_monotonic_ns();
+    uint64_t end = start + (uint64_t)m->seconds * 1000000000ull;
+
+    while (gip_monotonic_ns() < end) {
+        int result = gip_device_read(dev, buffer, sizeof(buffer), &transferred, 100);
+        uint64_t now = gip_monotonic_ns();
+
+        if (result == GIP_ERROR_TIMEOUT) {
+            m->timeouts++;
+            continue;
+        } else if (result == GIP_ERROR_NO_DEVICE) {
+            printf("❌ Controller disconnected!\n");
+            break;
+        } else if (result != 0) {
+            m->errors++;
+            continue;
+        }
+
+        m->packets++;
+        m->bytes += transferred;
+        if (!gip_decode_input(buffer, transferred)) {
+            continue;
+        }
+        m->input_packets++;
+
+        if (last_input_ns) {
+            uint64_t interval_us = (now - last_input_ns) / 1000;
+            interval_record(&m->interval, interval_us);
+            if (prev_interval_us) {
+                interval_record(&m->jitter, interval_us > prev_interval_us ?
+                                interval_us - prev_interval_us : prev_interval_us - interval_us);
+            }
+            prev_interval_us = interval_us;
+        }
+        last_input_ns = now;
+
+        printf("\r  %llu input reports", (unsigned long long)m->input_packets);
+        fflush(stdout);
+    }
+
+    m->elapsed = (gip_monotonic_ns() - start) / 1e9;
+    printf("\n\n");
+}
+
+// OUT→IN round trip: send ack-required commands and time the controller's acks
+void measure_round_trip(GipDevice *dev, Measurement *m) {
+    uint8_t buffer[64];
+    uint8_t command[GIP_MAX_COMMAND_SIZE];
+    const uint8_t power_on = 0x00;
+    int transferred;
+
+    printf("=== Measuring OUT→IN Round Trip (%d pings) ===\n", RTT_PINGS);
+
+    for (int i = 0; i < RTT_PINGS; i++) {
+        uint8_t sequence = (uint8_t)(i + 1);
+
+        // Re-sending power on is harmless and the controller must acknowledge it
+        int length = gip_build_command(command, sizeof(command), GIP_CMD_POWER,
+                                       GIP_OPT_INTERNAL | GIP_OPT_ACK_REQUIRED, sequence,
+                                       &power_on, 1);
+        uint64_t sent = gip_monotonic_ns();
+        if (gip_device_send(dev, command, length) != 0) {
+            continue;
+        }
+        m->rtt_sent++;
+
+        // Skip input reports until our ack arrives
+        uint64_t deadline = sent + RTT_TIMEOUT_MS * 1000000ull;
+        while (gip_monotonic_ns() < deadline) {
+            int result = gip_device_read(dev, buffer, sizeof(buffer), &transferred, RTT_TIMEOUT_MS);
+            if (result == 0 && gip_is_ack_for(buffer, transferred, GIP_CMD_POWER, sequence)) {
+                interval_record(&m->rtt, (gip_monotonic_ns() - sent) / 1000);
+                m->rtt_received++;
+                break;
+            } else if (result == GIP_ERROR_NO_DEVICE) {
+                printf("❌ Controller disconnected!\n");
+                return;
+            }
+        }
+    }
+    printf("  %d of %d acknowledged\n\n", m->rtt_received, m->rtt_sent);
+}
+
+void print_measurement(const Measurement *m) {
+    printf("=== Results ===\n");
+    printf("  Packets: %llu (%llu input reports, %llu bytes) in %.1f s\n",
+           (unsigned long long)m->packets, (unsigned long long)m->input_packets,
+           (unsigned long long)m->bytes, m->elapsed);
+    if (m->elapsed > 0) {
+        printf("  Average report rate: %.1f reports/s\n", m->input_packets / m->elapsed);
+    }
+    if (m->interval.min_us > 0) {
+        printf("  Peak report rate: %.0f reports/s (shortest interval)\n", 1e6 / m->interval.min_us);
+    }
+    printf("  Timeouts: %llu, errors: %llu\n",
+           (unsigned long long)m->timeouts, (unsigned long long)m->errors);
+    interval_print("Inter-arrival", &m->interval);
+    interval_print("Jitter", &m->jitter);
+    interval_print("Round trip", &m->rtt);
+    printf("\n");
+}
+
+// ============================================================================
+// Machine-Readable Report
+// ============================================================================
+
+static void json_histogram(FILE *out, const char *name, const IntervalHistogram *h, bool last) {
+    fprintf(out, "    \"%s\": {\"count\": %llu, \"min_us\": %llu, \"mean_us\": %.1f, \"max_us\": %llu, \"buckets\": [",
+            name, (unsigned long long)h->count, (unsigned long long)h->min_us,
+            interval_mean(h), (unsigned long long)h->max_us);
+    for (int b = 0; b <= INTERVAL_BUCKETS; b++) {
+        if (b < INTERVAL_BUCKETS) {
+            fprintf(out, "{\"le_us\": %u, \"count\": %llu}, ", interval_bounds_us[b],
+                    (unsigned long long)h->buckets[b]);
+        } else {
+            fprintf(out, "{\"le_us\": null, \"count\": %llu}", (unsigned long long)h->buckets[b]);
+        }
+    }
+    fprintf(out, "]}%s\n", last ? "" : ",");
+}
+
+bool write_json_report(const char *path, libusb_device *device, int speed,
+                       const char *serial, const Measurement *m) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        return false;
+    }
+
+    struct libusb_device_descriptor desc;
+    libusb_get_device_descriptor(device, &desc);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"report_version\": 1,\n");
+    fprintf(out, "  \"timestamp\": %lld,\n", (long long)time(NULL));
+    fprintf(out, "  \"device\": {\"vendor_id\": \"%04x\", \"product_id\": \"%04x\", "
+            "\"bcd_usb\": \"%04x\", \"bcd_device\": \"%04x\", \"serial\": ",
+            desc.idVendor, desc.idProduct, desc.bcdUSB, desc.bcdDevice);
+    trace_write_json_string(out, serial);    // Reported by the device: anything goes
+    fprintf(out, ", \"speed\": \"%s\"},\n", speed_name(speed));
+
+    fprintf(out, "  \"configurations\": [\n");
+    for (int c = 0; c < desc.bNumConfigurations; c++) {
+        struct libusb_config_descriptor *config;
+        if (libusb_get_config_descriptor(device, c, &config) != 0) {
+            continue;
+        }
+        fprintf(out, "    {\"value\": %d, \"attributes\": %d, \"max_power_ma\": %d, \"interfaces\": [\n",
+                config->bConfigurationValue, config->bmAttributes, config->MaxPower * 2);
+
+        bool first_interface = true;
+        for (int i = 0; i < config->bNumInterfaces; i++) {
+            const struct libusb_interface *inter = &config->interface[i];
+            for (int a = 0; a < inter->num_altsetting; a++) {
+                const struct libusb_interface_descriptor *interdesc = &inter->altsetting[a];
+                fprintf(out, "%s      {\"number\": %d, \"alt_setting\": %d, \"class\": %d, "
+                        "\"subclass\": %d, \"protocol\": %d, \"endpoints\": [",
+                        first_interface ? "" : ",\n", interdesc->bInterfaceNumber,
+                        interdesc->bAlternateSetting, interdesc->bInterfaceClass,
+                        interdesc->bInterfaceSubClass, interdesc->bInterfaceProtocol);
+                first_interface = false;
+
+                for (int e = 0; e < interdesc->bNumEndpoints; e++) {
+                    const struct libusb_endpoint_descriptor *endpoint = &interdesc->endpoint[e];
+                    int type = endpoint->bmAttributes & 0x03;
+                    fprintf(out, "%s{\"address\": %d, \"direction\": \"%s\", \"type\": \"%s\", "
+                            "\"max_packet_size\": %d, \"b_interval\": %d, \"interval_us\": %.0f}",
+                            e ? ", " : "", endpoint->bEndpointAddress,
+                            (endpoint->bEndpointAddress & LIBUSB_ENDPOINT_IN) ? "in" : "out",
+                            transfer_type_name(type), endpoint->wMaxPacketSize, endpoint->bInterval,
+                            type == LIBUSB_TRANSFER_TYPE_INTERRUPT ?
+                                endpoint_interval_us(speed, endpoint->bInterval) : 0.0);
+                }
+                fprintf(out, "]}");
+            }
+        }
+        fprintf(out, "\n    ]}%s\n", c + 1 < desc.bNumConfigurations ? "," : "");
+        libusb_free_config_descriptor(config);
+    }
+    fprintf(out, "  ],\n");
+
+    if (m) {
+        fprintf(out, "  \"measurement\": {\n");
+        fprintf(out, "    \"duration_s\": %.3f,\n", m->elapsed);
+        fprintf(out, "    \"packets\": %llu,\n", (unsigned long long)m->packets);
+        fprintf(out, "    \"input_reports\": %llu,\n", (unsigned long long)m->input_packets);
+        fprintf(out, "    \"bytes\": %llu,\n", (unsigned long long)m->bytes);
+        fprintf(out, "    \"timeouts\": %llu,\n", (unsigned long long)m->timeouts);
+        fprintf(out, "    \"errors\": %llu,\n", (unsigned long long)m->errors);
+        fprintf(out, "    \"average_rate_hz\": %.2f,\n", m->elapsed > 0 ? m->input_packets / m->elapsed : 0.0);
+        fprintf(out, "    \"peak_rate_hz\": %.2f,\n", m->interval.min_us ? 1e6 / m->interval.min_us : 0.0);
+        fprintf(out, "    \"rtt_sent\": %d,\n", m->rtt_sent);
+        fprintf(out, "    \"rtt_received\": %d,\n", m->rtt_received);
+        json_histogram(out, "interval", &m->interval, false);
+        json_histogram(out, "jitter", &m->jitter, false);
+        json_histogram(out, "rtt", &m->rtt, true);
+        fprintf(out, "  }\n");
+    } else {
+        fprintf(out, "  \"measurement\": null\n");
+    }
+    fprintf(out, "}\n");
+
+    return fclose(out) == 0;
+}
+
+// ============================================================================
+// Basic Read Test (no handshake)
+// ============================================================================
+
+void basic_read_test(libusb_device_handle *handle, uint8_t in_endpoint) {
+    printf("Attempting to read from controller (endpoint 0x%02x)...\n", in_endpoint);
+    printf("Press any button on your controller...\n\n");
+
+    uint8_t buffer[64];
+    int transferred;
+    int packets_received = 0;
+
+    for (int i = 0; i < 10; i++) {  // Try for 10 iterations
+        int result = libusb_interrupt_transfer(
+            handle,
+            in_endpoint,
+            buffer,
+            sizeof(buffer),
+            &transferred,
+            1000  // 1 second timeout
+        );
+
+        if (result == 0 && transferred > 0) {
+            packets_received++;
+            printf("📦 Received %d bytes: ", transferred);
+            for (int j = 0; j < transferred && j < 32; j++) {
+                printf("%02x ", buffer[j]);
+            }
+            if (transferred > 32) {
+                printf("...");
+            }
+            printf("\n");
+        } else if (result == LIBUSB_ERROR_TIMEOUT) {
+            printf(".");
+            fflush(stdout);
+        } else {
+            printf("\n⚠️  Read error: %s\n", libusb_error_name(result));
+        }
+    }
+
+    printf("\n");
+    if (packets_received > 0) {
+        printf("✅ SUCCESS! Received %d packets from controller\n", packets_received);
+        printf("   This means USB communication is working!\n");
+        printf("   Next step: Parse the GIP protocol from these packets\n");
+    } else {
+        printf("⚠️  No data received. This might mean:\n");
+        printf("   1. The controller needs an initialization sequence first\n");
+        printf("   2. macOS is interfering with the device\n");
+        printf("   3. The controller is in a different mode\n");
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(int argc, char **argv) {
     libusb_context *ctx = NULL;
     libusb_device_handle *handle = NULL;
     int result;
-    
+    bool measure = false;
+    const char *json_path = NULL;
+    Measurement measurement;
+
+    memset(&measurement, 0, sizeof(measurement));
+    measurement.seconds = DEFAULT_MEASURE_SECONDS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--measure") == 0) {
+            measure = true;
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                measurement.seconds = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            printf("Usage: %s [--measure [seconds]] [--json FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
     printf("Xbox One Controller USB Test\n");
     printf("=============================\n\n");
-    
+
     // Initialize libusb
     result = libusb_init(&ctx);
     if (result < 0) {
         printf("❌ Failed to initialize libusb: %s\n", libusb_error_name(result));
         return 1;
     }
-    
+
     // Set debug level (optional)
     libusb_set_option(ctx, LIBUSB_OPTION_LOG_LEVEL, LIBUSB_LOG_LEVEL_WARNING);
-    
+
     // Find and open the Xbox controller
-    printf("Looking for Xbox controller (VID=%04x, PID=%04x)...\n", 
+    printf("Looking for Xbox controller (VID=%04x, PID=%04x)...\n",
            XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
-    
+
     handle = libusb_open_device_with_vid_pid(ctx, XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
     if (!handle) {
         printf("❌ Could not find Xbox controller\n");
@@ -39,32 +496,73 @@ int main() {
         libusb_exit(ctx);
         return 1;
     }
-    
+
     printf("✅ Found Xbox One controller!\n\n");
-    
+
     // Get device descriptor
+    libusb_device *device = libusb_get_device(handle);
     struct libusb_device_descriptor desc;
-    libusb_get_device_descriptor(libusb_get_device(handle), &desc);
-    
+    libusb_get_device_descriptor(device, &desc);
+    int speed = libusb_get_device_speed(device);
+
     printf("Device Information:\n");
     printf("  USB Version: %04x\n", desc.bcdUSB);
     printf("  Device Version: %04x\n", desc.bcdDevice);
     printf("  Vendor ID: %04x\n", desc.idVendor);
     printf("  Product ID: %04x\n", desc.idProduct);
     printf("  Device Class: %d\n", desc.bDeviceClass);
+    printf("  Speed: %s\n", speed_name(speed));
     printf("  Number of Configurations: %d\n", desc.bNumConfigurations);
     printf("\n");
-    
+
+    dump_descriptors(device, speed);
+
+    if (measure) {
+        // The measurement needs the handshake, which libgip does on its own handle.
+        // Keep a reference so the descriptors stay readable for the report.
+        libusb_ref_device(device);
+        libusb_close(handle);
+
+        GipDevice *dev = NULL;
+        result = gip_device_open(&dev, XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
+        if (result != GIP_OK) {
+            printf("❌ Could not open controller: %s\n", gip_strerror(result));
+            libusb_unref_device(device);
+            libusb_exit(ctx);
+            return 1;
+        }
+        gip_device_set_verbosity(dev, GIP_VERBOSE_SUMMARY);
+        gip_device_handshake(dev);
+
+        measure_report_rate(dev, &measurement);
+        measure_round_trip(dev, &measurement);
+        print_measurement(&measurement);
+
+        if (json_path) {
+            if (write_json_report(json_path, device, speed, gip_device_serial(dev), &measurement)) {
+                printf("✅ Wrote report to %s\n", json_path);
+            } else {
+                printf("❌ Failed to write %s\n", json_path);
+            }
+        }
+
+        gip_device_close(dev);
+        libusb_unref_device(device);
+        libusb_exit(ctx);
+        printf("\n✅ Measurement complete!\n");
+        return 0;
+    }
+
     // Detach kernel driver if active
     if (libusb_kernel_driver_active(handle, 0) == 1) {
         printf("Kernel driver is active, detaching...\n");
         result = libusb_detach_kernel_driver(handle, 0);
         if (result != 0) {
-            printf("⚠️  Warning: Could not detach kernel driver: %s\n", 
+            printf("⚠️  Warning: Could not detach kernel driver: %s\n",
                    libusb_error_name(result));
         }
     }
-    
+
     // Claim interface 0 (main controller interface)
     printf("Claiming controller interface...\n");
     result = libusb_claim_interface(handle, 0);
@@ -75,134 +573,52 @@ int main() {
         libusb_exit(ctx);
         return 1;
     }
-    
+
     printf("✅ Successfully claimed controller interface!\n\n");
-    
-    // Get configuration descriptor
-    struct libusb_config_descriptor *config;
-    result = libusb_get_active_config_descriptor(libusb_get_device(handle), &config);
-    if (result != 0) {
-        printf("❌ Failed to get configuration descriptor\n");
-        libusb_release_interface(handle, 0);
-        libusb_close(handle);
-        libusb_exit(ctx);
-        return 1;
+
+    if (json_path) {
+        unsigned char serial[64] = "";
+        if (desc.iSerialNumber) {
+            libusb_get_string_descriptor_ascii(handle, desc.iSerialNumber, serial, sizeof(serial));
+        }
+        if (write_json_report(json_path, device, speed, (const char *)serial, NULL)) {
+            printf("✅ Wrote descriptor report to %s\n\n", json_path);
+        } else {
+            printf("❌ Failed to write %s\n\n", json_path);
+        }
     }
-    
-    printf("Configuration:\n");
-    printf("  Number of interfaces: %d\n", config->bNumInterfaces);
-    printf("\n");
-    
-    // Get endpoint information for interface 0
-    const struct libusb_interface *inter = &config->interface[0];
-    const struct libusb_interface_descriptor *interdesc = &inter->altsetting[0];
-    
-    printf("Interface 0 Endpoints:\n");
+
+    // Find the interrupt IN endpoint on interface 0
+    struct libusb_config_descriptor *config;
     uint8_t in_endpoint = 0;
-    uint8_t out_endpoint = 0;
-    
-    for (int i = 0; i < interdesc->bNumEndpoints; i++) {
-        const struct libusb_endpoint_descriptor *endpoint = &interdesc->endpoint[i];
-        int direction = endpoint->bEndpointAddress & LIBUSB_ENDPOINT_IN;
-        
-        printf("  Endpoint %d:\n", i);
-        printf("    Address: 0x%02x\n", endpoint->bEndpointAddress);
-        printf("    Direction: %s\n", direction ? "IN (device to host)" : "OUT (host to device)");
-        printf("    Transfer Type: ");
-        
-        int type = endpoint->bmAttributes & 0x03;
-        switch (type) {
-            case LIBUSB_TRANSFER_TYPE_CONTROL:
-                printf("Control\n");
-                break;
-            case LIBUSB_TRANSFER_TYPE_ISOCHRONOUS:
-                printf("Isochronous\n");
-                break;
-            case LIBUSB_TRANSFER_TYPE_BULK:
-                printf("Bulk\n");
-                break;
-            case LIBUSB_TRANSFER_TYPE_INTERRUPT:
-                printf("Interrupt\n");
-                break;
-        }
-        
-        printf("    Max Packet Size: %d bytes\n", endpoint->wMaxPacketSize);
-        printf("    Interval: %d\n", endpoint->bInterval);
-        
-        // Save interrupt endpoints for later use
-        if (type == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
-            if (direction) {
+    if (libusb_get_active_config_descriptor(device, &config) == 0) {
+        const struct libusb_interface_descriptor *interdesc = &config->interface[0].altsetting[0];
+        for (int i = 0; i < interdesc->bNumEndpoints; i++) {
+            const struct libusb_endpoint_descriptor *endpoint = &interdesc->endpoint[i];
+            if ((endpoint->bmAttributes & 0x03) == LIBUSB_TRANSFER_TYPE_INTERRUPT &&
+                (endpoint->bEndpointAddress & LIBUSB_ENDPOINT_IN)) {
                 in_endpoint = endpoint->bEndpointAddress;
-                printf("    👉 This is the INPUT endpoint for controller data\n");
-            } else {
-                out_endpoint = endpoint->bEndpointAddress;
-                printf("    👉 This is the OUTPUT endpoint for commands (rumble, etc.)\n");
+                printf("👉 Input endpoint for controller data: 0x%02x\n\n", in_endpoint);
             }
         }
-        printf("\n");
+        libusb_free_config_descriptor(config);
     }
-    
-    libusb_free_config_descriptor(config);
-    
+
     // Try to read some data from the IN endpoint
     if (in_endpoint != 0) {
-        printf("Attempting to read from controller (endpoint 0x%02x)...\n", in_endpoint);
-        printf("Press any button on your controller...\n\n");
-        
-        uint8_t buffer[64];
-        int transferred;
-        int packets_received = 0;
-        
-        for (int i = 0; i < 10; i++) {  // Try for 10 iterations
-            result = libusb_interrupt_transfer(
-                handle,
-                in_endpoint,
-                buffer,
-                sizeof(buffer),
-                &transferred,
-                1000  // 1 second timeout
-            );
-            
-            if (result == 0 && transferred > 0) {
-                packets_received++;
-                printf("📦 Received %d bytes: ", transferred);
-                for (int j = 0; j < transferred && j < 32; j++) {
-                    printf("%02x ", buffer[j]);
-                }
-                if (transferred > 32) {
-                    printf("...");
-                }
-                printf("\n");
-            } else if (result == LIBUSB_ERROR_TIMEOUT) {
-                printf(".");
-                fflush(stdout);
-            } else {
-                printf("\n⚠️  Read error: %s\n", libusb_error_name(result));
-            }
-        }
-        
-        printf("\n");
-        if (packets_received > 0) {
-            printf("✅ SUCCESS! Received %d packets from controller\n", packets_received);
-            printf("   This means USB communication is working!\n");
-            printf("   Next step: Parse the GIP protocol from these packets\n");
-        } else {
-            printf("⚠️  No data received. This might mean:\n");
-            printf("   1. The controller needs an initialization sequence first\n");
-            printf("   2. macOS is interfering with the device\n");
-            printf("   3. The controller is in a different mode\n");
-        }
+        basic_read_test(handle, in_endpoint);
     }
-    
+
     // Cleanup
     printf("\nCleaning up...\n");
     libusb_release_interface(handle, 0);
     libusb_close(handle);
     libusb_exit(ctx);
-    
+
     printf("\n✅ Test completed successfully!\n");
     printf("\nIf you saw packet data above, you're ready for Phase 3 (GIP protocol).\n");
     printf("If not, don't worry - Phase 3 will implement the initialization sequence.\n");
-    
+    printf("Run with --measure to handshake and measure report rate and latency.\n");
+
     return 0;
 }
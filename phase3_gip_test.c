@@ -2,17 +2,32 @@
 // Tests GIP protocol communication with Xbox One controller
 // Compile: make xbox_gip_test
 // Run: sudo ./xbox_gip_test
+//      sudo ./xbox_gip_test --calibrate [seconds]   (record stick outer range)
+//      sudo ./xbox_gip_test --circularity           (report saved calibration)
+//      sudo ./xbox_gip_test --sniff [options]        (hexdump and decode every packet)
+//          --cmd LIST       only show these commands (e.g. 0x03,0x07)
+//          --skip LIST      hide these commands (e.g. 0x20)
+//          --opt MASK       only show packets with any of these option bits
+//          --no-hex         decoded lines only
+//          --capture FILE   write every packet to a capture file for replay
+//          --packed         write the capture packed and indexed (long sessions)
+//          --no-handshake   don't power the controller on (sniff the announce phase)
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
-#include <libusb.h>
+#include <time.h>
 #include "gip.h"
+#include "gip_protocol.h"
+#include "gip_device.h"
+#include "calibration.h"
+#include "capture.h"
+#include "capture_async.h"
 
-#define XBOX_VENDOR_ID  0x045e
-#define XBOX_PRODUCT_ID 0x02dd
+#define DEFAULT_CALIBRATION_SECONDS 15
 
 static int running = 1;
 
@@ -22,127 +37,8 @@ void signal_handler(int sig) {
     printf("\nShutting down...\n");
 }
 
-// Send acknowledgment packet
-int send_ack(libusb_device_handle *handle, uint8_t out_endpoint, uint8_t sequence) {
-    uint8_t ack_packet[] = {
-        GIP_CMD_ACKNOWLEDGE,
-        0x20,       // options
-        sequence,   // sequence number from the packet we're acknowledging
-        0x09,       // length
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
-    
-    int transferred;
-    int result = libusb_interrupt_transfer(
-        handle,
-        out_endpoint,
-        ack_packet,
-        sizeof(ack_packet),
-        &transferred,
-        1000
-    );
-    
-    if (result == 0) {
-        printf("  → Sent ACK (seq=%d)\n", sequence);
-        return 0;
-    } else {
-        printf("  ✗ Failed to send ACK: %s\n", libusb_error_name(result));
-        return -1;
-    }
-}
-
-// Initialize controller with GIP handshake
-int initialize_controller(libusb_device_handle *handle, uint8_t in_endpoint, uint8_t out_endpoint) {
-    uint8_t buffer[64];
-    int transferred;
-    int result;
-    
-    printf("\n=== Initializing Controller ===\n");
-    printf("This performs the GIP handshake sequence\n\n");
-    
-    // The controller should announce itself when we first connect
-    // We need to read and acknowledge these packets
-    
-    for (int attempt = 0; attempt < 5; attempt++) {
-        printf("Reading initialization packet %d...\n", attempt + 1);
-        
-        result = libusb_interrupt_transfer(
-            handle,
-            in_endpoint,
-            buffer,
-            sizeof(buffer),
-            &transferred,
-            2000  // 2 second timeout
-        );
-        
-        if (result == 0 && transferred >= (int)sizeof(GipHeader)) {
-            GipHeader *header = (GipHeader *)buffer;
-            
-            printf("  Received: %s (0x%02x), seq=%d, len=%d\n",
-                   gip_command_name(header->command),
-                   header->command,
-                   header->sequence,
-                   header->length);
-            
-            // Print raw packet
-            printf("  Data: ");
-            for (int i = 0; i < transferred && i < 32; i++) {
-                printf("%02x ", buffer[i]);
-            }
-            if (transferred > 32) printf("...");
-            printf("\n");
-            
-            // Send acknowledgment for announce packets
-            if (header->command == GIP_CMD_ANNOUNCE) {
-                send_ack(handle, out_endpoint, header->sequence);
-            }
-            
-        } else if (result == LIBUSB_ERROR_TIMEOUT) {
-            printf("  Timeout (this is normal after init sequence)\n");
-            break;
-        } else {
-            printf("  Error: %s\n", libusb_error_name(result));
-        }
-        
-        printf("\n");
-    }
-    
-    printf("✅ Initialization complete!\n");
-    
-    // Send POWER ON command to start input mode
-    printf("\nSending POWER ON command...\n");
-    uint8_t power_on[] = {
-        GIP_CMD_POWER,  // 0x05
-        0x20,           // options
-        0x00,           // sequence (can be 0 for commands we initiate)
-        0x01,           // length
-        0x00            // mode: 0x00 = on
-    };
-    
-    result = libusb_interrupt_transfer(
-        handle,
-        out_endpoint,
-        power_on,
-        sizeof(power_on),
-        &transferred,
-        1000
-    );
-    
-    if (result == 0) {
-        printf("✅ Power ON command sent!\n");
-    } else {
-        printf("⚠️  Failed to send power command: %s\n", libusb_error_name(result));
-    }
-    
-    // Wait a moment for controller to respond
-    printf("Waiting for controller to start input mode...\n\n");
-    usleep(500000);  // 500ms
-    
-    return 0;
-}
-
 // Main input reading loop
-void input_loop(libusb_device_handle *handle, uint8_t in_endpoint) {
+void input_loop(GipDevice *dev) {
     uint8_t buffer[64];
     int transferred;
     int result;
@@ -153,21 +49,14 @@ void input_loop(libusb_device_handle *handle, uint8_t in_endpoint) {
     printf("Press Ctrl+C to exit\n\n");
     
     while (running) {
-        result = libusb_interrupt_transfer(
-            handle,
-            in_endpoint,
-            buffer,
-            sizeof(buffer),
-            &transferred,
-            100  // 100ms timeout
-        );
+        result = gip_device_read(dev, buffer, sizeof(buffer), &transferred, 100);  // 100ms timeout
+        const GipHeader *header = (result == 0) ? gip_decode_header(buffer, transferred) : NULL;
         
-        if (result == 0 && transferred >= (int)sizeof(GipHeader)) {
-            GipHeader *header = (GipHeader *)buffer;
+        if (header) {
+            const GipInputPacket *input = gip_decode_input(buffer, transferred);
             
             // Check if this is an input packet
-            if (header->command == GIP_CMD_INPUT && transferred >= (int)sizeof(GipInputPacket)) {
-                GipInputPacket *input = (GipInputPacket *)buffer;
+            if (input) {
                 input_count++;
                 
                 // Clear line and print input state
@@ -209,9 +98,9 @@ void input_loop(libusb_device_handle *handle, uint8_t in_endpoint) {
                        header->command);
             }
             
-        } else if (result != LIBUSB_ERROR_TIMEOUT) {
-            printf("\nRead error: %s\n", libusb_error_name(result));
-            if (result == LIBUSB_ERROR_NO_DEVICE) {
+        } else if (result != 0 && result != GIP_ERROR_TIMEOUT) {
+            printf("\nRead error: %s\n", gip_strerror(result));
+            if (result == GIP_ERROR_NO_DEVICE) {
                 printf("Controller disconnected!\n");
                 break;
             }
@@ -221,96 +110,451 @@ void input_loop(libusb_device_handle *handle, uint8_t in_endpoint) {
     printf("\n\n");
 }
 
-int main() {
-    libusb_context *ctx = NULL;
-    libusb_device_handle *handle = NULL;
+// ============================================================================
+// Sniffer
+// ============================================================================
+
+// Console output is collected here and written at most every
+// SNIFF_FLUSH_MS, so a burst of packets costs memcpy, not terminal I/O, on
+// the path that timestamps them. Lines that don't fit before the next flush
+// are dropped and counted. Each line is formatted in full before it goes
+// in, so a line is either all there or not at all.
+#define SNIFF_FLUSH_MS          100
+#define SNIFF_CONSOLE_BYTES     (32 * 1024)
+#define SNIFF_LINE_BYTES        512
+
+typedef struct {
+    // Filters (console only - the capture file always gets every packet)
+    bool only_command[256];     // --cmd: show only these commands
+    bool has_only;
+    bool skip_command[256];     // --skip: hide these commands
+    uint8_t options_mask;       // --opt: show only packets with any of these option bits
+    bool hexdump;
+
+    // Per-command sequence tracking
+    uint8_t last_sequence[256];
+    bool have_sequence[256];
+
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t packets;
+    uint64_t shown;
+    uint64_t gaps;
+    uint64_t command_counts[256];
+
+    CaptureAsync *capture;      // Written from a background thread
+
+    char console[SNIFF_CONSOLE_BYTES];
+    int console_used;
+    uint64_t console_dropped;
+    uint64_t last_flush_ns;
+} Sniffer;
+
+static void line_printf(char *line, int *used, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+// Appends to a line being built; anything past SNIFF_LINE_BYTES is cut off
+static void line_printf(char *line, int *used, const char *format, ...) {
+    int space = SNIFF_LINE_BYTES - *used;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line + *used, space, format, args);
+    va_end(args);
+
+    if (length > 0) {
+        *used += length < space ? length : space - 1;
+    }
+}
+
+// A whole line into the console buffer, or counted as dropped
+static void sniff_line(Sniffer *s, const char *line, int length) {
+    if (length > SNIFF_CONSOLE_BYTES - s->console_used) {
+        s->console_dropped++;
+        return;
+    }
+    memcpy(s->console + s->console_used, line, length);
+    s->console_used += length;
+}
+
+static void sniff_printf(Sniffer *s, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// One complete line, format ending in \n
+static void sniff_printf(Sniffer *s, const char *format, ...) {
+    char line[SNIFF_LINE_BYTES];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (length > 0) {
+        sniff_line(s, line, length < (int)sizeof(line) ? length : (int)sizeof(line) - 1);
+    }
+}
+
+static void sniff_flush(Sniffer *s, uint64_t now_ns, bool force) {
+    if (!force && now_ns - s->last_flush_ns < SNIFF_FLUSH_MS * 1000000ull) {
+        return;
+    }
+    if (s->console_used > 0) {
+        fwrite(s->console, 1, s->console_used, stdout);
+        s->console_used = 0;
+    }
+    if (s->console_dropped > 0) {
+        printf("... %llu lines dropped (console rate limit)\n", (unsigned long long)s->console_dropped);
+        s->console_dropped = 0;
+    }
+    fflush(stdout);
+    s->last_flush_ns = now_ns;
+}
+
+static bool sniff_visible(const Sniffer *s, const GipHeader *header) {
+    if (!header) {
+        return true;    // Always show garbage
+    }
+    if (s->has_only && !s->only_command[header->command]) {
+        return false;
+    }
+    if (s->skip_command[header->command]) {
+        return false;
+    }
+    return s->options_mask == 0 || (header->options & s->options_mask) != 0;
+}
+
+// Called from gip_device_process() with the packet still in the USB buffer
+static void sniff_packet(void *user_data, const uint8_t *data, int length, uint64_t timestamp_ns) {
+    Sniffer *s = user_data;
+    const GipHeader *header = gip_decode_header(data, length);
+
+    if (s->capture) {
+        capture_async_write(s->capture, timestamp_ns, CAPTURE_DIR_IN, data, length);
+    }
+
+    if (s->packets == 0) {
+        s->first_ns = timestamp_ns;
+        s->last_ns = timestamp_ns;
+    }
+    double since_start_s = (timestamp_ns - s->first_ns) / 1e9;
+    double delta_ms = (timestamp_ns - s->last_ns) / 1e6;
+    s->last_ns = timestamp_ns;
+    s->packets++;
+
+    // Sequence numbers count per command and wrap at 256; a large jump
+    // backwards is a reorder or restart, not a gap
+    unsigned missing = 0;
+    if (header) {
+        s->command_counts[header->command]++;
+        if (s->have_sequence[header->command]) {
+            uint8_t skipped = (uint8_t)(header->sequence - s->last_sequence[header->command] - 1);
+            if (skipped != 0 && skipped < 128) {
+                missing = skipped;
+                s->gaps += missing;
+            }
+        }
+        s->last_sequence[header->command] = header->sequence;
+        s->have_sequence[header->command] = true;
+    }
+
+    if (!sniff_visible(s, header)) {
+        return;
+    }
+    s->shown++;
+
+    char line[SNIFF_LINE_BYTES];
+    int used = 0;
+    if (!header) {
+        line_printf(line, &used, "[%11.6f] +%8.3fms IN  truncated packet (%d bytes)\n",
+                    since_start_s, delta_ms, length);
+    } else {
+        char description[128];
+        gip_describe_packet(data, length, description, sizeof(description));
+        line_printf(line, &used, "[%11.6f] +%8.3fms IN  %-13s cmd=0x%02x opt=0x%02x seq=%3d len=%-3d %s",
+                    since_start_s, delta_ms, gip_command_name(header->command), header->command,
+                    header->options, header->sequence, header->length, description);
+        if (missing) {
+            line_printf(line, &used, "  ⚠️  GAP: %u missing", missing);
+        }
+        if (header->length + (int)sizeof(GipHeader) != length) {
+            line_printf(line, &used, "  (header says %d payload bytes, got %d)",
+                        header->length, length - (int)sizeof(GipHeader));
+        }
+        line_printf(line, &used, "\n");
+    }
+    sniff_line(s, line, used);
+
+    if (s->hexdump) {
+        for (int offset = 0; offset < length; offset += 16) {
+            used = 0;
+            line_printf(line, &used, "    %04x: ", offset);
+            for (int i = offset; i < offset + 16; i++) {
+                if (i < length) {
+                    line_printf(line, &used, "%02x ", data[i]);
+                } else {
+                    line_printf(line, &used, "   ");
+                }
+            }
+            line_printf(line, &used, " ");
+            for (int i = offset; i < offset + 16 && i < length; i++) {
+                line_printf(line, &used, "%c", (data[i] >= 0x20 && data[i] <= 0x7e) ? data[i] : '.');
+            }
+            line_printf(line, &used, "\n");
+            sniff_line(s, line, used);
+        }
+    }
+}
+
+// Parse a comma-separated list of command numbers ("0x20,0x03") into a set
+static bool parse_command_list(const char *list, bool set[256]) {
+    char *end;
+    while (*list) {
+        long value = strtol(list, &end, 0);
+        if (end == list || value < 0 || value > 255 || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        set[value] = true;
+        list = (*end == ',') ? end + 1 : end;
+    }
+    return true;
+}
+
+// Show every packet the controller sends, optionally capturing them to a file
+void sniff_loop(GipDevice *dev, Sniffer *s) {
+    printf("=== Sniffing GIP Packets ===\n");
+    if (s->capture) {
+        printf("Capturing all packets (filters apply to the console only)\n");
+    }
+    printf("Press Ctrl+C to exit\n\n");
+
+    int result = gip_device_start(dev, sniff_packet, s);
+    if (result != GIP_OK) {
+        printf("❌ Could not start input transfers: %s\n", gip_strerror(result));
+        return;
+    }
+
+    s->last_flush_ns = gip_monotonic_ns();
+    while (running) {
+        // Transfers stay queued while we write to the console, so a slow
+        // terminal delays the printout, never the timestamps
+        result = gip_device_process(dev, SNIFF_FLUSH_MS * 1000 / 4);
+        sniff_flush(s, gip_monotonic_ns(), false);
+        if (result == GIP_ERROR_NO_DEVICE) {
+            sniff_printf(s, "❌ Controller disconnected!\n");
+            break;
+        } else if (result < 0 && result != GIP_ERROR_TIMEOUT) {
+            // Just resubmit: the full recovery ladder would re-run the
+            // handshake and change what is being observed
+            sniff_printf(s, "⚠️  Read error: %s\n", gip_strerror(result));
+            gip_device_resubmit(dev);
+        }
+    }
+    gip_device_stop(dev);
+    sniff_flush(s, gip_monotonic_ns(), true);
+
+    printf("\n=== Sniffer Summary ===\n");
+    printf("  Packets: %llu (%llu shown), sequence gaps: %llu missing\n",
+           (unsigned long long)s->packets, (unsigned long long)s->shown, (unsigned long long)s->gaps);
+    for (int command = 0; command < 256; command++) {
+        if (s->command_counts[command]) {
+            printf("  %-13s (0x%02x): %llu\n", gip_command_name(command), command,
+                   (unsigned long long)s->command_counts[command]);
+        }
+    }
+    printf("\n");
+}
+
+// Count bins that have seen at least one sample
+static int calibration_bins_covered(const StickRange *range) {
+    int covered = 0;
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        if (range->outer_radius[i] > 0) covered++;
+    }
+    return covered;
+}
+
+// Record the outer range of both sticks while the user rotates them
+void calibrate_sticks(GipDevice *dev, int seconds, const char *serial) {
+    uint8_t buffer[64];
+    int transferred;
     int result;
+    StickCalibration cal;
     
-    // Set up signal handler for clean exit
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    memset(&cal, 0, sizeof(cal));
+    cal.magic = CALIBRATION_MAGIC;
+    cal.version = CALIBRATION_VERSION;
+    cal.bins = CALIBRATION_BINS;
+    snprintf(cal.serial, sizeof(cal.serial), "%s", (serial && serial[0]) ? serial : "default");
     
-    printf("Xbox One Controller GIP Protocol Test\n");
-    printf("======================================\n\n");
+    printf("=== Stick Calibration ===\n");
+    printf("Slowly rotate BOTH sticks around their full edge, several times.\n");
+    printf("Recording for %d seconds... (Ctrl+C to stop early)\n\n", seconds);
     
-    // Initialize libusb
-    result = libusb_init(&ctx);
-    if (result < 0) {
-        printf("❌ Failed to initialize libusb: %s\n", libusb_error_name(result));
-        return 1;
+    time_t end = time(NULL) + seconds;
+    while (running && time(NULL) < end) {
+        result = gip_device_read(dev, buffer, sizeof(buffer), &transferred, 100);
+        const GipInputPacket *input = (result == 0) ? gip_decode_input(buffer, transferred) : NULL;
+        
+        if (input) {
+            calibration_record(&cal.left, input->left_stick_x, input->left_stick_y);
+            calibration_record(&cal.right, input->right_stick_x, input->right_stick_y);
+            
+            printf("\rCoverage: left %2d/%d  right %2d/%d  (%2lds left)  ",
+                   calibration_bins_covered(&cal.left), CALIBRATION_BINS,
+                   calibration_bins_covered(&cal.right), CALIBRATION_BINS,
+                   (long)(end - time(NULL)));
+            fflush(stdout);
+        } else if (result == GIP_ERROR_NO_DEVICE) {
+            printf("\nController disconnected!\n");
+            return;
+        }
     }
+    printf("\n\n");
     
-    // Find controller
-    printf("Looking for Xbox controller...\n");
-    handle = libusb_open_device_with_vid_pid(ctx, XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
-    if (!handle) {
-        printf("❌ Controller not found\n");
-        libusb_exit(ctx);
-        return 1;
+    int missing_left = calibration_finish(&cal.left);
+    int missing_right = calibration_finish(&cal.right);
+    if (missing_left || missing_right) {
+        printf("⚠️  %d left / %d right directions were never reached and were interpolated.\n",
+               missing_left, missing_right);
+        printf("   Re-run and rotate more slowly for a better table.\n\n");
     }
-    printf("✅ Found controller\n");
     
-    // Detach kernel driver if needed
-    if (libusb_kernel_driver_active(handle, 0) == 1) {
-        libusb_detach_kernel_driver(handle, 0);
-    }
+    calibration_print_report("Left", &cal.left);
+    calibration_print_report("Right", &cal.right);
     
-    // Claim interface
-    result = libusb_claim_interface(handle, 0);
-    if (result < 0) {
-        printf("❌ Failed to claim interface: %s\n", libusb_error_name(result));
-        libusb_close(handle);
-        libusb_exit(ctx);
-        return 1;
+    char path[128];
+    calibration_path(cal.serial, path, sizeof(path));
+    if (calibration_save(&cal)) {
+        printf("✅ Saved calibration to %s\n", path);
+        printf("   The simulator loads it automatically for this controller.\n");
+    } else {
+        printf("❌ Failed to write %s\n", path);
     }
-    printf("✅ Claimed interface\n");
-    
-    // Get endpoint addresses
-    struct libusb_config_descriptor *config;
-    libusb_get_active_config_descriptor(libusb_get_device(handle), &config);
-    
-    uint8_t in_endpoint = 0;
-    uint8_t out_endpoint = 0;
-    
-    const struct libusb_interface *inter = &config->interface[0];
-    const struct libusb_interface_descriptor *interdesc = &inter->altsetting[0];
+}
+
+int main(int argc, char **argv) {
+    GipDevice *dev = NULL;
+    int result;
+    bool calibrate = false;
+    bool circularity = false;
+    int calibration_seconds = DEFAULT_CALIBRATION_SECONDS;
+    bool sniff = false;
+    bool handshake = true;
+    const char *capture_path = NULL;
+    bool capture_packed = false;
+    static Sniffer sniffer;     // Large console buffer; keep it off the stack
+    bool usage_error = false;
     
-    for (int i = 0; i < interdesc->bNumEndpoints; i++) {
-        const struct libusb_endpoint_descriptor *ep = &interdesc->endpoint[i];
-        int type = ep->bmAttributes & 0x03;
-        
-        if (type == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
-            if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
-                in_endpoint = ep->bEndpointAddress;
-            } else {
-                out_endpoint = ep->bEndpointAddress;
+    sniffer.hexdump = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--calibrate") == 0) {
+            calibrate = true;
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                calibration_seconds = atoi(argv[++i]);
             }
+        } else if (strcmp(argv[i], "--circularity") == 0) {
+            circularity = true;
+        } else if (strcmp(argv[i], "--sniff") == 0) {
+            sniff = true;
+        } else if (strcmp(argv[i], "--cmd") == 0 && i + 1 < argc) {
+            sniffer.has_only = true;
+            usage_error |= !parse_command_list(argv[++i], sniffer.only_command);
+        } else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc) {
+            usage_error |= !parse_command_list(argv[++i], sniffer.skip_command);
+        } else if (strcmp(argv[i], "--opt") == 0 && i + 1 < argc) {
+            sniffer.options_mask = (uint8_t)strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--no-hex") == 0) {
+            sniffer.hexdump = false;
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--packed") == 0) {
+            capture_packed = true;
+        } else if (strcmp(argv[i], "--no-handshake") == 0) {
+            handshake = false;
+        } else {
+            usage_error = true;
         }
     }
+    if (usage_error) {
+        printf("Usage: %s [--calibrate [seconds] | --circularity |\n"
+               "        --sniff [--cmd LIST] [--skip LIST] [--opt MASK] [--no-hex]\n"
+               "                [--capture FILE [--packed]] [--no-handshake]]\n", argv[0]);
+        return 1;
+    }
     
-    libusb_free_config_descriptor(config);
+    // Set up signal handler for clean exit
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
     
-    printf("Endpoints: IN=0x%02x, OUT=0x%02x\n", in_endpoint, out_endpoint);
+    printf("Xbox One Controller GIP Protocol Test\n");
+    printf("======================================\n\n");
     
-    if (in_endpoint == 0 || out_endpoint == 0) {
-        printf("❌ Could not find interrupt endpoints\n");
-        libusb_release_interface(handle, 0);
-        libusb_close(handle);
-        libusb_exit(ctx);
+    // Find controller and claim its interface
+    printf("Looking for Xbox controller...\n");
+    result = gip_device_open(&dev, XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
+    if (result != GIP_OK) {
+        printf("❌ Could not open controller: %s\n", gip_strerror(result));
         return 1;
     }
+    printf("✅ Found controller\n");
+    printf("✅ Claimed interface\n");
+    printf("Endpoints: IN=0x%02x, OUT=0x%02x\n",
+           gip_device_in_endpoint(dev), gip_device_out_endpoint(dev));
+    
+    // Serial number identifies this controller's calibration file
+    const char *serial = gip_device_serial(dev);
+    
+    if (circularity) {
+        StickCalibration cal;
+        char path[128];
+        calibration_path(serial, path, sizeof(path));
+        bool loaded = calibration_load(serial, &cal);
+        gip_device_close(dev);
+        
+        if (!loaded) {
+            printf("❌ No calibration found at %s (run with --calibrate first)\n", path);
+            return 1;
+        }
+        printf("\nCircularity report for %s\n\n", cal.serial);
+        calibration_print_report("Left", &cal.left);
+        calibration_print_report("Right", &cal.right);
+        return 0;
+    }
     
     // Perform GIP initialization
-    initialize_controller(handle, in_endpoint, out_endpoint);
+    gip_device_set_verbosity(dev, GIP_VERBOSE_PACKETS);
+    if (handshake || !sniff) {
+        gip_device_handshake(dev);
+    }
     
-    // Enter main input loop
-    input_loop(handle, in_endpoint);
+    // Enter main input loop (or record calibration, or sniff)
+    if (sniff) {
+        if (capture_path) {
+            if (!capture_async_open(&sniffer.capture, capture_path, capture_packed,
+                                    XBOX_VENDOR_ID, XBOX_PRODUCT_ID, serial)) {
+                printf("❌ Could not create %s\n", capture_path);
+                gip_device_close(dev);
+                return 1;
+            }
+        }
+        sniff_loop(dev, &sniffer);
+        if (sniffer.capture) {
+            CaptureAsyncStats stats;
+            if (capture_async_close(sniffer.capture, &stats)) {
+                printf("✅ Wrote %llu packets to %s\n", (unsigned long long)stats.written, capture_path);
+            } else {
+                printf("❌ Capture %s is incomplete: %llu written, %llu dropped%s\n", capture_path,
+                       (unsigned long long)stats.written, (unsigned long long)stats.dropped,
+                       stats.failed ? ", write failed" : "");
+            }
+            printf("   %llu flushes, p99 < %.1f us, max %.1f us\n", (unsigned long long)stats.flushes,
+                   stats.flush_p99_ns / 1000.0, stats.flush_max_ns / 1000.0);
+        }
+    } else if (calibrate) {
+        calibrate_sticks(dev, calibration_seconds, serial);
+    } else {
+        input_loop(dev);
+    }
     
     // Cleanup
     printf("Cleaning up...\n");
-    libusb_release_interface(handle, 0);
-    libusb_close(handle);
-    libusb_exit(ctx);
+    gip_device_close(dev);
     
     printf("✅ Done!\n");
     return 0;
@@ -0,0 +1,252 @@
+// playback.c
+// Timed capture playback (see playback.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "playback.h"
+
+// Long waits are slept in slices so a stop request is noticed promptly
+#define MAX_SLEEP_NS    100000000ull
+
+// Pause between passes when the capture has a single packet
+#define DEFAULT_LOOP_GAP_NS 4000000ull
+
+static uint64_t playback_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static bool keep_running(const PlaybackOptions *options) {
+    return !options->running || *options->running;
+}
+
+// Sleep to spin_ns short of deadline_ns, then spin. Returns the time the
+// wait ended, or 0 if playback was stopped meanwhile.
+static uint64_t wait_until(const PlaybackOptions *options, uint64_t deadline_ns) {
+    uint64_t spin_ns = (uint64_t)options->spin_us * 1000;
+    uint64_t now = playback_clock_ns();
+
+    while (keep_running(options) && now + spin_ns < deadline_ns) {
+        uint64_t wake = deadline_ns - spin_ns;
+        if (wake - now > MAX_SLEEP_NS) {
+            wake = now + MAX_SLEEP_NS;
+        }
+#if defined(__linux__)
+        struct timespec ts = { (time_t)(wake / 1000000000ull), (long)(wake % 1000000000ull) };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+#else
+        // No absolute sleep on macOS; the spin absorbs the difference
+        uint64_t ns = wake - now;
+        struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+        nanosleep(&ts, NULL);
+#endif
+        now = playback_clock_ns();
+    }
+    if (!keep_running(options)) {
+        return 0;
+    }
+    while (now < deadline_ns) {
+        cpu_relax();
+        now = playback_clock_ns();
+    }
+    return now;
+}
+
+static void record_late(PlaybackStats *stats, uint64_t ns) {
+    int bucket = 0;
+    while (bucket < 39 && (ns >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    stats->late_buckets[bucket]++;
+    stats->late_total_ns += ns;
+    if (ns > stats->late_max_ns) {
+        stats->late_max_ns = ns;
+    }
+    stats->late_over_1ms += ns > 1000000;
+}
+
+// ============================================================================
+// Loading
+// ============================================================================
+
+bool playback_load(Playback *playback, const char *path, char *error, int error_size) {
+    CaptureReader reader;
+    CaptureRecord record;
+    int capacity = 0;
+    int result;
+
+    memset(playback, 0, sizeof(*playback));
+    if (!capture_reader_open(&reader, path)) {
+        snprintf(error, error_size, "%s is not a capture file", path);
+        return false;
+    }
+    memcpy(playback->serial, reader.header.serial, sizeof(playback->serial));
+    playback->serial[sizeof(playback->serial) - 1] = '\0';
+
+    uint64_t first_ns = 0;
+    while ((result = capture_read(&reader, &record)) == 1) {
+        if (record.direction != CAPTURE_DIR_IN) {
+            continue;
+        }
+        if (playback->count == capacity) {
+            capacity = capacity ? capacity * 2 : 4096;
+            void *data = realloc(playback->data, capacity * sizeof(*playback->data));
+            void *length = realloc(playback->length, capacity * sizeof(*playback->length));
+            void *timestamp = realloc(playback->timestamp_ns, capacity * sizeof(*playback->timestamp_ns));
+            if (data) playback->data = data;
+            if (length) playback->length = length;
+            if (timestamp) playback->timestamp_ns = timestamp;
+            if (!data || !length || !timestamp) {
+                snprintf(error, error_size, "out of memory loading %s", path);
+                capture_reader_close(&reader);
+                playback_free(playback);
+                return false;
+            }
+        }
+        if (playback->count == 0) {
+            first_ns = record.timestamp_ns;
+        }
+        int i = playback->count++;
+        memcpy(playback->data[i], record.data, record.length);
+        playback->length[i] = (uint16_t)record.length;
+        // Timestamps only go forwards; clamp any that don't so deadlines do
+        uint64_t t = record.timestamp_ns > first_ns ? record.timestamp_ns - first_ns : 0;
+        playback->timestamp_ns[i] = i > 0 && t < playback->timestamp_ns[i - 1] ? playback->timestamp_ns[i - 1] : t;
+    }
+    capture_reader_close(&reader);
+
+    if (result < 0) {
+        snprintf(error, error_size, "%s is corrupt after %d packets", path, playback->count);
+        playback_free(playback);
+        return false;
+    }
+    if (playback->count == 0) {
+        snprintf(error, error_size, "%s has no input packets", path);
+        playback_free(playback);
+        return false;
+    }
+
+    // Next pass starts one average packet interval after the last packet
+    playback->duration_ns = playback->timestamp_ns[playback->count - 1];
+    playback->loop_gap_ns = playback->count > 1 ? playback->duration_ns / (playback->count - 1)
+                                                : DEFAULT_LOOP_GAP_NS;
+    return true;
+}
+
+void playback_free(Playback *playback) {
+    free(playback->data);
+    free(playback->length);
+    free(playback->timestamp_ns);
+    playback->data = NULL;
+    playback->length = NULL;
+    playback->timestamp_ns = NULL;
+    playback->count = 0;
+}
+
+// ============================================================================
+// Playback
+// ============================================================================
+
+// One pass through the capture starting at pass_start. false if stopped.
+static bool play_pass(const Playback *playback, const PlaybackOptions *options, const PlaybackSink *sink,
+                      uint64_t pass_start, double scale, uint64_t *next_tick, PlaybackStats *stats) {
+    for (int i = 0; i < playback->count; i++) {
+        uint64_t deadline = pass_start + (uint64_t)(playback->timestamp_ns[i] * scale);
+
+        // Read-timeout ticks in the gaps, as the live input loop would get them
+        while (sink->tick && *next_tick && *next_tick < deadline) {
+            uint64_t now = wait_until(options, *next_tick);
+            if (!now) {
+                return false;
+            }
+            sink->tick(sink->user, now);
+            *next_tick += options->tick_ns;
+        }
+
+        uint64_t now = wait_until(options, deadline);
+        if (!now) {
+            return false;
+        }
+        record_late(stats, now - deadline);
+        sink->packet(sink->user, playback->data[i], playback->length[i], now);
+        stats->packets++;
+        *next_tick = options->tick_ns ? deadline + options->tick_ns : 0;
+    }
+    return true;
+}
+
+bool playback_run(const Playback *playback, const PlaybackOptions *options,
+                  const PlaybackSink *sink, PlaybackStats *stats) {
+    double scale = options->speed > 0 ? 1.0 / options->speed : 1.0;
+    uint64_t pass_ns = (uint64_t)((playback->duration_ns + playback->loop_gap_ns) * scale);
+    uint64_t start = playback_clock_ns();
+    uint64_t next_tick = 0;
+    bool finished = true;
+
+    memset(stats, 0, sizeof(*stats));
+
+    // Every pass is scheduled from the same start, so loops don't drift either
+    for (int pass = 0; options->loops == 0 || pass < options->loops; pass++) {
+        if (!play_pass(playback, options, sink, start + (uint64_t)pass * pass_ns, scale, &next_tick, stats)) {
+            finished = false;
+            break;
+        }
+        stats->loops++;
+    }
+    stats->elapsed_ns = playback_clock_ns() - start;
+    return finished;
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+uint64_t playback_late_percentile(const PlaybackStats *stats, double percentile) {
+    uint64_t target = (uint64_t)(stats->packets * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < 40; i++) {
+        seen += stats->late_buckets[i];
+        if (seen > target) {
+            return 2ull << i;
+        }
+    }
+    return stats->late_max_ns;
+}
+
+void playback_print_stats(const PlaybackStats *stats) {
+    printf("Playback: %llu packets, %d full passes in %.1f s\n", (unsigned long long)stats->packets,
+           stats->loops, stats->elapsed_ns / 1e9);
+    if (stats->packets == 0) {
+        return;
+    }
+    printf("  Timing error (packet sent - deadline): mean %.1f us, p50 < %.1f us, p99 < %.1f us, "
+           "max %.1f us, %llu over 1 ms\n",
+           stats->late_total_ns / (double)stats->packets / 1000.0,
+           playback_late_percentile(stats, 50) / 1000.0, playback_late_percentile(stats, 99) / 1000.0,
+           stats->late_max_ns / 1000.0, (unsigned long long)stats->late_over_1ms);
+    // Everything under a microsecond is one row: that is the spin doing its job
+    uint64_t under_1us = 0;
+    for (int i = 0; i < 10; i++) {
+        under_1us += stats->late_buckets[i];
+    }
+    printf("    < %9.1f us  %10llu  %5.1f%%\n", 1.0, (unsigned long long)under_1us,
+           100.0 * under_1us / stats->packets);
+    for (int i = 10; i < 40; i++) {
+        if (stats->late_buckets[i]) {
+            printf("    < %9.1f us  %10llu  %5.1f%%\n", (2ull << i) / 1000.0,
+                   (unsigned long long)stats->late_buckets[i],
+                   100.0 * stats->late_buckets[i] / stats->packets);
+        }
+    }
+}
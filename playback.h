@@ -0,0 +1,75 @@
+// playback.h
+// Timed playback of captures into a live pipeline (part of libgip)
+//
+// Hands each IN packet of a capture to a callback at the moment it arrived
+// in the original session, so a recorded session can drive the real outputs
+// without the controller. Deadlines are absolute (start + capture time /
+// speed), never "previous packet + gap": a late packet costs that packet
+// only and the error does not add up over a long session. Each wait sleeps
+// to just short of the deadline and spins the rest, and how late every
+// packet actually went out is kept in a log2 histogram.
+//
+// The whole capture is decoded up front, so no disk reads happen between
+// deadlines. Between packets further apart than tick_ns the tick callback
+// runs on the same schedule as the live input loop's read timeouts.
+
+#ifndef PLAYBACK_H
+#define PLAYBACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "capture.h"
+
+#define PLAYBACK_DEFAULT_SPIN_US    200
+
+typedef struct {
+    double speed;               // 2.0 = twice as fast
+    int loops;                  // Times through the capture; 0 = until stopped
+    unsigned spin_us;           // Spin (not sleep) this close to a deadline
+    uint64_t tick_ns;           // 0 = no ticks
+    const volatile int *running;     // Cleared (e.g. by a signal handler) to stop; may be NULL
+} PlaybackOptions;
+
+#define PLAYBACK_DEFAULT_OPTIONS { .speed = 1.0, .loops = 1, .spin_us = PLAYBACK_DEFAULT_SPIN_US }
+
+typedef struct {
+    // Called at the packet's deadline; now_ns is CLOCK_MONOTONIC, as
+    // gip_device would have stamped it
+    void (*packet)(void *user, const uint8_t *data, int length, uint64_t now_ns);
+    void (*tick)(void *user, uint64_t now_ns);      // May be NULL
+    void *user;
+} PlaybackSink;
+
+typedef struct {
+    uint64_t packets;
+    int loops;                  // Completed passes
+    uint64_t late_buckets[40];  // Callback start - deadline, log2 ns buckets
+    uint64_t late_total_ns;
+    uint64_t late_max_ns;
+    uint64_t late_over_1ms;     // Packets that went out more than 1 ms late
+    uint64_t elapsed_ns;
+} PlaybackStats;
+
+typedef struct {
+    uint8_t (*data)[CAPTURE_MAX_PACKET];
+    uint16_t *length;
+    uint64_t *timestamp_ns;     // Relative to the first IN packet
+    int count;
+    uint64_t duration_ns;
+    uint64_t loop_gap_ns;       // Wait between the last packet and the next pass
+    char serial[32];            // From the capture header
+} Playback;
+
+// Load the IN packets of path (either capture version); false with a message
+bool playback_load(Playback *playback, const char *path, char *error, int error_size);
+void playback_free(Playback *playback);
+
+// Play until done or *running is cleared. Returns false if stopped early.
+bool playback_run(const Playback *playback, const PlaybackOptions *options,
+                  const PlaybackSink *sink, PlaybackStats *stats);
+
+// Upper bound of the log2 bucket holding the percentile of the lateness
+uint64_t playback_late_percentile(const PlaybackStats *stats, double percentile);
+void playback_print_stats(const PlaybackStats *stats);
+
+#endif // PLAYBACK_H
@@ -0,0 +1,160 @@
+// plugin_bench.c
+// Runs input plugins (xbox_plugin.h) over the packets of captures through
+// the same host the simulator uses, and reports each plugin's time per
+// packet, the host's own overhead (frame conversion, field masking, the
+// clock reads around every call) and calls over budget. Packets go through
+// once one at a time, as in the simulator, and once in batches.
+// Compile: make plugin_bench plugins/aim_curve.so plugins/turbo.so
+// Run: ./plugin_bench [--batch N] [--budget-ns N] --plugin FILE.so[:CONFIG]... FILE.xcap...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gip.h"
+#include "gip_protocol.h"
+#include "capture.h"
+#include "plugin_host.h"
+
+#define MIN_PACKETS         2000000     // Per run, so short corpora still time well
+#define DEFAULT_BATCH       32
+
+typedef struct {
+    XboxPluginFrame *frames;
+    int count;
+    int capacity;
+} FrameCorpus;
+
+static uint64_t bench_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Decoded input packets of path, appended to corpus
+static bool corpus_load(FrameCorpus *corpus, const char *path) {
+    CaptureReader reader;
+    CaptureRecord record;
+    int result;
+
+    if (!capture_reader_open(&reader, path)) {
+        printf("❌ %s is not a capture file\n", path);
+        return false;
+    }
+    while ((result = capture_read(&reader, &record)) == 1) {
+        const GipInputPacket *input = record.direction == CAPTURE_DIR_IN ?
+                                      gip_decode_input(record.data, record.length) : NULL;
+        if (!input) {
+            continue;
+        }
+        if (corpus->count == corpus->capacity) {
+            corpus->capacity = corpus->capacity ? corpus->capacity * 2 : 4096;
+            corpus->frames = realloc(corpus->frames, corpus->capacity * sizeof(XboxPluginFrame));
+            if (!corpus->frames) {
+                printf("❌ Out of memory loading %s\n", path);
+                capture_reader_close(&reader);
+                return false;
+            }
+        }
+        plugin_frame_from_input(input, record.timestamp_ns, &corpus->frames[corpus->count++]);
+    }
+    capture_reader_close(&reader);
+    if (result < 0) {
+        printf("⚠️  %s is corrupt, using the packets before the damage\n", path);
+    }
+    return true;
+}
+
+static void reset_stats(PluginHost *host) {
+    for (int p = 0; p < host->count; p++) {
+        memset(&host->plugins[p].stats, 0, sizeof(host->plugins[p].stats));
+    }
+}
+
+// Whole corpus in batches of batch until MIN_PACKETS went through. Frames
+// are copied fresh for every batch since plugins rewrite them.
+static void run(PluginHost *host, const FrameCorpus *corpus, int batch) {
+    XboxPluginFrame work[PLUGIN_MAX_BATCH];
+    uint64_t packets = 0, plugin_ns = 0;
+    uint64_t timeline_ns = 0;
+
+    reset_stats(host);
+    uint64_t start = bench_clock_ns();
+    while (packets < MIN_PACKETS) {
+        // Later passes continue the timeline, so time-based plugins keep going
+        uint64_t pass_ns = corpus->frames[corpus->count - 1].timestamp_ns + 4000000;
+        for (int i = 0; i < corpus->count; i += batch) {
+            int n = corpus->count - i < batch ? corpus->count - i : batch;
+            memcpy(work, &corpus->frames[i], n * sizeof(XboxPluginFrame));
+            for (int j = 0; j < n; j++) {
+                work[j].timestamp_ns += timeline_ns;
+            }
+            plugin_ns += plugin_host_process(host, work, n);
+        }
+        packets += corpus->count;
+        timeline_ns += pass_ns;
+    }
+    uint64_t elapsed = bench_clock_ns() - start;
+
+    printf("\n📈 Batches of %d: %llu packets, %.1f ns/packet total, %.1f in plugins, %.1f host overhead\n",
+           batch, (unsigned long long)packets, elapsed / (double)packets, plugin_ns / (double)packets,
+           (elapsed - plugin_ns) / (double)packets);
+    plugin_host_print_stats(host);
+    plugin_host_report_overruns(host);
+}
+
+int main(int argc, char **argv) {
+    static PluginHost host;
+    FrameCorpus corpus = { 0 };
+    const char *specs[PLUGIN_MAX];
+    int plugin_count = 0;
+    uint64_t budget_ns = PLUGIN_DEFAULT_BUDGET_NS;
+    int batch = DEFAULT_BATCH;
+    int files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--budget-ns") == 0 && i + 1 < argc) {
+            budget_ns = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--plugin") == 0 && i + 1 < argc && plugin_count < PLUGIN_MAX) {
+            specs[plugin_count++] = argv[++i];
+        } else if (argv[i][0] == '-' || !corpus_load(&corpus, argv[i])) {
+            printf("Usage: %s [--batch N] [--budget-ns N] --plugin FILE.so[:CONFIG]... FILE.xcap...\n",
+                   argv[0]);
+            return 1;
+        } else {
+            files++;
+        }
+    }
+    if (plugin_count == 0 || corpus.count == 0 || batch < 1 || batch > PLUGIN_MAX_BATCH) {
+        printf("Usage: %s [--batch N] [--budget-ns N] --plugin FILE.so[:CONFIG]... FILE.xcap...\n"
+               "       (batch 1-%d, at least one plugin and one capture with input)\n",
+               argv[0], PLUGIN_MAX_BATCH);
+        return 1;
+    }
+
+    if (!plugin_host_init(&host, PLUGIN_DEFAULT_ARENA_SIZE)) {
+        printf("❌ Could not allocate the plugin arena\n");
+        return 1;
+    }
+    for (int i = 0; i < plugin_count; i++) {
+        char error[512];
+        if (!plugin_host_load_spec(&host, specs[i], budget_ns, error, sizeof(error))) {
+            printf("❌ %s\n", error);
+            return 1;
+        }
+        printf("✅ Loaded [%s] from %s\n", host.plugins[i].plugin->name, host.plugins[i].path);
+    }
+
+    printf("%d input packets from %d capture%s, budget %.2f us per packet per plugin\n", corpus.count,
+           files, files == 1 ? "" : "s", budget_ns / 1000.0);
+    run(&host, &corpus, 1);
+    if (batch > 1) {
+        run(&host, &corpus, batch);
+    }
+
+    plugin_host_destroy(&host);
+    free(corpus.frames);
+    return 0;
+}
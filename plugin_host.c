@@ -0,0 +1,296 @@
+// plugin_host.c
+// Input plugin loading and the per-batch plugin chain (see plugin_host.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include "plugin_host.h"
+
+// The frame layout is part of the ABI
+_Static_assert(sizeof(XboxPluginFrame) == 24, "XboxPluginFrame layout changed; bump XBOX_PLUGIN_ABI_VERSION");
+
+// Descriptors older than this (by struct_size) predate fields we need
+#define PLUGIN_MIN_STRUCT_SIZE  (offsetof(XboxPlugin, destroy) + sizeof(void (*)(void *)))
+
+static uint64_t plugin_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static size_t align_up(size_t n) {
+    return (n + PLUGIN_STATE_ALIGN - 1) & ~(size_t)(PLUGIN_STATE_ALIGN - 1);
+}
+
+const char *plugin_pipeline_name(uint32_t pipeline) {
+    switch (pipeline) {
+        case XBOX_PLUGIN_ANALOG:                        return "analog";
+        case XBOX_PLUGIN_BUTTONS:                       return "buttons";
+        case XBOX_PLUGIN_ANALOG | XBOX_PLUGIN_BUTTONS:  return "analog+buttons";
+        default:                                        return "none";
+    }
+}
+
+// ============================================================================
+// Loading
+// ============================================================================
+
+bool plugin_host_init(PluginHost *host, size_t arena_size) {
+    void *arena = NULL;
+    size_t scratch_size = align_up(PLUGIN_MAX_BATCH * sizeof(XboxPluginFrame));
+
+    memset(host, 0, sizeof(*host));
+    arena_size = align_up(arena_size + scratch_size);
+    if (posix_memalign(&arena, PLUGIN_STATE_ALIGN, arena_size) != 0) {
+        return false;
+    }
+    memset(arena, 0, arena_size);
+    host->arena = arena;
+    host->arena_size = arena_size;
+    host->scratch = arena;
+    host->arena_used = scratch_size;
+    return true;
+}
+
+bool plugin_host_load(PluginHost *host, const char *path, const char *config, uint64_t budget_ns,
+                      char *error, int error_size) {
+    if (host->count == PLUGIN_MAX) {
+        snprintf(error, error_size, "at most %d plugins", PLUGIN_MAX);
+        return false;
+    }
+
+    // A bare file name would be looked up on the library path, not here
+    char local[sizeof(((LoadedPlugin *)0)->path) + 2];
+    snprintf(local, sizeof(local), "%s%s", strchr(path, '/') ? "" : "./", path);
+    void *handle = dlopen(local, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        snprintf(error, error_size, "%s", dlerror());
+        return false;
+    }
+    XboxPluginEntry entry = (XboxPluginEntry)dlsym(handle, XBOX_PLUGIN_ENTRY_NAME);
+    if (!entry) {
+        snprintf(error, error_size, "%s is not a plugin (no %s)", path, XBOX_PLUGIN_ENTRY_NAME);
+        dlclose(handle);
+        return false;
+    }
+
+    const XboxPlugin *plugin = entry(XBOX_PLUGIN_ABI_VERSION);
+    if (!plugin) {
+        snprintf(error, error_size, "%s does not support plugin ABI v%d", path, XBOX_PLUGIN_ABI_VERSION);
+        dlclose(handle);
+        return false;
+    }
+    if (plugin->abi_version != XBOX_PLUGIN_ABI_VERSION || plugin->struct_size < PLUGIN_MIN_STRUCT_SIZE) {
+        snprintf(error, error_size, "%s was built for plugin ABI v%u, this driver is v%d; rebuild it",
+                 path, plugin->abi_version, XBOX_PLUGIN_ABI_VERSION);
+        dlclose(handle);
+        return false;
+    }
+    if (!plugin->name || !plugin->init || !plugin->process_batch ||
+        plugin->pipeline == 0 || (plugin->pipeline & ~(XBOX_PLUGIN_ANALOG | XBOX_PLUGIN_BUTTONS))) {
+        snprintf(error, error_size, "%s has an incomplete descriptor (name, init, process_batch and pipeline are required)",
+                 path);
+        dlclose(handle);
+        return false;
+    }
+
+    // State is carved from the arena; a failed init gives it back
+    size_t state_size = align_up(plugin->state_size);
+    if (state_size > host->arena_size - host->arena_used) {
+        snprintf(error, error_size, "%s needs %u bytes of state, %zu left in the plugin arena", path,
+                 plugin->state_size, host->arena_size - host->arena_used);
+        dlclose(handle);
+        return false;
+    }
+    void *state = host->arena + host->arena_used;
+    memset(state, 0, state_size);
+
+    int status = plugin->init(state, config ? config : "");
+    if (status != 0) {
+        snprintf(error, error_size, "%s: init failed (%d)", plugin->name, status);
+        dlclose(handle);
+        return false;
+    }
+    host->arena_used += state_size;
+
+    LoadedPlugin *loaded = &host->plugins[host->count++];
+    memset(loaded, 0, sizeof(*loaded));
+    loaded->handle = handle;
+    loaded->plugin = plugin;
+    snprintf(loaded->path, sizeof(loaded->path), "%s", path);
+    loaded->state = state;
+    loaded->keep = plugin->pipeline;
+    loaded->budget_ns = budget_ns;
+    return true;
+}
+
+bool plugin_host_load_spec(PluginHost *host, const char *spec, uint64_t budget_ns,
+                           char *error, int error_size) {
+    char path[sizeof(((LoadedPlugin *)0)->path)];
+    const char *slash = strrchr(spec, '/');
+    const char *colon = strchr(slash ? slash : spec, ':');
+    int length = colon ? (int)(colon - spec) : (int)strlen(spec);
+
+    if (length >= (int)sizeof(path)) {
+        snprintf(error, error_size, "plugin path too long");
+        return false;
+    }
+    snprintf(path, sizeof(path), "%.*s", length, spec);
+    return plugin_host_load(host, path, colon ? colon + 1 : "", budget_ns, error, error_size);
+}
+
+void plugin_host_destroy(PluginHost *host) {
+    while (host->count > 0) {
+        LoadedPlugin *loaded = &host->plugins[--host->count];
+        if (loaded->plugin->destroy) {
+            loaded->plugin->destroy(loaded->state);
+        }
+        dlclose(loaded->handle);
+    }
+    free(host->arena);
+    host->arena = NULL;
+    host->scratch = NULL;
+    host->arena_size = 0;
+    host->arena_used = 0;
+}
+
+// ============================================================================
+// Processing
+// ============================================================================
+
+// GIP swaps the stick axes and the triggers; frames are player-facing
+void plugin_frame_from_input(const GipInputPacket *input, uint64_t now_ns, XboxPluginFrame *frame) {
+    frame->timestamp_ns = now_ns;
+    frame->buttons = input->buttons;
+    frame->left_trigger = input->right_trigger;
+    frame->right_trigger = input->left_trigger;
+    frame->left_x = input->left_stick_y;
+    frame->left_y = input->left_stick_x;
+    frame->right_x = input->right_stick_y;
+    frame->right_y = input->right_stick_x;
+    frame->reserved = 0;
+}
+
+void plugin_frame_to_input(const XboxPluginFrame *frame, GipInputPacket *input) {
+    input->buttons = frame->buttons;
+    input->left_trigger = frame->right_trigger;
+    input->right_trigger = frame->left_trigger;
+    input->left_stick_x = frame->left_y;
+    input->left_stick_y = frame->left_x;
+    input->right_stick_x = frame->right_y;
+    input->right_stick_y = frame->right_x;
+}
+
+// Put back whatever the plugin wasn't allowed to change
+static void restrict_changes(const XboxPluginFrame *before, XboxPluginFrame *after, uint32_t count,
+                             uint32_t keep) {
+    for (uint32_t i = 0; i < count; i++) {
+        XboxPluginFrame frame = before[i];
+        if (keep & XBOX_PLUGIN_BUTTONS) {
+            frame.buttons = after[i].buttons;
+        }
+        if (keep & XBOX_PLUGIN_ANALOG) {
+            frame.left_trigger = after[i].left_trigger;
+            frame.right_trigger = after[i].right_trigger;
+            frame.left_x = after[i].left_x;
+            frame.left_y = after[i].left_y;
+            frame.right_x = after[i].right_x;
+            frame.right_y = after[i].right_y;
+        }
+        after[i] = frame;
+    }
+}
+
+static void record_call(LoadedPlugin *loaded, uint64_t ns, uint32_t count) {
+    PluginStats *stats = &loaded->stats;
+    uint64_t per_frame = ns / count;
+    int bucket = 0;
+    while (bucket < 39 && (per_frame >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    stats->buckets[bucket] += count;
+    stats->calls++;
+    stats->frames += count;
+    stats->total_ns += ns;
+    if (ns > stats->max_ns) {
+        stats->max_ns = ns;
+    }
+    stats->overruns += loaded->budget_ns && ns > loaded->budget_ns * count;
+}
+
+uint64_t plugin_host_process(PluginHost *host, XboxPluginFrame *frames, int count) {
+    uint64_t total = 0;
+
+    while (count > 0) {
+        uint32_t batch = count < PLUGIN_MAX_BATCH ? (uint32_t)count : PLUGIN_MAX_BATCH;
+        for (int p = 0; p < host->count; p++) {
+            LoadedPlugin *loaded = &host->plugins[p];
+            memcpy(host->scratch, frames, batch * sizeof(XboxPluginFrame));
+
+            uint64_t start = plugin_clock_ns();
+            loaded->plugin->process_batch(loaded->state, frames, batch);
+            uint64_t ns = plugin_clock_ns() - start;
+
+            restrict_changes(host->scratch, frames, batch, loaded->keep);
+            record_call(loaded, ns, batch);
+            total += ns;
+        }
+        frames += batch;
+        count -= batch;
+    }
+    return total;
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+uint64_t plugin_host_report_overruns(PluginHost *host) {
+    uint64_t reported = 0;
+    for (int p = 0; p < host->count; p++) {
+        LoadedPlugin *loaded = &host->plugins[p];
+        PluginStats *stats = &loaded->stats;
+        uint64_t fresh = stats->overruns - stats->overruns_reported;
+        if (fresh == 0) {
+            continue;
+        }
+        printf("\n⚠️  Plugin [%s] went over its %.2f us budget on %llu more call%s "
+               "(%llu of %llu so far, slowest %.1f us)\n",
+               loaded->plugin->name, loaded->budget_ns / 1000.0, (unsigned long long)fresh,
+               fresh == 1 ? "" : "s", (unsigned long long)stats->overruns,
+               (unsigned long long)stats->calls, stats->max_ns / 1000.0);
+        stats->overruns_reported = stats->overruns;
+        reported += fresh;
+    }
+    return reported;
+}
+
+uint64_t plugin_stats_percentile(const PluginStats *stats, double percentile) {
+    uint64_t target = (uint64_t)(stats->frames * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < 40; i++) {
+        seen += stats->buckets[i];
+        if (seen > target) {
+            return 2ull << i;
+        }
+    }
+    return stats->max_ns;
+}
+
+void plugin_host_print_stats(const PluginHost *host) {
+    printf("Plugins (%zu of %zu arena bytes used):\n", host->arena_used, host->arena_size);
+    printf("  %-20s %-14s %10s %9s %9s %9s %9s %9s\n", "plugin", "pipeline", "packets", "mean ns",
+           "p50 <ns", "p99 <ns", "max us", "overruns");
+    for (int p = 0; p < host->count; p++) {
+        const LoadedPlugin *loaded = &host->plugins[p];
+        const PluginStats *stats = &loaded->stats;
+        printf("  %-20s %-14s %10llu %9.1f %9llu %9llu %9.1f %9llu\n", loaded->plugin->name,
+               plugin_pipeline_name(loaded->keep), (unsigned long long)stats->frames,
+               stats->frames ? stats->total_ns / (double)stats->frames : 0.0,
+               (unsigned long long)(stats->frames ? plugin_stats_percentile(stats, 50) : 0),
+               (unsigned long long)(stats->frames ? plugin_stats_percentile(stats, 99) : 0),
+               stats->max_ns / 1000.0, (unsigned long long)stats->overruns);
+    }
+}
@@ -0,0 +1,116 @@
+// plugin_host.h
+// Loads input plugins (xbox_plugin.h) and runs them ahead of the mapper
+//
+// Plugins are loaded once at startup, in order, and run as a chain over
+// each batch of decoded input frames before it reaches mapper_process().
+// One arena is allocated when the host is created: every plugin's state
+// block and the host's scratch frames come out of it, so nothing is
+// allocated once input is flowing. Plugins can't be unloaded individually;
+// plugin_host_destroy() calls every destroy and dlcloses in reverse order.
+//
+// Every process_batch call is timed (CLOCK_MONOTONIC around the call, two
+// clock reads per plugin per batch). Calls that take longer than the
+// plugin's budget times the batch size are counted as overruns;
+// plugin_host_report_overruns() prints the ones not yet reported.
+//
+//   PluginHost host;
+//   plugin_host_init(&host, PLUGIN_DEFAULT_ARENA_SIZE);
+//   plugin_host_load(&host, "plugins/aim_curve.so", "exponent=2.2", budget_ns, error, sizeof(error));
+//   plugin_host_process_packet(&host, &input, now_ns);    // per packet, before the mapper
+//   plugin_host_report_overruns(&host);                   // now and then, off the hot path
+//   plugin_host_destroy(&host);
+
+#ifndef PLUGIN_HOST_H
+#define PLUGIN_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "gip.h"
+#include "xbox_plugin.h"
+
+#define PLUGIN_MAX                  8
+#define PLUGIN_MAX_BATCH            64
+#define PLUGIN_DEFAULT_ARENA_SIZE   (64 * 1024)
+#define PLUGIN_DEFAULT_BUDGET_NS    20000   // Per packet, per plugin
+#define PLUGIN_STATE_ALIGN          64
+
+typedef struct {
+    uint64_t calls;
+    uint64_t frames;
+    uint64_t total_ns;
+    uint64_t max_ns;            // Slowest call
+    uint64_t buckets[40];       // ns per frame, log2 buckets
+    uint64_t overruns;          // Calls over budget_ns * frames
+    uint64_t overruns_reported;
+} PluginStats;
+
+typedef struct {
+    void *handle;               // dlopen
+    const XboxPlugin *plugin;
+    char path[256];
+    void *state;                // In the host's arena
+    uint32_t keep;              // XBOX_PLUGIN_* fields this plugin may change
+    uint64_t budget_ns;         // Per frame; 0 = no budget
+    PluginStats stats;
+} LoadedPlugin;
+
+typedef struct {
+    uint8_t *arena;
+    size_t arena_size;
+    size_t arena_used;
+    XboxPluginFrame *scratch;   // PLUGIN_MAX_BATCH frames: input to the current plugin
+    int count;
+    LoadedPlugin plugins[PLUGIN_MAX];
+} PluginHost;
+
+// Allocates the arena. False if it can't.
+bool plugin_host_init(PluginHost *host, size_t arena_size);
+
+// dlopen path, check its ABI version, reserve its state and call init.
+// False with a message (and nothing loaded) on any failure.
+bool plugin_host_load(PluginHost *host, const char *path, const char *config, uint64_t budget_ns,
+                      char *error, int error_size);
+
+// Same, from "FILE.so[:CONFIG]" as given on the command line; the config
+// starts at the first ':' after the last '/'
+bool plugin_host_load_spec(PluginHost *host, const char *spec, uint64_t budget_ns,
+                           char *error, int error_size);
+
+// Destroys and unloads every plugin, then frees the arena
+void plugin_host_destroy(PluginHost *host);
+
+// Run every plugin over frames[0..count-1] in order, in batches of at most
+// PLUGIN_MAX_BATCH. Returns the time spent in plugins.
+uint64_t plugin_host_process(PluginHost *host, XboxPluginFrame *frames, int count);
+
+// Packets ↔ frames
+void plugin_frame_from_input(const GipInputPacket *input, uint64_t now_ns, XboxPluginFrame *frame);
+void plugin_frame_to_input(const XboxPluginFrame *frame, GipInputPacket *input);
+
+// One packet through the chain; input is rewritten in place. Returns the
+// time spent in plugins (0, and no work, without any).
+static inline uint64_t plugin_host_process_packet(PluginHost *host, GipInputPacket *input, uint64_t now_ns) {
+    XboxPluginFrame frame;
+    uint64_t ns;
+    if (host->count == 0) {
+        return 0;
+    }
+    plugin_frame_from_input(input, now_ns, &frame);
+    ns = plugin_host_process(host, &frame, 1);
+    plugin_frame_to_input(&frame, input);
+    return ns;
+}
+
+// Print a warning for every plugin with overruns since the last call.
+// Returns how many new overruns were reported.
+uint64_t plugin_host_report_overruns(PluginHost *host);
+
+// "analog", "buttons" or "analog+buttons"
+const char *plugin_pipeline_name(uint32_t pipeline);
+
+// Upper bound of the log2 bucket holding the percentile of ns per frame
+uint64_t plugin_stats_percentile(const PluginStats *stats, double percentile);
+void plugin_host_print_stats(const PluginHost *host);
+
+#endif // PLUGIN_HOST_H
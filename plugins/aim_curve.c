@@ -0,0 +1,117 @@
+// aim_curve.c
+// Example analog plugin: radial response curve with anti-deadzone, for games
+// whose own stick handling is too linear or swallows small movements
+//
+// Reshapes the distance from center of one or both sticks, keeping the
+// direction: out = anti + (1 - anti) * in^exponent, where in is the
+// deflection past `inner` and anti is the game's own deadzone, so the
+// slightest push already moves the crosshair in game.
+// Compile: make plugins/aim_curve.so
+// Run: ./simulator --plugin plugins/aim_curve.so:exponent=1.8,anti_deadzone=0.12,stick=right
+//      exponent       0.2-5.0 (default 1.5)
+//      anti_deadzone  0.0-0.9, fraction of full deflection (default 0)
+//      inner          0.0-0.9, ignored near center (default 0.05)
+//      stick          left, right or both (default right)
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../xbox_plugin.h"
+
+typedef struct {
+    float exponent;
+    float anti_deadzone;
+    float inner;
+    int left;
+    int right;
+} AimCurve;
+
+// "key=value,key=value"; unknown keys or bad values fail init
+static int parse_config(AimCurve *curve, const char *config) {
+    char copy[256];
+    char *save = NULL;
+
+    strncpy(copy, config, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+    for (char *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(item, '=');
+        if (!value) {
+            return 1;
+        }
+        *value++ = '\0';
+        if (strcmp(item, "exponent") == 0) {
+            curve->exponent = strtof(value, NULL);
+        } else if (strcmp(item, "anti_deadzone") == 0) {
+            curve->anti_deadzone = strtof(value, NULL);
+        } else if (strcmp(item, "inner") == 0) {
+            curve->inner = strtof(value, NULL);
+        } else if (strcmp(item, "stick") == 0) {
+            curve->left = strcmp(value, "left") == 0 || strcmp(value, "both") == 0;
+            curve->right = strcmp(value, "right") == 0 || strcmp(value, "both") == 0;
+            if (!curve->left && !curve->right) {
+                return 2;
+            }
+        } else {
+            return 3;
+        }
+    }
+    if (!(curve->exponent >= 0.2f && curve->exponent <= 5.0f) ||
+        !(curve->anti_deadzone >= 0.0f && curve->anti_deadzone <= 0.9f) ||
+        !(curve->inner >= 0.0f && curve->inner <= 0.9f)) {
+        return 4;
+    }
+    return 0;
+}
+
+static int aim_curve_init(void *state, const char *config) {
+    AimCurve *curve = state;
+    curve->exponent = 1.5f;
+    curve->anti_deadzone = 0.0f;
+    curve->inner = 0.05f;
+    curve->left = 0;
+    curve->right = 1;
+    return parse_config(curve, config);
+}
+
+static void reshape(const AimCurve *curve, int16_t *x, int16_t *y) {
+    float fx = *x / 32767.0f;
+    float fy = *y / 32767.0f;
+    float r = sqrtf(fx * fx + fy * fy);
+    if (r <= curve->inner) {
+        *x = 0;
+        *y = 0;
+        return;
+    }
+    float in = (fminf(r, 1.0f) - curve->inner) / (1.0f - curve->inner);
+    float out = curve->anti_deadzone + (1.0f - curve->anti_deadzone) * powf(in, curve->exponent);
+    float scale = out / r * 32767.0f;
+    *x = (int16_t)fmaxf(-32767.0f, fminf(32767.0f, fx * scale));
+    *y = (int16_t)fmaxf(-32767.0f, fminf(32767.0f, fy * scale));
+}
+
+static void aim_curve_process(void *state, XboxPluginFrame *frames, uint32_t count) {
+    const AimCurve *curve = state;
+    for (uint32_t i = 0; i < count; i++) {
+        if (curve->left) {
+            reshape(curve, &frames[i].left_x, &frames[i].left_y);
+        }
+        if (curve->right) {
+            reshape(curve, &frames[i].right_x, &frames[i].right_y);
+        }
+    }
+}
+
+static const XboxPlugin plugin = {
+    .abi_version = XBOX_PLUGIN_ABI_VERSION,
+    .struct_size = sizeof(XboxPlugin),
+    .name = "aim_curve",
+    .pipeline = XBOX_PLUGIN_ANALOG,
+    .state_size = sizeof(AimCurve),
+    .init = aim_curve_init,
+    .process_batch = aim_curve_process,
+    .destroy = NULL
+};
+
+const XboxPlugin *XBOX_PLUGIN_ENTRY(uint32_t host_abi_version) {
+    return host_abi_version == XBOX_PLUGIN_ABI_VERSION ? &plugin : NULL;
+}
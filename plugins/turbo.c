@@ -0,0 +1,118 @@
+// turbo.c
+// Example button plugin: rapid fire while a button is held
+//
+// Held buttons from the list are pulsed on and off at the given rate,
+// starting pressed. The timing comes from the frames' timestamps, so the
+// pattern is the same live and in replays. Plugins only run when a packet
+// arrives, so while nothing else on the pad changes a pulse edge waits for
+// the next packet.
+// Compile: make plugins/turbo.so
+// Run: ./simulator --plugin plugins/turbo.so:buttons=A+RB,rate=12
+//      buttons  A, B, X, Y, LB, RB, LS or RS joined with '+' (default A)
+//      rate     presses per second, 1-30 (default 10)
+
+#include <stdlib.h>
+#include <string.h>
+#include "../xbox_plugin.h"
+
+typedef struct {
+    uint16_t mask;
+    uint64_t half_period_ns;
+    uint64_t held_since_ns[16];     // Per button bit; 0 = not held
+} Turbo;
+
+static const struct {
+    const char *name;
+    uint16_t mask;
+} button_names[] = {
+    { "A", 0x0010 }, { "B", 0x0020 }, { "X", 0x0040 }, { "Y", 0x0080 },
+    { "LB", 0x1000 }, { "RB", 0x2000 }, { "LS", 0x4000 }, { "RS", 0x8000 },
+};
+
+static uint16_t parse_buttons(char *list) {
+    uint16_t mask = 0;
+    char *save = NULL;
+    for (char *name = strtok_r(list, "+", &save); name; name = strtok_r(NULL, "+", &save)) {
+        uint16_t bit = 0;
+        for (size_t i = 0; i < sizeof(button_names) / sizeof(button_names[0]); i++) {
+            if (strcmp(name, button_names[i].name) == 0) {
+                bit = button_names[i].mask;
+            }
+        }
+        if (!bit) {
+            return 0;
+        }
+        mask |= bit;
+    }
+    return mask;
+}
+
+static int turbo_init(void *state, const char *config) {
+    Turbo *turbo = state;
+    char copy[256];
+    char *save = NULL;
+    double rate = 10.0;
+
+    turbo->mask = 0x0010;
+    strncpy(copy, config, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+    for (char *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(item, '=');
+        if (!value) {
+            return 1;
+        }
+        *value++ = '\0';
+        if (strcmp(item, "buttons") == 0) {
+            turbo->mask = parse_buttons(value);
+        } else if (strcmp(item, "rate") == 0) {
+            rate = strtod(value, NULL);
+        } else {
+            return 2;
+        }
+    }
+    if (turbo->mask == 0 || !(rate >= 1.0 && rate <= 30.0)) {
+        return 3;
+    }
+    turbo->half_period_ns = (uint64_t)(500000000.0 / rate);
+    return 0;
+}
+
+static void turbo_process(void *state, XboxPluginFrame *frames, uint32_t count) {
+    Turbo *turbo = state;
+    for (uint32_t i = 0; i < count; i++) {
+        XboxPluginFrame *frame = &frames[i];
+        for (int bit = 0; bit < 16; bit++) {
+            uint16_t mask = (uint16_t)(1u << bit);
+            if (!(turbo->mask & mask)) {
+                continue;
+            }
+            if (!(frame->buttons & mask)) {
+                turbo->held_since_ns[bit] = 0;
+                continue;
+            }
+            if (turbo->held_since_ns[bit] == 0) {
+                turbo->held_since_ns[bit] = frame->timestamp_ns;
+            }
+            // Odd half-periods are the released half
+            uint64_t held = frame->timestamp_ns - turbo->held_since_ns[bit];
+            if ((held / turbo->half_period_ns) & 1) {
+                frame->buttons &= (uint16_t)~mask;
+            }
+        }
+    }
+}
+
+static const XboxPlugin plugin = {
+    .abi_version = XBOX_PLUGIN_ABI_VERSION,
+    .struct_size = sizeof(XboxPlugin),
+    .name = "turbo",
+    .pipeline = XBOX_PLUGIN_BUTTONS,
+    .state_size = sizeof(Turbo),
+    .init = turbo_init,
+    .process_batch = turbo_process,
+    .destroy = NULL
+};
+
+const XboxPlugin *XBOX_PLUGIN_ENTRY(uint32_t host_abi_version) {
+    return host_abi_version == XBOX_PLUGIN_ABI_VERSION ? &plugin : NULL;
+}
@@ -0,0 +1,66 @@
+// probes.h
+// USDT static probes for observing a running simulator with bpftrace/perf/dtrace
+//
+// Each probe compiles to a single nop plus a note in the binary; tools enable
+// it by patching the nop at runtime, so a running process can be traced
+// without restarting it. Without <sys/sdt.h> (or with -DXBOX_NO_PROBES) the
+// probes compile to nothing.
+//
+// Linux: install systemtap-sdt-dev (Debian/Ubuntu) or systemtap-sdt-devel
+// (Fedora) before building. List the probes with:
+//   sudo bpftrace -l 'usdt:./simulator:*'
+// macOS ships <sys/sdt.h>; the same probes are visible to dtrace as xbox*:::.
+//
+// Probe                        Arguments
+// xbox:packet_received         seq, length, completion time (ns, CLOCK_MONOTONIC)
+// xbox:packet_decoded          seq, command, buttons
+// xbox:binding_fired           OutputActionType, keycode/button, pressed
+// xbox:output_posted           seq, action count, completion → posted latency (ns)
+// xbox:handshake_state         GipHandshakeState, seq
+// xbox:disconnect              error code (GIP_ERROR_*)
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#if !defined(XBOX_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define XBOX_PROBES_ENABLED 1
+#endif
+#endif
+
+// Steps of the GIP handshake reported by xbox:handshake_state
+typedef enum {
+    GIP_HANDSHAKE_ANNOUNCE_RECEIVED = 1,
+    GIP_HANDSHAKE_ACK_SENT          = 2,
+    GIP_HANDSHAKE_POWER_ON_SENT     = 3,
+    GIP_HANDSHAKE_FAILED            = 4
+} GipHandshakeState;
+
+#ifdef XBOX_PROBES_ENABLED
+
+#define PROBE_PACKET_RECEIVED(seq, length, completion_ns) \
+    DTRACE_PROBE3(xbox, packet_received, seq, length, completion_ns)
+#define PROBE_PACKET_DECODED(seq, command, buttons) \
+    DTRACE_PROBE3(xbox, packet_decoded, seq, command, buttons)
+#define PROBE_BINDING_FIRED(type, code, pressed) \
+    DTRACE_PROBE3(xbox, binding_fired, type, code, pressed)
+#define PROBE_OUTPUT_POSTED(seq, count, latency_ns) \
+    DTRACE_PROBE3(xbox, output_posted, seq, count, latency_ns)
+#define PROBE_HANDSHAKE_STATE(state, seq) \
+    DTRACE_PROBE2(xbox, handshake_state, state, seq)
+#define PROBE_DISCONNECT(error) \
+    DTRACE_PROBE1(xbox, disconnect, error)
+
+#else
+
+#define PROBE_PACKET_RECEIVED(seq, length, completion_ns)   do { } while (0)
+#define PROBE_PACKET_DECODED(seq, command, buttons)         do { } while (0)
+#define PROBE_BINDING_FIRED(type, code, pressed)            do { } while (0)
+#define PROBE_OUTPUT_POSTED(seq, count, latency_ns)         do { } while (0)
+#define PROBE_HANDSHAKE_STATE(state, seq)                   do { } while (0)
+#define PROBE_DISCONNECT(error)                             do { } while (0)
+
+#endif
+
+#endif // PROBES_H
@@ -0,0 +1,992 @@
+// profile.c
+// Text profiles and compiled binary profile files (part of libmapper)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "profile.h"
+
+// ============================================================================
+// Text Profiles
+// ============================================================================
+
+typedef enum {
+    FIELD_KEY,
+    FIELD_STICK_MODE,
+    FIELD_TRIGGER_MODE,
+    FIELD_FLOAT,
+    FIELD_DEADZONE,
+    FIELD_THRESHOLD,
+    FIELD_BOOL,
+    FIELD_CHAIN
+} FieldType;
+
+typedef struct {
+    const char *name;
+    FieldType type;
+    size_t offset;              // Into ControllerMapping
+    float min, max;             // FIELD_FLOAT range
+} ProfileField;
+
+#define FIELD(name, type, member) { name, type, offsetof(ControllerMapping, member), 0, 0 }
+#define FLOAT_FIELD(name, member, min, max) \
+    { name, FIELD_FLOAT, offsetof(ControllerMapping, member), min, max }
+
+static const ProfileField profile_fields[] = {
+    FIELD("buttons.a",          FIELD_KEY, buttons.key_a),
+    FIELD("buttons.b",          FIELD_KEY, buttons.key_b),
+    FIELD("buttons.x",          FIELD_KEY, buttons.key_x),
+    FIELD("buttons.y",          FIELD_KEY, buttons.key_y),
+    FIELD("buttons.lb",         FIELD_KEY, buttons.key_lb),
+    FIELD("buttons.rb",         FIELD_KEY, buttons.key_rb),
+    FIELD("buttons.ls",         FIELD_KEY, buttons.key_ls),
+    FIELD("buttons.rs",         FIELD_KEY, buttons.key_rs),
+    FIELD("buttons.view",       FIELD_KEY, buttons.key_view),
+    FIELD("buttons.menu",       FIELD_KEY, buttons.key_menu),
+    FIELD("buttons.dpad_up",    FIELD_KEY, buttons.key_dpad_up),
+    FIELD("buttons.dpad_down",  FIELD_KEY, buttons.key_dpad_down),
+    FIELD("buttons.dpad_left",  FIELD_KEY, buttons.key_dpad_left),
+    FIELD("buttons.dpad_right", FIELD_KEY, buttons.key_dpad_right),
+
+    FIELD("left_stick.mode",    FIELD_STICK_MODE, sticks.left_stick_mode),
+    FIELD("left_stick.up",      FIELD_KEY, sticks.left_up),
+    FIELD("left_stick.down",    FIELD_KEY, sticks.left_down),
+    FIELD("left_stick.left",    FIELD_KEY, sticks.left_left),
+    FIELD("left_stick.right",   FIELD_KEY, sticks.left_right),
+    FIELD("right_stick.mode",   FIELD_STICK_MODE, sticks.right_stick_mode),
+    FIELD("right_stick.up",     FIELD_KEY, sticks.right_up),
+    FIELD("right_stick.down",   FIELD_KEY, sticks.right_down),
+    FIELD("right_stick.left",   FIELD_KEY, sticks.right_left),
+    FIELD("right_stick.right",  FIELD_KEY, sticks.right_right),
+    FIELD("left_stick.chain",   FIELD_CHAIN, sticks.left_chain),
+    FIELD("right_stick.chain",  FIELD_CHAIN, sticks.right_chain),
+
+    FLOAT_FIELD("mouse.sensitivity", sticks.mouse_sensitivity, 0.01f, 20.0f),
+    FLOAT_FIELD("mouse.curve",       sticks.mouse_curve, 0.1f, 5.0f),
+    FLOAT_FIELD("mouse.smoothing",   sticks.mouse_smoothing, 0.0f, 0.95f),
+    FLOAT_FIELD("kinetic.friction",  sticks.kinetic_friction, 0.1f, 50.0f),
+    FIELD("deadzone",           FIELD_DEADZONE, sticks.deadzone),
+
+    FIELD("left_trigger.mode",  FIELD_TRIGGER_MODE, triggers.left_trigger_mode),
+    FIELD("left_trigger.key",   FIELD_KEY, triggers.left_trigger_key),
+    FIELD("right_trigger.mode", FIELD_TRIGGER_MODE, triggers.right_trigger_mode),
+    FIELD("right_trigger.key",  FIELD_KEY, triggers.right_trigger_key),
+    FIELD("triggers.threshold", FIELD_THRESHOLD, triggers.threshold),
+
+    FIELD("fixed_point_math",   FIELD_BOOL, fixed_point_math),
+};
+
+// macOS virtual keycodes by name (same table as the reference in keymapping.h)
+typedef struct {
+    const char *name;
+    uint16_t code;
+} KeyName;
+
+static const KeyName key_names[] = {
+    {"A", 0x00}, {"B", 0x0B}, {"C", 0x08}, {"D", 0x02}, {"E", 0x0E}, {"F", 0x03},
+    {"G", 0x05}, {"H", 0x04}, {"I", 0x22}, {"J", 0x26}, {"K", 0x28}, {"L", 0x25},
+    {"M", 0x2E}, {"N", 0x2D}, {"O", 0x1F}, {"P", 0x23}, {"Q", 0x0C}, {"R", 0x0F},
+    {"S", 0x01}, {"T", 0x11}, {"U", 0x20}, {"V", 0x09}, {"W", 0x0D}, {"X", 0x07},
+    {"Y", 0x10}, {"Z", 0x06},
+    {"1", 0x12}, {"2", 0x13}, {"3", 0x14}, {"4", 0x15}, {"5", 0x17},
+    {"6", 0x16}, {"7", 0x1A}, {"8", 0x1C}, {"9", 0x19}, {"0", 0x1D},
+    {"Space", 0x31}, {"Return", 0x24}, {"Enter", 0x24}, {"Tab", 0x30},
+    {"Escape", 0x35}, {"Esc", 0x35}, {"Delete", 0x33}, {"Backspace", 0x33},
+    {"ForwardDelete", 0x75},
+    {"Shift", 0x38}, {"LeftShift", 0x38}, {"RightShift", 0x3C},
+    {"Control", 0x3B}, {"Ctrl", 0x3B}, {"LeftControl", 0x3B}, {"RightControl", 0x3E},
+    {"Option", 0x3A}, {"Alt", 0x3A}, {"LeftOption", 0x3A}, {"RightOption", 0x3D},
+    {"Command", 0x37}, {"Cmd", 0x37}, {"LeftCommand", 0x37}, {"RightCommand", 0x36},
+    {"Up", 0x7E}, {"Down", 0x7D}, {"Left", 0x7B}, {"Right", 0x7C},
+    {"F1", 0x7A}, {"F2", 0x78}, {"F3", 0x63}, {"F4", 0x76}, {"F5", 0x60}, {"F6", 0x61},
+    {"F7", 0x62}, {"F8", 0x64}, {"F9", 0x65}, {"F10", 0x6D}, {"F11", 0x67}, {"F12", 0x6F},
+    {"Minus", 0x1B}, {"Equals", 0x18}, {"LeftBracket", 0x21}, {"RightBracket", 0x1E},
+    {"Backslash", 0x2A}, {"Semicolon", 0x29}, {"Quote", 0x27}, {"Comma", 0x2B},
+    {"Period", 0x2F}, {"Slash", 0x2C}, {"Grave", 0x32},
+};
+
+static bool parse_key(const char *value, uint16_t *code) {
+    for (size_t i = 0; i < sizeof(key_names) / sizeof(key_names[0]); i++) {
+        if (strcasecmp(value, key_names[i].name) == 0) {
+            *code = key_names[i].code;
+            return true;
+        }
+    }
+    // Raw keycode, e.g. 0x31
+    char *end;
+    long number = strtol(value, &end, 0);
+    if (end != value && *end == '\0' && number >= 0 && number <= 0x7F) {
+        *code = (uint16_t)number;
+        return true;
+    }
+    return false;
+}
+
+static bool parse_stick_mode(const char *value, StickMode *mode) {
+    static const struct { const char *name; StickMode mode; } modes[] = {
+        {"wasd", STICK_MODE_WASD}, {"arrows", STICK_MODE_ARROWS}, {"mouse", STICK_MODE_MOUSE},
+        {"kinetic", STICK_MODE_KINETIC}, {"disabled", STICK_MODE_DISABLED}
+    };
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcasecmp(value, modes[i].name) == 0) {
+            *mode = modes[i].mode;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_trigger_mode(const char *value, TriggerMode *mode) {
+    if (strcasecmp(value, "mouse") == 0) {
+        *mode = TRIGGER_MODE_MOUSE;
+    } else if (strcasecmp(value, "key") == 0) {
+        *mode = TRIGGER_MODE_KEY;
+    } else if (strcasecmp(value, "disabled") == 0) {
+        *mode = TRIGGER_MODE_DISABLED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// "calibrate, deadzone 5000, snap 8, curve 1.8, scale 2.0 1.5" (one scale
+// value scales both axes), or "settings" for the chain the mouse settings
+// describe. false with the reason in error.
+static bool parse_chain(const char *value, StickChainSpec *spec, char *error, int error_size) {
+    static const struct { const char *name; StickStageType type; int values; } stages[] = {
+        {"calibrate", STAGE_CALIBRATE, 0}, {"deadzone", STAGE_DEADZONE, 1}, {"curve", STAGE_CURVE, 1},
+        {"filter", STAGE_FILTER, 1}, {"snap", STAGE_SNAP, 1}, {"scale", STAGE_SCALE, 2},
+        {"rotate", STAGE_ROTATE, 1}
+    };
+    StickChainSpec parsed;
+    char text[256];
+
+    memset(&parsed, 0, sizeof(parsed));
+    if (strcasecmp(value, "settings") == 0) {
+        *spec = parsed;
+        return true;
+    }
+    snprintf(text, sizeof(text), "%s", value);
+
+    for (char *item = strtok(text, ","); item; item = strtok(NULL, ",")) {
+        char name[16];
+        float values[2];
+        int fields = sscanf(item, " %15s %f %f", name, &values[0], &values[1]);
+        if (fields < 1) {
+            snprintf(error, error_size, "empty stage");
+            return false;
+        }
+        if (parsed.count == STICK_CHAIN_MAX) {
+            snprintf(error, error_size, "at most %d stages", STICK_CHAIN_MAX);
+            return false;
+        }
+
+        size_t i = 0;
+        while (i < sizeof(stages) / sizeof(stages[0]) && strcasecmp(name, stages[i].name) != 0) {
+            i++;
+        }
+        if (i == sizeof(stages) / sizeof(stages[0])) {
+            snprintf(error, error_size, "unknown stage '%s'", name);
+            return false;
+        }
+        if (fields - 1 > stages[i].values || (stages[i].values > 0 && fields < 2)) {
+            snprintf(error, error_size, stages[i].values == 0 ? "%s takes no value" :
+                     stages[i].values == 1 ? "%s takes one value" : "%s takes one or two values",
+                     stages[i].name);
+            return false;
+        }
+
+        StickStageSpec *stage = &parsed.stages[parsed.count++];
+        stage->type = stages[i].type;
+        stage->value = fields > 1 ? values[0] : 0.0f;
+        stage->value2 = fields > 2 ? values[1] : stage->value;
+    }
+    if (parsed.count == 0) {
+        snprintf(error, error_size, "no stages");
+        return false;
+    }
+    if (!stick_chain_check(&parsed, error, error_size)) {
+        return false;
+    }
+    *spec = parsed;
+    return true;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+// ============================================================================
+// Rules
+// ============================================================================
+
+// rule = CONDITION [for DURATION] -> ACTION KEY[+KEY...]
+//
+//   condition  button | axis COMPARE number | not c | c and c | c or c | (c)
+//   button     a b x y lb rb ls rs view menu dpad_up dpad_down dpad_left dpad_right
+//   axis       lx ly rx ry (-1 to 1, up and right positive), lt rt (0 to 1)
+//   compare    > < >= <=
+//   duration   500ms, 2s: the condition must hold that long first
+//   action     tap (once when the rule switches on), hold (while on) or
+//              toggle (press on one switch-on, release on the next)
+//   key        a key name as for buttons.*, or mouse_left/right/middle
+//
+// "not" binds tightest, then "and", then "or". Sticks are compared after the
+// profile's deadzone and calibration, triggers as reported.
+
+#define RULE_OPERANDS_MAX   16      // Per and/or chain
+
+typedef struct {
+    const char *p;
+    RuleProgram *program;
+    int last_load;                  // Offset of the load just emitted, or -1
+    int last_target;                // Where the last patched jumps land
+    char *error;
+    int error_size;
+} RuleParser;
+
+static const struct { const char *name; uint16_t mask; } rule_buttons[] = {
+    {"a", XBOX_BTN_A}, {"b", XBOX_BTN_B}, {"x", XBOX_BTN_X}, {"y", XBOX_BTN_Y},
+    {"lb", XBOX_BTN_LB}, {"rb", XBOX_BTN_RB}, {"ls", XBOX_BTN_LS}, {"rs", XBOX_BTN_RS},
+    {"view", XBOX_BTN_VIEW}, {"menu", XBOX_BTN_MENU}, {"dpad_up", XBOX_BTN_DPAD_UP},
+    {"dpad_down", XBOX_BTN_DPAD_DOWN}, {"dpad_left", XBOX_BTN_DPAD_LEFT},
+    {"dpad_right", XBOX_BTN_DPAD_RIGHT}
+};
+
+static bool rule_fail(RuleParser *parser, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(parser->error, parser->error_size, format, args);
+    va_end(args);
+    return false;
+}
+
+static void rule_skip_space(RuleParser *parser) {
+    while (isspace((unsigned char)*parser->p)) {
+        parser->p++;
+    }
+}
+
+// Next word (letters, digits, '_'), not consumed; 0 if none
+static int rule_peek_word(RuleParser *parser, char *word, int size) {
+    rule_skip_space(parser);
+    int length = 0;
+    while (isalnum((unsigned char)parser->p[length]) || parser->p[length] == '_') {
+        length++;
+    }
+    if (length == 0 || length >= size) {
+        return 0;
+    }
+    memcpy(word, parser->p, length);
+    word[length] = '\0';
+    return length;
+}
+
+// Consume keyword if it is the next word
+static bool rule_accept(RuleParser *parser, const char *keyword) {
+    char word[16];
+    int length = rule_peek_word(parser, word, sizeof(word));
+    if (length == 0 || strcasecmp(word, keyword) != 0) {
+        return false;
+    }
+    parser->p += length;
+    return true;
+}
+
+static bool rule_emit(RuleParser *parser, const uint8_t *bytes, int size) {
+    RuleProgram *program = parser->program;
+    if (program->code_size + size > RULE_CODE_MAX) {
+        return rule_fail(parser, "rules take more than %d bytes of code", RULE_CODE_MAX);
+    }
+    if (program->instructions + 1 > RULE_INSTRUCTION_BUDGET) {
+        return rule_fail(parser, "rules take more than %d instructions", RULE_INSTRUCTION_BUDGET);
+    }
+    memcpy(program->code + program->code_size, bytes, size);
+    program->code_size += size;
+    program->instructions++;
+    parser->last_load = -1;
+    return true;
+}
+
+// axis > raw (above) or axis < raw. Out of int16 range after a >=, <= or
+// folded "not" adjustment, it becomes the opposite compare, negated.
+static bool rule_emit_compare(RuleParser *parser, int axis, bool above, long raw) {
+    static const uint8_t not_op[1] = { RULE_OP_NOT };
+    bool negate = raw < -32768 || raw > 32767;
+    if (negate) {
+        above = !above;
+        raw += above ? -1 : 1;
+    }
+    uint8_t op[4] = { above ? RULE_OP_ABOVE : RULE_OP_BELOW, (uint8_t)axis,
+                      (uint8_t)(raw & 0xFF), (uint8_t)((raw >> 8) & 0xFF) };
+    int offset = parser->program->code_size;
+    if (!rule_emit(parser, op, sizeof(op))) {
+        return false;
+    }
+    if (negate) {
+        return rule_emit(parser, not_op, sizeof(not_op));
+    }
+    parser->last_load = offset;
+    return true;
+}
+
+static uint8_t rule_fused(uint8_t load, RuleOp jump) {
+    bool and = jump == RULE_OP_AND_JUMP;
+    switch (load) {
+        case RULE_OP_BUTTON: return and ? RULE_OP_BUTTON_AND : RULE_OP_BUTTON_OR;
+        case RULE_OP_ABOVE:  return and ? RULE_OP_ABOVE_AND : RULE_OP_ABOVE_OR;
+        default:             return and ? RULE_OP_BELOW_AND : RULE_OP_BELOW_OR;
+    }
+}
+
+// A jump straight after a load rides along with it, unless other jumps land
+// between the two. *patch gets the offset byte's position.
+static bool rule_emit_jump(RuleParser *parser, RuleOp jump, int *patch) {
+    RuleProgram *program = parser->program;
+
+    if (parser->last_load >= 0 && parser->last_target != program->code_size) {
+        if (program->code_size + 1 > RULE_CODE_MAX) {
+            return rule_fail(parser, "rules take more than %d bytes of code", RULE_CODE_MAX);
+        }
+        program->code[parser->last_load] = rule_fused(program->code[parser->last_load], jump);
+        *patch = program->code_size;
+        program->code[program->code_size++] = 0;
+        parser->last_load = -1;
+        return true;
+    }
+    uint8_t op[2] = { jump, 0 };
+    *patch = program->code_size + 1;
+    return rule_emit(parser, op, sizeof(op));
+}
+
+// Point the jump whose offset byte is at patch to the current end of the code
+static bool rule_patch(RuleParser *parser, int patch) {
+    int distance = parser->program->code_size - (patch + 1);
+    if (distance > 255) {
+        return rule_fail(parser, "condition too long");
+    }
+    parser->program->code[patch] = (uint8_t)distance;
+    parser->last_target = parser->program->code_size;
+    return true;
+}
+
+static bool rule_parse_or(RuleParser *parser);
+
+static bool rule_parse_term(RuleParser *parser) {
+    char word[16];
+    int length = rule_peek_word(parser, word, sizeof(word));
+
+    rule_skip_space(parser);
+    if (*parser->p == '(') {
+        parser->p++;
+        if (!rule_parse_or(parser)) {
+            return false;
+        }
+        rule_skip_space(parser);
+        if (*parser->p != ')') {
+            return rule_fail(parser, "expected ')'");
+        }
+        parser->p++;
+        return true;
+    }
+    if (length == 0) {
+        return rule_fail(parser, "expected a button or axis at '%s'", parser->p);
+    }
+    parser->p += length;
+
+    for (size_t i = 0; i < sizeof(rule_buttons) / sizeof(rule_buttons[0]); i++) {
+        if (strcasecmp(word, rule_buttons[i].name) == 0) {
+            uint8_t op[3] = { RULE_OP_BUTTON, rule_buttons[i].mask & 0xFF, rule_buttons[i].mask >> 8 };
+            int offset = parser->program->code_size;
+            if (!rule_emit(parser, op, sizeof(op))) {
+                return false;
+            }
+            parser->last_load = offset;
+            return true;
+        }
+    }
+
+    int axis = 0;
+    while (axis < RULE_AXIS_COUNT && strcasecmp(word, rule_axis_name(axis)) != 0) {
+        axis++;
+    }
+    if (axis == RULE_AXIS_COUNT) {
+        return rule_fail(parser, "unknown button or axis '%s'", word);
+    }
+
+    // Compare in raw units; >= and <= become > and < one step further out
+    rule_skip_space(parser);
+    bool above = *parser->p == '>';
+    if (*parser->p != '>' && *parser->p != '<') {
+        return rule_fail(parser, "expected > or < after %s", word);
+    }
+    parser->p++;
+    bool inclusive = *parser->p == '=';
+    parser->p += inclusive;
+
+    char *end;
+    float value = strtof(parser->p, &end);
+    bool trigger = axis == RULE_AXIS_LT || axis == RULE_AXIS_RT;
+    if (end == parser->p || !(value >= (trigger ? 0.0f : -1.0f) && value <= 1.0f)) {
+        return rule_fail(parser, trigger ? "%s needs a threshold from 0 to 1" :
+                                           "%s needs a threshold from -1 to 1", word);
+    }
+    parser->p = end;
+
+    long raw = lroundf(value * (trigger ? 255.0f : 32767.0f));
+    if (inclusive) {
+        raw += above ? -1 : 1;
+    }
+    return rule_emit_compare(parser, axis, above, raw);
+}
+
+static bool rule_parse_not(RuleParser *parser) {
+    static const uint8_t op[1] = { RULE_OP_NOT };
+    RuleProgram *program = parser->program;
+
+    if (!rule_accept(parser, "not")) {
+        return rule_parse_term(parser);
+    }
+    if (!rule_parse_not(parser)) {
+        return false;
+    }
+
+    // not (axis > v) is axis < v + 1: rewrite a lone compare instead of negating
+    int load = parser->last_load;
+    if (load >= 0 && parser->last_target != program->code_size && program->code[load] != RULE_OP_BUTTON) {
+        bool above = program->code[load] == RULE_OP_ABOVE;
+        int axis = program->code[load + 1];
+        long raw = (int16_t)rule_operand16(&program->code[load + 2]);
+        program->code_size = (uint16_t)load;
+        program->instructions--;
+        return rule_emit_compare(parser, axis, !above, raw + (above ? 1 : -1));
+    }
+    return rule_emit(parser, op, sizeof(op));
+}
+
+// operand {keyword operand}: each keyword jumps to the end once the chain's
+// outcome is known (AND on false, OR on true)
+static bool rule_parse_chain(RuleParser *parser, const char *keyword, RuleOp jump,
+                             bool (*operand)(RuleParser *)) {
+    int jumps[RULE_OPERANDS_MAX];
+    int count = 0;
+
+    if (!operand(parser)) {
+        return false;
+    }
+    while (rule_accept(parser, keyword)) {
+        if (count == RULE_OPERANDS_MAX - 1) {
+            return rule_fail(parser, "more than %d terms joined by '%s'", RULE_OPERANDS_MAX, keyword);
+        }
+        if (!rule_emit_jump(parser, jump, &jumps[count++]) || !operand(parser)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (!rule_patch(parser, jumps[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool rule_parse_and(RuleParser *parser) {
+    return rule_parse_chain(parser, "and", RULE_OP_AND_JUMP, rule_parse_not);
+}
+
+static bool rule_parse_or(RuleParser *parser) {
+    return rule_parse_chain(parser, "or", RULE_OP_OR_JUMP, rule_parse_and);
+}
+
+// "Shift+F5", "mouse_left"
+static bool rule_parse_chord(RuleParser *parser, CompiledRule *rule) {
+    static const char *mouse_names[] = { "mouse_left", "mouse_right", "mouse_middle" };
+    char text[128];
+    char *save = NULL;
+
+    rule_skip_space(parser);
+    snprintf(text, sizeof(text), "%s", parser->p);
+    for (char *name = strtok_r(text, "+", &save); name; name = strtok_r(NULL, "+", &save)) {
+        name = trim(name);
+        if (rule->count == RULE_CHORD_MAX) {
+            return rule_fail(parser, "more than %d keys in '%s'", RULE_CHORD_MAX, parser->p);
+        }
+        int k = rule->count++;
+        rule->target[k] = RULE_TARGET_KEY;
+        if (parse_key(name, &rule->code[k])) {
+            continue;
+        }
+        rule->target[k] = RULE_TARGET_MOUSE;
+        rule->code[k] = 0;
+        while (rule->code[k] < 3 && strcasecmp(name, mouse_names[rule->code[k]]) != 0) {
+            rule->code[k]++;
+        }
+        if (rule->code[k] == 3) {
+            return rule_fail(parser, "unknown key '%s'", name);
+        }
+    }
+    if (rule->count == 0) {
+        return rule_fail(parser, "no key after the action");
+    }
+    return true;
+}
+
+bool profile_compile_rule(RuleProgram *program, const char *text, char *error, int error_size) {
+    RuleParser parser = { .p = text, .program = program, .last_load = -1, .last_target = -1,
+                          .error = error, .error_size = error_size };
+    uint16_t code_size = program->code_size;
+    uint16_t instructions = program->instructions;
+    CompiledRule rule;
+
+    memset(&rule, 0, sizeof(rule));
+    rule.timer = RULE_NO_TIMER;
+    if (program->count == RULES_MAX) {
+        return rule_fail(&parser, "more than %d rules", RULES_MAX);
+    }
+
+    bool ok = rule_parse_or(&parser);
+    if (ok && rule_accept(&parser, "for")) {
+        char *end;
+        double ms = strtod(parser.p, &end);
+        if (end != parser.p) {
+            parser.p = end;
+            if (rule_accept(&parser, "s")) {
+                ms *= 1000.0;
+            } else if (!rule_accept(&parser, "ms")) {
+                ms = -1.0;
+            }
+        } else {
+            ms = -1.0;
+        }
+        if (!(ms >= 1.0 && ms <= 60000.0)) {
+            ok = rule_fail(&parser, "duration must be 1ms to 60s, like 500ms or 2s");
+        } else if (program->timers == RULE_TIMERS_MAX) {
+            ok = rule_fail(&parser, "more than %d rules with 'for'", RULE_TIMERS_MAX);
+        } else {
+            rule.for_ms = (uint32_t)(ms + 0.5);
+        }
+    }
+    rule_skip_space(&parser);
+    if (ok && strncmp(parser.p, "->", 2) != 0) {
+        ok = rule_fail(&parser, "expected '->' at '%s'", parser.p);
+    }
+    if (ok) {
+        parser.p += 2;
+        static const char *actions[] = { "tap", "hold", "toggle" };
+        int action = 0;
+        while (action < 3 && !rule_accept(&parser, actions[action])) {
+            action++;
+        }
+        rule.action = (uint8_t)action;
+        ok = action < 3 ? rule_parse_chord(&parser, &rule) :
+                          rule_fail(&parser, "expected tap, hold or toggle at '%s'", parser.p);
+    }
+    if (ok) {
+        uint8_t op[2] = { RULE_OP_RULE, program->count };
+        ok = rule_emit(&parser, op, sizeof(op));
+    }
+    if (!ok) {
+        // Zeroed past the end as before, so profile hashes stay stable
+        memset(program->code + code_size, 0, RULE_CODE_MAX - code_size);
+        program->code_size = code_size;
+        program->instructions = instructions;
+        return false;
+    }
+
+    if (rule.for_ms) {
+        rule.timer = program->timers++;
+    }
+    program->rules[program->count++] = rule;
+    return true;
+}
+
+static bool parse_long(const char *value, long min, long max, long *out) {
+    char *end;
+    long number = strtol(value, &end, 0);
+    if (end == value || *end != '\0' || number < min || number > max) {
+        return false;
+    }
+    *out = number;
+    return true;
+}
+
+// Store value into the field; false if it doesn't parse or is out of range
+// message gets the reason, for the fields that have more to say than
+// "invalid value"
+static bool set_field(ControllerMapping *mapping, const ProfileField *field, const char *value,
+                      char *message, int message_size) {
+    void *target = (uint8_t *)mapping + field->offset;
+    long number;
+
+    switch (field->type) {
+        case FIELD_KEY:
+            return parse_key(value, (uint16_t *)target);
+        case FIELD_STICK_MODE:
+            return parse_stick_mode(value, (StickMode *)target);
+        case FIELD_TRIGGER_MODE:
+            return parse_trigger_mode(value, (TriggerMode *)target);
+        case FIELD_FLOAT: {
+            char *end;
+            float f = strtof(value, &end);
+            if (end == value || *end != '\0' || !(f >= field->min && f <= field->max)) {
+                return false;
+            }
+            *(float *)target = f;
+            return true;
+        }
+        case FIELD_DEADZONE:
+            if (!parse_long(value, 0, 32767, &number)) {
+                return false;
+            }
+            *(int16_t *)target = (int16_t)number;
+            return true;
+        case FIELD_THRESHOLD:
+            if (!parse_long(value, 0, 255, &number)) {
+                return false;
+            }
+            *(uint8_t *)target = (uint8_t)number;
+            return true;
+        case FIELD_CHAIN:
+            return parse_chain(value, (StickChainSpec *)target, message, message_size);
+        case FIELD_BOOL:
+            if (strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+                *(bool *)target = true;
+            } else if (strcasecmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+                *(bool *)target = false;
+            } else {
+                return false;
+            }
+            return true;
+    }
+    return false;
+}
+
+static void source_init(ProfileSource *source, const char *name) {
+    memset(source, 0, sizeof(*source));
+    snprintf(source->name, sizeof(source->name), "%s", name);
+    source->mapping = get_default_mapping();
+}
+
+int profile_parse_file(const char *path, ProfileSource *sources, int max_profiles,
+                       char *error, int error_size) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        snprintf(error, error_size, "%s: cannot open", path);
+        return -1;
+    }
+
+    char line[256];
+    int line_number = 0;
+    int count = 0;
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), f)) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        char *text = trim(line);
+        if (*text == '\0') {
+            continue;
+        }
+
+        // [name] starts a new profile from the keymapping.h defaults
+        if (*text == '[') {
+            char *close = strchr(text, ']');
+            if (!close || close[1] != '\0' || close == text + 1 ||
+                close - text - 1 >= PROFILE_NAME_SIZE) {
+                snprintf(error, error_size, "%s:%d: bad profile name", path, line_number);
+                ok = false;
+            } else if (count == max_profiles) {
+                snprintf(error, error_size, "%s:%d: more than %d profiles", path, line_number, max_profiles);
+                ok = false;
+            } else {
+                *close = '\0';
+                source_init(&sources[count++], trim(text + 1));
+            }
+            continue;
+        }
+
+        char *equals = strchr(text, '=');
+        if (!equals) {
+            snprintf(error, error_size, "%s:%d: expected setting = value", path, line_number);
+            ok = false;
+            continue;
+        }
+        *equals = '\0';
+        char *key = trim(text);
+        char *value = trim(equals + 1);
+
+        // Settings before the first [name] belong to a profile called "default"
+        if (count == 0) {
+            source_init(&sources[count++], "default");
+        }
+        ProfileSource *source = &sources[count - 1];
+
+        // Each rule line adds one rule
+        if (strcmp(key, "rule") == 0) {
+            char message[128];
+            if (!profile_compile_rule(&source->rules, value, message, sizeof(message))) {
+                snprintf(error, error_size, "%s:%d: rule: %s", path, line_number, message);
+                ok = false;
+            }
+            continue;
+        }
+
+        if (strcmp(key, "calibration") == 0) {
+            snprintf(source->calibration_serial, sizeof(source->calibration_serial), "%s",
+                     strcasecmp(value, "none") == 0 ? "" : value);
+            continue;
+        }
+
+        const ProfileField *field = NULL;
+        char message[128] = "";
+        for (size_t i = 0; i < sizeof(profile_fields) / sizeof(profile_fields[0]); i++) {
+            if (strcmp(key, profile_fields[i].name) == 0) {
+                field = &profile_fields[i];
+                break;
+            }
+        }
+        if (!field) {
+            snprintf(error, error_size, "%s:%d: unknown setting '%s'", path, line_number, key);
+            ok = false;
+        } else if (!set_field(&source->mapping, field, value, message, sizeof(message))) {
+            snprintf(error, error_size, "%s:%d: invalid value '%s' for %s%s%s", path, line_number, value, key,
+                     message[0] ? ": " : "", message);
+            ok = false;
+        }
+    }
+    fclose(f);
+
+    if (ok && count == 0) {
+        snprintf(error, error_size, "%s: no profiles", path);
+        ok = false;
+    }
+    return ok ? count : -1;
+}
+
+void profile_source_compile(const ProfileSource *source, const StickCalibration *calibration,
+                            CompiledProfile *profile) {
+    mapper_compile_profile(&source->mapping, calibration, profile);
+    profile->rules = source->rules;
+}
+
+// ============================================================================
+// Binary Profile Files
+// ============================================================================
+
+static uint32_t fnv1a(const void *data, size_t size) {
+    const uint8_t *bytes = data;
+    uint32_t hash = 0x811c9dc5u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x01000193u;
+    }
+    return hash;
+}
+
+uint32_t profile_abi_fingerprint(void) {
+    // Anything that moves a field or resizes a table changes the fingerprint;
+    // the marker catches a file copied between byte orders
+    const uint32_t layout[] = {
+        0x01020304u,
+        sizeof(CompiledProfile),
+        offsetof(CompiledProfile, left_stick),
+        offsetof(CompiledProfile, right_stick),
+        offsetof(CompiledProfile, left_trigger),
+        offsetof(CompiledProfile, deadzone),
+        offsetof(CompiledProfile, fx_params),
+        offsetof(CompiledProfile, rules),
+        MAPPER_NUM_BUTTONS,
+        STICK_CHAIN_MAX,
+        RULES_MAX,
+        RULE_CHORD_MAX,
+        RULE_CODE_MAX,
+        CALIBRATION_BINS,
+        FX_CURVE_LUT_SIZE,
+    };
+    return fnv1a(layout, sizeof(layout));
+}
+
+static size_t align_up(size_t offset) {
+    return (offset + PROFILE_ALIGN - 1) & ~(size_t)(PROFILE_ALIGN - 1);
+}
+
+bool profile_file_write(const char *path, const ProfileSource *sources,
+                        const CompiledProfile *profiles, const uint32_t *flags, int count) {
+    if (count < 1 || count > PROFILE_MAX_PROFILES) {
+        return false;
+    }
+
+    ProfileFileHeader header;
+    ProfileEntry entries[PROFILE_MAX_PROFILES];
+    memset(&header, 0, sizeof(header));
+    memset(entries, 0, sizeof(entries));
+
+    size_t offset = align_up(sizeof(header) + count * sizeof(ProfileEntry));
+    for (int i = 0; i < count; i++) {
+        snprintf(entries[i].name, sizeof(entries[i].name), "%s", sources[i].name);
+        entries[i].offset = (uint32_t)offset;
+        entries[i].size = sizeof(CompiledProfile);
+        entries[i].checksum = fnv1a(&profiles[i], sizeof(CompiledProfile));
+        entries[i].flags = flags ? flags[i] : 0;
+        offset = align_up(offset + sizeof(CompiledProfile));
+    }
+
+    header.magic = PROFILE_MAGIC;
+    header.version = PROFILE_VERSION;
+    header.count = (uint16_t)count;
+    header.abi = profile_abi_fingerprint();
+    header.file_size = (uint32_t)offset;
+
+    // Write to a temporary file and rename, so a running simulator never
+    // maps a half-written profile
+    char temp_path[512];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE *f = fopen(temp_path, "wb");
+    if (!f) {
+        return false;
+    }
+
+    static const uint8_t padding[PROFILE_ALIGN];
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(entries, sizeof(ProfileEntry), count, f) == (size_t)count;
+    size_t written = sizeof(header) + count * sizeof(ProfileEntry);
+    for (int i = 0; ok && i < count; i++) {
+        ok = fwrite(padding, 1, entries[i].offset - written, f) == entries[i].offset - written &&
+             fwrite(&profiles[i], sizeof(CompiledProfile), 1, f) == 1;
+        written = entries[i].offset + sizeof(CompiledProfile);
+    }
+    if (ok && written < header.file_size) {
+        ok = fwrite(padding, 1, header.file_size - written, f) == header.file_size - written;
+    }
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return false;
+    }
+    return true;
+}
+
+static bool map_error(ProfileFile *file, char *error, int error_size, const char *path, const char *message) {
+    snprintf(error, error_size, "%s: %s", path, message);
+    profile_file_unmap(file);
+    return false;
+}
+
+// The checksum only catches damage; a file written by something other than
+// profilec can be consistent and still index past the mapper's arrays.
+// Returns what is out of range, or NULL.
+static const char *profile_out_of_range(const CompiledProfile *profile) {
+    const RuleProgram *rules = &profile->rules;
+
+    if (rules->count > RULES_MAX || rules->timers > RULE_TIMERS_MAX || rules->code_size > RULE_CODE_MAX) {
+        return "rule program out of range";
+    }
+    for (int i = 0; i < rules->count; i++) {
+        const CompiledRule *rule = &rules->rules[i];
+        if ((rule->timer >= RULE_TIMERS_MAX && rule->timer != RULE_NO_TIMER) ||
+            rule->count > RULE_CHORD_MAX) {
+            return "rule out of range";
+        }
+    }
+    if (profile->left_stick.chain.count < 0 || profile->left_stick.chain.count > STICK_CHAIN_MAX ||
+        profile->right_stick.chain.count < 0 || profile->right_stick.chain.count > STICK_CHAIN_MAX) {
+        return "stick chain out of range";
+    }
+    return NULL;
+}
+
+bool profile_file_map(ProfileFile *file, const char *path, char *error, int error_size) {
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        snprintf(error, error_size, "%s: cannot open", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ProfileFileHeader)) {
+        close(fd);
+        snprintf(error, error_size, "%s: too short", path);
+        return false;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        snprintf(error, error_size, "%s: mmap failed", path);
+        return false;
+    }
+    file->base = base;
+    file->size = (size_t)st.st_size;
+    file->header = (const ProfileFileHeader *)file->base;
+    file->entries = (const ProfileEntry *)(file->base + sizeof(ProfileFileHeader));
+
+    const ProfileFileHeader *header = file->header;
+    if (header->magic != PROFILE_MAGIC) {
+        return map_error(file, error, error_size, path, "not a compiled profile (run profilec)");
+    }
+    if (header->version != PROFILE_VERSION || header->abi != profile_abi_fingerprint()) {
+        return map_error(file, error, error_size, path, "compiled by a different build, recompile with profilec");
+    }
+    if (header->file_size != file->size || header->count < 1 || header->count > PROFILE_MAX_PROFILES ||
+        sizeof(ProfileFileHeader) + header->count * sizeof(ProfileEntry) > file->size) {
+        return map_error(file, error, error_size, path, "truncated or corrupt");
+    }
+
+    for (int i = 0; i < header->count; i++) {
+        const ProfileEntry *entry = &file->entries[i];
+        if (entry->size != sizeof(CompiledProfile) || entry->offset % PROFILE_ALIGN != 0 ||
+            entry->offset > file->size || file->size - entry->offset < entry->size ||
+            memchr(entry->name, '\0', sizeof(entry->name)) == NULL) {
+            return map_error(file, error, error_size, path, "corrupt profile table");
+        }
+        if (fnv1a(file->base + entry->offset, entry->size) != entry->checksum) {
+            return map_error(file, error, error_size, path, "checksum mismatch");
+        }
+        const char *problem = profile_out_of_range((const CompiledProfile *)(file->base + entry->offset));
+        if (problem) {
+            return map_error(file, error, error_size, path, problem);
+        }
+    }
+    return true;
+}
+
+void profile_file_unmap(ProfileFile *file) {
+    if (file->base) {
+        munmap((void *)file->base, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+const CompiledProfile *profile_file_get(const ProfileFile *file, int index) {
+    if (index < 0 || index >= file->header->count) {
+        return NULL;
+    }
+    return (const CompiledProfile *)(file->base + file->entries[index].offset);
+}
+
+int profile_file_find(const ProfileFile *file, const char *name) {
+    for (int i = 0; i < file->header->count; i++) {
+        if (strcmp(file->entries[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,106 @@
+// profile.h
+// Text profiles and compiled binary profile files (part of libmapper)
+//
+// A text profile overrides keymapping.h's defaults for one or more named
+// profiles (see profiles/example.profile for every setting):
+//
+//   [shooter]
+//   left_stick.mode  = wasd
+//   right_stick.mode = mouse
+//   buttons.a        = Space
+//   mouse.sensitivity = 2.0
+//   calibration      = 3032363030303130    # bake in this controller's calibration
+//   rule = lb and ry > 0.5 -> tap F5         # conditional binding (grammar in profile.c)
+//
+// profilec compiles text profiles into one binary file holding each
+// profile's CompiledProfile ready to use - bindings, curve LUT and
+// calibration tables included. CompiledProfile contains no pointers, so the
+// simulator maps the file read-only and points its Mapper straight into it:
+// no parsing, compiling or allocation at startup or on a profile switch.
+//
+// Binary layout (host byte order; files written for a different struct
+// layout or byte order are rejected by the ABI fingerprint):
+//
+//   ProfileFileHeader
+//   ProfileEntry[count]
+//   CompiledProfile at each entry's offset (PROFILE_ALIGN-aligned)
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "keymapping.h"
+#include "mapper.h"
+
+#define PROFILE_MAGIC           0x46525058  // "XPRF"
+#define PROFILE_VERSION         1
+#define PROFILE_MAX_PROFILES    16
+#define PROFILE_NAME_SIZE       32
+#define PROFILE_ALIGN           64          // Cache line; also keeps every field aligned
+
+// ProfileEntry.flags
+#define PROFILE_FLAG_CALIBRATED 0x01
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t abi;               // profile_abi_fingerprint() of the writer
+    uint32_t file_size;
+} ProfileFileHeader;
+
+typedef struct {
+    char name[PROFILE_NAME_SIZE];
+    uint32_t offset;            // From the start of the file
+    uint32_t size;              // sizeof(CompiledProfile)
+    uint32_t checksum;          // FNV-1a of the CompiledProfile bytes
+    uint32_t flags;
+} ProfileEntry;
+
+// One profile from a text file, before compilation
+typedef struct {
+    char name[PROFILE_NAME_SIZE];
+    ControllerMapping mapping;
+    char calibration_serial[64];    // Empty = no calibration
+    RuleProgram rules;              // Compiled as the file is parsed
+} ProfileSource;
+
+// A mapped binary profile file
+typedef struct {
+    const uint8_t *base;
+    size_t size;
+    const ProfileFileHeader *header;
+    const ProfileEntry *entries;
+} ProfileFile;
+
+// Layout fingerprint of CompiledProfile on this build
+uint32_t profile_abi_fingerprint(void);
+
+// Parse a text profile into up to max_profiles sources. Returns the number
+// of profiles, or -1 with a "file:line: message" in error.
+int profile_parse_file(const char *path, ProfileSource *sources, int max_profiles,
+                       char *error, int error_size);
+
+// Compile one rule line's value and append it to program. False (program
+// unchanged) with the reason in error.
+bool profile_compile_rule(RuleProgram *program, const char *text, char *error, int error_size);
+
+// mapper_compile_profile() plus the source's rules
+void profile_source_compile(const ProfileSource *source, const StickCalibration *calibration,
+                            CompiledProfile *profile);
+
+// Write compiled profiles (names and flags from sources) as a binary file
+bool profile_file_write(const char *path, const ProfileSource *sources,
+                        const CompiledProfile *profiles, const uint32_t *flags, int count);
+
+// Map and validate a binary profile file (checksums included)
+bool profile_file_map(ProfileFile *file, const char *path, char *error, int error_size);
+void profile_file_unmap(ProfileFile *file);
+
+// Profile in place inside the mapping; valid until profile_file_unmap()
+const CompiledProfile *profile_file_get(const ProfileFile *file, int index);
+int profile_file_find(const ProfileFile *file, const char *name);    // -1 if absent
+
+#endif // PROFILE_H
@@ -0,0 +1,225 @@
+// profilec.c
+// Compiles text profiles into a binary profile file the simulator maps at
+// startup (see profile.h)
+// Compile: make profilec
+// Run: ./profilec -o profiles.xprof FILE.profile...
+//      ./profilec --dump profiles.xprof
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "profile.h"
+#include "calibration.h"
+
+static const char *stick_mode_name(StickMode mode) {
+    switch (mode) {
+        case STICK_MODE_WASD:     return "wasd";
+        case STICK_MODE_ARROWS:   return "arrows";
+        case STICK_MODE_MOUSE:    return "mouse";
+        case STICK_MODE_KINETIC:  return "kinetic";
+        case STICK_MODE_DISABLED: return "disabled";
+        default:                  return "?";
+    }
+}
+
+static const char *trigger_mode_name(TriggerMode mode) {
+    switch (mode) {
+        case TRIGGER_MODE_MOUSE:    return "mouse";
+        case TRIGGER_MODE_KEY:      return "key";
+        case TRIGGER_MODE_DISABLED: return "disabled";
+        default:                    return "?";
+    }
+}
+
+static void print_chain(const char *name, const StickChain *chain) {
+    printf("  %s chain: %sdeadzone %d", name, chain->calibrate ? "calibrate, " : "", chain->deadzone);
+    for (int i = 0; i < chain->count; i++) {
+        const StickStage *stage = &chain->stages[i];
+        switch (stage->type) {
+            case STAGE_DEADZONE: printf(" → deadzone %.0f", stage->deadzone.radius * 32767.0f); break;
+            case STAGE_CURVE:    printf(" → curve %.2f", stage->curve.exponent); break;
+            case STAGE_FILTER:   printf(" → filter %.2f", 1.0f - stage->filter.alpha); break;
+            case STAGE_SNAP:     printf(" → snap %.1f°", atanf(stage->snap.tan_limit) * 180.0f / STICK_CHAIN_PI); break;
+            case STAGE_SCALE:    printf(" → scale %.2f %.2f", stage->scale.x, stage->scale.y); break;
+            case STAGE_ROTATE:
+                printf(" → rotate %.1f°", atan2f(stage->rotate.sin_angle, stage->rotate.cos_angle) * 180.0f / STICK_CHAIN_PI);
+                break;
+            default: break;
+        }
+    }
+    printf(" (%s)\n", chain->path == STICK_CHAIN_FUSED ? "fused" : "stage loop");
+}
+
+// One line per rule: its code (jumps as and/or +bytes skipped), then what it presses
+static void print_rules(const RuleProgram *program) {
+    static const char *actions[] = { "tap", "hold", "toggle" };
+    static const char *mouse[] = { "mouse_left", "mouse_right", "mouse_middle" };
+    int pc = 0;
+
+    if (program->count == 0) {
+        return;
+    }
+    printf("  Rules: %d, %d bytes of code, %d instructions (budget %d), %d timer%s\n", program->count,
+           program->code_size, program->instructions, RULE_INSTRUCTION_BUDGET, program->timers,
+           program->timers == 1 ? "" : "s");
+    for (int i = 0; i < program->count; i++) {
+        printf("    %2d:", i);
+        while (pc < program->code_size && program->code[pc] != RULE_OP_RULE) {
+            const uint8_t *op = &program->code[pc];
+            switch (op[0]) {
+                case RULE_OP_BUTTON:
+                case RULE_OP_BUTTON_AND:
+                case RULE_OP_BUTTON_OR:
+                    printf(" button %04x", rule_operand16(op + 1));
+                    pc += 3;
+                    break;
+                case RULE_OP_ABOVE:
+                case RULE_OP_ABOVE_AND:
+                case RULE_OP_ABOVE_OR:
+                case RULE_OP_BELOW:
+                case RULE_OP_BELOW_AND:
+                case RULE_OP_BELOW_OR: {
+                    bool above = op[0] == RULE_OP_ABOVE || op[0] == RULE_OP_ABOVE_AND || op[0] == RULE_OP_ABOVE_OR;
+                    printf(" %s %c %d", rule_axis_name(op[1]), above ? '>' : '<', (int16_t)rule_operand16(op + 2));
+                    pc += 4;
+                    break;
+                }
+                case RULE_OP_NOT:
+                    printf(" not");
+                    pc += 1;
+                    break;
+                case RULE_OP_AND_JUMP:
+                case RULE_OP_OR_JUMP:
+                    pc += 1;
+                    break;
+                default:
+                    printf(" ?%02x", op[0]);
+                    pc = program->code_size;
+                    break;
+            }
+            // Jumps, on their own or fused into the load before
+            if (op[0] == RULE_OP_AND_JUMP || op[0] == RULE_OP_BUTTON_AND || op[0] == RULE_OP_ABOVE_AND ||
+                op[0] == RULE_OP_BELOW_AND) {
+                printf(" and(+%d)", program->code[pc++]);
+            } else if (op[0] == RULE_OP_OR_JUMP || op[0] == RULE_OP_BUTTON_OR || op[0] == RULE_OP_ABOVE_OR ||
+                       op[0] == RULE_OP_BELOW_OR) {
+                printf(" or(+%d)", program->code[pc++]);
+            }
+        }
+        pc += 2;
+
+        const CompiledRule *rule = &program->rules[i];
+        if (rule->for_ms) {
+            printf(" for %ums", rule->for_ms);
+        }
+        printf(" → %s", rule->action < 3 ? actions[rule->action] : "?");
+        for (int k = 0; k < rule->count && k < RULE_CHORD_MAX; k++) {
+            if (rule->target[k] == RULE_TARGET_MOUSE) {
+                printf("%s%s", k ? "+" : " ", rule->code[k] < 3 ? mouse[rule->code[k]] : "?");
+            } else {
+                printf("%s0x%02X", k ? "+" : " ", rule->code[k]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+static int dump(const char *path) {
+    ProfileFile file;
+    char error[256];
+    if (!profile_file_map(&file, path, error, sizeof(error))) {
+        printf("❌ %s\n", error);
+        return 1;
+    }
+
+    printf("%s: %d profiles, %zu bytes, ABI %08x\n\n", path, file.header->count, file.size,
+           file.header->abi);
+    for (int i = 0; i < file.header->count; i++) {
+        const ProfileEntry *entry = &file.entries[i];
+        const CompiledProfile *p = profile_file_get(&file, i);
+        printf("[%s] offset %u, checksum %08x%s\n", entry->name, entry->offset, entry->checksum,
+               (entry->flags & PROFILE_FLAG_CALIBRATED) ? ", calibrated" : "");
+        printf("  Sticks: left %s, right %s, deadzone %d\n", stick_mode_name(p->left_stick.mode),
+               stick_mode_name(p->right_stick.mode), p->deadzone);
+        printf("  Mouse: sensitivity %.2f, curve %.2f, smoothing %.2f, kinetic friction %.1f\n",
+               p->mouse_sensitivity, p->mouse_curve, p->mouse_smoothing, p->kinetic_friction);
+        print_chain("Left", &p->left_stick.chain);
+        print_chain("Right", &p->right_stick.chain);
+        printf("  Triggers: left %s, right %s, threshold %d\n", trigger_mode_name(p->left_trigger.mode),
+               trigger_mode_name(p->right_trigger.mode), p->trigger_threshold);
+        printf("  Stick math: %s\n", p->fixed_point_math ? "fixed-point" : "floating-point");
+        print_rules(&p->rules);
+        printf("\n");
+    }
+    profile_file_unmap(&file);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    static ProfileSource sources[PROFILE_MAX_PROFILES];
+    static CompiledProfile profiles[PROFILE_MAX_PROFILES];
+    uint32_t flags[PROFILE_MAX_PROFILES];
+    int count = 0;
+    char error[256];
+
+    if (argc == 3 && strcmp(argv[1], "--dump") == 0) {
+        return dump(argv[2]);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+            continue;
+        }
+        int parsed = profile_parse_file(argv[i], sources + count, PROFILE_MAX_PROFILES - count,
+                                        error, sizeof(error));
+        if (parsed < 0) {
+            printf("❌ %s\n", error);
+            return 1;
+        }
+        count += parsed;
+    }
+    if (!output || count == 0) {
+        printf("Usage: %s -o OUTPUT.xprof FILE.profile...\n", argv[0]);
+        printf("       %s --dump FILE.xprof\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(sources[i].name, sources[j].name) == 0) {
+                printf("❌ Profile [%s] defined twice\n", sources[i].name);
+                return 1;
+            }
+        }
+
+        // Bake the controller's calibration tables into the profile
+        StickCalibration calibration;
+        const char *serial = sources[i].calibration_serial;
+        flags[i] = 0;
+        if (serial[0]) {
+            if (!calibration_load(serial, &calibration)) {
+                char path[128];
+                calibration_path(serial, path, sizeof(path));
+                printf("❌ [%s]: no calibration at %s\n", sources[i].name, path);
+                return 1;
+            }
+            flags[i] |= PROFILE_FLAG_CALIBRATED;
+        }
+        profile_source_compile(&sources[i], serial[0] ? &calibration : NULL, &profiles[i]);
+        printf("✅ [%s]%s", sources[i].name, serial[0] ? " (calibrated)" : "");
+        if (sources[i].rules.count) {
+            printf(" %d rule%s", sources[i].rules.count, sources[i].rules.count == 1 ? "" : "s");
+        }
+        printf("\n");
+    }
+
+    if (!profile_file_write(output, sources, profiles, flags, count)) {
+        printf("❌ Failed to write %s\n", output);
+        return 1;
+    }
+    printf("✅ Wrote %d profiles to %s\n", count, output);
+    return 0;
+}
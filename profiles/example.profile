@@ -0,0 +1,68 @@
+# example.profile
+# Text profiles for profilec. Every profile starts from the defaults in
+# keymapping.h, so list only what you change. Compile and run with:
+#
+#   make profiles/example.xprof
+#   sudo ./simulator --profile profiles/example.xprof --profile-name shooter
+#
+# Send SIGUSR2 to a running simulator to switch to the next profile.
+#
+# Keys: letter/digit names, Space, Return, Tab, Escape, Delete, Shift,
+# Control, Option, Command (Left/Right variants), Up/Down/Left/Right, F1-F12,
+# Minus, Equals, LeftBracket, RightBracket, Backslash, Semicolon, Quote,
+# Comma, Period, Slash, Grave - or a raw keycode such as 0x31.
+# Stick modes: wasd, arrows, mouse, kinetic, disabled
+# Trigger modes: mouse, key, disabled
+# Stick chains (mouse/kinetic sticks): comma-separated stages from
+# calibrate (first only), deadzone R, curve E, filter S, snap DEG,
+# scale X [Y], rotate DEG - or "settings" for the chain the mouse.* settings
+# describe (the default)
+# Rules (any number of lines, up to 64 per profile):
+#   rule = CONDITION [for DURATION] -> tap|hold|toggle KEY[+KEY...]
+# Conditions combine buttons (a b x y lb rb ls rs view menu dpad_up ...),
+# stick axes (lx ly rx ry, -1 to 1, up/right positive) and triggers (lt rt,
+# 0 to 1) compared with > < >= <=, using and, or, not and parentheses.
+# "for 500ms" or "for 2s" waits until the condition has held that long.
+# Keys are named as above, plus mouse_left, mouse_right and mouse_middle.
+
+[shooter]
+left_stick.mode    = wasd
+right_stick.mode   = mouse
+buttons.a          = Space
+buttons.b          = C
+buttons.x          = R
+buttons.y          = F
+buttons.lb         = Q
+buttons.rb         = E
+buttons.ls         = Shift
+buttons.rs         = Control
+mouse.sensitivity  = 1.5
+mouse.curve        = 1.8
+mouse.smoothing    = 0.3
+deadzone           = 8000
+# right_stick.chain = calibrate, deadzone 6000, snap 8, filter 0.3, curve 1.8, scale 2.0 1.5
+left_trigger.mode  = mouse
+right_trigger.mode = mouse
+triggers.threshold = 127
+# calibration      = <serial>   # bake in `xbox_gip_test --calibrate` results
+rule = lb and ry > 0.5 -> tap F5                  # quick save
+rule = lb and ry < -0.5 -> tap F9                 # quick load
+rule = view for 1s -> tap Escape                  # hold View for the menu
+rule = lt > 0.9 and rt > 0.9 -> hold V            # both triggers: melee
+
+[desktop]
+left_stick.mode    = kinetic
+right_stick.mode   = arrows
+buttons.a          = Return
+buttons.b          = Escape
+buttons.x          = Delete
+buttons.y          = Tab
+buttons.lb         = LeftBracket
+buttons.rb         = RightBracket
+mouse.sensitivity  = 1.0
+kinetic.friction   = 4.0
+left_trigger.mode  = mouse
+right_trigger.mode = mouse
+triggers.threshold = 64
+rule = menu and view -> tap Command+Space         # Spotlight
+rule = rb and dpad_up -> toggle Shift             # sticky Shift
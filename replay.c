@@ -0,0 +1,581 @@
+// replay.c
+// Feeds capture files through the same decode → mapper path as the
+// simulator, without a controller or OS output. Time comes from the capture,
+// so a replay is deterministic: the checksum over all output actions only
+// changes when mapping behaviour does.
+// Compile: make xbox_replay
+// Run: ./xbox_replay [--loops N] [--bench] [--quiet] FILE...
+//      --loops N   replay the files N times (training runs for the PGO build)
+//      --bench     time the replay and report ns per packet (best of several runs)
+//      ./xbox_replay --checkpoint-every SEC --output OUT.xcap FILE
+//                  copy FILE with a pipeline checkpoint every SEC seconds
+//      ./xbox_replay --from SEC FILE
+//                  start at the last checkpoint at or before SEC
+//      ./xbox_replay --segments [--threads N] FILE...
+//                  replay each file as checkpoint-to-checkpoint segments in
+//                  parallel and check them against one continuous replay
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "gip.h"
+#include "gip_protocol.h"
+#include "capture.h"
+#include "mapper.h"
+#include "keymapping.h"
+
+// Same output tick as the simulator's input loop
+#define TICK_NS             10000000ull
+
+// Replays start one second in: the mapper treats time 0 as "never"
+#define REPLAY_EPOCH_NS     1000000000ull
+
+#define BENCH_RUNS          7
+#define BENCH_MIN_PACKETS   2000000     // Per run, so short corpora still time well
+
+// Checkpoint payload: time since the last packet or tick, then the mapper
+#define CHECKPOINT_SIZE     (8 + MAPPER_STATE_SIZE)
+#define DEFAULT_THREADS     4
+#define MAX_THREADS         64
+
+// Mapper state plus the replay loop's own clock, taken just before a packet
+typedef struct {
+    int record;                     // Index of that packet in the corpus
+    uint8_t data[CHECKPOINT_SIZE];
+} Checkpoint;
+
+typedef struct {
+    int first_record;
+    int count;
+    uint64_t base_ns;               // Offset added to this file's timestamps
+} CorpusFile;
+
+typedef struct {
+    CaptureRecord *records;
+    int count;
+    uint64_t duration_ns;
+    CorpusFile files[64];
+    int file_count;
+    Checkpoint *checkpoints;
+    int checkpoint_count;
+} Corpus;
+
+typedef struct {
+    uint64_t packets;
+    uint64_t input_packets;
+    uint64_t decode_errors;
+    uint64_t ticks;
+    uint64_t actions[3];            // By OutputActionType
+    uint64_t checksum;              // FNV-1a over every action
+} ReplayStats;
+
+static void checksum_actions(ReplayStats *stats, const OutputActions *actions) {
+    for (int i = 0; i < actions->count; i++) {
+        const OutputAction *action = &actions->actions[i];
+        // Moves are quantized to 1/16 px so last-bit float differences
+        // between builds don't change the checksum
+        int32_t values[5] = {
+            action->type, action->code, action->pressed,
+            (int32_t)(action->dx * 16.0f), (int32_t)(action->dy * 16.0f)
+        };
+        const uint8_t *bytes = (const uint8_t *)values;
+        for (size_t b = 0; b < sizeof(values); b++) {
+            stats->checksum = (stats->checksum ^ bytes[b]) * 0x100000001b3ull;
+        }
+        stats->actions[action->type]++;
+    }
+}
+
+static bool corpus_load(Corpus *corpus, const char *path) {
+    CaptureReader reader;
+    if (!capture_reader_open(&reader, path)) {
+        printf("❌ %s is not a capture file\n", path);
+        return false;
+    }
+
+    if (corpus->file_count == (int)(sizeof(corpus->files) / sizeof(corpus->files[0]))) {
+        printf("❌ Too many files\n");
+        capture_reader_close(&reader);
+        return false;
+    }
+    CorpusFile *file = &corpus->files[corpus->file_count++];
+    file->first_record = corpus->count;
+    file->base_ns = corpus->duration_ns;
+
+    int result;
+    CaptureRecord record;
+    static CaptureState state;
+    while ((result = capture_read(&reader, &record)) == 1) {
+        if (capture_state_collect(&state, &record) && state.length == CHECKPOINT_SIZE) {
+            if ((corpus->checkpoint_count & (corpus->checkpoint_count - 1)) == 0) {
+                int capacity = corpus->checkpoint_count ? corpus->checkpoint_count * 2 : 16;
+                Checkpoint *grown = realloc(corpus->checkpoints, capacity * sizeof(*grown));
+                if (!grown) {
+                    capture_reader_close(&reader);
+                    return false;
+                }
+                corpus->checkpoints = grown;
+            }
+            Checkpoint *checkpoint = &corpus->checkpoints[corpus->checkpoint_count++];
+            checkpoint->record = corpus->count;
+            memcpy(checkpoint->data, state.data, CHECKPOINT_SIZE);
+        }
+        if (record.direction != CAPTURE_DIR_IN) {
+            continue;
+        }
+        if ((corpus->count & (corpus->count - 1)) == 0) {
+            int capacity = corpus->count ? corpus->count * 2 : 1024;
+            CaptureRecord *grown = realloc(corpus->records, capacity * sizeof(*grown));
+            if (!grown) {
+                capture_reader_close(&reader);
+                return false;
+            }
+            corpus->records = grown;
+        }
+        // Concatenated files play back to back
+        record.timestamp_ns += corpus->duration_ns;
+        corpus->records[corpus->count++] = record;
+    }
+    capture_reader_close(&reader);
+    file->count = corpus->count - file->first_record;
+
+    if (result < 0) {
+        printf("⚠️  %s is truncated after %llu records\n", path, (unsigned long long)reader.records);
+    }
+    if (corpus->count > 0) {
+        corpus->duration_ns = corpus->records[corpus->count - 1].timestamp_ns + TICK_NS;
+    }
+    return true;
+}
+
+// Everything that carries over from one packet to the next
+typedef struct {
+    Mapper mapper;
+    OutputActions actions;
+    uint64_t last_ns;               // Last packet or output tick
+} Pipeline;
+
+static void pipeline_init(Pipeline *pipeline, const CompiledProfile *profile) {
+    mapper_init(&pipeline->mapper, profile);
+    pipeline->last_ns = REPLAY_EPOCH_NS;
+}
+
+// One packet, preceded by the output ticks the simulator would have run
+static inline void pipeline_packet(Pipeline *pipeline, const CaptureRecord *record, uint64_t now_ns,
+                                   ReplayStats *stats) {
+    Mapper *mapper = &pipeline->mapper;
+
+    // The simulator ticks whenever TICK_NS passes without a packet
+    while (mapper_tick_pending(mapper) && now_ns - pipeline->last_ns > TICK_NS) {
+        pipeline->last_ns += TICK_NS;
+        mapper_tick(mapper, pipeline->last_ns, &pipeline->actions);
+        checksum_actions(stats, &pipeline->actions);
+        stats->ticks++;
+    }
+    pipeline->last_ns = now_ns;
+
+    stats->packets++;
+    const GipHeader *header = gip_decode_header(record->data, record->length);
+    const GipInputPacket *input = gip_decode_input(record->data, record->length);
+    if (!header || (header->command == GIP_CMD_INPUT && !input)) {
+        stats->decode_errors++;
+        return;
+    }
+    if (input) {
+        stats->input_packets++;
+        mapper_process(mapper, input, now_ns, &pipeline->actions);
+        checksum_actions(stats, &pipeline->actions);
+    }
+}
+
+static void pipeline_release(Pipeline *pipeline, ReplayStats *stats) {
+    while (mapper_release_all(&pipeline->mapper, &pipeline->actions) > 0) {
+        checksum_actions(stats, &pipeline->actions);
+    }
+}
+
+static bool pipeline_save(const Pipeline *pipeline, uint64_t now_ns, uint8_t out[CHECKPOINT_SIZE]) {
+    uint64_t since_last = now_ns - pipeline->last_ns;
+    memcpy(out, &since_last, sizeof(since_last));
+    return mapper_save_state(&pipeline->mapper, out + 8);
+}
+
+static bool pipeline_restore(Pipeline *pipeline, const uint8_t in[CHECKPOINT_SIZE], uint64_t now_ns) {
+    uint64_t since_last;
+    memcpy(&since_last, in, sizeof(since_last));
+    pipeline->last_ns = now_ns - since_last;
+    return mapper_restore_state(&pipeline->mapper, in + 8, MAPPER_STATE_SIZE);
+}
+
+// One pass over the corpus with a fresh mapper, like a simulator session
+static void replay_corpus(const Corpus *corpus, const CompiledProfile *profile, ReplayStats *stats) {
+    static Pipeline pipeline;
+
+    pipeline_init(&pipeline, profile);
+    for (int i = 0; i < corpus->count; i++) {
+        const CaptureRecord *record = &corpus->records[i];
+        pipeline_packet(&pipeline, record, REPLAY_EPOCH_NS + record->timestamp_ns, stats);
+    }
+    pipeline_release(&pipeline, stats);
+}
+
+static uint64_t bench_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void stats_reset(ReplayStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->checksum = 0xcbf29ce484222325ull;
+}
+
+// ============================================================================
+// Checkpoints
+// ============================================================================
+
+// Checkpoints are taken and used on a per-file clock, so they don't depend on
+// which files were replayed before
+static uint64_t file_time_ns(const CorpusFile *file, const CaptureRecord *record) {
+    return REPLAY_EPOCH_NS + record->timestamp_ns - file->base_ns;
+}
+
+// Copy in_path with a checkpoint before the first packet of every interval
+static int write_checkpoints(const char *in_path, const char *out_path, uint64_t interval_ns,
+                             const CompiledProfile *profile) {
+    CaptureReader reader;
+    if (!capture_reader_open(&reader, in_path)) {
+        printf("❌ %s is not a capture file\n", in_path);
+        return 1;
+    }
+    static CaptureWriter writer;
+    const CaptureFileHeader *h = &reader.header;
+    bool opened = h->version == CAPTURE_VERSION_PACKED
+        ? capture_writer_open_packed(&writer, out_path, h->vendor_id, h->product_id, h->serial)
+        : capture_writer_open(&writer, out_path, h->vendor_id, h->product_id, h->serial);
+    if (!opened) {
+        printf("❌ Could not create %s\n", out_path);
+        capture_reader_close(&reader);
+        return 1;
+    }
+
+    static Pipeline pipeline;
+    ReplayStats stats;
+    stats_reset(&stats);
+    pipeline_init(&pipeline, profile);
+
+    CaptureRecord record;
+    uint64_t next_ns = interval_ns;
+    int checkpoints = 0;
+    int result;
+    bool ok = true;
+    while (ok && (result = capture_read(&reader, &record)) == 1) {
+        if (record.direction == CAPTURE_DIR_STATE) {
+            continue;   // Replaced by the new ones
+        }
+        if (record.direction == CAPTURE_DIR_IN) {
+            uint64_t now_ns = REPLAY_EPOCH_NS + record.timestamp_ns;
+            if (record.timestamp_ns >= next_ns) {
+                uint8_t checkpoint[CHECKPOINT_SIZE];
+                ok = pipeline_save(&pipeline, now_ns, checkpoint) &&
+                     capture_write_state(&writer, record.timestamp_ns, checkpoint, sizeof(checkpoint));
+                checkpoints++;
+                while (next_ns <= record.timestamp_ns) {
+                    next_ns += interval_ns;
+                }
+            }
+            pipeline_packet(&pipeline, &record, now_ns, &stats);
+        }
+        ok = ok && capture_write(&writer, record.timestamp_ns, record.direction, record.data, record.length);
+    }
+    ok = capture_writer_close(&writer) && ok;
+    capture_reader_close(&reader);
+
+    if (!ok || result < 0) {
+        printf("❌ Could not write %s\n", out_path);
+        return 1;
+    }
+    printf("✅ Wrote %s with %d checkpoints (%d bytes each)\n", out_path, checkpoints, CHECKPOINT_SIZE);
+    return 0;
+}
+
+// A run of packets between two checkpoints in one file
+typedef struct {
+    const CorpusFile *file;
+    int begin, end;                 // Records [begin, end)
+    const Checkpoint *checkpoint;   // NULL: the file's start
+    bool last;                      // Release held outputs at the end
+    ReplayStats stats;
+    bool failed;
+} Segment;
+
+static void replay_segment(const Corpus *corpus, const CompiledProfile *profile, Segment *segment) {
+    Pipeline pipeline;
+    stats_reset(&segment->stats);
+    pipeline_init(&pipeline, profile);
+    if (segment->checkpoint) {
+        uint64_t now_ns = file_time_ns(segment->file, &corpus->records[segment->begin]);
+        if (!pipeline_restore(&pipeline, segment->checkpoint->data, now_ns)) {
+            segment->failed = true;
+            return;
+        }
+    }
+    for (int i = segment->begin; i < segment->end; i++) {
+        const CaptureRecord *record = &corpus->records[i];
+        pipeline_packet(&pipeline, record, file_time_ns(segment->file, record), &segment->stats);
+    }
+    if (segment->last) {
+        pipeline_release(&pipeline, &segment->stats);
+    }
+}
+
+// The reference: each file replayed in one go, with the checksum cut at the
+// same records the segments start at
+static void replay_continuous(const Corpus *corpus, const CompiledProfile *profile,
+                              const Segment *segments, int count, ReplayStats *out) {
+    static Pipeline pipeline;
+    for (int s = 0; s < count; s++) {
+        const Segment *segment = &segments[s];
+        if (!segment->checkpoint) {
+            pipeline_init(&pipeline, profile);
+        }
+        stats_reset(&out[s]);
+        for (int i = segment->begin; i < segment->end; i++) {
+            const CaptureRecord *record = &corpus->records[i];
+            pipeline_packet(&pipeline, record, file_time_ns(segment->file, record), &out[s]);
+        }
+        if (segment->last) {
+            pipeline_release(&pipeline, &out[s]);
+        }
+    }
+}
+
+typedef struct {
+    const Corpus *corpus;
+    const CompiledProfile *profile;
+    Segment *segments;
+    int count;
+    atomic_int next;
+} SegmentPool;
+
+static void *segment_worker(void *arg) {
+    SegmentPool *pool = arg;
+    int s;
+    while ((s = atomic_fetch_add(&pool->next, 1)) < pool->count) {
+        replay_segment(pool->corpus, pool->profile, &pool->segments[s]);
+    }
+    return NULL;
+}
+
+static int build_segments(const Corpus *corpus, Segment **out) {
+    Segment *segments = calloc(corpus->checkpoint_count + corpus->file_count, sizeof(Segment));
+    int count = 0, c = 0;
+    for (int f = 0; f < corpus->file_count; f++) {
+        const CorpusFile *file = &corpus->files[f];
+        int end = file->first_record + file->count;
+        segments[count] = (Segment){ .file = file, .begin = file->first_record };
+        for (; c < corpus->checkpoint_count && corpus->checkpoints[c].record < end; c++) {
+            const Checkpoint *checkpoint = &corpus->checkpoints[c];
+            if (checkpoint->record <= segments[count].begin) {
+                continue;   // Nothing before it to split off
+            }
+            segments[count].end = checkpoint->record;
+            count++;
+            segments[count] = (Segment){ .file = file, .begin = checkpoint->record, .checkpoint = checkpoint };
+        }
+        segments[count].end = end;
+        segments[count].last = true;
+        count++;
+    }
+    *out = segments;
+    return count;
+}
+
+static int verify_segments(const Corpus *corpus, const CompiledProfile *profile, int threads) {
+    Segment *segments;
+    int count = build_segments(corpus, &segments);
+    ReplayStats *reference = calloc(count, sizeof(ReplayStats));
+
+    uint64_t start = bench_clock_ns();
+    replay_continuous(corpus, profile, segments, count, reference);
+    uint64_t continuous_ns = bench_clock_ns() - start;
+
+    SegmentPool pool = { corpus, profile, segments, count, 0 };
+    pthread_t workers[MAX_THREADS];
+    start = bench_clock_ns();
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&workers[t], NULL, segment_worker, &pool);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    uint64_t parallel_ns = bench_clock_ns() - start;
+
+    int mismatches = 0;
+    for (int s = 0; s < count; s++) {
+        if (segments[s].failed || segments[s].stats.checksum != reference[s].checksum ||
+            segments[s].stats.packets != reference[s].packets) {
+            double at = (corpus->records[segments[s].begin].timestamp_ns - segments[s].file->base_ns) / 1e9;
+            printf("  ❌ segment %d (file %d, %.1f s): %s\n", s, (int)(segments[s].file - corpus->files), at,
+                   segments[s].failed ? "checkpoint rejected (other profile?)" : "output differs");
+            mismatches++;
+        }
+    }
+    printf("Segments: %d files, %d checkpoints → %d segments on %d threads\n",
+           corpus->file_count, corpus->checkpoint_count, count, threads);
+    printf("  continuous %8.2f ms, segmented %8.2f ms\n", continuous_ns / 1e6, parallel_ns / 1e6);
+    if (mismatches == 0) {
+        printf("✅ All %d segments bit-identical to the continuous replay\n", count);
+    }
+    free(reference);
+    free(segments);
+    return mismatches ? 1 : 0;
+}
+
+// Replay one file from the last checkpoint at or before from_ns
+static bool replay_from(const Corpus *corpus, const CompiledProfile *profile, uint64_t from_ns,
+                        ReplayStats *stats) {
+    Segment segment = { .file = &corpus->files[0], .begin = 0, .end = corpus->count, .last = true };
+    for (int c = 0; c < corpus->checkpoint_count; c++) {
+        const Checkpoint *checkpoint = &corpus->checkpoints[c];
+        if (checkpoint->record < corpus->count &&
+            corpus->records[checkpoint->record].timestamp_ns <= from_ns) {
+            segment.begin = checkpoint->record;
+            segment.checkpoint = checkpoint;
+        }
+    }
+    printf("Starting at %.1f s (%s, skipped %d packets)\n",
+           segment.begin < corpus->count ? corpus->records[segment.begin].timestamp_ns / 1e9 : 0.0,
+           segment.checkpoint ? "checkpoint" : "no checkpoint before it, from the start", segment.begin);
+    replay_segment(corpus, profile, &segment);
+    *stats = segment.stats;
+    if (segment.failed) {
+        printf("❌ Checkpoint was taken with a different profile\n");
+    }
+    return !segment.failed;
+}
+
+int main(int argc, char **argv) {
+    int loops = 1;
+    bool bench = false;
+    bool quiet = false;
+    double checkpoint_every = 0.0;
+    const char *output_path = NULL;
+    double from = -1.0;
+    bool segments = false;
+    int threads = DEFAULT_THREADS;
+    const char *last_path = NULL;
+    Corpus corpus;
+    int files = 0;
+
+    memset(&corpus, 0, sizeof(corpus));
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+            checkpoint_every = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--segments") == 0) {
+            segments = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (argv[i][0] == '-' || !corpus_load(&corpus, argv[i])) {
+            printf("Usage: %s [--loops N] [--bench] [--quiet] FILE...\n", argv[0]);
+            return 1;
+        } else {
+            last_path = argv[i];
+            files++;
+        }
+    }
+    bool single_file = checkpoint_every > 0.0 || from >= 0.0;
+    if (files == 0 || corpus.count == 0 || loops < 1 || threads < 1 || threads > MAX_THREADS ||
+        (single_file && files != 1) || (checkpoint_every > 0.0) != (output_path != NULL)) {
+        printf("Usage: %s [--loops N] [--bench] [--quiet] FILE...\n"
+               "       %s --checkpoint-every SEC --output OUT.xcap FILE\n"
+               "       %s --from SEC FILE\n"
+               "       %s --segments [--threads N] FILE...\n", argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    ControllerMapping config = get_default_mapping();
+    CompiledProfile profile;
+    mapper_compile_profile(&config, NULL, &profile);
+
+    ReplayStats stats;
+    stats_reset(&stats);
+
+    if (checkpoint_every > 0.0) {
+        free(corpus.records);
+        return write_checkpoints(last_path, output_path, (uint64_t)(checkpoint_every * 1e9), &profile);
+    }
+    if (segments) {
+        int status = verify_segments(&corpus, &profile, threads);
+        free(corpus.records);
+        free(corpus.checkpoints);
+        return status;
+    }
+    if (from >= 0.0) {
+        if (!replay_from(&corpus, &profile, (uint64_t)(from * 1e9), &stats)) {
+            return 1;
+        }
+    } else if (!bench) {
+        for (int loop = 0; loop < loops; loop++) {
+            replay_corpus(&corpus, &profile, &stats);
+        }
+    } else {
+        // Enough passes per run to dwarf timer overhead; best run wins
+        int passes = loops;
+        while ((uint64_t)passes * corpus.count < BENCH_MIN_PACKETS) {
+            passes *= 2;
+        }
+        double best_ns = 0.0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            ReplayStats run_stats;
+            stats_reset(&run_stats);
+
+            uint64_t start = bench_clock_ns();
+            for (int pass = 0; pass < passes; pass++) {
+                replay_corpus(&corpus, &profile, &run_stats);
+            }
+            double per_packet = (double)(bench_clock_ns() - start) / run_stats.packets;
+            if (run == 0 || per_packet < best_ns) {
+                best_ns = per_packet;
+            }
+            if (run == 0) {
+                stats = run_stats;
+            }
+        }
+        printf("Replayed %d files, %d packets x %d passes, best of %d runs\n",
+               files, corpus.count, passes, BENCH_RUNS);
+        // Parsed by `make pgo-bench`
+        printf("result ns_per_packet=%.2f checksum=%016llx\n", best_ns, (unsigned long long)stats.checksum);
+        free(corpus.records);
+        free(corpus.checkpoints);
+        return 0;
+    }
+
+    if (!quiet) {
+        printf("Replayed %d files (%.1f s of input) x %d\n", files, corpus.duration_ns / 1e9, loops);
+        printf("  Packets:        %llu (%llu input, %llu decode errors)\n",
+               (unsigned long long)stats.packets, (unsigned long long)stats.input_packets,
+               (unsigned long long)stats.decode_errors);
+        printf("  Output ticks:   %llu\n", (unsigned long long)stats.ticks);
+        printf("  Key events:     %llu\n", (unsigned long long)stats.actions[OUTPUT_KEY]);
+        printf("  Mouse buttons:  %llu\n", (unsigned long long)stats.actions[OUTPUT_MOUSE_BUTTON]);
+        printf("  Mouse moves:    %llu\n", (unsigned long long)stats.actions[OUTPUT_MOUSE_MOVE]);
+        printf("  Checksum:       %016llx\n", (unsigned long long)stats.checksum);
+    }
+    free(corpus.records);
+    free(corpus.checkpoints);
+    return 0;
+}
@@ -0,0 +1,134 @@
+// ring_bench.c
+// Measures what the usb_helper/simulator split costs per packet: a forked
+// producer publishes packets into a usb_ring at a controller-like rate and
+// the consumer reports publish→pop latency, including the futex/pipe wakeup
+// of a consumer that was asleep (no controller or root needed).
+// Compile: make ring_bench
+// Run: ./ring_bench [--spin] [packets] [interval_us]
+//      (--spin: consumer polls the ring instead of sleeping, like the
+//       simulator's busy-poll mode)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "usb_ring.h"
+#include "gip_device.h"
+
+#define DEFAULT_PACKETS     4000
+#define DEFAULT_INTERVAL_US 1000
+
+// The split is worth it only if it stays well under one USB frame
+#define TARGET_P99_NS       20000
+
+static uint64_t bench_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_producer(UsbRing *ring, int packets, int interval_us) {
+    uint8_t packet[18] = { 0x20, 0x00, 0x00, 0x0e };
+    struct timespec interval = { 0, (long)interval_us * 1000 };
+
+    nanosleep(&(struct timespec){ 0, 50000000 }, NULL);    // Let the consumer attach
+    for (int i = 0; i < packets; i++) {
+        packet[2] = (uint8_t)i;
+        usb_ring_push(ring, packet, sizeof(packet), bench_clock_ns());
+        nanosleep(&interval, NULL);
+    }
+    usb_ring_set_state(ring, USB_RING_DISCONNECTED);
+}
+
+int main(int argc, char **argv) {
+    bool spin = argc > 1 && strcmp(argv[1], "--spin") == 0;
+    if (spin) {
+        argc--;
+        argv++;
+    }
+    int packets = argc > 1 ? atoi(argv[1]) : DEFAULT_PACKETS;
+    int interval_us = argc > 2 ? atoi(argv[2]) : DEFAULT_INTERVAL_US;
+    if (packets <= 0 || interval_us < 0) {
+        printf("Usage: ring_bench [--spin] [packets] [interval_us]\n");
+        return 1;
+    }
+
+    UsbRing *producer_ring;
+    if (usb_ring_create(&producer_ring, USB_RING_DEFAULT_CAPACITY, "bench") != GIP_OK) {
+        printf("❌ Could not create ring\n");
+        return 1;
+    }
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        printf("❌ socketpair failed\n");
+        return 1;
+    }
+
+    // Same hand-over as usb_helper: the consumer maps the fds it receives
+    if (usb_ring_send_fds(producer_ring, sockets[0]) != GIP_OK) {
+        printf("❌ Could not send ring fds\n");
+        return 1;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(sockets[1]);
+        run_producer(producer_ring, packets, interval_us);
+        usb_ring_close(producer_ring);
+        _exit(0);
+    }
+
+    UsbRing *ring;
+    if (usb_ring_attach(&ring, sockets[1]) != GIP_OK) {
+        printf("❌ Could not attach to ring\n");
+        return 1;
+    }
+    usb_ring_close(producer_ring);
+    close(sockets[0]);
+    close(sockets[1]);
+
+    printf("Ring latency: %d packets, one every %d us, consumer %s between packets\n\n",
+           packets, interval_us, spin ? "spinning" : "blocking");
+
+    uint64_t *latency = calloc(packets, sizeof(uint64_t));
+    int received = 0;
+    UsbRingPacket packet;
+    while (usb_ring_wait(ring, spin ? 0 : 100000) >= 0) {
+        while (usb_ring_pop(ring, &packet)) {
+            uint64_t now = bench_clock_ns();
+            if (received < packets) {
+                latency[received++] = now - packet.publish_ns;
+            }
+        }
+    }
+    uint64_t dropped = usb_ring_dropped(ring);
+    usb_ring_close(ring);
+    waitpid(child, NULL, 0);
+
+    if (received == 0) {
+        printf("❌ No packets received\n");
+        free(latency);
+        return 1;
+    }
+    qsort(latency, received, sizeof(uint64_t), compare_u64);
+    uint64_t p50 = latency[received / 2];
+    uint64_t p99 = latency[(int)(received * 0.99)];
+    uint64_t p999 = latency[(int)(received * 0.999)];
+    printf("  received %d, dropped %llu\n", received, (unsigned long long)dropped);
+    printf("  publish→pop  p50=%6.1fus p99=%6.1fus p99.9=%6.1fus max=%6.1fus\n",
+           p50 / 1000.0, p99 / 1000.0, p999 / 1000.0, latency[received - 1] / 1000.0);
+    if (p99 <= TARGET_P99_NS) {
+        printf("\n✅ p99 within the %d us target\n", TARGET_P99_NS / 1000);
+    } else {
+        printf("\n⚠️  p99 above the %d us target\n", TARGET_P99_NS / 1000);
+    }
+    free(latency);
+    return 0;
+}
@@ -0,0 +1,261 @@
+// rule_bench.c
+// Rule interpreter benchmark: compiles a 50-rule profile the same way
+// profilec does and runs it over a synthetic input stream (buttons pressed
+// and released, sticks and triggers wandering), then over the worst case
+// (every button held, sticks and triggers at full deflection, so no
+// condition can end early). Reports interpreter time and instructions per
+// packet, and what the rules add to mapper_process, against the 1 us per
+// packet budget.
+// Compile: make rule_bench
+// Run: ./rule_bench [packets]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "profile.h"
+#include "rules.h"
+#include "gip.h"
+
+#define DEFAULT_PACKETS     1000000
+#define RULE_COUNT          50
+#define RUNS                5           // Best of, to ride out preemption
+#define PACKET_INTERVAL_NS  4000000ull  // 250 Hz
+#define BUDGET_NS           1000.0
+
+// Ten shapes of rule, each used five times with different buttons and keys.
+// Formats take up to three button names; unused ones are ignored.
+static const struct {
+    const char *condition;
+    const char *action;
+} rule_shapes[10] = {
+    {"%s and ry > 0.5", "tap"},
+    {"%s and %s", "hold"},
+    {"(lt > 0.2 or rt > 0.2) and not %s", "hold"},
+    {"%s for 300ms", "tap"},
+    {"lx < -0.6 and ly >= 0.6 and not %s", "tap"},
+    {"not (%s or %s) and rx > 0.8", "hold"},
+    {"%s and (dpad_up or dpad_down) and lt > 0.5", "toggle"},
+    {"rt >= 0.9 and %s for 1s", "tap"},
+    {"(ly < -0.7 or ry < -0.7) and %s", "hold"},
+    {"%s and %s and %s", "tap"},
+};
+
+static const char *button_names[10] = {
+    "a", "b", "x", "y", "lb", "rb", "ls", "rs", "view", "menu"
+};
+
+static const char *key_names[10] = {
+    "F1", "F2", "F3", "F4", "F5", "Shift+F6", "Command+Z", "Q", "E", "mouse_middle"
+};
+
+static uint64_t bench_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static int16_t wander(int16_t value, uint32_t *rng) {
+    int next = value + (int)(xorshift(rng) % 4001) - 2000;
+    return (int16_t)(next > 32767 ? 32767 : next < -32767 ? -32767 : next);
+}
+
+static bool build_rules(RuleProgram *program) {
+    memset(program, 0, sizeof(*program));
+    for (int i = 0; i < RULE_COUNT; i++) {
+        char text[160], condition[96], error[128];
+        int shape = i % 10;
+        snprintf(condition, sizeof(condition), rule_shapes[shape].condition,
+                 button_names[(i / 10 + shape) % 10], button_names[(i / 10 + shape + 3) % 10],
+                 button_names[(i / 10 + shape + 7) % 10]);
+        snprintf(text, sizeof(text), "%s -> %s %s", condition, rule_shapes[shape].action,
+                 key_names[(i + i / 10) % 10]);
+        if (!profile_compile_rule(program, text, error, sizeof(error))) {
+            printf("❌ rule %d \"%s\": %s\n", i, text, error);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Gameplay-like stream: a button changes every ~20 packets, sticks and
+// triggers drift
+static void generate_packets(GipInputPacket *packets, int count) {
+    static const uint16_t masks[14] = {
+        XBOX_BTN_A, XBOX_BTN_B, XBOX_BTN_X, XBOX_BTN_Y, XBOX_BTN_LB, XBOX_BTN_RB,
+        XBOX_BTN_LS, XBOX_BTN_RS, XBOX_BTN_VIEW, XBOX_BTN_MENU, XBOX_BTN_DPAD_UP,
+        XBOX_BTN_DPAD_DOWN, XBOX_BTN_DPAD_LEFT, XBOX_BTN_DPAD_RIGHT
+    };
+    GipInputPacket packet;
+    uint32_t rng = 0x9e3779b9u;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.header.command = GIP_CMD_INPUT;
+    for (int i = 0; i < count; i++) {
+        if (xorshift(&rng) % 20 == 0) {
+            packet.buttons ^= masks[xorshift(&rng) % 14];
+        }
+        packet.left_stick_x = wander(packet.left_stick_x, &rng);
+        packet.left_stick_y = wander(packet.left_stick_y, &rng);
+        packet.right_stick_x = wander(packet.right_stick_x, &rng);
+        packet.right_stick_y = wander(packet.right_stick_y, &rng);
+        packet.left_trigger = (uint8_t)(xorshift(&rng) % 8 == 0 ? xorshift(&rng) : packet.left_trigger);
+        packet.right_trigger = (uint8_t)(xorshift(&rng) % 8 == 0 ? xorshift(&rng) : packet.right_trigger);
+        packets[i] = packet;
+    }
+}
+
+// Rule inputs as the mapper builds them (sticks ungated here)
+static void rule_input(const GipInputPacket *packet, RuleInput *input) {
+    input->buttons = packet->buttons;
+    input->axis[RULE_AXIS_LX] = packet->left_stick_y;
+    input->axis[RULE_AXIS_LY] = packet->left_stick_x;
+    input->axis[RULE_AXIS_RX] = packet->right_stick_y;
+    input->axis[RULE_AXIS_RY] = packet->right_stick_x;
+    input->axis[RULE_AXIS_LT] = packet->right_trigger;
+    input->axis[RULE_AXIS_RT] = packet->left_trigger;
+}
+
+typedef struct {
+    double ns;                  // Per packet, best run
+    double instructions;        // Per packet, mean
+    int max_instructions;
+    uint64_t switches;          // Rules switching on or off, whole run
+    uint64_t over_budget;
+} VmResult;
+
+static VmResult bench_vm(const RuleProgram *program, const RuleInput *inputs, int count) {
+    VmResult result = { .ns = 1e30 };
+
+    for (int run = 0; run < RUNS; run++) {
+        RuleState state;
+        uint64_t executed = 0, switches = 0, over = 0;
+        int max_instructions = 0;
+
+        memset(&state, 0, sizeof(state));
+        uint64_t start = bench_clock_ns();
+        for (int i = 0; i < count; i++) {
+            uint64_t rose, fell;
+            int n = rules_run(program, &state, &inputs[i], (uint64_t)(i + 1) * PACKET_INTERVAL_NS,
+                              &rose, &fell);
+            if (n < 0) {
+                over++;
+                continue;
+            }
+            executed += n;
+            max_instructions = n > max_instructions ? n : max_instructions;
+            switches += (uint64_t)__builtin_popcountll(rose | fell);
+        }
+        double ns = (bench_clock_ns() - start) / (double)count;
+
+        if (ns < result.ns) {
+            result.ns = ns;
+        }
+        result.instructions = executed / (double)count;
+        result.max_instructions = max_instructions;
+        result.switches = switches;
+        result.over_budget = over;
+    }
+    return result;
+}
+
+// mapper_process per packet, best run
+static double bench_mapper(const CompiledProfile *profile, const GipInputPacket *packets, int count,
+                           uint64_t *actions_out) {
+    static Mapper mapper;
+    static OutputActions actions;
+    double best = 1e30;
+
+    for (int run = 0; run < RUNS; run++) {
+        uint64_t total = 0;
+        mapper_init(&mapper, profile);
+        uint64_t start = bench_clock_ns();
+        for (int i = 0; i < count; i++) {
+            mapper_process(&mapper, &packets[i], (uint64_t)(i + 1) * PACKET_INTERVAL_NS, &actions);
+            total += actions.count;
+        }
+        double ns = (bench_clock_ns() - start) / (double)count;
+        best = ns < best ? ns : best;
+        *actions_out = total;
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    static CompiledProfile plain, with_rules;
+    int count = argc > 1 ? atoi(argv[1]) : DEFAULT_PACKETS;
+
+    if (argc > 2 || count < 1000) {
+        printf("Usage: %s [packets (at least 1000)]\n", argv[0]);
+        return 1;
+    }
+
+    ControllerMapping mapping = get_default_mapping();
+    mapper_compile_profile(&mapping, NULL, &plain);
+    with_rules = plain;
+    if (!build_rules(&with_rules.rules)) {
+        return 1;
+    }
+    const RuleProgram *program = &with_rules.rules;
+
+    GipInputPacket *packets = malloc(count * sizeof(GipInputPacket));
+    RuleInput *inputs = malloc(count * sizeof(RuleInput));
+    RuleInput *worst = malloc(count * sizeof(RuleInput));
+    if (!packets || !inputs || !worst) {
+        printf("❌ Out of memory\n");
+        return 1;
+    }
+    generate_packets(packets, count);
+    for (int i = 0; i < count; i++) {
+        rule_input(&packets[i], &inputs[i]);
+        worst[i].buttons = 0xFFFF;
+        for (int a = 0; a < RULE_AXIS_COUNT; a++) {
+            worst[i].axis[a] = (int16_t)(a >= RULE_AXIS_LT ? 255 : (i & 1) ? 32767 : -32767);
+        }
+    }
+
+    printf("Rule interpreter benchmark\n");
+    printf("==========================\n");
+    printf("%d rules (%d with timers), %d bytes of code, %d instructions at most; %d packets, best of %d\n\n",
+           program->count, program->timers, program->code_size, program->instructions, count, RUNS);
+
+    VmResult typical = bench_vm(program, inputs, count);
+    VmResult held = bench_vm(program, worst, count);
+    printf("Interpreter (rules_run):\n");
+    printf("  gameplay stream:  %6.1f ns/packet, %5.1f instructions/packet (max %d), %llu switches\n",
+           typical.ns, typical.instructions, typical.max_instructions, (unsigned long long)typical.switches);
+    printf("  everything held:  %6.1f ns/packet, %5.1f instructions/packet (max %d)\n",
+           held.ns, held.instructions, held.max_instructions);
+    if (typical.over_budget || held.over_budget) {
+        printf("  ⚠️  %llu packets ran out of instruction budget\n",
+               (unsigned long long)(typical.over_budget + held.over_budget));
+    }
+
+    uint64_t plain_actions, rule_actions;
+    double plain_ns = bench_mapper(&plain, packets, count, &plain_actions);
+    double rules_ns = bench_mapper(&with_rules, packets, count, &rule_actions);
+    printf("\nmapper_process (default profile):\n");
+    printf("  no rules:         %6.1f ns/packet, %llu actions\n", plain_ns, (unsigned long long)plain_actions);
+    printf("  %d rules:         %6.1f ns/packet, %llu actions (%+.1f ns/packet)\n", program->count,
+           rules_ns, (unsigned long long)rule_actions, rules_ns - plain_ns);
+
+    double slowest = held.ns > typical.ns ? held.ns : typical.ns;
+    if (rules_ns - plain_ns > slowest) {
+        slowest = rules_ns - plain_ns;
+    }
+    printf("\n%s %d rules: %.1f ns/packet at worst, budget %.0f ns\n",
+           slowest <= BUDGET_NS ? "✅" : "❌", program->count, slowest, BUDGET_NS);
+
+    free(packets);
+    free(inputs);
+    free(worst);
+    return slowest <= BUDGET_NS ? 0 : 1;
+}
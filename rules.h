@@ -0,0 +1,262 @@
+// rules.h
+// Conditional bindings: rule bytecode and its interpreter (part of libmapper)
+//
+// A rule in a text profile ("rule = lb and ry > 0.5 -> tap F5", grammar in
+// profile.c) is compiled once, when the profile is parsed, into a few bytes
+// of code appended to a RuleProgram. The program lives in the
+// CompiledProfile like everything else there - no pointers - so it is
+// mapped straight from profile files.
+//
+// The interpreter is an accumulator machine: one boolean register, loads
+// that set it from the input, NOT, and forward-only AND/OR jumps that skip
+// the rest of a condition once its outcome is known. Each condition ends
+// in RULE, which passes the register through the rule's `for` timer and
+// latch. There are no backward jumps, so a program runs at most as many
+// instructions as it has; the compiler caps that at
+// RULE_INSTRUCTION_BUDGET and the interpreter counts down from the same
+// budget anyway, so a damaged program can't run away. It reads no clocks
+// (time is passed in), allocates nothing and doesn't emit output itself:
+// it reports which rules switched on and off, and the mapper turns those
+// into key and mouse button actions.
+//
+// Opcodes (operands little-endian):
+//   RULE_OP_END
+//   RULE_OP_BUTTON mask16          acc = (buttons & mask) != 0
+//   RULE_OP_ABOVE axis8 value16    acc = axis > value   (raw units)
+//   RULE_OP_BELOW axis8 value16    acc = axis < value
+//   RULE_OP_NOT                    acc = !acc
+//   RULE_OP_AND_JUMP offset8       if !acc, skip offset bytes
+//   RULE_OP_OR_JUMP offset8        if acc, skip offset bytes
+//   RULE_OP_RULE index8            rule index's condition is acc
+//   RULE_OP_{BUTTON,ABOVE,BELOW}_{AND,OR} ... offset8
+//                                  the load, then the jump, in one dispatch
+//
+// Dispatch is most of the cost, so the compiler fuses every load that is
+// directly followed by a jump (most of them: "lb and ry > 0.5" is
+// BUTTON_AND, ABOVE, RULE) and folds "not" into axis compares.
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RULES_MAX                   64      // Latches are one uint64_t bit each
+#define RULE_TIMERS_MAX             16      // Rules with a `for` duration
+#define RULE_CHORD_MAX              3       // Keys pressed together by one rule
+#define RULE_CODE_MAX               4096
+#define RULE_CODE_SLACK             5       // Operands never read past the array
+#define RULE_INSTRUCTION_BUDGET     1024    // Per packet, for the whole program
+#define RULE_NO_TIMER               0xFF
+
+typedef enum {
+    RULE_OP_END,
+    RULE_OP_BUTTON,
+    RULE_OP_ABOVE,
+    RULE_OP_BELOW,
+    RULE_OP_NOT,
+    RULE_OP_AND_JUMP,
+    RULE_OP_OR_JUMP,
+    RULE_OP_RULE,
+    RULE_OP_BUTTON_AND,
+    RULE_OP_BUTTON_OR,
+    RULE_OP_ABOVE_AND,
+    RULE_OP_ABOVE_OR,
+    RULE_OP_BELOW_AND,
+    RULE_OP_BELOW_OR
+} RuleOp;
+
+// Inputs as the player sees them: x right, y up, triggers left/right as
+// labelled (GIP swaps both; the mapper swaps them back)
+typedef enum {
+    RULE_AXIS_LX,
+    RULE_AXIS_LY,
+    RULE_AXIS_RX,
+    RULE_AXIS_RY,
+    RULE_AXIS_LT,
+    RULE_AXIS_RT,
+    RULE_AXIS_COUNT
+} RuleAxis;
+
+typedef enum {
+    RULE_ACTION_TAP,            // Press and release once when the rule switches on
+    RULE_ACTION_HOLD,           // Held for as long as the rule is on
+    RULE_ACTION_TOGGLE          // Each time the rule switches on: press, or release
+} RuleAction;
+
+typedef enum {
+    RULE_TARGET_KEY,            // code = macOS virtual keycode
+    RULE_TARGET_MOUSE           // code = MouseButton (mapper.h)
+} RuleTarget;
+
+typedef struct {
+    uint8_t action;             // RuleAction
+    uint8_t count;              // Keys in the chord, pressed in order, released in reverse
+    uint8_t timer;              // Index into RuleState.timer_since_ns, or RULE_NO_TIMER
+    uint8_t target[RULE_CHORD_MAX];
+    uint16_t code[RULE_CHORD_MAX];
+    uint32_t for_ms;            // Condition must hold this long first
+} CompiledRule;
+
+typedef struct {
+    uint16_t code_size;
+    uint16_t instructions;      // Total; what the worst packet runs
+    uint8_t count;
+    uint8_t timers;
+    CompiledRule rules[RULES_MAX];
+    uint8_t code[RULE_CODE_MAX + RULE_CODE_SLACK];
+} RuleProgram;
+
+// Carried from packet to packet (and saved in mapper checkpoints)
+typedef struct {
+    uint64_t latched;           // Bit per rule: on after the last run
+    uint64_t toggled;           // Bit per toggle rule: its keys are down
+    uint16_t armed;             // Bit per timer: its condition is true
+    uint64_t timer_since_ns[RULE_TIMERS_MAX];   // Since when, while armed
+} RuleState;
+
+_Static_assert(RULE_TIMERS_MAX <= 16, "RuleState.armed has one bit per timer");
+
+typedef struct {
+    uint16_t buttons;
+    int16_t axis[RULE_AXIS_COUNT];
+} RuleInput;
+
+static inline const char *rule_axis_name(int axis) {
+    switch (axis) {
+        case RULE_AXIS_LX: return "lx";
+        case RULE_AXIS_LY: return "ly";
+        case RULE_AXIS_RX: return "rx";
+        case RULE_AXIS_RY: return "ry";
+        case RULE_AXIS_LT: return "lt";
+        case RULE_AXIS_RT: return "rt";
+        default:           return "?";
+    }
+}
+
+static inline uint16_t rule_operand16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+// One pass over the program. rose/fell get a bit for each rule that
+// switched on/off. Returns the instructions run, or -1 if the budget ran
+// out (the rules after that point keep their previous state).
+static inline int rules_run(const RuleProgram *program, RuleState *state, const RuleInput *input,
+                            uint64_t now_ns, uint64_t *rose, uint64_t *fell) {
+    const uint8_t *code = program->code;
+    int size = program->code_size < RULE_CODE_MAX ? program->code_size : RULE_CODE_MAX;
+    int budget = RULE_INSTRUCTION_BUDGET;
+    uint64_t latched = state->latched;
+    uint16_t armed = state->armed;
+    uint64_t on = 0, off = 0;
+    bool acc = false;
+    int pc = 0;
+
+    while (pc < size) {
+        if (--budget < 0) {
+            break;
+        }
+        const uint8_t *op = &code[pc];
+        switch (op[0]) {
+            case RULE_OP_BUTTON:
+                acc = (input->buttons & rule_operand16(op + 1)) != 0;
+                pc += 3;
+                break;
+            case RULE_OP_ABOVE:
+                acc = op[1] < RULE_AXIS_COUNT && input->axis[op[1]] > (int16_t)rule_operand16(op + 2);
+                pc += 4;
+                break;
+            case RULE_OP_BELOW:
+                acc = op[1] < RULE_AXIS_COUNT && input->axis[op[1]] < (int16_t)rule_operand16(op + 2);
+                pc += 4;
+                break;
+            case RULE_OP_NOT:
+                acc = !acc;
+                pc += 1;
+                break;
+            case RULE_OP_AND_JUMP:
+                pc += acc ? 2 : 2 + op[1];
+                break;
+            case RULE_OP_OR_JUMP:
+                pc += acc ? 2 + op[1] : 2;
+                break;
+            case RULE_OP_BUTTON_AND:
+                acc = (input->buttons & rule_operand16(op + 1)) != 0;
+                pc += acc ? 4 : 4 + op[3];
+                break;
+            case RULE_OP_BUTTON_OR:
+                acc = (input->buttons & rule_operand16(op + 1)) != 0;
+                pc += acc ? 4 + op[3] : 4;
+                break;
+            case RULE_OP_ABOVE_AND:
+                acc = op[1] < RULE_AXIS_COUNT && input->axis[op[1]] > (int16_t)rule_operand16(op + 2);
+                pc += acc ? 5 : 5 + op[4];
+                break;
+            case RULE_OP_ABOVE_OR:
+                acc = op[1] < RULE_AXIS_COUNT && input->axis[op[1]] > (int16_t)rule_operand16(op + 2);
+                pc += acc ? 5 + op[4] : 5;
+                break;
+            case RULE_OP_BELOW_AND:
+                acc = op[1] < RULE_AXIS_COUNT && input->axis[op[1]] < (int16_t)rule_operand16(op + 2);
+                pc += acc ? 5 : 5 + op[4];
+                break;
+            case RULE_OP_BELOW_OR:
+                acc = op[1] < RULE_AXIS_COUNT && input->axis[op[1]] < (int16_t)rule_operand16(op + 2);
+                pc += acc ? 5 + op[4] : 5;
+                break;
+            case RULE_OP_RULE: {
+                int index = op[1];
+                pc += 2;
+                if (index >= program->count || index >= RULES_MAX) {
+                    break;
+                }
+                const CompiledRule *rule = &program->rules[index];
+                if (rule->timer < RULE_TIMERS_MAX) {
+                    // A flag, not a zero time: now_ns may well be 0
+                    uint16_t timer = (uint16_t)(1u << rule->timer);
+                    if (!acc) {
+                        armed &= (uint16_t)~timer;
+                    } else if (!(armed & timer)) {
+                        armed |= timer;
+                        state->timer_since_ns[rule->timer] = now_ns;
+                    }
+                    acc = acc && now_ns - state->timer_since_ns[rule->timer] >= (uint64_t)rule->for_ms * 1000000ull;
+                }
+                uint64_t bit = 1ull << index;
+                if (acc != ((latched & bit) != 0)) {
+                    latched ^= bit;
+                    if (acc) {
+                        on |= bit;
+                    } else {
+                        off |= bit;
+                    }
+                }
+                break;
+            }
+            case RULE_OP_END:
+            default:
+                pc = size;
+                break;
+        }
+    }
+    state->latched = latched;
+    state->armed = armed;
+    *rose = on;
+    *fell = off;
+    return budget < 0 ? -1 : RULE_INSTRUCTION_BUDGET - budget;
+}
+
+// True while some `for` timer is running: its rule switches on with time
+// alone, so the caller has to keep running the program without packets
+static inline bool rules_pending(const RuleProgram *program, const RuleState *state) {
+    for (int i = 0; i < program->count && i < RULES_MAX; i++) {
+        const CompiledRule *rule = &program->rules[i];
+        if (rule->timer < RULE_TIMERS_MAX && (state->armed & (1u << rule->timer)) &&
+            !(state->latched & (1ull << i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // RULES_H
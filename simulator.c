@@ -1,60 +1,88 @@
 // simulator.c
 // Xbox Controller to Keyboard/Mouse Simulator
 // Builds on phase3_gip_test.c with keyboard/mouse injection
+// Protocol handling lives in libgip, input mapping in libmapper; this file
+// posts the mapper's output actions through CoreGraphics.
 // Compile: make simulator
 // Run: sudo ./simulator
+//      sudo ./simulator --profile FILE.xprof [--profile-name NAME]
+//          (compiled profiles from profilec; SIGUSR2 switches to the next one)
+//      ./simulator --helper [SOCKET]
+//          (packets from a running `sudo ./usb_helper`; no root needed here)
+//      sudo ./simulator --record FILE.xcap
+//          (also records every packet, packed, from a background thread)
+//      ./simulator --play FILE.xcap [--speed X] [--loop [N]]
+//          (drives the outputs from a capture, at its original timing)
+//      sudo ./simulator --plugin FILE.so[:CONFIG]... [--plugin-budget US]
+//          (custom input transforms ahead of the mapper, see xbox_plugin.h)
 
+#define _GNU_SOURCE  // pthread_setaffinity_np
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
-#include <math.h>
-#include <libusb.h>
+#include <time.h>
+#include <pthread.h>
 #include <ApplicationServices/ApplicationServices.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#endif
 #include "gip.h"
+#include "gip_protocol.h"
+#include "gip_device.h"
 #include "keymapping.h"
+#include "calibration.h"
+#include "mapper.h"
+#include "trace.h"
+#include "probes.h"
+#include "metrics.h"
+#include "profile.h"
+#include "usb_ring.h"
+#include "capture_async.h"
+#include "playback.h"
+#include "plugin_host.h"
 
-#define XBOX_VENDOR_ID  0x045e
-#define XBOX_PRODUCT_ID 0x02dd
+// Read timeouts: short while continuous output is needed, long when idle
+#define TICK_TIMEOUT_MS         10
+#define IDLE_TIMEOUT_MS         100
+
+// Give up on in-place recovery if errors keep coming back without any input
+// getting through in between
+#define MAX_RECOVERIES_IN_A_ROW 5
+
+// Plugin budget overruns are reported at most this often
+#define PLUGIN_REPORT_INTERVAL_NS   1000000000ull
+
+// Written on SIGUSR1 and at exit when tracing is enabled
+#define TRACE_OUTPUT_PATH       "simulator_trace.json"
 
 static int running = 1;
+static volatile sig_atomic_t trace_dump_requested = 0;
 static ControllerMapping config;
 
-// State tracking for keys (prevent redundant events)
-typedef struct {
-    bool keys[256];           // Track which keys are currently pressed
-    bool mouse_left;          // Left mouse button state
-    bool mouse_right;         // Right mouse button state
-    bool mouse_middle;        // Middle mouse button state
-    
-    // Previous controller state for change detection
-    uint16_t prev_buttons;
-    uint8_t prev_left_trigger;
-    uint8_t prev_right_trigger;
-    int16_t prev_left_stick_x;
-    int16_t prev_left_stick_y;
-    int16_t prev_right_stick_x;
-    int16_t prev_right_stick_y;
-    
-    // Current stick positions (for continuous movement)
-    int16_t current_left_stick_x;
-    int16_t current_left_stick_y;
-    int16_t current_right_stick_x;
-    int16_t current_right_stick_y;
-    
-    // Smoothed stick positions (for mouse mode)
-    float smoothed_right_x;
-    float smoothed_right_y;
-    float smoothed_left_x;
-    float smoothed_left_y;
-    
-    // Mouse delta accumulation
-    float mouse_dx;
-    float mouse_dy;
-} InputState;
-
-static InputState input_state = {0};
+// Outer-range calibration for the connected controller (see calibration.h)
+static StickCalibration calibration;
+static bool calibration_loaded = false;
+
+// Compiled bindings and per-controller state (see mapper.h)
+static CompiledProfile profile;
+static Mapper mapper;
+static OutputActions actions;
+
+// Compiled profile file mapped with --profile (see profile.h); the mapper
+// points straight into it
+static ProfileFile profile_file;
+static bool profile_file_mapped = false;
+static int profile_index = 0;
+static volatile sig_atomic_t profile_switch_requested = 0;
+
+// --record: packets are queued here and written by a background thread
+static CaptureAsync *recorder = NULL;
+
+// --plugin: input transforms run on every packet before the mapper
+static PluginHost plugins;
 
 // ============================================================================
 // Event Injection Functions
@@ -127,421 +155,667 @@ void send_mouse_movement(float dx, float dy) {
     }
 }
 
+static CGMouseButton cg_mouse_button(uint16_t button) {
+    switch (button) {
+        case MOUSE_BUTTON_RIGHT:  return kCGMouseButtonRight;
+        case MOUSE_BUTTON_MIDDLE: return kCGMouseButtonCenter;
+        case MOUSE_BUTTON_LEFT:
+        default:                  return kCGMouseButtonLeft;
+    }
+}
+
+// Post the mapper's output actions, in order
+void post_actions(const OutputActions *out) {
+    for (int i = 0; i < out->count; i++) {
+        const OutputAction *action = &out->actions[i];
+        switch (action->type) {
+            case OUTPUT_KEY:
+                send_key_event(action->code, action->pressed);
+                metrics_inc(METRIC_EVENTS_KEY);
+                break;
+            case OUTPUT_MOUSE_BUTTON:
+                send_mouse_button_event(cg_mouse_button(action->code), action->pressed);
+                metrics_inc(METRIC_EVENTS_MOUSE_BUTTON);
+                break;
+            case OUTPUT_MOUSE_MOVE:
+                send_mouse_movement(action->dx, action->dy);
+                metrics_inc(METRIC_EVENTS_MOUSE_MOVE);
+                break;
+        }
+    }
+}
+
 // ============================================================================
-// Input Processing Functions
+// Packet Handling
 // ============================================================================
 
-void apply_deadzone(int16_t *x, int16_t *y, int16_t deadzone) {
-    float magnitude = sqrtf((float)(*x) * (*x) + (float)(*y) * (*y));
+void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+    printf("\nShutting down...\n");
+}
+
+void trace_signal_handler(int sig) {
+    (void)sig;
+    trace_dump_requested = 1;
+}
+
+void profile_signal_handler(int sig) {
+    (void)sig;
+    profile_switch_requested = 1;
+}
+
+// Export the pipeline trace (see trace.h) if one was requested
+static void dump_trace_if_requested(void) {
+    if (!trace_dump_requested) {
+        return;
+    }
+    trace_dump_requested = 0;
     
-    if (magnitude < deadzone) {
-        *x = 0;
-        *y = 0;
-    } else if (magnitude > 32767) {
-        // Normalize if outside unit circle
-        float scale = 32767.0f / magnitude;
-        *x = (int16_t)(*x * scale);
-        *y = (int16_t)(*y * scale);
+    int events = trace_export_chrome_json(TRACE_OUTPUT_PATH);
+    if (events >= 0) {
+        printf("\n📈 Wrote %d trace events to %s (open in ui.perfetto.dev)\n", events, TRACE_OUTPUT_PATH);
+    } else {
+        printf("\n❌ Could not write %s\n", TRACE_OUTPUT_PATH);
     }
 }
 
-void process_buttons(uint16_t buttons) {
-    // Check each button for state changes
-    struct {
-        uint16_t mask;
-        uint16_t keycode;
-    } button_map[] = {
-        {XBOX_BTN_A, config.buttons.key_a},
-        {XBOX_BTN_B, config.buttons.key_b},
-        {XBOX_BTN_X, config.buttons.key_x},
-        {XBOX_BTN_Y, config.buttons.key_y},
-        {XBOX_BTN_LB, config.buttons.key_lb},
-        {XBOX_BTN_RB, config.buttons.key_rb},
-        {XBOX_BTN_LS, config.buttons.key_ls},
-        {XBOX_BTN_RS, config.buttons.key_rs},
-        {XBOX_BTN_VIEW, config.buttons.key_view},
-        {XBOX_BTN_MENU, config.buttons.key_menu},
-        {XBOX_BTN_DPAD_UP, config.buttons.key_dpad_up},
-        {XBOX_BTN_DPAD_DOWN, config.buttons.key_dpad_down},
-        {XBOX_BTN_DPAD_LEFT, config.buttons.key_dpad_left},
-        {XBOX_BTN_DPAD_RIGHT, config.buttons.key_dpad_right}
-    };
-    
-    for (int i = 0; i < 14; i++) {
-        bool is_pressed = (buttons & button_map[i].mask) != 0;
-        bool was_pressed = (input_state.prev_buttons & button_map[i].mask) != 0;
-        
-        if (is_pressed != was_pressed) {
-            send_key_event(button_map[i].keycode, is_pressed);
-            input_state.keys[button_map[i].keycode] = is_pressed;
-        }
+// Move to the next profile in the mapped file. Held outputs are released
+// under the old profile first; the switch itself is a pointer change.
+static void switch_profile_if_requested(void) {
+    if (!profile_switch_requested) {
+        return;
+    }
+    profile_switch_requested = 0;
+    if (!profile_file_mapped || profile_file.header->count < 2) {
+        return;
     }
     
-    input_state.prev_buttons = buttons;
+    while (mapper_release_all(&mapper, &actions) > 0) {
+        post_actions(&actions);
+    }
+    profile_index = (profile_index + 1) % profile_file.header->count;
+    mapper_init(&mapper, profile_file_get(&profile_file, profile_index));
+    printf("\n🎮 Switched to profile [%s]\n", profile_file.entries[profile_index].name);
 }
 
-void process_triggers(uint8_t left_trigger, uint8_t right_trigger) {
-    // Right trigger (swapped - GIP packet has them reversed)
-    bool right_pressed = left_trigger > config.triggers.threshold;
-    bool right_was_pressed = input_state.prev_right_trigger > config.triggers.threshold;
-    
-    if (right_pressed != right_was_pressed) {
-        if (config.triggers.right_trigger_mode == TRIGGER_MODE_MOUSE) {
-            send_mouse_button_event(kCGMouseButtonRight, right_pressed);
-            input_state.mouse_right = right_pressed;
-        } else if (config.triggers.right_trigger_mode == TRIGGER_MODE_KEY) {
-            send_key_event(config.triggers.right_trigger_key, right_pressed);
-            input_state.keys[config.triggers.right_trigger_key] = right_pressed;
-        }
+// Packet counters, arrival interval and input sequence gaps
+static void count_packet(const GipHeader *header, bool is_input, int transferred, uint64_t now_ns) {
+    static uint64_t last_packet_ns = 0;
+    static uint8_t last_input_sequence = 0;
+    static bool have_input_sequence = false;
+    
+    metrics_inc(METRIC_PACKETS);
+    metrics_add(METRIC_BYTES, transferred);
+    if (last_packet_ns) {
+        metrics_observe_ns(METRIC_PACKET_INTERVAL, now_ns - last_packet_ns);
     }
+    last_packet_ns = now_ns;
     
-    // Left trigger (swapped - GIP packet has them reversed)
-    bool left_pressed = right_trigger > config.triggers.threshold;
-    bool left_was_pressed = input_state.prev_left_trigger > config.triggers.threshold;
-    
-    if (left_pressed != left_was_pressed) {
-        if (config.triggers.left_trigger_mode == TRIGGER_MODE_MOUSE) {
-            send_mouse_button_event(kCGMouseButtonLeft, left_pressed);
-            input_state.mouse_left = left_pressed;
-        } else if (config.triggers.left_trigger_mode == TRIGGER_MODE_KEY) {
-            send_key_event(config.triggers.left_trigger_key, left_pressed);
-            input_state.keys[config.triggers.left_trigger_key] = left_pressed;
+    if (!header) {
+        metrics_inc(METRIC_DECODE_ERRORS);
+    } else if (header->command == GIP_CMD_INPUT) {
+        if (!is_input) {
+            metrics_inc(METRIC_DECODE_ERRORS);
+            return;
         }
+        // Sequence numbers wrap at 256; a large jump backwards is a reorder, not a gap
+        uint8_t missing = (uint8_t)(header->sequence - last_input_sequence - 1);
+        if (have_input_sequence && missing != 0 && missing < 128) {
+            metrics_add(METRIC_SEQUENCE_GAPS, missing);
+        }
+        last_input_sequence = header->sequence;
+        have_input_sequence = true;
     }
-    
-    input_state.prev_left_trigger = right_trigger;  // Swapped
-    input_state.prev_right_trigger = left_trigger;  // Swapped
 }
 
-void process_stick_as_keys(int16_t x, int16_t y, uint16_t key_up, uint16_t key_down, 
-                           uint16_t key_left, uint16_t key_right) {
-    // Axes are swapped in the controller - swap them back
-    // Physical up/down is reported in X, physical left/right is reported in Y
-    int16_t temp = x;
-    x = y;
-    y = temp;
-    
-    // Normalize to -1.0 to 1.0
-    float norm_x = x / 32767.0f;
-    float norm_y = y / 32767.0f;
-    
-    // Determine which directions are active (with threshold)
-    bool up = (norm_y > 0.3f);
-    bool down = (norm_y < -0.3f);
-    bool left = (norm_x < -0.3f);
-    bool right = (norm_x > 0.3f);
-    
-    // Send key events for state changes
-    if (up != input_state.keys[key_up]) {
-        send_key_event(key_up, up);
-        input_state.keys[key_up] = up;
-    }
-    if (down != input_state.keys[key_down]) {
-        send_key_event(key_down, down);
-        input_state.keys[key_down] = down;
-    }
-    if (left != input_state.keys[key_left]) {
-        send_key_event(key_left, left);
-        input_state.keys[key_left] = left;
-    }
-    if (right != input_state.keys[key_right]) {
-        send_key_event(key_right, right);
-        input_state.keys[key_right] = right;
+// Budget overruns since the last report, at most once per interval
+static void report_plugin_overruns(uint64_t now_ns) {
+    static uint64_t last_report_ns = 0;
+    if (now_ns - last_report_ns < PLUGIN_REPORT_INTERVAL_NS) {
+        return;
     }
+    last_report_ns = now_ns;
+    metrics_add(METRIC_PLUGIN_OVERRUNS, plugin_host_report_overruns(&plugins));
 }
 
-void process_stick_as_mouse(int16_t x, int16_t y, float *smoothed_x, float *smoothed_y) {
-    // Axes are swapped in the controller - swap them back
-    // Physical up/down is reported in X, physical left/right is reported in Y
-    int16_t temp = x;
-    x = y;
-    y = temp;
-    
-    // Normalize to -1.0 to 1.0
-    float target_x = x / 32767.0f;
-    float target_y = -y / 32767.0f;  // Invert Y - pushing up should move cursor up
-    
-    // Exponential smoothing (higher smoothing = smoother but more lag)
-    // alpha determines how much of the new value vs old value to use
-    // smoothing = 0.0 means no smoothing (all new value)
-    // smoothing = 0.9 means heavy smoothing (mostly old value)
-    float alpha = 1.0f - config.sticks.mouse_smoothing;
-    *smoothed_x = alpha * target_x + (1.0f - alpha) * (*smoothed_x);
-    *smoothed_y = alpha * target_y + (1.0f - alpha) * (*smoothed_y);
-    
-    // Use smoothed values for movement
-    float norm_x = *smoothed_x;
-    float norm_y = *smoothed_y;
-    
-    // Apply exponential curve for better control
-    float sign_x = (norm_x >= 0) ? 1.0f : -1.0f;
-    float sign_y = (norm_y >= 0) ? 1.0f : -1.0f;
-    
-    float curved_x = sign_x * powf(fabsf(norm_x), config.sticks.mouse_curve);
-    float curved_y = sign_y * powf(fabsf(norm_y), config.sticks.mouse_curve);
-    
-    // Scale by sensitivity
-    float dx = curved_x * config.sticks.mouse_sensitivity * 15.0f;
-    float dy = curved_y * config.sticks.mouse_sensitivity * 15.0f;
-    
-    // Accumulate deltas (sent in main loop)
-    input_state.mouse_dx += dx;
-    input_state.mouse_dy += dy;
-}
-
-void process_sticks(int16_t left_x, int16_t left_y, int16_t right_x, int16_t right_y) {
-    // Apply deadzones
-    apply_deadzone(&left_x, &left_y, config.sticks.deadzone);
-    apply_deadzone(&right_x, &right_y, config.sticks.deadzone);
-    
-    // Process left stick
-    switch (config.sticks.left_stick_mode) {
-        case STICK_MODE_WASD:
-            process_stick_as_keys(left_x, left_y, 
-                                 config.sticks.left_up, config.sticks.left_down,
-                                 config.sticks.left_left, config.sticks.left_right);
-            break;
-        case STICK_MODE_ARROWS:
-            process_stick_as_keys(left_x, left_y, 0x7E, 0x7D, 0x7B, 0x7C);
-            break;
-        case STICK_MODE_MOUSE:
-            process_stick_as_mouse(left_x, left_y, 
-                                  &input_state.smoothed_left_x, 
-                                  &input_state.smoothed_left_y);
-            break;
-        case STICK_MODE_DISABLED:
-        default:
-            break;
-    }
+// Translate one received GIP packet into keyboard/mouse events
+void handle_packet(const uint8_t *buffer, int transferred, uint64_t now_ns) {
+    static int input_count = 0;
+    uint64_t start = TRACE_BEGIN();
     
-    // Process right stick
-    switch (config.sticks.right_stick_mode) {
-        case STICK_MODE_WASD:
-            process_stick_as_keys(right_x, right_y, 
-                                 config.sticks.left_up, config.sticks.left_down,
-                                 config.sticks.left_left, config.sticks.left_right);
-            break;
-        case STICK_MODE_ARROWS:
-            process_stick_as_keys(right_x, right_y, 0x7E, 0x7D, 0x7B, 0x7C);
-            break;
-        case STICK_MODE_MOUSE:
-            process_stick_as_mouse(right_x, right_y, 
-                                  &input_state.smoothed_right_x, 
-                                  &input_state.smoothed_right_y);
-            break;
-        case STICK_MODE_DISABLED:
-        default:
-            break;
+    if (recorder && !capture_async_write(recorder, now_ns, CAPTURE_DIR_IN, buffer, transferred)) {
+        metrics_inc(METRIC_CAPTURE_DROPPED);
     }
     
-    // Always send accumulated mouse movement if any exists (no minimum threshold)
-    if (input_state.mouse_dx != 0.0f || input_state.mouse_dy != 0.0f) {
-        send_mouse_movement(input_state.mouse_dx, input_state.mouse_dy);
-        input_state.mouse_dx = 0.0f;
-        input_state.mouse_dy = 0.0f;
+    const GipHeader *header = gip_decode_header(buffer, transferred);
+    const GipInputPacket *input = gip_decode_input(buffer, transferred);
+    count_packet(header, input != NULL, transferred, now_ns);
+    if (!header) {
+        return;
     }
     
-    // Store current positions for continuous movement generation
-    input_state.current_left_stick_x = left_x;
-    input_state.current_left_stick_y = left_y;
-    input_state.current_right_stick_x = right_x;
-    input_state.current_right_stick_y = right_y;
+    TRACE_SPAN(TRACE_STAGE_USB, now_ns, start, header->sequence);
+    TRACE_END(TRACE_STAGE_DECODE, start, header->sequence);
+    PROBE_PACKET_RECEIVED(header->sequence, transferred, now_ns);
+    PROBE_PACKET_DECODED(header->sequence, header->command, input ? input->buttons : 0);
     
-    input_state.prev_left_stick_x = left_x;
-    input_state.prev_left_stick_y = left_y;
-    input_state.prev_right_stick_x = right_x;
-    input_state.prev_right_stick_y = right_y;
+    if (input) {
+        GipInputPacket transformed;
+        input_count++;
+        
+        // Plugins see the packet first; everything after sees their output
+        if (plugins.count > 0) {
+            start = TRACE_BEGIN();
+            transformed = *input;
+            metrics_observe_ns(METRIC_PLUGIN_TIME, plugin_host_process_packet(&plugins, &transformed, now_ns));
+            input = &transformed;
+            TRACE_END(TRACE_STAGE_PLUGINS, start, header->sequence);
+        }
+        
+        // Map and inject input events (updates stick positions)
+        start = TRACE_BEGIN();
+        mapper_process(&mapper, input, now_ns, &actions);
+        TRACE_END(TRACE_STAGE_MAP, start, header->sequence);
+        
+        start = TRACE_BEGIN();
+        post_actions(&actions);
+        TRACE_END(TRACE_STAGE_POST, start, header->sequence);
+        
+        uint64_t latency_ns = gip_monotonic_ns() - now_ns;
+        metrics_observe_ns(METRIC_POST_LATENCY, latency_ns);
+        PROBE_OUTPUT_POSTED(header->sequence, actions.count, latency_ns);
+        if (plugins.count > 0) {
+            report_plugin_overruns(now_ns);
+        }
+        
+        // Console output (if enabled)
+        if (config.console_output_enabled) {
+            start = TRACE_BEGIN();
+            printf("\r[%04d] ", input_count);
+            printf("BTN: ");
+            if (input->buttons) {
+                print_buttons(input->buttons);
+            } else {
+                printf("none ");
+            }
+            printf("%-40s", "");
+            printf("\r[%04d] BTN: ", input_count);
+            print_buttons(input->buttons);
+            printf("| LT:%3d RT:%3d ", input->left_trigger, input->right_trigger);
+            printf("| LS:(%6d,%6d) RS:(%6d,%6d)  ",
+                   input->left_stick_x, input->left_stick_y,
+                   input->right_stick_x, input->right_stick_y);
+            fflush(stdout);
+            TRACE_END(TRACE_STAGE_CONSOLE, start, header->sequence);
+        }
+        
+    } else if (header->command == GIP_CMD_GUIDE_BUTTON && 
+              config.console_output_enabled) {
+        printf("\n🎮 GUIDE BUTTON PRESSED\n");
+    }
 }
 
-// Generate continuous mouse movement from currently held stick positions
+// Continuous mouse/kinetic output from held stick positions
 // This is called every frame, even when no new USB packet arrives
-void generate_continuous_movement() {
-    // Use the last known stick positions to generate movement
-    int16_t left_x = input_state.current_left_stick_x;
-    int16_t left_y = input_state.current_left_stick_y;
-    int16_t right_x = input_state.current_right_stick_x;
-    int16_t right_y = input_state.current_right_stick_y;
-    
-    // Apply deadzones
-    apply_deadzone(&left_x, &left_y, config.sticks.deadzone);
-    apply_deadzone(&right_x, &right_y, config.sticks.deadzone);
-    
-    // Generate mouse movement if sticks are in mouse mode
-    if (config.sticks.left_stick_mode == STICK_MODE_MOUSE) {
-        process_stick_as_mouse(left_x, left_y, 
-                              &input_state.smoothed_left_x, 
-                              &input_state.smoothed_left_y);
-    }
-    
-    if (config.sticks.right_stick_mode == STICK_MODE_MOUSE) {
-        process_stick_as_mouse(right_x, right_y, 
-                              &input_state.smoothed_right_x, 
-                              &input_state.smoothed_right_y);
-    }
-    
-    // Send accumulated mouse movement
-    if (input_state.mouse_dx != 0.0f || input_state.mouse_dy != 0.0f) {
-        send_mouse_movement(input_state.mouse_dx, input_state.mouse_dy);
-        input_state.mouse_dx = 0.0f;
-        input_state.mouse_dy = 0.0f;
-    }
+static void output_tick(void) {
+    uint64_t start = TRACE_BEGIN();
+    mapper_tick(&mapper, gip_monotonic_ns(), &actions);
+    post_actions(&actions);
+    TRACE_END(TRACE_STAGE_TICK, start, 0);
 }
 
-// ============================================================================
-// GIP Protocol Functions (from phase3)
-// ============================================================================
+// Input failed with something other than a disconnect. Release whatever the
+// mapper is holding (the user can't let go of it while input is down), then
+// walk the recovery ladder. Whatever is still held is pressed again by the
+// first packet after recovery; filters and kinetic glides are kept.
+static int recoveries_in_a_row = 0;
 
-void signal_handler(int sig) {
-    (void)sig;
-    running = 0;
-    printf("\nShutting down...\n");
+static bool recover_input(GipDevice *dev, int error) {
+    if (++recoveries_in_a_row > MAX_RECOVERIES_IN_A_ROW) {
+        printf("\n❌ %s keeps coming back, giving up\n", gip_strerror(error));
+        return false;
+    }
+    printf("\n⚠️  USB error: %s, recovering...\n", gip_strerror(error));
+    while (mapper_release_all(&mapper, &actions) > 0) {
+        post_actions(&actions);
+    }
+    metrics_gauge_set(METRIC_CONNECTED, 0);
+    
+    GipRecoveryOps ops;
+    GipRecoveryPolicy policy = GIP_RECOVERY_DEFAULT_POLICY;
+    GipRecoveryResult recovery;
+    gip_device_recovery_ops(dev, &ops);
+    int result = gip_recover(&ops, &policy, error, &recovery);
+    if (result != GIP_OK) {
+        printf("❌ Could not recover after %d attempts: %s\n", recovery.attempts, gip_strerror(result));
+        return false;
+    }
+    
+    metrics_inc(METRIC_USB_RECOVERIES);
+    metrics_gauge_set(METRIC_CONNECTED, 1);
+    printf("✅ Recovered by %s in %.1f ms (%d attempts)\n", gip_recovery_step_name(recovery.step),
+           recovery.elapsed_ns / 1e6, recovery.attempts);
+    return true;
 }
 
-int send_ack(libusb_device_handle *handle, uint8_t out_endpoint, uint8_t sequence) {
-    uint8_t ack_packet[] = {
-        GIP_CMD_ACKNOWLEDGE, 0x20, sequence, 0x09,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
-    
-    int transferred;
-    int result = libusb_interrupt_transfer(handle, out_endpoint, ack_packet,
-                                          sizeof(ack_packet), &transferred, 1000);
-    
-    if (result == 0 && config.console_output_enabled) {
-        printf("  → Sent ACK (seq=%d)\n", sequence);
+static void print_loop_banner(void) {
+    printf("=== Xbox Controller Simulator Active ===\n");
+    printf("Controller input is now being translated to keyboard/mouse\n");
+    if (config.console_output_enabled) {
+        printf("Console output: ENABLED (see input below)\n");
+    } else {
+        printf("Console output: DISABLED\n");
+    }
+    if (config.busy_poll_enabled) {
+        printf("Busy-poll mode: ENABLED (spinning on CPU %d, blocking after %d ms idle)\n",
+               config.busy_poll_cpu, config.busy_poll_idle_ms);
+    }
+    if (config.metrics_socket_path) {
+        printf("Metrics: curl --unix-socket %s http://localhost/metrics\n", config.metrics_socket_path);
+    }
+    if (config.metrics_textfile_path) {
+        printf("Metrics: written to %s every %d ms\n", config.metrics_textfile_path,
+               config.metrics_interval_ms);
     }
-    return (result == 0) ? 0 : -1;
+    if (config.trace_enabled) {
+        printf("Tracing: ENABLED (kill -USR1 %d writes %s)\n", (int)getpid(), TRACE_OUTPUT_PATH);
+    }
+    printf("Press Ctrl+C to exit\n\n");
 }
 
-int initialize_controller(libusb_device_handle *handle, uint8_t in_endpoint, 
-                         uint8_t out_endpoint) {
+void input_loop(GipDevice *dev) {
     uint8_t buffer[64];
     int transferred;
     int result;
     
-    if (config.console_output_enabled) {
-        printf("\n=== Initializing Controller ===\n");
-        printf("Performing GIP handshake...\n\n");
-    }
+    print_loop_banner();
     
-    for (int attempt = 0; attempt < 5; attempt++) {
-        result = libusb_interrupt_transfer(handle, in_endpoint, buffer,
-                                          sizeof(buffer), &transferred, 2000);
+    while (running) {
+        dump_trace_if_requested();
+        switch_profile_if_requested();
+        
+        // 10ms timeout for smoother mouse; block longer once nothing needs ticks
+        unsigned int timeout = mapper_tick_pending(&mapper) ? TICK_TIMEOUT_MS : IDLE_TIMEOUT_MS;
+        result = gip_device_read(dev, buffer, sizeof(buffer), &transferred, timeout);
         
-        if (result == 0 && transferred >= (int)sizeof(GipHeader)) {
-            GipHeader *header = (GipHeader *)buffer;
+        if (result == 0) {
+            recoveries_in_a_row = 0;
+            handle_packet(buffer, transferred, gip_monotonic_ns());
             
-            if (config.console_output_enabled) {
-                printf("  Received: %s (0x%02x), seq=%d\n",
-                       gip_command_name(header->command), header->command, header->sequence);
-            }
+        } else if (result == GIP_ERROR_TIMEOUT) {
+            // Timeout: No new packet, but generate movement from held stick positions
+            metrics_inc(METRIC_TIMEOUTS);
+            output_tick();
             
-            if (header->command == GIP_CMD_ANNOUNCE) {
-                send_ack(handle, out_endpoint, header->sequence);
-            }
-        } else if (result == LIBUSB_ERROR_TIMEOUT) {
+        } else if (result == GIP_ERROR_NO_DEVICE) {
+            printf("\n❌ Controller disconnected!\n");
+            break;
+            
+        } else if (!recover_input(dev, result)) {
             break;
         }
     }
     
-    if (config.console_output_enabled) {
-        printf("\n✅ Initialization complete!\n");
-        printf("Sending POWER ON command...\n");
+    printf("\n\n");
+}
+
+// ============================================================================
+// Busy-Poll Input Loop (opt-in, trades one CPU core for latency)
+// ============================================================================
+
+// Log2-bucketed latency histogram: bucket i counts samples in [2^i, 2^(i+1)) ns
+typedef struct {
+    uint64_t buckets[40];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} LatencyHistogram;
+
+// Busy-poll bookkeeping, updated from the packet callback
+typedef struct {
+    LatencyHistogram processing[2];  // [0] spinning, [1] blocking
+    LatencyHistogram jitter[2];
+    uint64_t last_packet_ns;
+    uint64_t prev_interval_ns;
+    bool spinning;
+} BusyPollStats;
+
+static void histogram_record(LatencyHistogram *h, uint64_t ns) {
+    int bucket = 0;
+    while (bucket < 39 && (ns >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    h->buckets[bucket]++;
+    h->count++;
+    h->total_ns += ns;
+    if (ns > h->max_ns) {
+        h->max_ns = ns;
+    }
+}
+
+// Upper bound of the bucket holding the given percentile
+static uint64_t histogram_percentile(const LatencyHistogram *h, double percentile) {
+    uint64_t target = (uint64_t)(h->count * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < 40; i++) {
+        seen += h->buckets[i];
+        if (seen > target) {
+            return 2ull << i;
+        }
+    }
+    return h->max_ns;
+}
+
+static void histogram_print(const char *name, const LatencyHistogram *h) {
+    if (h->count == 0) {
+        printf("  %-26s no samples\n", name);
+        return;
+    }
+    printf("  %-26s n=%-8llu mean=%6.1fus p50<%6.1fus p99<%6.1fus max=%6.1fus\n", name,
+           (unsigned long long)h->count, h->total_ns / (double)h->count / 1000.0,
+           histogram_percentile(h, 50) / 1000.0, histogram_percentile(h, 99) / 1000.0,
+           h->max_ns / 1000.0);
+}
+
+// Spin-wait hint: lets the sibling hyperthread run and saves power
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Pin the polling thread to one (ideally isolated) core. macOS only takes
+// this as an affinity hint; Linux pins hard.
+static void pin_to_cpu(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        printf("⚠️  Could not pin to CPU %d\n", cpu);
+    }
+#elif defined(__APPLE__)
+    thread_affinity_policy_data_t policy = { cpu + 1 };
+    thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_AFFINITY_POLICY,
+                      (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT);
+#endif
+}
+
+// Packet callback for the busy-poll loop: runs inside gip_device_process(),
+// straight from the USB transfer buffer
+static void busy_poll_packet(void *user_data, const uint8_t *data, int length,
+                             uint64_t timestamp_ns) {
+    BusyPollStats *stats = user_data;
+    int mode = stats->spinning ? 0 : 1;
+    
+    handle_packet(data, length, timestamp_ns);
+    histogram_record(&stats->processing[mode], gip_monotonic_ns() - timestamp_ns);
+    
+    // Jitter = change in inter-arrival time between consecutive packets
+    uint64_t interval = timestamp_ns - stats->last_packet_ns;
+    if (stats->prev_interval_ns) {
+        histogram_record(&stats->jitter[mode], interval > stats->prev_interval_ns ?
+                         interval - stats->prev_interval_ns : stats->prev_interval_ns - interval);
     }
+    stats->prev_interval_ns = interval;
+    stats->last_packet_ns = timestamp_ns;
     
-    uint8_t power_on[] = {GIP_CMD_POWER, 0x20, 0x00, 0x01, 0x00};
-    result = libusb_interrupt_transfer(handle, out_endpoint, power_on,
-                                      sizeof(power_on), &transferred, 1000);
+    if (!stats->spinning) {
+        stats->spinning = true;
+        metrics_gauge_set(METRIC_BUSY_POLL_SPINNING, 1);
+        stats->prev_interval_ns = 0;
+    }
+}
+
+// Same work as input_loop(), but with async transfers that are reaped by
+// spinning on gip_device_process() with a zero timeout instead of sleeping
+// in the kernel. After busy_poll_idle_ms without input it falls back to
+// blocking waits, and resumes spinning on the next packet.
+//
+// Reports, per wait strategy, the time from libusb handing us a completed
+// transfer to the resulting events being posted, and the jitter of packet
+// inter-arrival times (which is where kernel wakeup latency shows up).
+void input_loop_busy_poll(GipDevice *dev) {
+    BusyPollStats stats;
+    uint64_t idle_ns = (uint64_t)config.busy_poll_idle_ms * 1000000ull;
+    uint64_t tick_ns = (uint64_t)TICK_TIMEOUT_MS * 1000000ull;
+    
+    memset(&stats, 0, sizeof(stats));
+    stats.spinning = true;
+    metrics_gauge_set(METRIC_BUSY_POLL_SPINNING, 1);
+    stats.last_packet_ns = gip_monotonic_ns();
+    uint64_t last_tick_ns = stats.last_packet_ns;
+    
+    print_loop_banner();
+    pin_to_cpu(config.busy_poll_cpu);
+    
+    int result = gip_device_start(dev, busy_poll_packet, &stats);
+    if (result != GIP_OK) {
+        printf("❌ Could not start async input (%s), using blocking loop\n", gip_strerror(result));
+        input_loop(dev);
+        return;
+    }
     
-    if (result == 0 && config.console_output_enabled) {
-        printf("✅ Controller powered on!\n\n");
+    while (running) {
+        int packets = gip_device_process(dev, stats.spinning ? 0 : TICK_TIMEOUT_MS * 1000);
+        uint64_t now = gip_monotonic_ns();
+        
+        if (packets == GIP_ERROR_NO_DEVICE) {
+            printf("\n❌ Controller disconnected!\n");
+            break;
+        }
+        if (packets < 0) {
+            if (!recover_input(dev, packets)) {
+                break;
+            }
+            continue;
+        }
+        
+        if (packets > 0) {
+            recoveries_in_a_row = 0;
+            last_tick_ns = now;
+            continue;
+        }
+        
+        dump_trace_if_requested();
+        switch_profile_if_requested();
+        
+        if (stats.spinning && now - stats.last_packet_ns > idle_ns) {
+            stats.spinning = false;
+            metrics_gauge_set(METRIC_BUSY_POLL_SPINNING, 0);
+            if (config.console_output_enabled) {
+                printf("\n💤 Idle for %d ms, switching to blocking waits\n", config.busy_poll_idle_ms);
+            }
+        }
+        if (now - last_tick_ns >= tick_ns) {
+            output_tick();
+            last_tick_ns = now;
+        } else if (stats.spinning) {
+            cpu_relax();
+        }
     }
     
-    usleep(500000);
-    return 0;
+    // Cancel the in-flight transfers and wait for libusb to hand them back
+    gip_device_stop(dev);
+    metrics_gauge_set(METRIC_BUSY_POLL_SPINNING, 0);
+    
+    printf("\n\nInput latency (busy-poll vs. blocking fallback):\n");
+    histogram_print("completion→posted (spin)", &stats.processing[0]);
+    histogram_print("completion→posted (block)", &stats.processing[1]);
+    histogram_print("arrival jitter (spin)", &stats.jitter[0]);
+    histogram_print("arrival jitter (block)", &stats.jitter[1]);
+    printf("\n");
 }
 
-void input_loop(libusb_device_handle *handle, uint8_t in_endpoint) {
-    uint8_t buffer[64];
-    int transferred;
-    int result;
-    int input_count = 0;
-    
-    printf("=== Xbox Controller Simulator Active ===\n");
-    printf("Controller input is now being translated to keyboard/mouse\n");
-    if (config.console_output_enabled) {
-        printf("Console output: ENABLED (see input below)\n");
-    } else {
-        printf("Console output: DISABLED\n");
+// ============================================================================
+// USB Helper Input Loop (--helper: packets from usb_helper's shared ring)
+// ============================================================================
+
+// The helper stamps each packet at USB completion and again when it is
+// published, so the cost of the process split is measured directly:
+// published→popped is the ring plus our wakeup, completion→posted the
+// whole path. With busy-poll enabled the ring is polled instead of slept
+// on until busy_poll_idle_ms without input.
+void input_loop_helper(UsbRing *ring) {
+    LatencyHistogram ring_latency;
+    LatencyHistogram end_to_end;
+    UsbRingPacket packet;
+    uint64_t idle_ns = (uint64_t)config.busy_poll_idle_ms * 1000000ull;
+    uint64_t tick_ns = (uint64_t)TICK_TIMEOUT_MS * 1000000ull;
+    uint64_t last_packet_ns = gip_monotonic_ns();
+    uint64_t last_tick_ns = last_packet_ns;
+    
+    memset(&ring_latency, 0, sizeof(ring_latency));
+    memset(&end_to_end, 0, sizeof(end_to_end));
+    
+    print_loop_banner();
+    if (config.busy_poll_enabled) {
+        pin_to_cpu(config.busy_poll_cpu);
     }
-    printf("Press Ctrl+C to exit\n\n");
     
     while (running) {
-        result = libusb_interrupt_transfer(handle, in_endpoint, buffer,
-                                          sizeof(buffer), &transferred, 10);  // 10ms timeout for smoother mouse
+        dump_trace_if_requested();
+        switch_profile_if_requested();
         
-        if (result == 0 && transferred >= (int)sizeof(GipHeader)) {
-            GipHeader *header = (GipHeader *)buffer;
-            
-            if (header->command == GIP_CMD_INPUT && 
-                transferred >= (int)sizeof(GipInputPacket)) {
-                GipInputPacket *input = (GipInputPacket *)buffer;
-                input_count++;
-                
-                // Process and inject input events (updates stick positions)
-                process_buttons(input->buttons);
-                process_triggers(input->left_trigger, input->right_trigger);
-                process_sticks(input->left_stick_x, input->left_stick_y,
-                             input->right_stick_x, input->right_stick_y);
-                
-                // Console output (if enabled)
-                if (config.console_output_enabled) {
-                    printf("\r[%04d] ", input_count);
-                    printf("BTN: ");
-                    if (input->buttons) {
-                        print_buttons(input->buttons);
-                    } else {
-                        printf("none ");
-                    }
-                    printf("%-40s", "");
-                    printf("\r[%04d] BTN: ", input_count);
-                    print_buttons(input->buttons);
-                    printf("| LT:%3d RT:%3d ", input->left_trigger, input->right_trigger);
-                    printf("| LS:(%6d,%6d) RS:(%6d,%6d)  ",
-                           input->left_stick_x, input->left_stick_y,
-                           input->right_stick_x, input->right_stick_y);
-                    fflush(stdout);
-                }
-                
-            } else if (header->command == GIP_CMD_GUIDE_BUTTON && 
-                      config.console_output_enabled) {
-                printf("\n🎮 GUIDE BUTTON PRESSED\n");
-            }
-            
-        } else if (result == LIBUSB_ERROR_TIMEOUT) {
-            // Timeout: No new packet, but generate movement from held stick positions
-            generate_continuous_movement();
-            
-        } else if (result == LIBUSB_ERROR_NO_DEVICE) {
-            printf("\n❌ Controller disconnected!\n");
+        uint64_t now = gip_monotonic_ns();
+        bool spinning = config.busy_poll_enabled && now - last_packet_ns < idle_ns;
+        int timeout_ms = mapper_tick_pending(&mapper) ? TICK_TIMEOUT_MS : IDLE_TIMEOUT_MS;
+        int result = usb_ring_wait(ring, spinning ? 0 : timeout_ms * 1000);
+        
+        if (result == GIP_ERROR_NO_DEVICE) {
+            printf("\n❌ Controller disconnected! (USB helper stopped)\n");
             break;
         }
+        
+        if (result > 0) {
+            while (usb_ring_pop(ring, &packet)) {
+                histogram_record(&ring_latency, gip_monotonic_ns() - packet.publish_ns);
+                handle_packet(packet.data, packet.length, packet.completion_ns);
+                histogram_record(&end_to_end, gip_monotonic_ns() - packet.completion_ns);
+            }
+            last_packet_ns = last_tick_ns = gip_monotonic_ns();
+            continue;
+        }
+        
+        // Nothing new: keep held sticks moving, at tick rate even when spinning
+        now = gip_monotonic_ns();
+        if (!spinning || now - last_tick_ns >= tick_ns) {
+            metrics_inc(METRIC_TIMEOUTS);
+            output_tick();
+            last_tick_ns = now;
+        } else {
+            cpu_relax();
+        }
+    }
+    
+    printf("\n\nUSB helper latency:\n");
+    histogram_print("published→popped", &ring_latency);
+    histogram_print("completion→posted", &end_to_end);
+    printf("  %-26s %llu\n\n", "dropped (ring full)", (unsigned long long)usb_ring_dropped(ring));
+}
+
+// ============================================================================
+// Capture Playback (--play: a recorded session instead of the controller)
+// ============================================================================
+
+static void playback_packet(void *user, const uint8_t *data, int length, uint64_t now_ns) {
+    (void)user;
+    dump_trace_if_requested();
+    switch_profile_if_requested();
+    handle_packet(data, length, now_ns);
+}
+
+static void playback_tick(void *user, uint64_t now_ns) {
+    (void)user;
+    (void)now_ns;
+    metrics_inc(METRIC_TIMEOUTS);
+    output_tick();
+}
+
+// Same packet path as a live controller, so outputs, metrics, traces and
+// --record all behave as they would in the recorded session
+void input_loop_playback(const Playback *playback, const PlaybackOptions *options) {
+    PlaybackSink sink = { .packet = playback_packet, .tick = playback_tick };
+    PlaybackStats stats;
+    
+    print_loop_banner();
+    printf("🎮 Playing %d packets (%.1f s) at %.2gx, ", playback->count, playback->duration_ns / 1e9,
+           options->speed);
+    if (options->loops == 0) {
+        printf("looping until Ctrl+C\n\n");
+    } else {
+        printf("%d pass%s\n\n", options->loops, options->loops == 1 ? "" : "es");
     }
     
+    if (!playback_run(playback, options, &sink, &stats)) {
+        printf("\n\nStopped early");
+    }
     printf("\n\n");
+    playback_print_stats(&stats);
+    printf("\n");
 }
 
 // ============================================================================
 // Main
 // ============================================================================
 
-int main() {
-    libusb_context *ctx = NULL;
-    libusb_device_handle *handle = NULL;
+int main(int argc, char **argv) {
+    GipDevice *dev = NULL;
+    UsbRing *ring = NULL;
     int result;
+    const char *profile_path = NULL;
+    const char *profile_name = NULL;
+    const char *helper_socket = NULL;
+    const char *record_path = NULL;
+    const char *play_path = NULL;
+    PlaybackOptions play_options = PLAYBACK_DEFAULT_OPTIONS;
+    Playback playback;
+    const char *plugin_specs[PLUGIN_MAX];
+    int plugin_count = 0;
+    uint64_t plugin_budget_ns = PLUGIN_DEFAULT_BUDGET_NS;
+    const char *serial;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (strcmp(argv[i], "--profile-name") == 0 && i + 1 < argc) {
+            profile_name = argv[++i];
+        } else if (strcmp(argv[i], "--helper") == 0) {
+            helper_socket = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : USB_HELPER_SOCKET_PATH;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc) {
+            play_path = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            play_options.speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            play_options.loops = (i + 1 < argc && argv[i + 1][0] != '-') ? atoi(argv[++i]) : 0;
+        } else if (strcmp(argv[i], "--plugin") == 0 && i + 1 < argc && plugin_count < PLUGIN_MAX) {
+            plugin_specs[plugin_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--plugin-budget") == 0 && i + 1 < argc) {
+            plugin_budget_ns = (uint64_t)(atof(argv[++i]) * 1000.0);
+        } else {
+            printf("Usage: %s [--profile FILE.xprof [--profile-name NAME]] [--helper [SOCKET]]\n"
+                   "       [--record FILE.xcap] [--play FILE.xcap [--speed X] [--loop [N]]]\n"
+                   "       [--plugin FILE.so[:CONFIG]]... [--plugin-budget US]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (play_path && (helper_socket || play_options.speed <= 0 || play_options.loops < 0)) {
+        printf("❌ --play takes a speed above 0 and can't be combined with --helper\n");
+        return 1;
+    }
     
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, trace_signal_handler);
+    signal(SIGUSR2, profile_signal_handler);
     
     printf("Xbox Controller to Keyboard/Mouse Simulator\n");
     printf("============================================\n\n");
@@ -549,25 +823,55 @@ int main() {
     // Load configuration
     config = get_default_mapping();
     
+    // Compiled profiles replace the bindings from keymapping.h
+    if (profile_path) {
+        char error[256];
+        if (!profile_file_map(&profile_file, profile_path, error, sizeof(error))) {
+            printf("❌ %s\n", error);
+            return 1;
+        }
+        profile_file_mapped = true;
+        if (profile_name) {
+            profile_index = profile_file_find(&profile_file, profile_name);
+            if (profile_index < 0) {
+                printf("❌ No profile [%s] in %s\n", profile_name, profile_path);
+                return 1;
+            }
+        }
+        printf("✅ Mapped %d profiles from %s, using [%s]", profile_file.header->count, profile_path,
+               profile_file.entries[profile_index].name);
+        printf("%s\n\n", profile_file.header->count > 1 ? " (kill -USR2 to switch)" : "");
+    }
+    
     printf("Configuration loaded:\n");
-    printf("  Left stick: %s\n", 
-           config.sticks.left_stick_mode == STICK_MODE_WASD ? "WASD" :
-           config.sticks.left_stick_mode == STICK_MODE_ARROWS ? "Arrows" :
-           config.sticks.left_stick_mode == STICK_MODE_MOUSE ? "Mouse" : "Disabled");
-    printf("  Right stick: %s\n",
-           config.sticks.right_stick_mode == STICK_MODE_WASD ? "WASD" :
-           config.sticks.right_stick_mode == STICK_MODE_ARROWS ? "Arrows" :
-           config.sticks.right_stick_mode == STICK_MODE_MOUSE ? "Mouse" : "Disabled");
-    printf("  Left trigger: %s\n",
-           config.triggers.left_trigger_mode == TRIGGER_MODE_MOUSE ? "Mouse Left" :
-           config.triggers.left_trigger_mode == TRIGGER_MODE_KEY ? "Key" : "Disabled");
-    printf("  Right trigger: %s\n",
-           config.triggers.right_trigger_mode == TRIGGER_MODE_MOUSE ? "Mouse Right" :
-           config.triggers.right_trigger_mode == TRIGGER_MODE_KEY ? "Key" : "Disabled");
-    printf("  Deadzone: %d (%.1f%%)\n", config.sticks.deadzone,
-           (config.sticks.deadzone / 32767.0f) * 100.0f);
-    printf("  Mouse smoothing: %.2f (0.0=none, 0.9=max)\n", config.sticks.mouse_smoothing);
-    printf("  Mouse sensitivity: %.1f\n", config.sticks.mouse_sensitivity);
+    if (!profile_file_mapped) {
+        printf("  Left stick: %s\n", 
+               config.sticks.left_stick_mode == STICK_MODE_WASD ? "WASD" :
+               config.sticks.left_stick_mode == STICK_MODE_ARROWS ? "Arrows" :
+               config.sticks.left_stick_mode == STICK_MODE_MOUSE ? "Mouse" :
+               config.sticks.left_stick_mode == STICK_MODE_KINETIC ? "Kinetic" : "Disabled");
+        printf("  Right stick: %s\n",
+               config.sticks.right_stick_mode == STICK_MODE_WASD ? "WASD" :
+               config.sticks.right_stick_mode == STICK_MODE_ARROWS ? "Arrows" :
+               config.sticks.right_stick_mode == STICK_MODE_MOUSE ? "Mouse" :
+               config.sticks.right_stick_mode == STICK_MODE_KINETIC ? "Kinetic" : "Disabled");
+        printf("  Left trigger: %s\n",
+               config.triggers.left_trigger_mode == TRIGGER_MODE_MOUSE ? "Mouse Left" :
+               config.triggers.left_trigger_mode == TRIGGER_MODE_KEY ? "Key" : "Disabled");
+        printf("  Right trigger: %s\n",
+               config.triggers.right_trigger_mode == TRIGGER_MODE_MOUSE ? "Mouse Right" :
+               config.triggers.right_trigger_mode == TRIGGER_MODE_KEY ? "Key" : "Disabled");
+        printf("  Deadzone: %d (%.1f%%)\n", config.sticks.deadzone,
+               (config.sticks.deadzone / 32767.0f) * 100.0f);
+        printf("  Mouse smoothing: %.2f (0.0=none, 0.9=max)\n", config.sticks.mouse_smoothing);
+        printf("  Mouse sensitivity: %.1f\n", config.sticks.mouse_sensitivity);
+        if (config.sticks.left_stick_mode == STICK_MODE_KINETIC ||
+            config.sticks.right_stick_mode == STICK_MODE_KINETIC) {
+            printf("  Kinetic friction: %.1f/s\n", config.sticks.kinetic_friction);
+        }
+        printf("  Stick math: %s\n", config.fixed_point_math ? "fixed-point (Q15)" : "floating-point");
+    }
+    printf("  Tracing: %s\n", config.trace_enabled ? "enabled (SIGUSR1 to export)" : "disabled");
     printf("  Streaming mode: %s\n", config.streaming_mode ? "ENABLED (for Moonlight/Parsec)" : "disabled (for local apps)");
     printf("\n");
     
@@ -575,95 +879,163 @@ int main() {
     printf("   System Settings → Privacy & Security → Accessibility\n");
     printf("   Add Terminal (or your terminal app) to the list\n\n");
     
-    // Initialize libusb
-    result = libusb_init(&ctx);
-    if (result < 0) {
-        printf("❌ Failed to initialize libusb: %s\n", libusb_error_name(result));
-        return 1;
+    // Plugins get their state now; nothing is allocated for them once input flows
+    if (plugin_count > 0) {
+        if (!plugin_host_init(&plugins, PLUGIN_DEFAULT_ARENA_SIZE)) {
+            printf("❌ Could not allocate the plugin arena\n");
+            return 1;
+        }
+        for (int i = 0; i < plugin_count; i++) {
+            char error[512];
+            if (!plugin_host_load_spec(&plugins, plugin_specs[i], plugin_budget_ns, error, sizeof(error))) {
+                printf("❌ %s\n", error);
+                return 1;
+            }
+            const LoadedPlugin *loaded = &plugins.plugins[i];
+            printf("✅ Plugin [%s] from %s (%s, budget %.1f us per packet)\n", loaded->plugin->name,
+                   loaded->path, plugin_pipeline_name(loaded->keep), plugin_budget_ns / 1000.0);
+        }
     }
     
-    // Find controller
-    printf("Looking for Xbox controller...\n");
-    handle = libusb_open_device_with_vid_pid(ctx, XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
-    if (!handle) {
-        printf("❌ Controller not found\n");
-        printf("   Make sure it's plugged in and you're running with sudo\n");
-        libusb_exit(ctx);
-        return 1;
+    if (play_path) {
+        // The capture stands in for the controller; outputs are real
+        char error[256];
+        if (!playback_load(&playback, play_path, error, sizeof(error))) {
+            printf("❌ %s\n", error);
+            return 1;
+        }
+        play_options.running = &running;
+        play_options.tick_ns = (uint64_t)TICK_TIMEOUT_MS * 1000000ull;
+        serial = playback.serial;
+        printf("✅ Loaded %d packets from %s\n", playback.count, play_path);
+    } else if (helper_socket) {
+        // usb_helper already owns the controller and did the handshake
+        printf("Connecting to USB helper at %s...\n", helper_socket);
+        result = usb_ring_connect(&ring, helper_socket);
+        if (result != GIP_OK) {
+            printf("❌ Could not attach to USB helper: %s\n", gip_strerror(result));
+            printf("   Start it first: sudo ./usb_helper\n");
+            return 1;
+        }
+        serial = usb_ring_serial(ring);
+        printf("✅ Attached to helper's packet ring\n");
+    } else {
+        // Find controller and claim its interface
+        printf("Looking for Xbox controller...\n");
+        result = gip_device_open(&dev, XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
+        if (result != GIP_OK) {
+            printf("❌ Could not open controller: %s\n", gip_strerror(result));
+            if (result == GIP_ERROR_NOT_FOUND || result == GIP_ERROR_ACCESS) {
+                printf("   Make sure it's plugged in and you're running with sudo\n");
+            }
+            return 1;
+        }
+        serial = gip_device_serial(dev);
+        printf("✅ Found controller\n");
+        printf("✅ Claimed interface\n");
     }
-    printf("✅ Found controller\n");
     
-    // Detach kernel driver
-    if (libusb_kernel_driver_active(handle, 0) == 1) {
-        libusb_detach_kernel_driver(handle, 0);
+    // Load outer-range calibration recorded for this controller
+    calibration_loaded = calibration_load(serial, &calibration);
+    if (calibration_loaded) {
+        printf("✅ Loaded stick calibration for %s\n", calibration.serial);
+    } else {
+        printf("   No stick calibration (run: sudo ./xbox_gip_test --calibrate)\n");
     }
     
-    // Claim interface
-    result = libusb_claim_interface(handle, 0);
-    if (result < 0) {
-        printf("❌ Failed to claim interface: %s\n", libusb_error_name(result));
-        libusb_close(handle);
-        libusb_exit(ctx);
-        return 1;
+    if (profile_file_mapped) {
+        // Used in place: calibration is whatever profilec baked in
+        const ProfileEntry *entry = &profile_file.entries[profile_index];
+        if (calibration_loaded && !(entry->flags & PROFILE_FLAG_CALIBRATED)) {
+            printf("⚠️  Profile [%s] has no calibration; add \"calibration = %s\" and recompile it\n",
+                   entry->name, calibration.serial);
+        }
+        mapper_init(&mapper, profile_file_get(&profile_file, profile_index));
+    } else {
+        // Compile bindings for the per-packet path
+        mapper_compile_profile(&config, calibration_loaded ? &calibration : NULL, &profile);
+        mapper_init(&mapper, &profile);
     }
-    printf("✅ Claimed interface\n");
-    
-    // Get endpoints
-    struct libusb_config_descriptor *desc;
-    libusb_get_active_config_descriptor(libusb_get_device(handle), &desc);
-    
-    uint8_t in_endpoint = 0;
-    uint8_t out_endpoint = 0;
     
-    const struct libusb_interface *inter = &desc->interface[0];
-    const struct libusb_interface_descriptor *interdesc = &inter->altsetting[0];
+    // Initialize controller
+    if (dev) {
+        gip_device_set_verbosity(dev, config.console_output_enabled ? GIP_VERBOSE_SUMMARY
+                                                                    : GIP_VERBOSE_QUIET);
+        gip_device_handshake(dev);
+    }
+    metrics_gauge_set(METRIC_CONNECTED, 1);
     
-    for (int i = 0; i < interdesc->bNumEndpoints; i++) {
-        const struct libusb_endpoint_descriptor *ep = &interdesc->endpoint[i];
-        if ((ep->bmAttributes & 0x03) == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
-            if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
-                in_endpoint = ep->bEndpointAddress;
-            } else {
-                out_endpoint = ep->bEndpointAddress;
-            }
+    if (record_path) {
+        if (!capture_async_open(&recorder, record_path, true, XBOX_VENDOR_ID, XBOX_PRODUCT_ID, serial)) {
+            printf("⚠️  Could not create %s, not recording\n", record_path);
+        } else {
+            printf("✅ Recording to %s\n", record_path);
         }
     }
     
-    libusb_free_config_descriptor(desc);
-    
-    if (in_endpoint == 0 || out_endpoint == 0) {
-        printf("❌ Could not find interrupt endpoints\n");
-        libusb_release_interface(handle, 0);
-        libusb_close(handle);
-        libusb_exit(ctx);
-        return 1;
+    if ((config.metrics_socket_path || config.metrics_textfile_path) &&
+        !metrics_exporter_start(config.metrics_socket_path, config.metrics_textfile_path,
+                                config.metrics_interval_ms)) {
+        printf("⚠️  Could not start metrics exporter\n");
     }
     
-    // Initialize controller
-    initialize_controller(handle, in_endpoint, out_endpoint);
+    if (config.trace_enabled) {
+        trace_start(TRACE_DEFAULT_EVENTS);
+        trace_set_thread_name("input");
+    }
     
     // Run simulator
-    input_loop(handle, in_endpoint);
+    if (play_path) {
+        input_loop_playback(&playback, &play_options);
+    } else if (ring) {
+        input_loop_helper(ring);
+    } else if (config.busy_poll_enabled) {
+        input_loop_busy_poll(dev);
+    } else {
+        input_loop(dev);
+    }
     
     // Cleanup - release all keys
     printf("Releasing all keys...\n");
-    for (int i = 0; i < 256; i++) {
-        if (input_state.keys[i]) {
-            send_key_event(i, false);
-        }
-    }
-    if (input_state.mouse_left) {
-        send_mouse_button_event(kCGMouseButtonLeft, false);
+    while (mapper_release_all(&mapper, &actions) > 0) {
+        post_actions(&actions);
     }
-    if (input_state.mouse_right) {
-        send_mouse_button_event(kCGMouseButtonRight, false);
+    
+    if (config.trace_enabled) {
+        trace_dump_requested = 1;
+        dump_trace_if_requested();
     }
     
     printf("Cleaning up...\n");
-    libusb_release_interface(handle, 0);
-    libusb_close(handle);
-    libusb_exit(ctx);
+    if (recorder) {
+        CaptureAsyncStats stats;
+        bool complete = capture_async_close(recorder, &stats);
+        recorder = NULL;
+        printf("%s Recorded %llu packets to %s (%llu dropped%s)\n", complete ? "✅" : "⚠️ ",
+               (unsigned long long)stats.written, record_path, (unsigned long long)stats.dropped,
+               stats.failed ? ", write failed" : "");
+        printf("   %llu flushes, p99 < %.1f us, max %.1f us\n", (unsigned long long)stats.flushes,
+               stats.flush_p99_ns / 1000.0, stats.flush_max_ns / 1000.0);
+    }
+    if (plugins.count > 0) {
+        metrics_add(METRIC_PLUGIN_OVERRUNS, plugin_host_report_overruns(&plugins));
+        printf("\n");
+        plugin_host_print_stats(&plugins);
+        plugin_host_destroy(&plugins);
+    }
+    metrics_gauge_set(METRIC_CONNECTED, 0);
+    metrics_exporter_stop();
+    if (play_path) {
+        playback_free(&playback);
+    } else if (ring) {
+        usb_ring_close(ring);
+    } else {
+        gip_device_close(dev);
+    }
+    if (profile_file_mapped) {
+        profile_file_unmap(&profile_file);
+    }
     
     printf("\n✅ Simulator stopped cleanly!\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,414 @@
+// state_bench.c
+// Per-controller state layout benchmark: the old single InputState struct
+// vs. the hot/cold split in input_state.h, with 16 simulated controllers.
+// Runs the per-packet state accesses of the default profile (buttons,
+// triggers, left stick WASD, right stick mouse) round-robin over all
+// controllers, single-threaded and with controllers spread over threads,
+// and reports time per packet, cache lines touched and (on Linux, where
+// perf counters are available) L1D misses per packet.
+// Compile: make state_bench
+// Run: ./state_bench [packets_per_controller] [threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "input_state.h"
+#include "stick_math.h"
+#include "gip.h"
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define NUM_CONTROLLERS     16
+#define DEFAULT_PACKETS     200000
+#define DEFAULT_THREADS     4
+
+// The InputState layout before the hot/cold split, kept for comparison
+typedef struct {
+    bool keys[256];
+    bool mouse_left;
+    bool mouse_right;
+    bool mouse_middle;
+    uint16_t prev_buttons;
+    uint8_t prev_left_trigger;
+    uint8_t prev_right_trigger;
+    int16_t prev_left_stick_x;
+    int16_t prev_left_stick_y;
+    int16_t prev_right_stick_x;
+    int16_t prev_right_stick_y;
+    int16_t current_left_stick_x;
+    int16_t current_left_stick_y;
+    int16_t current_right_stick_x;
+    int16_t current_right_stick_y;
+    float smoothed_right_x;
+    float smoothed_right_y;
+    float smoothed_left_x;
+    float smoothed_left_y;
+    int32_t fx_smoothed_right_x;
+    int32_t fx_smoothed_right_y;
+    int32_t fx_smoothed_left_x;
+    int32_t fx_smoothed_left_y;
+    KineticState kinetic_left;
+    KineticState kinetic_right;
+    float mouse_dx;
+    float mouse_dy;
+} LegacyInputState;
+
+// Just the fields a packet carries
+typedef struct {
+    uint16_t buttons;
+    uint8_t left_trigger;
+    uint8_t right_trigger;
+    int16_t left_x, left_y, right_x, right_y;
+} BenchPacket;
+
+static const uint16_t button_masks[14] = {
+    XBOX_BTN_A, XBOX_BTN_B, XBOX_BTN_X, XBOX_BTN_Y, XBOX_BTN_LB, XBOX_BTN_RB,
+    XBOX_BTN_LS, XBOX_BTN_RS, XBOX_BTN_VIEW, XBOX_BTN_MENU, XBOX_BTN_DPAD_UP,
+    XBOX_BTN_DPAD_DOWN, XBOX_BTN_DPAD_LEFT, XBOX_BTN_DPAD_RIGHT
+};
+static const uint16_t button_keys[14] = {
+    0x31, 0x08, 0x0F, 0x03, 0x0C, 0x0E, 0x38, 0x3B, 0x30, 0x35, 0x7E, 0x7D, 0x7B, 0x7C
+};
+
+// Sink for generated output so the compiler can't drop the work
+static volatile float output_sink;
+
+// ============================================================================
+// Per-packet state access, once per layout
+// ============================================================================
+
+// Body shared by both layouts. HOT/COLD are the structs holding the
+// per-packet fields and the key table; HELD_DIRS is NULL for the old WASD
+// change detection (reads the key table every packet).
+#define PROCESS_PACKET_BODY(HOT, COLD, HELD_DIRS)                                    \
+    uint16_t changed = p->buttons ^ (HOT)->prev_buttons;                             \
+    if (changed) {                                                                   \
+        for (int i = 0; i < 14; i++) {                                               \
+            if (changed & button_masks[i]) {                                         \
+                (COLD)->keys[button_keys[i]] = (p->buttons & button_masks[i]) != 0;  \
+            }                                                                        \
+        }                                                                            \
+    }                                                                                \
+    (HOT)->prev_buttons = p->buttons;                                                \
+                                                                                     \
+    if ((p->left_trigger > 127) != ((HOT)->prev_right_trigger > 127)) {              \
+        (COLD)->mouse_right = p->left_trigger > 127;                                 \
+    }                                                                                \
+    if ((p->right_trigger > 127) != ((HOT)->prev_left_trigger > 127)) {              \
+        (COLD)->mouse_left = p->right_trigger > 127;                                 \
+    }                                                                                \
+    (HOT)->prev_left_trigger = p->right_trigger;                                     \
+    (HOT)->prev_right_trigger = p->left_trigger;                                     \
+                                                                                     \
+    int16_t lx = p->left_x, ly = p->left_y, rx = p->right_x, ry = p->right_y;        \
+    apply_deadzone(&lx, &ly, 8000, NULL);                                            \
+    apply_deadzone(&rx, &ry, 8000, NULL);                                            \
+                                                                                     \
+    bool up = lx > 9830, down = lx < -9830, left = ly < -9830, right = ly > 9830;    \
+    uint8_t *held = (HELD_DIRS);                                                     \
+    if (!held) {                                                                     \
+        if (up != (COLD)->keys[0x0D]) (COLD)->keys[0x0D] = up;                       \
+        if (down != (COLD)->keys[0x01]) (COLD)->keys[0x01] = down;                   \
+        if (left != (COLD)->keys[0x00]) (COLD)->keys[0x00] = left;                   \
+        if (right != (COLD)->keys[0x02]) (COLD)->keys[0x02] = right;                 \
+    } else {                                                                         \
+        uint8_t dirs = (up ? STICK_DIR_UP : 0) | (down ? STICK_DIR_DOWN : 0) |       \
+                       (left ? STICK_DIR_LEFT : 0) | (right ? STICK_DIR_RIGHT : 0);  \
+        if (dirs != *held) {                                                         \
+            (COLD)->keys[0x0D] = up;                                                 \
+            (COLD)->keys[0x01] = down;                                               \
+            (COLD)->keys[0x00] = left;                                               \
+            (COLD)->keys[0x02] = right;                                              \
+            *held = dirs;                                                            \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    float cx, cy;                                                                    \
+    stick_shape_input(rx, ry, 0.3f, 1.8f, &(HOT)->smoothed_right_x,                  \
+                      &(HOT)->smoothed_right_y, &cx, &cy);                           \
+    (HOT)->mouse_dx += cx * 22.5f;                                                   \
+    (HOT)->mouse_dy += cy * 22.5f;                                                   \
+    if ((HOT)->mouse_dx != 0.0f || (HOT)->mouse_dy != 0.0f) {                        \
+        output_sink = (HOT)->mouse_dx + (HOT)->mouse_dy;                             \
+        (HOT)->mouse_dx = 0.0f;                                                      \
+        (HOT)->mouse_dy = 0.0f;                                                      \
+    }                                                                                \
+                                                                                     \
+    (HOT)->current_left_stick_x = lx;                                                \
+    (HOT)->current_left_stick_y = ly;                                                \
+    (HOT)->current_right_stick_x = rx;                                               \
+    (HOT)->current_right_stick_y = ry;                                               \
+    (HOT)->prev_left_stick_x = lx;                                                   \
+    (HOT)->prev_left_stick_y = ly;                                                   \
+    (HOT)->prev_right_stick_x = rx;                                                  \
+    (HOT)->prev_right_stick_y = ry;
+
+static void process_legacy(LegacyInputState *s, const BenchPacket *p) {
+    PROCESS_PACKET_BODY(s, s, NULL)
+}
+
+static void process_split(ControllerState *s, const BenchPacket *p) {
+    PROCESS_PACKET_BODY(&s->hot, &s->cold, &s->hot.left_stick_dirs)
+}
+
+// ============================================================================
+// Measurement helpers
+// ============================================================================
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// L1D read misses for the calling thread (-1 where perf counters aren't available)
+static int perf_open_l1d_misses(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_L1D |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void perf_start(int fd) {
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+static long long perf_stop(int fd) {
+    long long count = -1;
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+            count = -1;
+        }
+    }
+#else
+    (void)fd;
+#endif
+    return count;
+}
+
+// Mark the cache lines covered by [offset, offset + size) in a bitmask
+static uint32_t lines_covered(size_t offset, size_t size) {
+    uint32_t mask = 0;
+    for (size_t line = offset / CACHE_LINE_SIZE; line <= (offset + size - 1) / CACHE_LINE_SIZE; line++) {
+        mask |= 1u << line;
+    }
+    return mask;
+}
+
+static int count_lines(uint32_t mask) {
+    int count = 0;
+    for (; mask; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+}
+
+// Controllers whose state shares a cache line with the previous controller's
+static int count_shared_lines(const void *base, size_t stride) {
+    int shared = 0;
+    for (int c = 1; c < NUM_CONTROLLERS; c++) {
+        uintptr_t prev_end = (uintptr_t)base + c * stride - 1;
+        uintptr_t start = (uintptr_t)base + c * stride;
+        if (prev_end / CACHE_LINE_SIZE == start / CACHE_LINE_SIZE) {
+            shared++;
+        }
+    }
+    return shared;
+}
+
+// ============================================================================
+// Workloads
+// ============================================================================
+
+static BenchPacket *packets;   // [packet][controller]
+static int packet_count;
+static int thread_count;
+
+static LegacyInputState *legacy_states;
+static ControllerState *split_states;
+
+typedef struct {
+    int thread;
+    bool split;
+} WorkerArgs;
+
+static void run_controllers(bool split, int thread, int stride) {
+    for (int i = 0; i < packet_count; i++) {
+        const BenchPacket *row = &packets[(size_t)i * NUM_CONTROLLERS];
+        for (int c = thread; c < NUM_CONTROLLERS; c += stride) {
+            if (split) {
+                process_split(&split_states[c], &row[c]);
+            } else {
+                process_legacy(&legacy_states[c], &row[c]);
+            }
+        }
+    }
+}
+
+static void *worker(void *arg) {
+    WorkerArgs *args = arg;
+    run_controllers(args->split, args->thread, thread_count);
+    return NULL;
+}
+
+static void generate_packets(void) {
+    uint32_t rng = 1;
+    for (int i = 0; i < packet_count; i++) {
+        for (int c = 0; c < NUM_CONTROLLERS; c++) {
+            BenchPacket *p = &packets[(size_t)i * NUM_CONTROLLERS + c];
+            int phase = (i / 200 + c) % 4;
+            rng = rng * 1664525u + 1013904223u;
+
+            p->buttons = (phase == 3 && (i % 40) < 20) ? XBOX_BTN_A : 0;
+            p->left_trigger = (phase == 2) ? 255 : 0;
+            p->right_trigger = 0;
+            p->left_x = (int16_t)(phase == 1 ? 30000 : (int32_t)(rng % 2001) - 1000);
+            p->left_y = (int16_t)((int32_t)((rng >> 11) % 2001) - 1000);
+            p->right_x = (int16_t)((int32_t)((rng >> 3) % 40001) - 20000);
+            p->right_y = (int16_t)((int32_t)((rng >> 17) % 40001) - 20000);
+        }
+    }
+}
+
+static void run_single(bool split, double *ns_per_packet, long long *misses) {
+    int fd = perf_open_l1d_misses();
+    perf_start(fd);
+    double start = now_seconds();
+    run_controllers(split, 0, 1);
+    double elapsed = now_seconds() - start;
+    long long count = perf_stop(fd);
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    *ns_per_packet = elapsed / ((double)packet_count * NUM_CONTROLLERS) * 1e9;
+    *misses = count;
+}
+
+static double run_threaded(bool split) {
+    pthread_t threads[NUM_CONTROLLERS];
+    WorkerArgs args[NUM_CONTROLLERS];
+
+    double start = now_seconds();
+    for (int t = 0; t < thread_count; t++) {
+        args[t].thread = t;
+        args[t].split = split;
+        pthread_create(&threads[t], NULL, worker, &args[t]);
+    }
+    for (int t = 0; t < thread_count; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    double elapsed = now_seconds() - start;
+    return elapsed / ((double)packet_count * NUM_CONTROLLERS) * 1e9;
+}
+
+int main(int argc, char **argv) {
+    packet_count = (argc > 1) ? atoi(argv[1]) : DEFAULT_PACKETS;
+    thread_count = (argc > 2) ? atoi(argv[2]) : DEFAULT_THREADS;
+    if (packet_count <= 0 || thread_count <= 0 || thread_count > NUM_CONTROLLERS) {
+        printf("Usage: %s [packets_per_controller] [threads (1-%d)]\n", argv[0], NUM_CONTROLLERS);
+        return 1;
+    }
+
+    packets = malloc(sizeof(BenchPacket) * (size_t)packet_count * NUM_CONTROLLERS);
+    legacy_states = calloc(NUM_CONTROLLERS, sizeof(LegacyInputState));
+    if (posix_memalign((void **)&split_states, CACHE_LINE_SIZE,
+                       sizeof(ControllerState) * NUM_CONTROLLERS) != 0) {
+        split_states = NULL;
+    }
+    if (!packets || !legacy_states || !split_states) {
+        printf("❌ Out of memory\n");
+        return 1;
+    }
+    memset(split_states, 0, sizeof(ControllerState) * NUM_CONTROLLERS);
+    generate_packets();
+
+    printf("Controller state layout benchmark\n");
+    printf("=================================\n");
+    printf("%d controllers x %d packets, %d threads\n\n", NUM_CONTROLLERS, packet_count, thread_count);
+
+    // Cache lines the default profile touches on every packet: the old layout
+    // reads the WASD entries of the key table and spreads its fields over
+    // the end of the struct, the new one stays inside the first hot line
+    uint32_t legacy_lines =
+        lines_covered(offsetof(LegacyInputState, keys), 0x0E) |
+        lines_covered(offsetof(LegacyInputState, prev_buttons),
+                      offsetof(LegacyInputState, fx_smoothed_right_x) -
+                      offsetof(LegacyInputState, prev_buttons)) |
+        lines_covered(offsetof(LegacyInputState, mouse_dx), 2 * sizeof(float));
+    uint32_t split_lines =
+        lines_covered(offsetof(ControllerState, hot) + offsetof(InputStateHot, prev_buttons),
+                      offsetof(InputStateHot, kinetic_left));
+
+    printf("                          before (InputState)   after (hot/cold)\n");
+    printf("  State size              %5zu bytes           %zu + %zu bytes\n",
+           sizeof(LegacyInputState), sizeof(InputStateHot), sizeof(InputStateCold));
+    printf("  Lines touched/packet    %5d                 %d\n",
+           count_lines(legacy_lines), count_lines(split_lines));
+    printf("  Controllers sharing a\n");
+    printf("  line with a neighbour   %5d                 %d\n\n",
+           count_shared_lines(legacy_states, sizeof(LegacyInputState)),
+           count_shared_lines(split_states, sizeof(ControllerState)));
+
+    double legacy_ns, split_ns;
+    long long legacy_misses, split_misses;
+
+    // Warm up both, then measure
+    run_controllers(false, 0, 1);
+    run_controllers(true, 0, 1);
+    run_single(false, &legacy_ns, &legacy_misses);
+    run_single(true, &split_ns, &split_misses);
+
+    printf("Single thread:\n");
+    printf("  before: %6.1f ns/packet", legacy_ns);
+    if (legacy_misses >= 0) {
+        printf("   %.3f L1D misses/packet", legacy_misses / ((double)packet_count * NUM_CONTROLLERS));
+    }
+    printf("\n  after:  %6.1f ns/packet", split_ns);
+    if (split_misses >= 0) {
+        printf("   %.3f L1D misses/packet", split_misses / ((double)packet_count * NUM_CONTROLLERS));
+    }
+    printf("\n");
+    if (legacy_misses < 0) {
+        printf("  (L1D miss counters not available on this system)\n");
+    }
+
+    double legacy_mt = run_threaded(false);
+    double split_mt = run_threaded(true);
+    printf("\n%d threads (controllers interleaved across threads):\n", thread_count);
+    printf("  before: %6.1f ns/packet\n", legacy_mt);
+    printf("  after:  %6.1f ns/packet\n", split_mt);
+
+    free(packets);
+    free(legacy_states);
+    free(split_states);
+    return 0;
+}
@@ -0,0 +1,273 @@
+// stick_bench.c
+// Benchmarks the floating-point stick pipeline (stick_math.h) against the
+// fixed-point one (fixed_point.h) on a synthetic input stream, and checks
+// that the fixed-point path stays within its error bound and still produces
+// the golden checksum (i.e. is bit-exact with every other platform).
+// Also runs the same settings as a stage chain (stick_chain.h): the fused
+// path must match the hand-written pipeline bit for bit, and the generic
+// stage loop must agree with it to within rounding.
+// Compile: make stick_bench
+// Run: ./stick_bench [samples]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "stick_math.h"
+#include "stick_chain.h"
+#include "fixed_point.h"
+
+#define DEFAULT_SAMPLES     2000000
+
+// Same settings as the default keymapping.h profile
+#define BENCH_DEADZONE      8000
+#define BENCH_SMOOTHING     0.3f
+#define BENCH_CURVE         1.8f
+#define BENCH_SENSITIVITY   1.5f
+#define BENCH_PIXELS        15.0f
+
+// Largest allowed |float - fixed| difference per packet, in pixels
+// (full deflection is BENCH_SENSITIVITY * BENCH_PIXELS = 22.5 px)
+#define MAX_ERROR_PIXELS    0.02f
+
+// Largest allowed difference between the stage loop and the hand-written
+// float pipeline, in pixels (same math, different rounding)
+#define MAX_CHAIN_DIFFERENCE 0.0001
+
+// FNV-1a of all fixed-point outputs for the default sample count.
+// Must match on every compiler and architecture.
+#define GOLDEN_CHECKSUM     0xdd9ec7e481e4fc74ull
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+} StickSample;
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng_next(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+// Mix of resting noise, slow circles and fast flicks, roughly like real play.
+// Integer-only, so the input stream is identical on every platform.
+static void generate_samples(StickSample *samples, int count) {
+    static const int8_t flick_dirs[8][2] = {
+        {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
+    };
+    int32_t x = 0, y = 0;
+
+    for (int i = 0; i < count; i++) {
+        int phase = (i / 500) % 3;
+        if (phase == 0) {
+            // Resting noise inside the deadzone
+            x = (int32_t)(rng_next() % 4001) - 2000;
+            y = (int32_t)(rng_next() % 4001) - 2000;
+        } else if (phase == 1) {
+            // Slow circle (symplectic rotation keeps the radius stable)
+            if ((int64_t)x * x + (int64_t)y * y < 20000LL * 20000) {
+                x = 26000;
+                y = 0;
+            }
+            x -= y >> 6;
+            y += x >> 6;
+        } else if (i % 25 == 0) {
+            // Flick to the edge (or past it) in one of 8 directions, or release
+            const int8_t *dir = flick_dirs[rng_next() % 8];
+            int32_t reach = (rng_next() % 2) ? 23000 + (int32_t)(rng_next() % 12000) : 0;
+            x = dir[0] * reach;
+            y = dir[1] * reach;
+        }
+
+        samples[i].x = (int16_t)(x > 32767 ? 32767 : x < -32768 ? -32768 : x);
+        samples[i].y = (int16_t)(y > 32767 ? 32767 : y < -32768 ? -32768 : y);
+    }
+}
+
+// A slightly square, uneven gate like a worn stick
+static void make_calibration(StickRange *range) {
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        int phase = i % (CALIBRATION_BINS / 4);
+        int toward_diagonal = phase <= CALIBRATION_BINS / 8 ? phase : CALIBRATION_BINS / 4 - phase;
+        range->outer_radius[i] = 27000.0f + toward_diagonal * 1400.0f - (i % 5) * 300.0f;
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Gate + chain + pixel scale, as the mapper runs a mouse stick. Returns seconds.
+static double run_chain(const StickChain *chain, const StickRange *range, const StickSample *samples,
+                        int count, float *dx) {
+    float smoothed_x = 0, smoothed_y = 0;
+    double start = now_seconds();
+    for (int i = 0; i < count; i++) {
+        int16_t x = samples[i].x, y = samples[i].y;
+        float shaped_x, shaped_y;
+        apply_deadzone(&x, &y, chain->deadzone, chain->calibrate ? range : NULL);
+        stick_chain_run(chain, x, y, &smoothed_x, &smoothed_y, &shaped_x, &shaped_y);
+        dx[2 * i] = shaped_x * chain->gain_x * BENCH_PIXELS;
+        dx[2 * i + 1] = shaped_y * chain->gain_y * BENCH_PIXELS;
+    }
+    return now_seconds() - start;
+}
+
+static double max_difference(const float *a, const float *b, int count) {
+    double max = 0;
+    for (int i = 0; i < count * 2; i++) {
+        double difference = fabs((double)a[i] - b[i]);
+        if (difference > max) {
+            max = difference;
+        }
+    }
+    return max;
+}
+
+int main(int argc, char **argv) {
+    int count = (argc > 1) ? atoi(argv[1]) : DEFAULT_SAMPLES;
+    if (count <= 0) {
+        printf("Usage: %s [samples]\n", argv[0]);
+        return 1;
+    }
+
+    StickSample *samples = malloc(sizeof(StickSample) * count);
+    float *float_dx = malloc(sizeof(float) * count * 2);
+    int32_t *fixed_dx = malloc(sizeof(int32_t) * count * 2);
+    float *chain_dx = malloc(sizeof(float) * count * 2);
+    if (!samples || !float_dx || !fixed_dx || !chain_dx) {
+        printf("❌ Out of memory\n");
+        return 1;
+    }
+    generate_samples(samples, count);
+
+    StickRange range;
+    FixedStickRange fx_range;
+    FixedStickParams params;
+    make_calibration(&range);
+    fx_range_from_calibration(&fx_range, &range);
+    fx_stick_params_init(&params, BENCH_DEADZONE, BENCH_SMOOTHING, BENCH_CURVE,
+                         BENCH_SENSITIVITY, BENCH_PIXELS);
+
+    printf("Stick pipeline benchmark (%d samples)\n", count);
+    printf("=====================================\n\n");
+
+    // Floating-point path
+    float smoothed_x = 0, smoothed_y = 0;
+    double start = now_seconds();
+    for (int i = 0; i < count; i++) {
+        int16_t x = samples[i].x, y = samples[i].y;
+        float curved_x, curved_y;
+        apply_deadzone(&x, &y, BENCH_DEADZONE, &range);
+        stick_shape_input(x, y, BENCH_SMOOTHING, BENCH_CURVE,
+                          &smoothed_x, &smoothed_y, &curved_x, &curved_y);
+        float_dx[2 * i] = curved_x * BENCH_SENSITIVITY * BENCH_PIXELS;
+        float_dx[2 * i + 1] = curved_y * BENCH_SENSITIVITY * BENCH_PIXELS;
+    }
+    double float_time = now_seconds() - start;
+
+    // Fixed-point path
+    int32_t fx_smoothed_x = 0, fx_smoothed_y = 0;
+    start = now_seconds();
+    for (int i = 0; i < count; i++) {
+        int16_t x = samples[i].x, y = samples[i].y;
+        fx_apply_deadzone(&x, &y, &params, &fx_range);
+        fx_process_stick_as_mouse(&params, x, y, &fx_smoothed_x, &fx_smoothed_y,
+                                  &fixed_dx[2 * i], &fixed_dx[2 * i + 1]);
+    }
+    double fixed_time = now_seconds() - start;
+
+    // Compare
+    double max_error = 0, total_error = 0;
+    int max_index = 0;
+    uint64_t checksum = 0xcbf29ce484222325ull;
+    for (int i = 0; i < count * 2; i++) {
+        double error = fabs(float_dx[i] - fixed_dx[i] / (double)FX_ONE_Q16);
+        total_error += error;
+        if (error > max_error) {
+            max_error = error;
+            max_index = i / 2;
+        }
+
+        uint32_t v = (uint32_t)fixed_dx[i];
+        for (int b = 0; b < 4; b++) {
+            checksum ^= (v >> (8 * b)) & 0xFF;
+            checksum *= 0x100000001b3ull;
+        }
+    }
+
+    printf("Float pipeline:  %7.1f ns/packet\n", float_time / count * 1e9);
+    printf("Fixed pipeline:  %7.1f ns/packet  (%.2fx)\n",
+           fixed_time / count * 1e9, float_time / fixed_time);
+    printf("\n");
+    printf("Max error:   %.5f px (sample %d, bound %.3f px)\n", max_error, max_index, MAX_ERROR_PIXELS);
+    printf("Mean error:  %.6f px\n", total_error / (count * 2));
+    printf("Checksum:    0x%016llx\n", (unsigned long long)checksum);
+
+    // The same settings as a stage chain, on both paths
+    StickMapping settings = {
+        .mouse_sensitivity = BENCH_SENSITIVITY, .mouse_curve = BENCH_CURVE,
+        .mouse_smoothing = BENCH_SMOOTHING, .deadzone = BENCH_DEADZONE
+    };
+    StickChainSpec spec;
+    StickChain chain;
+    stick_chain_from_settings(&settings, &spec);
+    stick_chain_compile(&spec, true, &chain);
+
+    double fused_time = run_chain(&chain, &range, samples, count, chain_dx);
+    bool fused_exact = memcmp(chain_dx, float_dx, sizeof(float) * count * 2) == 0;
+
+    StickChain generic = chain;
+    generic.path = STICK_CHAIN_GENERIC;
+    generic.gain_x = generic.gain_y = 1.0f;
+    double generic_time = run_chain(&generic, &range, samples, count, chain_dx);
+    double generic_error = max_difference(chain_dx, float_dx, count);
+
+    // A chain only the stage loop can run
+    const StickChainSpec long_spec = { 7, {
+        { STAGE_CALIBRATE, 0, 0 },
+        { STAGE_DEADZONE, BENCH_DEADZONE, 0 },
+        { STAGE_ROTATE, 5, 0 },
+        { STAGE_SNAP, 8, 0 },
+        { STAGE_FILTER, BENCH_SMOOTHING, 0 },
+        { STAGE_CURVE, BENCH_CURVE, 0 },
+        { STAGE_SCALE, 2.0f, 1.5f } } };
+    StickChain long_chain;
+    stick_chain_compile(&long_spec, false, &long_chain);
+    double long_time = run_chain(&long_chain, &range, samples, count, chain_dx);
+
+    printf("\n");
+    printf("Stage chain, fused:          %7.1f ns/packet  (%s hand-written)\n", fused_time / count * 1e9,
+           fused_exact ? "bit-exact with" : "DIFFERS from");
+    printf("Stage chain, stage loop:     %7.1f ns/packet  (max difference %.2g px)\n",
+           generic_time / count * 1e9, generic_error);
+    printf("7-stage chain, stage loop:   %7.1f ns/packet\n", long_time / count * 1e9);
+
+    int failed = 0;
+    if (!fused_exact || generic_error > MAX_CHAIN_DIFFERENCE) {
+        printf("\n❌ Stage chain does not match the hand-written pipeline\n");
+        failed = 1;
+    }
+    if (max_error > MAX_ERROR_PIXELS) {
+        printf("\n❌ Fixed-point error exceeds bound\n");
+        failed = 1;
+    }
+    if (count == DEFAULT_SAMPLES && checksum != GOLDEN_CHECKSUM) {
+        printf("\n❌ Checksum differs from golden 0x%016llx (fixed-point path not bit-exact)\n",
+               (unsigned long long)GOLDEN_CHECKSUM);
+        failed = 1;
+    }
+    if (!failed) {
+        printf("\n✅ Fixed-point pipeline within bounds, stage chains match\n");
+    }
+
+    free(samples);
+    free(chain_dx);
+    free(float_dx);
+    free(fixed_dx);
+    return failed;
+}
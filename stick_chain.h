@@ -0,0 +1,303 @@
+// stick_chain.h
+// Stage chains for mouse and kinetic sticks (part of libmapper)
+//
+// A StickChainSpec (keymapping.h, or `left_stick.chain = ...` in a text
+// profile) is compiled once into a StickChain: a flat array of stages with
+// their parameters precomputed inline (alpha for filters, cos/sin for
+// rotations, tangents for snapping), stored in the CompiledProfile and so
+// mapped straight from profile files like everything else in it.
+//
+// Leading calibrate/deadzone stages become the stick's gate. The gate runs
+// on the raw int16 position before the stick mode is looked at, so key
+// modes, kinetic release detection and output ticks all see the gated
+// position, exactly as with the single global deadzone before chains.
+// Whatever follows runs per packet on the swapped, normalized position:
+//
+//   STICK_CHAIN_FUSED    [filter] [curve] [scale], each optional, in that
+//                        order - the chain the mouse settings describe. Runs
+//                        as the hand-written stick_shape_input() kernel, so
+//                        the default chain is bit-exact with the code that
+//                        predates chains.
+//   STICK_CHAIN_GENERIC  anything else: a loop over the stages.
+
+#ifndef STICK_CHAIN_H
+#define STICK_CHAIN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "keymapping.h"
+#include "stick_math.h"
+
+#define STICK_CHAIN_PI  3.14159265358979f
+
+typedef enum {
+    STICK_CHAIN_FUSED,
+    STICK_CHAIN_GENERIC
+} StickChainPath;
+
+typedef struct {
+    StickStageType type;
+    union {
+        struct { float radius; } deadzone;          // Normalized (1.0 = full deflection)
+        struct { float exponent; } curve;
+        struct { float alpha; } filter;             // 1 - smoothing
+        struct { float tan_limit; } snap;
+        struct { float x, y; } scale;
+        struct { float cos_angle, sin_angle; } rotate;
+    };
+} StickStage;
+
+typedef struct {
+    StickChainPath path;
+    bool calibrate;             // Gate: stretch to the recorded range (if any)
+    bool from_settings;         // Built from the mouse settings, not a spec
+    int16_t deadzone;           // Gate radius, raw units
+    float smoothing;            // STICK_CHAIN_FUSED parameters
+    float curve;
+    float gain_x;               // Multiplied in by the caller (1 on the generic path)
+    float gain_y;
+    int count;                  // Stages after the gate
+    StickStage stages[STICK_CHAIN_MAX];
+} StickChain;
+
+// ============================================================================
+// Building
+// ============================================================================
+
+// The chain the mouse settings describe
+static inline void stick_chain_from_settings(const StickMapping *sticks, StickChainSpec *spec) {
+    const StickChainSpec chain = { 5, {
+        { STAGE_CALIBRATE, 0, 0 },
+        { STAGE_DEADZONE, sticks->deadzone, 0 },
+        { STAGE_FILTER, sticks->mouse_smoothing, 0 },
+        { STAGE_CURVE, sticks->mouse_curve, 0 },
+        { STAGE_SCALE, sticks->mouse_sensitivity, sticks->mouse_sensitivity } } };
+    *spec = chain;
+}
+
+// Checks what compile would otherwise drop: calibrate anywhere but first,
+// a second filter (there is filter state for one per stick), out-of-range
+// values. false with a message in error.
+static inline bool stick_chain_check(const StickChainSpec *spec, char *error, int error_size) {
+    int filters = 0;
+    if (spec->count < 0 || spec->count > STICK_CHAIN_MAX) {
+        snprintf(error, error_size, "at most %d stages", STICK_CHAIN_MAX);
+        return false;
+    }
+    for (int i = 0; i < spec->count; i++) {
+        const StickStageSpec *stage = &spec->stages[i];
+        float v = stage->value;
+        switch (stage->type) {
+            case STAGE_CALIBRATE:
+                if (i != 0) {
+                    snprintf(error, error_size, "calibrate must be the first stage");
+                    return false;
+                }
+                break;
+            case STAGE_DEADZONE:
+                if (!(v >= 0 && v <= 32767)) {
+                    snprintf(error, error_size, "deadzone must be 0-32767");
+                    return false;
+                }
+                break;
+            case STAGE_CURVE:
+                if (!(v >= 0.1f && v <= 5.0f)) {
+                    snprintf(error, error_size, "curve must be 0.1-5.0");
+                    return false;
+                }
+                break;
+            case STAGE_FILTER:
+                if (++filters > 1 || !(v >= 0 && v <= 0.95f)) {
+                    snprintf(error, error_size, "one filter per chain, smoothing 0.0-0.95");
+                    return false;
+                }
+                break;
+            case STAGE_SNAP:
+                if (!(v >= 0 && v < 45)) {
+                    snprintf(error, error_size, "snap must be 0-45 degrees");
+                    return false;
+                }
+                break;
+            case STAGE_SCALE:
+                if (!(fabsf(v) <= 20 && fabsf(stage->value2) <= 20)) {
+                    snprintf(error, error_size, "scale must be -20 to 20");
+                    return false;
+                }
+                break;
+            case STAGE_ROTATE:
+                if (!(v >= -180 && v <= 180)) {
+                    snprintf(error, error_size, "rotate must be -180 to 180 degrees");
+                    return false;
+                }
+                break;
+            default:
+                snprintf(error, error_size, "unknown stage");
+                return false;
+        }
+    }
+    return true;
+}
+
+// Stages are listed in the order fused chains allow them
+static inline bool stick_chain_fusable(const StickStage *stages, int count) {
+    int next = 0;
+    static const StickStageType order[] = { STAGE_FILTER, STAGE_CURVE, STAGE_SCALE };
+    for (int i = 0; i < count; i++) {
+        while (next < 3 && order[next] != stages[i].type) {
+            next++;
+        }
+        if (next == 3) {
+            return false;
+        }
+        next++;
+    }
+    return true;
+}
+
+// Compile a checked spec. Anything stick_chain_check() rejects is skipped.
+static inline void stick_chain_compile(const StickChainSpec *spec, bool from_settings, StickChain *chain) {
+    int i = 0;
+    bool filtered = false;
+
+    memset(chain, 0, sizeof(*chain));
+    chain->from_settings = from_settings;
+    chain->smoothing = 0.0f;
+    chain->curve = 1.0f;
+    chain->gain_x = 1.0f;
+    chain->gain_y = 1.0f;
+
+    // Gate
+    if (i < spec->count && spec->stages[i].type == STAGE_CALIBRATE) {
+        chain->calibrate = true;
+        i++;
+    }
+    if (i < spec->count && spec->stages[i].type == STAGE_DEADZONE) {
+        chain->deadzone = (int16_t)spec->stages[i].value;
+        i++;
+    }
+
+    for (; i < spec->count && i < STICK_CHAIN_MAX; i++) {
+        const StickStageSpec *in = &spec->stages[i];
+        StickStage *out = &chain->stages[chain->count];
+        out->type = in->type;
+        switch (in->type) {
+            case STAGE_DEADZONE:
+                out->deadzone.radius = in->value / 32767.0f;
+                break;
+            case STAGE_CURVE:
+                out->curve.exponent = in->value;
+                chain->curve = in->value;
+                break;
+            case STAGE_FILTER:
+                if (filtered) {
+                    continue;
+                }
+                filtered = true;
+                out->filter.alpha = 1.0f - in->value;
+                chain->smoothing = in->value;
+                break;
+            case STAGE_SNAP:
+                out->snap.tan_limit = tanf(in->value * STICK_CHAIN_PI / 180.0f);
+                break;
+            case STAGE_SCALE:
+                out->scale.x = in->value;
+                out->scale.y = in->value2;
+                chain->gain_x = in->value;
+                chain->gain_y = in->value2;
+                break;
+            case STAGE_ROTATE:
+                out->rotate.cos_angle = cosf(in->value * STICK_CHAIN_PI / 180.0f);
+                out->rotate.sin_angle = sinf(in->value * STICK_CHAIN_PI / 180.0f);
+                break;
+            case STAGE_CALIBRATE:
+            default:
+                continue;
+        }
+        chain->count++;
+    }
+
+    // The fused kernel takes the parameters gathered above; the stage loop
+    // applies its scales itself
+    chain->path = stick_chain_fusable(chain->stages, chain->count) ? STICK_CHAIN_FUSED : STICK_CHAIN_GENERIC;
+    if (chain->path == STICK_CHAIN_GENERIC) {
+        chain->gain_x = 1.0f;
+        chain->gain_y = 1.0f;
+    }
+}
+
+// ============================================================================
+// Running
+// ============================================================================
+
+// The generic path: swap and normalize like stick_shape_input(), then each
+// stage in turn
+static inline void stick_chain_run_stages(const StickChain *chain, int16_t x, int16_t y,
+                                          float *smoothed_x, float *smoothed_y,
+                                          float *out_x, float *out_y) {
+    float vx = y / 32767.0f;
+    float vy = -x / 32767.0f;
+
+    for (int i = 0; i < chain->count; i++) {
+        const StickStage *stage = &chain->stages[i];
+        switch (stage->type) {
+            case STAGE_DEADZONE:
+                if (vx * vx + vy * vy < stage->deadzone.radius * stage->deadzone.radius) {
+                    vx = 0.0f;
+                    vy = 0.0f;
+                }
+                break;
+            case STAGE_FILTER: {
+                float alpha = stage->filter.alpha;
+                *smoothed_x = alpha * vx + (1.0f - alpha) * (*smoothed_x);
+                *smoothed_y = alpha * vy + (1.0f - alpha) * (*smoothed_y);
+                vx = *smoothed_x;
+                vy = *smoothed_y;
+                break;
+            }
+            case STAGE_CURVE:
+                vx = copysignf(powf(fabsf(vx), stage->curve.exponent), vx);
+                vy = copysignf(powf(fabsf(vy), stage->curve.exponent), vy);
+                break;
+            case STAGE_SNAP:
+                if (fabsf(vy) <= fabsf(vx) * stage->snap.tan_limit) {
+                    vy = 0.0f;
+                } else if (fabsf(vx) <= fabsf(vy) * stage->snap.tan_limit) {
+                    vx = 0.0f;
+                }
+                break;
+            case STAGE_SCALE:
+                vx *= stage->scale.x;
+                vy *= stage->scale.y;
+                break;
+            case STAGE_ROTATE: {
+                // Counterclockwise on screen, where y points down
+                float rx = vx * stage->rotate.cos_angle + vy * stage->rotate.sin_angle;
+                vy = vy * stage->rotate.cos_angle - vx * stage->rotate.sin_angle;
+                vx = rx;
+                break;
+            }
+            case STAGE_CALIBRATE:
+            default:
+                break;
+        }
+    }
+    *out_x = vx;
+    *out_y = vy;
+}
+
+// Gated position → shaped output, before chain->gain_x/gain_y (which the
+// caller folds into its pixel scale, as the mouse code always has)
+static inline void stick_chain_run(const StickChain *chain, int16_t x, int16_t y,
+                                   float *smoothed_x, float *smoothed_y,
+                                   float *out_x, float *out_y) {
+    if (chain->path == STICK_CHAIN_FUSED) {
+        stick_shape_input(x, y, chain->smoothing, chain->curve, smoothed_x, smoothed_y, out_x, out_y);
+    } else {
+        stick_chain_run_stages(chain, x, y, smoothed_x, smoothed_y, out_x, out_y);
+    }
+}
+
+#endif // STICK_CHAIN_H
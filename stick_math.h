@@ -0,0 +1,74 @@
+// stick_math.h
+// Floating-point stick kernels (deadzone/calibration and mouse input shaping)
+// Shared by the simulator and stick_bench, which compares them against the
+// fixed-point pipeline in fixed_point.h
+
+#ifndef STICK_MATH_H
+#define STICK_MATH_H
+
+#include <stdint.h>
+#include <math.h>
+#include "calibration.h"
+
+// range: per-angle outer reach of this stick, or NULL for an ideal circle
+static inline void apply_deadzone(int16_t *x, int16_t *y, int16_t deadzone, const StickRange *range) {
+    float magnitude = sqrtf((float)(*x) * (*x) + (float)(*y) * (*y));
+
+    // The exact centre passes a zero deadzone; it has no direction to
+    // calibrate along (0/0), and needs no scaling anyway
+    if (magnitude < deadzone || magnitude == 0.0f) {
+        *x = 0;
+        *y = 0;
+    } else if (range) {
+        // Stretch this direction's measured reach to full deflection
+        float outer = calibration_outer_radius(range, *x, *y);
+        float scale = 32767.0f / outer;
+        if (magnitude * scale > 32767.0f) {
+            scale = 32767.0f / magnitude;
+        }
+        *x = (int16_t)(*x * scale);
+        *y = (int16_t)(*y * scale);
+    } else if (magnitude > 32767) {
+        // Normalize if outside unit circle
+        float scale = 32767.0f / magnitude;
+        *x = (int16_t)(*x * scale);
+        *y = (int16_t)(*y * scale);
+    }
+}
+
+// Input side of the mouse and kinetic modes: swap, normalize, smooth, curve.
+// Produces -1.0..1.0 per axis; callers scale it to pixels.
+static inline void stick_shape_input(int16_t x, int16_t y, float smoothing, float curve,
+                                     float *smoothed_x, float *smoothed_y,
+                                     float *curved_x, float *curved_y) {
+    // Axes are swapped in the controller - swap them back
+    // Physical up/down is reported in X, physical left/right is reported in Y
+    int16_t temp = x;
+    x = y;
+    y = temp;
+
+    // Normalize to -1.0 to 1.0
+    float target_x = x / 32767.0f;
+    float target_y = -y / 32767.0f;  // Invert Y - pushing up should move cursor up
+
+    // Exponential smoothing (higher smoothing = smoother but more lag)
+    // alpha determines how much of the new value vs old value to use
+    // smoothing = 0.0 means no smoothing (all new value)
+    // smoothing = 0.9 means heavy smoothing (mostly old value)
+    float alpha = 1.0f - smoothing;
+    *smoothed_x = alpha * target_x + (1.0f - alpha) * (*smoothed_x);
+    *smoothed_y = alpha * target_y + (1.0f - alpha) * (*smoothed_y);
+
+    // Use smoothed values for movement
+    float norm_x = *smoothed_x;
+    float norm_y = *smoothed_y;
+
+    // Apply exponential curve for better control
+    float sign_x = (norm_x >= 0) ? 1.0f : -1.0f;
+    float sign_y = (norm_y >= 0) ? 1.0f : -1.0f;
+
+    *curved_x = sign_x * powf(fabsf(norm_x), curve);
+    *curved_y = sign_y * powf(fabsf(norm_y), curve);
+}
+
+#endif // STICK_MATH_H
@@ -0,0 +1,194 @@
+// trace.c
+// Per-thread trace buffers and Chrome JSON export (see trace.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#include "trace.h"
+
+typedef struct TraceBuffer {
+    struct TraceBuffer *next;       // Registry link, never changes once published
+    uint64_t thread_id;
+    char thread_name[32];
+    uint32_t mask;                  // Capacity - 1
+    _Atomic uint64_t head;          // Events ever written (owner thread only)
+    TraceEvent events[];
+} TraceBuffer;
+
+volatile bool trace_enabled = false;
+
+static uint32_t buffer_capacity = TRACE_DEFAULT_EVENTS;
+static _Atomic(TraceBuffer *) buffers = NULL;
+static __thread TraceBuffer *thread_buffer = NULL;
+
+static const char *const stage_names[TRACE_STAGE_COUNT] = {
+    [TRACE_STAGE_USB]     = "usb_completion",
+    [TRACE_STAGE_DECODE]  = "decode",
+    [TRACE_STAGE_MAP]     = "map",
+    [TRACE_STAGE_POST]    = "post_output",
+    [TRACE_STAGE_CONSOLE] = "console",
+    [TRACE_STAGE_TICK]    = "output_tick",
+    [TRACE_STAGE_PLUGINS] = "plugins",
+};
+
+const char *trace_stage_name(TraceStage stage) {
+    return (stage < TRACE_STAGE_COUNT) ? stage_names[stage] : "unknown";
+}
+
+static uint64_t current_thread_id(void) {
+#if defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(NULL, &tid);
+    return tid;
+#else
+    return (uint64_t)syscall(SYS_gettid);
+#endif
+}
+
+// First event on a thread: allocate its buffer and push it onto the registry
+static TraceBuffer *thread_buffer_create(void) {
+    TraceBuffer *buffer = calloc(1, sizeof(TraceBuffer) + buffer_capacity * sizeof(TraceEvent));
+    if (!buffer) {
+        return NULL;
+    }
+    buffer->thread_id = current_thread_id();
+    buffer->mask = buffer_capacity - 1;
+    snprintf(buffer->thread_name, sizeof(buffer->thread_name), "thread %llu",
+             (unsigned long long)buffer->thread_id);
+
+    TraceBuffer *head = atomic_load_explicit(&buffers, memory_order_relaxed);
+    do {
+        buffer->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&buffers, &head, buffer,
+                                                    memory_order_release, memory_order_relaxed));
+    thread_buffer = buffer;
+    return buffer;
+}
+
+void trace_record(TraceStage stage, uint64_t start_ns, uint64_t end_ns, uint16_t arg) {
+    TraceBuffer *buffer = thread_buffer;
+    if (!buffer && !(buffer = thread_buffer_create())) {
+        return;
+    }
+
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    TraceEvent *event = &buffer->events[head & buffer->mask];
+    event->start_ns = start_ns;
+    event->duration_ns = (end_ns > start_ns) ? (uint32_t)(end_ns - start_ns) : 0;
+    event->stage = (uint16_t)stage;
+    event->arg = arg;
+
+    // Publish after the event is written, so the exporter never sees it half-done
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+void trace_start(uint32_t events_per_thread) {
+    // Capacity is fixed once the first buffer exists
+    if (!atomic_load(&buffers)) {
+        uint32_t capacity = 1;
+        while (capacity < events_per_thread && capacity < (1u << 24)) {
+            capacity <<= 1;
+        }
+        buffer_capacity = capacity;
+    }
+    trace_enabled = true;
+}
+
+void trace_stop(void) {
+    trace_enabled = false;
+}
+
+void trace_set_thread_name(const char *name) {
+    TraceBuffer *buffer = thread_buffer ? thread_buffer : thread_buffer_create();
+    if (buffer) {
+        snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%s", name);
+        // A cut-off name mustn't end partway through a UTF-8 character
+        size_t length = strlen(buffer->thread_name);
+        if (length < strlen(name)) {
+            while (length > 0 && (buffer->thread_name[length - 1] & 0xC0) == 0x80) {
+                length--;
+            }
+            if (length > 0 && (buffer->thread_name[length - 1] & 0x80)) {
+                length--;
+            }
+            buffer->thread_name[length] = '\0';
+        }
+    }
+}
+
+// ============================================================================
+// Chrome JSON Export
+// ============================================================================
+
+void trace_write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+int trace_export_chrome_json(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return -1;
+    }
+
+    int pid = (int)getpid();
+    int written = 0;
+    bool first = true;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (TraceBuffer *buffer = atomic_load_explicit(&buffers, memory_order_acquire);
+         buffer; buffer = buffer->next) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%llu,"
+                "\"args\":{\"name\":",
+                first ? "" : ",\n", pid, (unsigned long long)buffer->thread_id);
+        trace_write_json_string(file, buffer->thread_name);
+        fprintf(file, "}}");
+        first = false;
+
+        uint64_t capacity = (uint64_t)buffer->mask + 1;
+        uint64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        uint64_t tail = (head > capacity) ? head - capacity : 0;
+
+        for (uint64_t i = tail; i < head; i++) {
+            TraceEvent event = buffer->events[i & buffer->mask];
+
+            // The writer may have lapped us while we were reading this slot
+            uint64_t now_head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+            if (now_head - i >= capacity) {
+                continue;
+            }
+
+            fprintf(file, ",\n{\"name\":");
+            trace_write_json_string(file, trace_stage_name((TraceStage)event.stage));
+            fprintf(file, ",\"cat\":\"input\",\"ph\":\"X\","
+                    "\"ts\":%llu.%03u,\"dur\":%u.%03u,\"pid\":%d,\"tid\":%llu,"
+                    "\"args\":{\"seq\":%u}}",
+                    (unsigned long long)(event.start_ns / 1000), (unsigned)(event.start_ns % 1000),
+                    event.duration_ns / 1000, event.duration_ns % 1000,
+                    pid, (unsigned long long)buffer->thread_id, event.arg);
+            written++;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    if (fclose(file) != 0) {
+        return -1;
+    }
+    return written;
+}
@@ -0,0 +1,243 @@
+// usb_helper.c
+// Privileged half of the split simulator: owns the controller, does the GIP
+// handshake and publishes raw packets into a shared-memory ring (see
+// usb_ring.h) for an unprivileged `./simulator --helper`.
+// Root is only needed to open the device. The helper drops to the invoking
+// user (SUDO_UID, or --user) right after that, so the code that runs per
+// packet never runs as root.
+// Compile: make usb_helper
+// Run: sudo ./usb_helper [--socket PATH] [--user NAME] [--capacity N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "gip_device.h"
+#include "usb_ring.h"
+
+#define PROCESS_TIMEOUT_MS  100
+
+// Give up on in-place recovery after this many failures with no packet between
+#define MAX_RECOVERIES_IN_A_ROW 5
+
+static volatile sig_atomic_t running = 1;
+
+typedef struct {
+    UsbRing *ring;
+    uint64_t published;
+} Helper;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+// Packet callback: straight from the USB transfer buffer into the ring
+static void publish_packet(void *user_data, const uint8_t *data, int length,
+                           uint64_t timestamp_ns) {
+    Helper *helper = user_data;
+    if (usb_ring_push(helper->ring, data, length, timestamp_ns)) {
+        helper->published++;
+    }
+}
+
+// Only the user we drop to may connect
+static int open_listen_socket(const char *path, uid_t owner, gid_t group) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);  // Stale socket from a previous run
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (chown(path, owner, group) != 0 || chmod(path, 0600) != 0) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+// Who to run as once the device is open: --user, else whoever ran sudo
+static bool find_target_user(const char *name, uid_t *uid, gid_t *gid) {
+    if (name) {
+        struct passwd *pw = getpwnam(name);
+        if (!pw) {
+            return false;
+        }
+        *uid = pw->pw_uid;
+        *gid = pw->pw_gid;
+        return true;
+    }
+    const char *sudo_uid = getenv("SUDO_UID");
+    const char *sudo_gid = getenv("SUDO_GID");
+    if (!sudo_uid || !sudo_gid) {
+        return false;
+    }
+    *uid = (uid_t)strtoul(sudo_uid, NULL, 10);
+    *gid = (gid_t)strtoul(sudo_gid, NULL, 10);
+    return true;
+}
+
+static bool drop_privileges(uid_t uid, gid_t gid) {
+    if (setgroups(0, NULL) != 0 || setgid(gid) != 0 || setuid(uid) != 0) {
+        return false;
+    }
+    // Must not be able to get root back
+    return uid == 0 || setuid(0) != 0;
+}
+
+int main(int argc, char **argv) {
+    const char *socket_path = USB_HELPER_SOCKET_PATH;
+    const char *user = NULL;
+    uint32_t capacity = USB_RING_DEFAULT_CAPACITY;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--user") == 0 && i + 1 < argc) {
+            user = argv[++i];
+        } else if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            capacity = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            printf("Usage: sudo %s [--socket PATH] [--user NAME] [--capacity N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);   // Client hung up before taking the ring
+
+    printf("Xbox Controller USB Helper\n");
+    printf("==========================\n\n");
+
+    uid_t uid;
+    gid_t gid;
+    if (!find_target_user(user, &uid, &gid)) {
+        printf("❌ %s\n", user ? "No such user" : "Run with sudo, or name the user to run as with --user");
+        return 1;
+    }
+
+    GipDevice *dev = NULL;
+    int result = gip_device_open(&dev, XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
+    if (result != GIP_OK) {
+        printf("❌ Could not open controller: %s\n", gip_strerror(result));
+        return 1;
+    }
+    printf("✅ Found controller %s\n", gip_device_serial(dev));
+    gip_device_set_verbosity(dev, GIP_VERBOSE_SUMMARY);
+    gip_device_handshake(dev);
+
+    Helper helper = { 0 };
+    result = usb_ring_create(&helper.ring, capacity, gip_device_serial(dev));
+    if (result != GIP_OK) {
+        printf("❌ Could not create packet ring (capacity must be a power of two)\n");
+        gip_device_close(dev);
+        return 1;
+    }
+
+    int listen_fd = open_listen_socket(socket_path, uid, gid);
+    if (listen_fd < 0) {
+        printf("❌ Could not listen on %s\n", socket_path);
+        usb_ring_close(helper.ring);
+        gip_device_close(dev);
+        return 1;
+    }
+
+    if (!drop_privileges(uid, gid)) {
+        printf("❌ Could not drop privileges to uid %d\n", (int)uid);
+        close(listen_fd);
+        unlink(socket_path);
+        usb_ring_close(helper.ring);
+        gip_device_close(dev);
+        return 1;
+    }
+    printf("✅ Running as uid %d, ring of %u packets\n", (int)getuid(), capacity);
+
+    result = gip_device_start(dev, publish_packet, &helper);
+    if (result != GIP_OK) {
+        printf("❌ Could not start async input: %s\n", gip_strerror(result));
+        running = 0;
+    } else {
+        printf("✅ Waiting for simulator on %s (./simulator --helper)\n", socket_path);
+        printf("Press Ctrl+C to exit\n\n");
+    }
+
+    GipRecoveryOps recovery_ops;
+    GipRecoveryPolicy policy = GIP_RECOVERY_DEFAULT_POLICY;
+    int recoveries_in_a_row = 0;
+    gip_device_recovery_ops(dev, &recovery_ops);
+
+    // USB events and new consumers from one poll(); packets go to the ring
+    // from inside gip_device_process()
+    while (running) {
+        struct pollfd fds[2] = {
+            { .fd = gip_device_fd(dev), .events = POLLIN },
+            { .fd = listen_fd, .events = POLLIN },
+        };
+        if (poll(fds, 2, PROCESS_TIMEOUT_MS) < 0) {
+            continue;   // EINTR
+        }
+
+        result = gip_device_process(dev, 0);
+        if (result > 0) {
+            recoveries_in_a_row = 0;
+        } else if (result == GIP_ERROR_NO_DEVICE) {
+            printf("❌ Controller disconnected!\n");
+            break;
+        } else if (result < 0) {
+            // Stall, overflow or I/O error: fix it in place, the ring stays up
+            GipRecoveryResult recovery;
+            printf("⚠️  USB error: %s, recovering...\n", gip_strerror(result));
+            if (++recoveries_in_a_row > MAX_RECOVERIES_IN_A_ROW ||
+                (result = gip_recover(&recovery_ops, &policy, result, &recovery)) != GIP_OK) {
+                printf("❌ Could not recover: %s\n", gip_strerror(result));
+                break;
+            }
+            printf("✅ Recovered by %s in %.1f ms\n", gip_recovery_step_name(recovery.step),
+                   recovery.elapsed_ns / 1e6);
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int client = accept(listen_fd, NULL, NULL);
+            if (client >= 0) {
+                if (usb_ring_send_fds(helper.ring, client) == GIP_OK) {
+                    printf("🎮 Simulator attached\n");
+                }
+                close(client);
+            }
+        }
+    }
+
+    // Tell the consumer before it starts waiting on a ring nobody fills
+    usb_ring_set_state(helper.ring, USB_RING_DISCONNECTED);
+    printf("\nPublished %llu packets, dropped %llu (ring full)\n",
+           (unsigned long long)helper.published, (unsigned long long)usb_ring_dropped(helper.ring));
+
+    gip_device_stop(dev);
+    gip_device_close(dev);
+    close(listen_fd);
+    unlink(socket_path);
+    usb_ring_close(helper.ring);
+    return 0;
+}
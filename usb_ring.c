@@ -0,0 +1,391 @@
+// usb_ring.c
+// Shared-memory packet ring between the USB helper and the simulator (see usb_ring.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include "usb_ring.h"
+#include "gip_device.h"
+#include "input_state.h"
+
+// ============================================================================
+// Shared layout
+// ============================================================================
+
+// Producer and consumer fields live on separate cache lines so a push
+// doesn't invalidate the line the consumer polls, and vice versa
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slot_size;
+    char serial[64];
+    _Atomic uint32_t state;                 // UsbRingState
+
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t head;    // Next slot to publish
+    _Atomic uint32_t wake_seq;              // The futex word: bumped on every wakeup
+    _Atomic uint64_t dropped;
+
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t tail;    // Next slot to consume
+    _Atomic uint32_t consumer_waiting;
+} UsbRingHeader;
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) uint64_t completion_ns;
+    uint64_t publish_ns;
+    uint32_t length;
+    uint8_t data[USB_RING_MAX_PACKET];
+} UsbRingSlot;
+
+struct UsbRing {
+    UsbRingHeader *header;
+    UsbRingSlot *slots;
+    size_t map_size;
+    int shm_fd;
+    int wake_fd;            // Pipe end: write (producer) or read (consumer); -1 on Linux
+    int wake_peer_fd;       // Producer only: the read end handed to consumers
+};
+
+static uint64_t ring_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static size_t ring_map_size(uint32_t capacity) {
+    return sizeof(UsbRingHeader) + (size_t)capacity * sizeof(UsbRingSlot);
+}
+
+static bool ring_map(UsbRing *ring, size_t size, int prot) {
+    void *base = mmap(NULL, size, prot, MAP_SHARED, ring->shm_fd, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    ring->header = base;
+    ring->slots = (UsbRingSlot *)((uint8_t *)base + sizeof(UsbRingHeader));
+    ring->map_size = size;
+    return true;
+}
+
+// ============================================================================
+// Wakeups
+// ============================================================================
+
+// Bumping the word first means a consumer that read it before the change
+// and hasn't reached FUTEX_WAIT yet returns at once instead of sleeping
+static void ring_wake(UsbRing *ring) {
+#if defined(__linux__)
+    atomic_fetch_add(&ring->header->wake_seq, 1);
+    syscall(SYS_futex, &ring->header->wake_seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+    if (ring->wake_fd >= 0) {
+        char byte = 1;
+        (void)!write(ring->wake_fd, &byte, 1);     // Full pipe = a wakeup is already pending
+    }
+#endif
+}
+
+static void ring_sleep(UsbRing *ring, uint32_t seq, int timeout_us) {
+#if defined(__linux__)
+    struct timespec ts = { timeout_us / 1000000, (long)(timeout_us % 1000000) * 1000 };
+    syscall(SYS_futex, &ring->header->wake_seq, FUTEX_WAIT, seq, &ts, NULL, 0);
+#else
+    (void)seq;
+    struct pollfd pfd = { ring->wake_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, (timeout_us + 999) / 1000) > 0) {
+        char drain[64];
+        while (read(ring->wake_fd, drain, sizeof(drain)) > 0) {
+        }
+    }
+#endif
+}
+
+// ============================================================================
+// Producer
+// ============================================================================
+
+int usb_ring_create(UsbRing **out, uint32_t capacity, const char *serial) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return GIP_ERROR_OTHER;
+    }
+    UsbRing *ring = calloc(1, sizeof(UsbRing));
+    if (!ring) {
+        return GIP_ERROR_NO_MEM;
+    }
+    ring->wake_fd = -1;
+    ring->wake_peer_fd = -1;
+
+    // Anonymous from the start: the name only exists long enough to open it
+    char name[64];
+    snprintf(name, sizeof(name), "/xbox_usb_ring.%d", (int)getpid());
+    ring->shm_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (ring->shm_fd < 0) {
+        free(ring);
+        return GIP_ERROR_IO;
+    }
+    shm_unlink(name);
+
+    size_t size = ring_map_size(capacity);
+    if (ftruncate(ring->shm_fd, (off_t)size) != 0 || !ring_map(ring, size, PROT_READ | PROT_WRITE)) {
+        close(ring->shm_fd);
+        free(ring);
+        return GIP_ERROR_NO_MEM;
+    }
+
+    UsbRingHeader *header = ring->header;
+    header->magic = USB_RING_MAGIC;
+    header->version = USB_RING_VERSION;
+    header->capacity = capacity;
+    header->slot_size = sizeof(UsbRingSlot);
+    snprintf(header->serial, sizeof(header->serial), "%s", serial ? serial : "");
+    atomic_store(&header->state, USB_RING_STREAMING);
+
+#if !defined(__linux__)
+    int fds[2];
+    if (pipe(fds) != 0) {
+        usb_ring_close(ring);
+        return GIP_ERROR_IO;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    ring->wake_peer_fd = fds[0];
+    ring->wake_fd = fds[1];
+#endif
+
+    *out = ring;
+    return GIP_OK;
+}
+
+int usb_ring_send_fds(UsbRing *ring, int socket_fd) {
+    int fds[2] = { ring->shm_fd, ring->wake_peer_fd };
+    int count = ring->wake_peer_fd >= 0 ? 2 : 1;
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    char tag = 'R';
+    struct iovec iov = { &tag, 1 };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, count * sizeof(int));
+
+    return sendmsg(socket_fd, &msg, 0) == 1 ? GIP_OK : GIP_ERROR_IO;
+}
+
+bool usb_ring_push(UsbRing *ring, const uint8_t *data, int length, uint64_t completion_ns) {
+    UsbRingHeader *header = ring->header;
+    uint32_t head = atomic_load_explicit(&header->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+    if (head - tail >= header->capacity) {
+        // Consumer stalled: drop the newest rather than block the USB side
+        atomic_fetch_add_explicit(&header->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    UsbRingSlot *slot = &ring->slots[head & (header->capacity - 1)];
+    if (length > USB_RING_MAX_PACKET) {
+        length = USB_RING_MAX_PACKET;
+    }
+    memcpy(slot->data, data, length);
+    slot->length = length;
+    slot->completion_ns = completion_ns;
+    slot->publish_ns = ring_clock_ns();
+
+    // seq_cst store + load pairs with the consumer's waiting/head check, so
+    // either we see it waiting or it sees the new head - never neither
+    atomic_store(&header->head, head + 1);
+    if (atomic_load(&header->consumer_waiting)) {
+        ring_wake(ring);
+    }
+    return true;
+}
+
+void usb_ring_set_state(UsbRing *ring, UsbRingState state) {
+    atomic_store(&ring->header->state, state);
+    ring_wake(ring);
+}
+
+// ============================================================================
+// Consumer
+// ============================================================================
+
+static bool receive_fds(int socket_fd, int *fds, int *count) {
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    char tag;
+    struct iovec iov = { &tag, 1 };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    if (recvmsg(socket_fd, &msg, 0) != 1 || tag != 'R') {
+        return false;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        return false;
+    }
+    *count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+    if (*count < 1 || *count > 2) {
+        return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), *count * sizeof(int));
+    return true;
+}
+
+int usb_ring_attach(UsbRing **out, int socket_fd) {
+    int fds[2] = { -1, -1 };
+    int count = 0;
+    if (!receive_fds(socket_fd, fds, &count)) {
+        return GIP_ERROR_IO;
+    }
+
+    UsbRing *ring = calloc(1, sizeof(UsbRing));
+    if (!ring) {
+        close(fds[0]);
+        if (count > 1) close(fds[1]);
+        return GIP_ERROR_NO_MEM;
+    }
+    ring->shm_fd = fds[0];
+    ring->wake_fd = count > 1 ? fds[1] : -1;
+    ring->wake_peer_fd = -1;
+
+    // Validate against the real size before trusting the header's capacity
+    struct stat st;
+    if (fstat(ring->shm_fd, &st) != 0 || (size_t)st.st_size < sizeof(UsbRingHeader) ||
+        !ring_map(ring, (size_t)st.st_size, PROT_READ | PROT_WRITE)) {
+        usb_ring_close(ring);
+        return GIP_ERROR_IO;
+    }
+    const UsbRingHeader *header = ring->header;
+    if (header->magic != USB_RING_MAGIC || header->version != USB_RING_VERSION ||
+        header->slot_size != sizeof(UsbRingSlot) || header->capacity == 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        ring_map_size(header->capacity) > ring->map_size) {
+        usb_ring_close(ring);
+        return GIP_ERROR_OTHER;
+    }
+#if !defined(__linux__)
+    if (ring->wake_fd < 0) {
+        usb_ring_close(ring);
+        return GIP_ERROR_OTHER;
+    }
+#endif
+
+    // Start from now; packets queued for a previous consumer are stale
+    atomic_store(&ring->header->tail, atomic_load(&ring->header->head));
+    *out = ring;
+    return GIP_OK;
+}
+
+int usb_ring_connect(UsbRing **out, const char *socket_path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        return GIP_ERROR_OTHER;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return GIP_ERROR_IO;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int error = (errno == EACCES) ? GIP_ERROR_ACCESS : GIP_ERROR_NOT_FOUND;
+        close(fd);
+        return error;
+    }
+    int result = usb_ring_attach(out, fd);
+    close(fd);
+    return result;
+}
+
+bool usb_ring_pop(UsbRing *ring, UsbRingPacket *packet) {
+    UsbRingHeader *header = ring->header;
+    uint32_t tail = atomic_load_explicit(&header->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&header->head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+
+    const UsbRingSlot *slot = &ring->slots[tail & (header->capacity - 1)];
+    packet->completion_ns = slot->completion_ns;
+    packet->publish_ns = slot->publish_ns;
+    packet->length = slot->length > USB_RING_MAX_PACKET ? USB_RING_MAX_PACKET : (int)slot->length;
+    memcpy(packet->data, slot->data, packet->length);
+
+    atomic_store_explicit(&header->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+int usb_ring_wait(UsbRing *ring, int timeout_us) {
+    UsbRingHeader *header = ring->header;
+    uint32_t tail = atomic_load_explicit(&header->tail, memory_order_relaxed);
+
+    // The word is read before head and state: a publish or state change
+    // that lands after these checks bumps it, and FUTEX_WAIT won't sleep
+    atomic_store(&header->consumer_waiting, 1);
+    uint32_t seq = atomic_load(&header->wake_seq);
+    uint32_t head = atomic_load(&header->head);
+    if (head == tail && atomic_load(&header->state) == USB_RING_STREAMING && timeout_us > 0) {
+        ring_sleep(ring, seq, timeout_us);
+        head = atomic_load(&header->head);
+    }
+    atomic_store_explicit(&header->consumer_waiting, 0, memory_order_relaxed);
+
+    if (head != tail) {
+        return 1;
+    }
+    return atomic_load(&header->state) == USB_RING_STREAMING ? 0 : GIP_ERROR_NO_DEVICE;
+}
+
+const char *usb_ring_serial(const UsbRing *ring) {
+    return ring->header->serial;
+}
+
+uint64_t usb_ring_dropped(const UsbRing *ring) {
+    return atomic_load_explicit(&ring->header->dropped, memory_order_relaxed);
+}
+
+void usb_ring_close(UsbRing *ring) {
+    if (!ring) {
+        return;
+    }
+    if (ring->header) {
+        munmap(ring->header, ring->map_size);
+    }
+    if (ring->shm_fd >= 0) close(ring->shm_fd);
+    if (ring->wake_fd >= 0) close(ring->wake_fd);
+    if (ring->wake_peer_fd >= 0) close(ring->wake_peer_fd);
+    free(ring);
+}
@@ -0,0 +1,63 @@
+// usb_ring.h
+// Shared-memory packet ring between the privileged USB helper and the
+// unprivileged simulator (part of libgip)
+//
+// usb_helper (root) owns the controller and pushes every received packet
+// into a single-producer/single-consumer ring in shared memory; the
+// simulator (a normal user) pops them. Setup goes over a Unix socket: the
+// helper passes the ring's memory fd (and, outside Linux, a wakeup pipe)
+// with SCM_RIGHTS. After that no syscalls are made per packet unless the
+// consumer is asleep:
+//  - Linux: the consumer sleeps on a futex word the producer bumps when it
+//    publishes to a waiting consumer or changes the ring state
+//  - elsewhere: the consumer polls the wakeup pipe
+//
+// Both processes timestamp with CLOCK_MONOTONIC, so the consumer can tell
+// exactly how long a packet spent in the ring.
+
+#ifndef USB_RING_H
+#define USB_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define USB_RING_MAGIC              0x474e4952  // "RING"
+#define USB_RING_VERSION            2
+#define USB_RING_DEFAULT_CAPACITY   256         // Packets; must be a power of two
+#define USB_RING_MAX_PACKET         64
+
+#define USB_HELPER_SOCKET_PATH      "/tmp/xbox_usb_helper.sock"
+
+typedef enum {
+    USB_RING_STREAMING      = 1,
+    USB_RING_DISCONNECTED   = 2     // Controller gone; the helper has stopped
+} UsbRingState;
+
+typedef struct UsbRing UsbRing;
+
+typedef struct {
+    uint64_t completion_ns;     // USB transfer completed (helper)
+    uint64_t publish_ns;        // Made visible in the ring (helper)
+    int length;
+    uint8_t data[USB_RING_MAX_PACKET];
+} UsbRingPacket;
+
+// Producer (helper) side
+int usb_ring_create(UsbRing **out, uint32_t capacity, const char *serial);
+int usb_ring_send_fds(UsbRing *ring, int socket_fd);   // Hand the ring to a consumer
+bool usb_ring_push(UsbRing *ring, const uint8_t *data, int length, uint64_t completion_ns);
+void usb_ring_set_state(UsbRing *ring, UsbRingState state);
+
+// Consumer side. usb_ring_attach() takes over socket_fd's received fds and
+// skips anything published before it attached.
+int usb_ring_connect(UsbRing **out, const char *socket_path);
+int usb_ring_attach(UsbRing **out, int socket_fd);
+bool usb_ring_pop(UsbRing *ring, UsbRingPacket *packet);
+// 1 = packets ready, 0 = timed out, GIP_ERROR_NO_DEVICE = helper lost the controller
+int usb_ring_wait(UsbRing *ring, int timeout_us);
+
+const char *usb_ring_serial(const UsbRing *ring);
+uint64_t usb_ring_dropped(const UsbRing *ring);     // Pushes refused because the ring was full
+void usb_ring_close(UsbRing *ring);
+
+#endif // USB_RING_H
@@ -0,0 +1,95 @@
+// xbox_plugin.h
+// Plugin ABI for custom input transforms (game-specific aim curves, filters,
+// button macros) loaded with `simulator --plugin`
+//
+// This header is the whole contract; a plugin includes nothing else from the
+// driver and is built on its own:
+//
+//   cc -O2 -shared -fPIC my_plugin.c -o my_plugin.so
+//
+// and exports one function, XBOX_PLUGIN_ENTRY, returning a static
+// descriptor:
+//
+//   static const XboxPlugin plugin = {
+//       .abi_version = XBOX_PLUGIN_ABI_VERSION,
+//       .struct_size = sizeof(XboxPlugin),
+//       .name = "my plugin",
+//       .pipeline = XBOX_PLUGIN_ANALOG,
+//       .state_size = sizeof(MyState),
+//       .init = my_init,
+//       .process_batch = my_process,
+//       .destroy = my_destroy
+//   };
+//   const XboxPlugin *xbox_plugin_entry(uint32_t host_abi_version) { return &plugin; }
+//
+// Rules for plugins:
+//  - State lives in the block the host hands to init (state_size bytes,
+//    zeroed, 64-byte aligned, carved out of one arena allocated at startup).
+//    process_batch runs on the input thread for every packet and must not
+//    allocate, block or do I/O.
+//  - process_batch rewrites frames in place. Only the fields of the declared
+//    pipeline are kept: an analog plugin can't change buttons, a button
+//    plugin can't move sticks or triggers. Both can read everything.
+//  - Time spent in process_batch is measured per plugin against a per-packet
+//    budget; overruns are counted and reported, not enforced.
+//
+// Compatibility: the host loads a plugin only if its abi_version matches
+// XBOX_PLUGIN_ABI_VERSION. Anything that changes the layout or meaning of
+// the types below bumps the version; new descriptor fields are only ever
+// appended (struct_size tells the host which ones a plugin knows about).
+
+#ifndef XBOX_PLUGIN_H
+#define XBOX_PLUGIN_H
+
+#include <stdint.h>
+
+#define XBOX_PLUGIN_ABI_VERSION     2
+#define XBOX_PLUGIN_ENTRY           xbox_plugin_entry
+#define XBOX_PLUGIN_ENTRY_NAME      "xbox_plugin_entry"
+
+// Which part of the frame a plugin may change
+#define XBOX_PLUGIN_ANALOG          0x1     // Triggers and sticks
+#define XBOX_PLUGIN_BUTTONS         0x2     // Button bits
+
+// One decoded input packet, oriented as the player sees the controller:
+// x is right, y is up, and left_trigger is the trigger labelled left. (The
+// controller reports both sticks with their axes swapped and the triggers
+// the other way round; the host undoes that before a plugin sees the frame
+// and redoes it afterwards.) Values are otherwise unprocessed: sticks
+// -32768..32767 with no deadzone or calibration, triggers 0..255, buttons
+// XBOX_BTN_* bits (gip.h).
+typedef struct {
+    uint64_t timestamp_ns;      // CLOCK_MONOTONIC at USB completion
+    uint16_t buttons;
+    uint8_t left_trigger;
+    uint8_t right_trigger;
+    int16_t left_x;
+    int16_t left_y;
+    int16_t right_x;
+    int16_t right_y;
+    uint32_t reserved;          // Zero; keeps the frame 24 bytes
+} XboxPluginFrame;
+
+typedef struct {
+    uint32_t abi_version;       // XBOX_PLUGIN_ABI_VERSION the plugin was built with
+    uint32_t struct_size;       // sizeof(XboxPlugin) the plugin was built with
+    const char *name;
+    uint32_t pipeline;          // XBOX_PLUGIN_ANALOG and/or XBOX_PLUGIN_BUTTONS
+    uint32_t state_size;        // Bytes of state the host reserves (may be 0)
+
+    // config is the text after ':' in `--plugin FILE:CONFIG` ("" if none).
+    // Returns 0 on success; anything else and the plugin is not loaded.
+    int (*init)(void *state, const char *config);
+
+    // frames[0..count-1], oldest first, rewritten in place
+    void (*process_batch)(void *state, XboxPluginFrame *frames, uint32_t count);
+
+    // May be NULL. The state block is released by the host afterwards.
+    void (*destroy)(void *state);
+} XboxPlugin;
+
+// The one exported symbol. host_abi_version lets a plugin that supports
+// several versions pick the matching descriptor; NULL refuses to load.
+typedef const XboxPlugin *(*XboxPluginEntry)(uint32_t host_abi_version);
+
+#endif // XBOX_PLUGIN_H